@@ -0,0 +1,137 @@
+/***************************************************************************
+  qgscompactgraph.cpp
+  --------------------------------------
+  Date                 : October 2020
+  Copyright            : (C) 2020 by agent
+  Email                : agent at local
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include "qgscompactgraph.h"
+#include "qgsgraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+QgsCompactGraph::QgsCompactGraph( const QgsGraph &graph )
+{
+  const int vertexCount = graph.vertexCount();
+  const int edgeCount = graph.edgeCount();
+
+  int strategyCount = 0;
+  for ( int i = 0; i < edgeCount; ++i )
+    strategyCount = std::max( strategyCount, graph.edge( i ).strategies().size() );
+
+  mPoints.reserve( vertexCount );
+  mEdgeFrom.resize( edgeCount );
+  mEdgeTo.resize( edgeCount );
+  mEdgeOutPosition.resize( edgeCount );
+  mOutOffsets.reserve( vertexCount + 1 );
+  mOutTargets.reserve( edgeCount );
+  mOutEdges.reserve( edgeCount );
+  mOutCosts.assign( strategyCount, std::vector< double >() );
+  for ( std::vector< double > &costs : mOutCosts )
+    costs.reserve( edgeCount );
+
+  // outgoing edges, keeping the order of QgsGraph so that ties are resolved the same way
+  for ( int vertexIdx = 0; vertexIdx < vertexCount; ++vertexIdx )
+  {
+    const QgsGraphVertex &vertex = graph.vertex( vertexIdx );
+    mPoints.emplace_back( vertex.point() );
+    mOutOffsets.push_back( static_cast< int >( mOutTargets.size() ) );
+
+    const QgsGraphEdgeIds outgoingEdges = vertex.outgoingEdges();
+    for ( int edgeIdx : outgoingEdges )
+    {
+      const QgsGraphEdge &edge = graph.edge( edgeIdx );
+      const QVector< QVariant > strategies = edge.strategies();
+
+      mEdgeFrom[ edgeIdx ] = vertexIdx;
+      mEdgeTo[ edgeIdx ] = edge.toVertex();
+      mEdgeOutPosition[ edgeIdx ] = static_cast< int >( mOutTargets.size() );
+      mOutTargets.push_back( edge.toVertex() );
+      mOutEdges.push_back( edgeIdx );
+      for ( int strategy = 0; strategy < strategyCount; ++strategy )
+        mOutCosts[ strategy ].push_back( strategies.value( strategy ).toDouble() );
+    }
+  }
+  mOutOffsets.push_back( static_cast< int >( mOutTargets.size() ) );
+
+  // incoming edges
+  mInOffsets.reserve( vertexCount + 1 );
+  mInSources.reserve( edgeCount );
+  mInEdges.reserve( edgeCount );
+  mInCosts.assign( strategyCount, std::vector< double >() );
+  for ( std::vector< double > &costs : mInCosts )
+    costs.reserve( edgeCount );
+
+  for ( int vertexIdx = 0; vertexIdx < vertexCount; ++vertexIdx )
+  {
+    mInOffsets.push_back( static_cast< int >( mInSources.size() ) );
+
+    const QgsGraphEdgeIds incomingEdges = graph.vertex( vertexIdx ).incomingEdges();
+    for ( int edgeIdx : incomingEdges )
+    {
+      mInSources.push_back( mEdgeFrom[ edgeIdx ] );
+      mInEdges.push_back( edgeIdx );
+      for ( int strategy = 0; strategy < strategyCount; ++strategy )
+        mInCosts[ strategy ].push_back( mOutCosts[ strategy ][ mEdgeOutPosition[ edgeIdx ] ] );
+    }
+  }
+  mInOffsets.push_back( static_cast< int >( mInSources.size() ) );
+
+  // lower bound of the cost per distance unit, for the A* heuristic
+  mMinimumCostPerDistance.assign( strategyCount, 0.0 );
+  for ( int strategy = 0; strategy < strategyCount; ++strategy )
+  {
+    double minimum = std::numeric_limits< double >::infinity();
+    for ( int edgeIdx = 0; edgeIdx < edgeCount; ++edgeIdx )
+    {
+      const double cost = mOutCosts[ strategy ][ mEdgeOutPosition[ edgeIdx ] ];
+      const double distance = std::sqrt( mPoints[ mEdgeFrom[ edgeIdx ] ].sqrDist( mPoints[ mEdgeTo[ edgeIdx ] ] ) );
+      if ( cost < 0 || !std::isfinite( cost ) )
+      {
+        minimum = 0;
+        break;
+      }
+      if ( distance > 0 )
+        minimum = std::min( minimum, cost / distance );
+    }
+    // keep a small margin, so that rounding errors cannot make the heuristic overestimate costs
+    mMinimumCostPerDistance[ strategy ] = std::isfinite( minimum ) ? minimum * ( 1 - 1e-9 ) : 0.0;
+  }
+}
+
+QgsPointXY QgsCompactGraph::vertexPoint( int vertexIdx ) const
+{
+  return mPoints[ vertexIdx ];
+}
+
+int QgsCompactGraph::edgeFromVertex( int edgeIdx ) const
+{
+  return mEdgeFrom[ edgeIdx ];
+}
+
+int QgsCompactGraph::edgeToVertex( int edgeIdx ) const
+{
+  return mEdgeTo[ edgeIdx ];
+}
+
+double QgsCompactGraph::edgeCost( int edgeIdx, int strategyIndex ) const
+{
+  return mOutCosts[ strategyIndex ][ mEdgeOutPosition[ edgeIdx ] ];
+}
+
+double QgsCompactGraph::minimumCostPerDistance( int strategyIndex ) const
+{
+  if ( strategyIndex < 0 || strategyIndex >= strategyCount() )
+    return 0;
+  return mMinimumCostPerDistance[ strategyIndex ];
+}
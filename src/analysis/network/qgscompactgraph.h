@@ -0,0 +1,128 @@
+/***************************************************************************
+  qgscompactgraph.h
+  --------------------------------------
+  Date                 : October 2020
+  Copyright            : (C) 2020 by agent
+  Email                : agent at local
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCOMPACTGRAPH_H
+#define QGSCOMPACTGRAPH_H
+
+#include <vector>
+
+#include "qgspointxy.h"
+#include "qgis_analysis.h"
+
+class QgsGraph;
+
+/**
+ * \ingroup analysis
+ * \class QgsCompactGraph
+ * \brief Read only copy of a QgsGraph, stored in flat arrays for fast shortest path computations.
+ *
+ * Outgoing and incoming edges of all vertices are stored in compressed sparse row (CSR) arrays,
+ * and edge costs are converted once to plain double values, with one array per strategy.
+ * This avoids the per edge allocations and QVariant conversions of QgsGraph when running
+ * QgsGraphAnalyzer algorithms on large networks.
+ *
+ * Vertex and edge indices are the same as in the QgsGraph the compact graph was built from.
+ *
+ * \see QgsGraphBuilder::compactGraph()
+ * \since QGIS 3.18
+ */
+class ANALYSIS_EXPORT QgsCompactGraph
+{
+  public:
+
+    /**
+     * Constructor for an empty QgsCompactGraph.
+     */
+    QgsCompactGraph() = default;
+
+    /**
+     * Creates a compact copy of a \a graph.
+     *
+     * Edge costs which cannot be converted to a number are considered to be 0.
+     */
+    explicit QgsCompactGraph( const QgsGraph &graph );
+
+    /**
+     * Returns number of graph vertices
+     */
+    int vertexCount() const { return static_cast< int >( mPoints.size() ); }
+
+    /**
+     * Returns number of graph edges
+     */
+    int edgeCount() const { return static_cast< int >( mEdgeFrom.size() ); }
+
+    /**
+     * Returns the number of cost strategies of the edges
+     */
+    int strategyCount() const { return static_cast< int >( mOutCosts.size() ); }
+
+    /**
+     * Returns the point associated with the vertex at index \a vertexIdx.
+     */
+    QgsPointXY vertexPoint( int vertexIdx ) const;
+
+    /**
+     * Returns the index of the vertex at the start of the edge at index \a edgeIdx.
+     */
+    int edgeFromVertex( int edgeIdx ) const;
+
+    /**
+     * Returns the index of the vertex at the end of the edge at index \a edgeIdx.
+     */
+    int edgeToVertex( int edgeIdx ) const;
+
+    /**
+     * Returns the cost of the edge at index \a edgeIdx for the given strategy.
+     */
+    double edgeCost( int edgeIdx, int strategyIndex ) const;
+
+    /**
+     * Returns the lowest ratio between the cost of an edge and the straight line distance
+     * between its vertices, for the given strategy.
+     *
+     * Multiplied by the straight line distance between two vertices, this gives a lower bound
+     * of the cost of any path between them, which is used as the heuristic of the A* algorithm.
+     * Returns 0 if no such bound is known, e.g. when some edges have a negative cost.
+     */
+    double minimumCostPerDistance( int strategyIndex ) const;
+
+  private:
+
+    std::vector< QgsPointXY > mPoints;
+
+    std::vector< int > mEdgeFrom;
+    std::vector< int > mEdgeTo;
+    //! Position of each edge in the outgoing arrays
+    std::vector< int > mEdgeOutPosition;
+
+    //! Position of the first outgoing edge of each vertex, plus the total edge count
+    std::vector< int > mOutOffsets;
+    std::vector< int > mOutTargets;
+    std::vector< int > mOutEdges;
+    std::vector< std::vector< double > > mOutCosts;
+
+    //! Position of the first incoming edge of each vertex, plus the total edge count
+    std::vector< int > mInOffsets;
+    std::vector< int > mInSources;
+    std::vector< int > mInEdges;
+    std::vector< std::vector< double > > mInCosts;
+
+    std::vector< double > mMinimumCostPerDistance;
+
+    friend class QgsGraphAnalyzer;
+};
+
+#endif // QGSCOMPACTGRAPH_H
@@ -0,0 +1,869 @@
+/***************************************************************************
+  qgscontractionhierarchy.cpp
+  --------------------------------------
+  Date                 : October 2020
+  Copyright            : (C) 2020 by agent
+  Email                : agent at local
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include "qgscontractionhierarchy.h"
+#include "qgscompactgraph.h"
+#include "qgsfeedback.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QObject>
+#include <QSharedData>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+///@cond PRIVATE
+
+static const char HIERARCHY_MAGIC[] = "QGSCHIER";
+static const quint32 HIERARCHY_VERSION = 1;
+
+//! Maximum number of vertices settled by a witness search, before assuming that a shortcut is required
+static const int MAX_WITNESS_SETTLED_VERTICES = 500;
+
+//! Binary heap of vertices by cost. Entries are not updated when a vertex cost decreases: outdated entries are skipped when popped.
+typedef std::pair< double, int > QgsGraphQueueEntry;
+typedef std::priority_queue< QgsGraphQueueEntry, std::vector< QgsGraphQueueEntry >, std::greater< QgsGraphQueueEntry > > QgsGraphVertexQueue;
+
+class QgsContractionHierarchyPrivate : public QSharedData
+{
+  public:
+
+    QgsContractionHierarchyPrivate() = default;
+    QgsContractionHierarchyPrivate( const QgsContractionHierarchyPrivate &other ) = default;
+
+    //! Fills the search arrays from the edge table and the upward and downward edge lists
+    void buildSearchArrays();
+
+    //! Runs a point to point query, optionally returning the path as original edge indices
+    double query( int startVertexIdx, int endVertexIdx, QVector< int > *path ) const;
+
+    //! Appends the original edges represented by the hierarchy edge \a edge to \a path
+    void unpackEdge( int edge, QVector< int > &path ) const;
+
+    //! Returns all the vertices reached by an upward search from \a vertex, with their costs
+    std::vector< std::pair< int, double > > searchSpace( int vertex, bool forward ) const;
+
+    bool mValid = false;
+    QByteArray mFingerprint;
+    int mVertexCount = 0;
+    int mStrategyIndex = -1;
+    int mShortcutCount = 0;
+
+    // hierarchy edges: original edges keep their index in the graph, shortcuts replace two child edges
+    std::vector< int > mEdgeFrom;
+    std::vector< int > mEdgeTo;
+    std::vector< double > mEdgeCost;
+    std::vector< int > mEdgeOriginal;
+    std::vector< int > mEdgeChild1;
+    std::vector< int > mEdgeChild2;
+
+    //! Edges from each vertex to vertices contracted after it, in CSR layout
+    std::vector< int > mUpOffsets;
+    std::vector< int > mUpEdges;
+    //! Edges to each vertex from vertices contracted after it, in CSR layout
+    std::vector< int > mDownOffsets;
+    std::vector< int > mDownEdges;
+
+    // copies of the edge ends and costs in CSR order, for cache friendly searches
+    std::vector< int > mUpTargets;
+    std::vector< double > mUpCosts;
+    std::vector< int > mDownSources;
+    std::vector< double > mDownCosts;
+};
+
+/**
+ * Dijkstra search restricted to the edges leading to higher vertices of the hierarchy.
+ *
+ * Search spaces are small, so vertex labels are kept in a hash map instead of arrays sized on the whole graph.
+ */
+class QgsContractionHierarchySearch
+{
+  public:
+
+    QgsContractionHierarchySearch( const QgsContractionHierarchyPrivate &hierarchy, bool forward, int startVertex )
+      : mOffsets( forward ? hierarchy.mUpOffsets.data() : hierarchy.mDownOffsets.data() )
+      , mNeighbors( forward ? hierarchy.mUpTargets.data() : hierarchy.mDownSources.data() )
+      , mCosts( forward ? hierarchy.mUpCosts.data() : hierarchy.mDownCosts.data() )
+      , mEdges( forward ? hierarchy.mUpEdges.data() : hierarchy.mDownEdges.data() )
+    {
+      mLabels[ startVertex ] = Label( 0.0, -1 );
+      mQueue.push( QgsGraphQueueEntry( 0.0, startVertex ) );
+    }
+
+    //! Cost and hierarchy edge of the best path found to a vertex
+    typedef std::pair< double, int > Label;
+
+    //! Removes outdated entries from the top of the queue, returns FALSE if the queue is empty
+    bool cleanTop()
+    {
+      while ( !mQueue.empty() && mQueue.top().first > mLabels.at( mQueue.top().second ).first )
+        mQueue.pop();
+      return !mQueue.empty();
+    }
+
+    //! Returns the lowest cost in the queue, which must not be empty
+    double topCost() const { return mQueue.top().first; }
+
+    //! Settles the vertex at the top of the queue, which must not be empty, and returns it
+    QgsGraphQueueEntry settleNext()
+    {
+      const QgsGraphQueueEntry entry = mQueue.top();
+      mQueue.pop();
+
+      const int vertex = entry.second;
+      for ( int position = mOffsets[ vertex ]; position < mOffsets[ vertex + 1 ]; ++position )
+      {
+        const double cost = entry.first + mCosts[ position ];
+        const auto inserted = mLabels.emplace( mNeighbors[ position ], Label( cost, mEdges[ position ] ) );
+        if ( inserted.second || cost < inserted.first->second.first )
+        {
+          inserted.first->second = Label( cost, mEdges[ position ] );
+          mQueue.push( QgsGraphQueueEntry( cost, mNeighbors[ position ] ) );
+        }
+      }
+      return entry;
+    }
+
+    const std::unordered_map< int, Label > &labels() const { return mLabels; }
+
+  private:
+
+    const int *mOffsets = nullptr;
+    const int *mNeighbors = nullptr;
+    const double *mCosts = nullptr;
+    const int *mEdges = nullptr;
+    std::unordered_map< int, Label > mLabels;
+    QgsGraphVertexQueue mQueue;
+};
+
+/**
+ * Contracts the vertices of a graph, filling the edge table and edge lists of a hierarchy.
+ */
+class QgsContractionHierarchyBuilder
+{
+  public:
+
+    QgsContractionHierarchyBuilder( const QgsCompactGraph &graph, int strategyIndex, QgsContractionHierarchyPrivate &result );
+
+    //! Contracts all the vertices, returns FALSE if canceled
+    bool run( QgsFeedback *feedback );
+
+  private:
+
+    //! Adds an edge to the table of the hierarchy, returns its index
+    int addEdge( int from, int to, double cost, int original, int child1, int child2 );
+
+    //! Adds an edge between two remaining vertices, unless a cheaper one already exists
+    void insertEdge( int from, int to, double cost, int original, int child1, int child2 );
+
+    //! Contracts \a vertex, or only counts the shortcuts this would add if \a simulate is TRUE
+    int contract( int vertex, bool simulate );
+
+    //! Returns the contraction priority of a vertex, lower values are contracted first
+    int priority( int vertex );
+
+    //! Runs a limited Dijkstra search from \a source among the remaining vertices, ignoring \a excludedVertex
+    void witnessSearch( int source, int excludedVertex, double maxCost );
+
+    QgsContractionHierarchyPrivate &mResult;
+
+    //! Outgoing and incoming hierarchy edges of each vertex, among remaining vertices until the vertex is contracted
+    std::vector< std::vector< int > > mOut;
+    std::vector< std::vector< int > > mIn;
+    std::vector< int > mContractedNeighbors;
+
+    std::vector< double > mWitnessCosts;
+    std::vector< int > mWitnessTouched;
+};
+
+QgsContractionHierarchyBuilder::QgsContractionHierarchyBuilder( const QgsCompactGraph &graph, int strategyIndex, QgsContractionHierarchyPrivate &result )
+  : mResult( result )
+{
+  const int vertexCount = graph.vertexCount();
+  mOut.resize( vertexCount );
+  mIn.resize( vertexCount );
+  mContractedNeighbors.assign( vertexCount, 0 );
+  mWitnessCosts.assign( vertexCount, std::numeric_limits<double>::infinity() );
+
+  for ( int edgeIdx = 0; edgeIdx < graph.edgeCount(); ++edgeIdx )
+  {
+    const int from = graph.edgeFromVertex( edgeIdx );
+    const int to = graph.edgeToVertex( edgeIdx );
+    const double cost = graph.edgeCost( edgeIdx, strategyIndex );
+    // self loops are never part of a shortest path
+    if ( from == to || cost < 0 || !std::isfinite( cost ) )
+      continue;
+
+    insertEdge( from, to, cost, edgeIdx, -1, -1 );
+  }
+}
+
+int QgsContractionHierarchyBuilder::addEdge( int from, int to, double cost, int original, int child1, int child2 )
+{
+  mResult.mEdgeFrom.push_back( from );
+  mResult.mEdgeTo.push_back( to );
+  mResult.mEdgeCost.push_back( cost );
+  mResult.mEdgeOriginal.push_back( original );
+  mResult.mEdgeChild1.push_back( child1 );
+  mResult.mEdgeChild2.push_back( child2 );
+  return static_cast< int >( mResult.mEdgeFrom.size() ) - 1;
+}
+
+void QgsContractionHierarchyBuilder::insertEdge( int from, int to, double cost, int original, int child1, int child2 )
+{
+  for ( int &existing : mOut[ from ] )
+  {
+    if ( mResult.mEdgeTo[ existing ] != to )
+      continue;
+
+    // parallel edges: only the cheapest one is kept, a replaced edge stays in the table as it may be the child of a shortcut
+    if ( cost >= mResult.mEdgeCost[ existing ] )
+      return;
+
+    const int replaced = existing;
+    existing = addEdge( from, to, cost, original, child1, child2 );
+    std::replace( mIn[ to ].begin(), mIn[ to ].end(), replaced, existing );
+    return;
+  }
+
+  const int edge = addEdge( from, to, cost, original, child1, child2 );
+  mOut[ from ].push_back( edge );
+  mIn[ to ].push_back( edge );
+}
+
+void QgsContractionHierarchyBuilder::witnessSearch( int source, int excludedVertex, double maxCost )
+{
+  for ( int vertex : mWitnessTouched )
+    mWitnessCosts[ vertex ] = std::numeric_limits<double>::infinity();
+  mWitnessTouched.clear();
+
+  mWitnessCosts[ source ] = 0.0;
+  mWitnessTouched.push_back( source );
+
+  QgsGraphVertexQueue queue;
+  queue.push( QgsGraphQueueEntry( 0.0, source ) );
+  int settledCount = 0;
+  while ( !queue.empty() && settledCount < MAX_WITNESS_SETTLED_VERTICES )
+  {
+    const QgsGraphQueueEntry entry = queue.top();
+    queue.pop();
+    if ( entry.first > mWitnessCosts[ entry.second ] )
+      continue;
+    if ( entry.first > maxCost )
+      break;
+
+    settledCount++;
+    for ( int edge : mOut[ entry.second ] )
+    {
+      const int toVertex = mResult.mEdgeTo[ edge ];
+      if ( toVertex == excludedVertex )
+        continue;
+
+      const double cost = entry.first + mResult.mEdgeCost[ edge ];
+      if ( cost < mWitnessCosts[ toVertex ] )
+      {
+        if ( std::isinf( mWitnessCosts[ toVertex ] ) )
+          mWitnessTouched.push_back( toVertex );
+        mWitnessCosts[ toVertex ] = cost;
+        queue.push( QgsGraphQueueEntry( cost, toVertex ) );
+      }
+    }
+  }
+}
+
+int QgsContractionHierarchyBuilder::contract( int vertex, bool simulate )
+{
+  double maxOutCost = 0;
+  for ( int outEdge : mOut[ vertex ] )
+    maxOutCost = std::max( maxOutCost, mResult.mEdgeCost[ outEdge ] );
+
+  int shortcutCount = 0;
+  for ( int inEdge : mIn[ vertex ] )
+  {
+    const int fromVertex = mResult.mEdgeFrom[ inEdge ];
+    const double inCost = mResult.mEdgeCost[ inEdge ];
+    witnessSearch( fromVertex, vertex, inCost + maxOutCost );
+
+    for ( int outEdge : mOut[ vertex ] )
+    {
+      const int toVertex = mResult.mEdgeTo[ outEdge ];
+      if ( toVertex == fromVertex )
+        continue;
+
+      // a shortcut is only needed when the path through the vertex is the only shortest one
+      const double viaCost = inCost + mResult.mEdgeCost[ outEdge ];
+      if ( mWitnessCosts[ toVertex ] <= viaCost )
+        continue;
+
+      shortcutCount++;
+      if ( !simulate )
+      {
+        insertEdge( fromVertex, toVertex, viaCost, -1, inEdge, outEdge );
+        mResult.mShortcutCount++;
+      }
+    }
+  }
+  return shortcutCount;
+}
+
+int QgsContractionHierarchyBuilder::priority( int vertex )
+{
+  // edge difference, plus contracted neighbors to spread the contraction uniformly over the graph
+  const int edgeDifference = contract( vertex, true ) - static_cast< int >( mIn[ vertex ].size() + mOut[ vertex ].size() );
+  return edgeDifference + mContractedNeighbors[ vertex ];
+}
+
+bool QgsContractionHierarchyBuilder::run( QgsFeedback *feedback )
+{
+  const int vertexCount = static_cast< int >( mOut.size() );
+
+  typedef std::pair< int, int > PriorityEntry;
+  std::priority_queue< PriorityEntry, std::vector< PriorityEntry >, std::greater< PriorityEntry > > queue;
+  for ( int vertex = 0; vertex < vertexCount; ++vertex )
+  {
+    if ( feedback && vertex % 1000 == 0 )
+    {
+      if ( feedback->isCanceled() )
+        return false;
+      feedback->setProgress( 10.0 * vertex / vertexCount );
+    }
+    queue.push( PriorityEntry( priority( vertex ), vertex ) );
+  }
+
+  int contractedCount = 0;
+  while ( !queue.empty() )
+  {
+    const int vertex = queue.top().second;
+    queue.pop();
+
+    // priorities are updated lazily: postpone the vertex if it is no longer the best candidate
+    const int currentPriority = priority( vertex );
+    if ( !queue.empty() && currentPriority > queue.top().first )
+    {
+      queue.push( PriorityEntry( currentPriority, vertex ) );
+      continue;
+    }
+
+    contract( vertex, false );
+
+    // the remaining edges of the vertex lead to higher vertices of the hierarchy, remove them from the neighbors
+    for ( int inEdge : mIn[ vertex ] )
+    {
+      const int fromVertex = mResult.mEdgeFrom[ inEdge ];
+      std::vector< int > &edges = mOut[ fromVertex ];
+      edges.erase( std::remove_if( edges.begin(), edges.end(), [this, vertex]( int edge ) { return mResult.mEdgeTo[ edge ] == vertex; } ), edges.end() );
+      mContractedNeighbors[ fromVertex ]++;
+    }
+    for ( int outEdge : mOut[ vertex ] )
+    {
+      const int toVertex = mResult.mEdgeTo[ outEdge ];
+      std::vector< int > &edges = mIn[ toVertex ];
+      edges.erase( std::remove_if( edges.begin(), edges.end(), [this, vertex]( int edge ) { return mResult.mEdgeFrom[ edge ] == vertex; } ), edges.end() );
+      mContractedNeighbors[ toVertex ]++;
+    }
+
+    contractedCount++;
+    if ( feedback && contractedCount % 1000 == 0 )
+    {
+      if ( feedback->isCanceled() )
+        return false;
+      feedback->setProgress( 10.0 + 90.0 * contractedCount / vertexCount );
+    }
+  }
+
+  // edge lists of contracted vertices are left untouched, they become the upward and downward edges
+  mResult.mUpOffsets.reserve( vertexCount + 1 );
+  mResult.mDownOffsets.reserve( vertexCount + 1 );
+  for ( int vertex = 0; vertex < vertexCount; ++vertex )
+  {
+    mResult.mUpOffsets.push_back( static_cast< int >( mResult.mUpEdges.size() ) );
+    mResult.mUpEdges.insert( mResult.mUpEdges.end(), mOut[ vertex ].begin(), mOut[ vertex ].end() );
+    mResult.mDownOffsets.push_back( static_cast< int >( mResult.mDownEdges.size() ) );
+    mResult.mDownEdges.insert( mResult.mDownEdges.end(), mIn[ vertex ].begin(), mIn[ vertex ].end() );
+  }
+  mResult.mUpOffsets.push_back( static_cast< int >( mResult.mUpEdges.size() ) );
+  mResult.mDownOffsets.push_back( static_cast< int >( mResult.mDownEdges.size() ) );
+  return true;
+}
+
+void QgsContractionHierarchyPrivate::buildSearchArrays()
+{
+  mUpTargets.resize( mUpEdges.size() );
+  mUpCosts.resize( mUpEdges.size() );
+  for ( std::size_t i = 0; i < mUpEdges.size(); ++i )
+  {
+    mUpTargets[ i ] = mEdgeTo[ mUpEdges[ i ] ];
+    mUpCosts[ i ] = mEdgeCost[ mUpEdges[ i ] ];
+  }
+
+  mDownSources.resize( mDownEdges.size() );
+  mDownCosts.resize( mDownEdges.size() );
+  for ( std::size_t i = 0; i < mDownEdges.size(); ++i )
+  {
+    mDownSources[ i ] = mEdgeFrom[ mDownEdges[ i ] ];
+    mDownCosts[ i ] = mEdgeCost[ mDownEdges[ i ] ];
+  }
+}
+
+double QgsContractionHierarchyPrivate::query( int startVertexIdx, int endVertexIdx, QVector<int> *path ) const
+{
+  if ( startVertexIdx == endVertexIdx )
+    return 0.0;
+
+  QgsContractionHierarchySearch forward( *this, true, startVertexIdx );
+  QgsContractionHierarchySearch backward( *this, false, endVertexIdx );
+
+  double bestCost = std::numeric_limits<double>::infinity();
+  int meetingVertex = -1;
+  while ( true )
+  {
+    // each search stops once it cannot improve the best path found so far
+    const bool forwardActive = forward.cleanTop() && forward.topCost() < bestCost;
+    const bool backwardActive = backward.cleanTop() && backward.topCost() < bestCost;
+    if ( !forwardActive && !backwardActive )
+      break;
+
+    const bool expandForward = forwardActive && ( !backwardActive || forward.topCost() <= backward.topCost() );
+    QgsContractionHierarchySearch &search = expandForward ? forward : backward;
+    const QgsContractionHierarchySearch &other = expandForward ? backward : forward;
+
+    const QgsGraphQueueEntry entry = search.settleNext();
+    const auto it = other.labels().find( entry.second );
+    if ( it != other.labels().end() && entry.first + it->second.first < bestCost )
+    {
+      bestCost = entry.first + it->second.first;
+      meetingVertex = entry.second;
+    }
+  }
+
+  if ( meetingVertex == -1 || !path )
+    return bestCost;
+
+  std::vector< int > forwardEdges;
+  for ( int vertex = meetingVertex; vertex != startVertexIdx; vertex = mEdgeFrom[ forwardEdges.back() ] )
+    forwardEdges.push_back( forward.labels().at( vertex ).second );
+  for ( auto it = forwardEdges.rbegin(); it != forwardEdges.rend(); ++it )
+    unpackEdge( *it, *path );
+
+  for ( int vertex = meetingVertex; vertex != endVertexIdx; )
+  {
+    const int edge = backward.labels().at( vertex ).second;
+    unpackEdge( edge, *path );
+    vertex = mEdgeTo[ edge ];
+  }
+  return bestCost;
+}
+
+void QgsContractionHierarchyPrivate::unpackEdge( int edge, QVector<int> &path ) const
+{
+  std::vector< int > stack( 1, edge );
+  while ( !stack.empty() )
+  {
+    const int current = stack.back();
+    stack.pop_back();
+    if ( mEdgeOriginal[ current ] >= 0 )
+    {
+      path.append( mEdgeOriginal[ current ] );
+    }
+    else
+    {
+      stack.push_back( mEdgeChild2[ current ] );
+      stack.push_back( mEdgeChild1[ current ] );
+    }
+  }
+}
+
+std::vector< std::pair< int, double > > QgsContractionHierarchyPrivate::searchSpace( int vertex, bool forward ) const
+{
+  std::vector< std::pair< int, double > > result;
+  if ( vertex < 0 || vertex >= mVertexCount )
+    return result;
+
+  QgsContractionHierarchySearch search( *this, forward, vertex );
+  while ( search.cleanTop() )
+  {
+    const QgsGraphQueueEntry entry = search.settleNext();
+    result.emplace_back( entry.second, entry.first );
+  }
+  return result;
+}
+
+template <typename T>
+static void addHashValue( QCryptographicHash &hash, T value )
+{
+  hash.addData( reinterpret_cast< const char * >( &value ), sizeof( value ) );
+}
+
+///@endcond
+
+QgsContractionHierarchy::QgsContractionHierarchy()
+  : d( new QgsContractionHierarchyPrivate() )
+{
+}
+
+QgsContractionHierarchy::QgsContractionHierarchy( const QgsContractionHierarchy &other ) = default;
+
+QgsContractionHierarchy &QgsContractionHierarchy::operator=( const QgsContractionHierarchy &other ) = default;
+
+QgsContractionHierarchy::~QgsContractionHierarchy() = default;
+
+QgsContractionHierarchy QgsContractionHierarchy::build( const QgsCompactGraph &graph, int strategyIndex, QgsFeedback *feedback )
+{
+  if ( strategyIndex < 0 || strategyIndex >= graph.strategyCount() )
+    return QgsContractionHierarchy();
+
+  QgsContractionHierarchy hierarchy;
+  QgsContractionHierarchyPrivate *hierarchyData = hierarchy.d.data();
+  hierarchyData->mVertexCount = graph.vertexCount();
+  hierarchyData->mStrategyIndex = strategyIndex;
+
+  QgsContractionHierarchyBuilder builder( graph, strategyIndex, *hierarchyData );
+  if ( !builder.run( feedback ) )
+    return QgsContractionHierarchy();
+
+  hierarchyData->buildSearchArrays();
+  hierarchyData->mFingerprint = graphFingerprint( graph, strategyIndex );
+  hierarchyData->mValid = true;
+  return hierarchy;
+}
+
+QByteArray QgsContractionHierarchy::graphFingerprint( const QgsCompactGraph &graph, int strategyIndex )
+{
+  if ( strategyIndex < 0 || strategyIndex >= graph.strategyCount() )
+    return QByteArray();
+
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+  addHashValue( hash, HIERARCHY_VERSION );
+  addHashValue( hash, graph.vertexCount() );
+  addHashValue( hash, graph.edgeCount() );
+  for ( int vertexIdx = 0; vertexIdx < graph.vertexCount(); ++vertexIdx )
+  {
+    const QgsPointXY point = graph.vertexPoint( vertexIdx );
+    addHashValue( hash, point.x() );
+    addHashValue( hash, point.y() );
+  }
+  for ( int edgeIdx = 0; edgeIdx < graph.edgeCount(); ++edgeIdx )
+  {
+    addHashValue( hash, graph.edgeFromVertex( edgeIdx ) );
+    addHashValue( hash, graph.edgeToVertex( edgeIdx ) );
+    addHashValue( hash, graph.edgeCost( edgeIdx, strategyIndex ) );
+  }
+  return hash.result();
+}
+
+bool QgsContractionHierarchy::isValid() const
+{
+  return d->mValid;
+}
+
+QByteArray QgsContractionHierarchy::fingerprint() const
+{
+  return d->mFingerprint;
+}
+
+int QgsContractionHierarchy::vertexCount() const
+{
+  return d->mVertexCount;
+}
+
+int QgsContractionHierarchy::strategyIndex() const
+{
+  return d->mStrategyIndex;
+}
+
+int QgsContractionHierarchy::shortcutCount() const
+{
+  return d->mShortcutCount;
+}
+
+QVector<int> QgsContractionHierarchy::shortestPath( int startVertexIdx, int endVertexIdx, double *cost ) const
+{
+  QVector< int > path;
+  double pathCost = std::numeric_limits<double>::infinity();
+  if ( d->mValid && startVertexIdx >= 0 && startVertexIdx < d->mVertexCount && endVertexIdx >= 0 && endVertexIdx < d->mVertexCount )
+    pathCost = d->query( startVertexIdx, endVertexIdx, &path );
+
+  if ( cost )
+    *cost = pathCost;
+  return path;
+}
+
+double QgsContractionHierarchy::shortestPathCost( int startVertexIdx, int endVertexIdx ) const
+{
+  if ( !d->mValid || startVertexIdx < 0 || startVertexIdx >= d->mVertexCount || endVertexIdx < 0 || endVertexIdx >= d->mVertexCount )
+    return std::numeric_limits<double>::infinity();
+
+  return d->query( startVertexIdx, endVertexIdx, nullptr );
+}
+
+QVector<QVector<double> > QgsContractionHierarchy::costMatrix( const QVector<int> &sources, const QVector<int> &targets, QgsFeedback *feedback ) const
+{
+  QVector< QVector< double > > matrix( sources.size(), QVector< double >( targets.size(), std::numeric_limits<double>::infinity() ) );
+  if ( !d->mValid || sources.isEmpty() || targets.isEmpty() )
+    return matrix;
+
+  const QgsContractionHierarchyPrivate *hierarchy = d.constData();
+
+  // backward searches from all the targets, the costs of their search spaces are stored in buckets on the reached vertices
+  struct TargetJob
+  {
+    int vertex;
+    std::vector< std::pair< int, double > > searchSpace;
+  };
+  QVector< TargetJob > targetJobs;
+  targetJobs.reserve( targets.size() );
+  for ( int target : targets )
+    targetJobs.append( TargetJob { target, std::vector< std::pair< int, double > >() } );
+
+  QtConcurrent::blockingMap( targetJobs, [hierarchy]( TargetJob & job )
+  {
+    job.searchSpace = hierarchy->searchSpace( job.vertex, false );
+  } );
+
+  if ( feedback && feedback->isCanceled() )
+    return matrix;
+
+  std::unordered_map< int, std::vector< std::pair< int, double > > > buckets;
+  for ( int column = 0; column < targetJobs.size(); ++column )
+  {
+    for ( const std::pair< int, double > &reached : targetJobs.at( column ).searchSpace )
+      buckets[ reached.first ].emplace_back( column, reached.second );
+  }
+  targetJobs.clear();
+
+  // forward searches from the sources meet the backward search spaces on the highest vertex of each shortest path
+  struct SourceJob
+  {
+    int vertex;
+    QVector< double > costs;
+  };
+  QVector< SourceJob > sourceJobs;
+  sourceJobs.reserve( sources.size() );
+  for ( int source : sources )
+    sourceJobs.append( SourceJob { source, QVector< double >( targets.size(), std::numeric_limits<double>::infinity() ) } );
+
+  // process the sources in batches, so that progress can be reported and cancellation checked in between
+  const int batchSize = std::max( 64, sourceJobs.size() / 100 );
+  for ( int first = 0; first < sourceJobs.size(); first += batchSize )
+  {
+    if ( feedback && feedback->isCanceled() )
+      break;
+
+    const int last = std::min( first + batchSize, sourceJobs.size() );
+    QtConcurrent::blockingMap( sourceJobs.begin() + first, sourceJobs.begin() + last, [hierarchy, &buckets]( SourceJob & job )
+    {
+      const std::vector< std::pair< int, double > > searchSpace = hierarchy->searchSpace( job.vertex, true );
+      double *costs = job.costs.data();
+      for ( const std::pair< int, double > &reached : searchSpace )
+      {
+        const auto bucket = buckets.find( reached.first );
+        if ( bucket == buckets.end() )
+          continue;
+
+        for ( const std::pair< int, double > &entry : bucket->second )
+          costs[ entry.first ] = std::min( costs[ entry.first ], reached.second + entry.second );
+      }
+    } );
+
+    for ( int row = first; row < last; ++row )
+      matrix[ row ] = sourceJobs.at( row ).costs;
+
+    if ( feedback )
+      feedback->setProgress( 100.0 * last / sourceJobs.size() );
+  }
+
+  return matrix;
+}
+
+bool QgsContractionHierarchy::writeToFile( const QString &path, QString *errorMessage ) const
+{
+  if ( !d->mValid )
+  {
+    if ( errorMessage )
+      *errorMessage = QObject::tr( "Cannot write an invalid contraction hierarchy" );
+    return false;
+  }
+
+  QFile file( path );
+  if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+  {
+    if ( errorMessage )
+      *errorMessage = QObject::tr( "Could not open %1 for writing: %2" ).arg( path, file.errorString() );
+    return false;
+  }
+
+  QDataStream stream( &file );
+  stream.setByteOrder( QDataStream::LittleEndian );
+  stream.writeRawData( HIERARCHY_MAGIC, 8 );
+  stream << HIERARCHY_VERSION;
+  stream << d->mFingerprint;
+  stream << static_cast< qint32 >( d->mVertexCount ) << static_cast< qint32 >( d->mStrategyIndex ) << static_cast< qint32 >( d->mShortcutCount );
+
+  stream << static_cast< quint32 >( d->mEdgeFrom.size() );
+  for ( std::size_t edge = 0; edge < d->mEdgeFrom.size(); ++edge )
+  {
+    stream << static_cast< qint32 >( d->mEdgeFrom[ edge ] ) << static_cast< qint32 >( d->mEdgeTo[ edge ] ) << d->mEdgeCost[ edge ]
+           << static_cast< qint32 >( d->mEdgeOriginal[ edge ] ) << static_cast< qint32 >( d->mEdgeChild1[ edge ] ) << static_cast< qint32 >( d->mEdgeChild2[ edge ] );
+  }
+
+  auto writeArray = [&stream]( const std::vector< int > &values )
+  {
+    stream << static_cast< quint32 >( values.size() );
+    for ( int value : values )
+      stream << static_cast< qint32 >( value );
+  };
+  writeArray( d->mUpOffsets );
+  writeArray( d->mUpEdges );
+  writeArray( d->mDownOffsets );
+  writeArray( d->mDownEdges );
+
+  if ( stream.status() != QDataStream::Ok || !file.flush() )
+  {
+    if ( errorMessage )
+      *errorMessage = QObject::tr( "Could not write contraction hierarchy to %1: %2" ).arg( path, file.errorString() );
+    return false;
+  }
+  return true;
+}
+
+QgsContractionHierarchy QgsContractionHierarchy::fromFile( const QString &path, QString *errorMessage )
+{
+  auto setError = [errorMessage]( const QString & message )
+  {
+    if ( errorMessage )
+      *errorMessage = message;
+  };
+
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+  {
+    setError( QObject::tr( "Could not open %1 for reading: %2" ).arg( path, file.errorString() ) );
+    return QgsContractionHierarchy();
+  }
+
+  QDataStream stream( &file );
+  stream.setByteOrder( QDataStream::LittleEndian );
+
+  char magic[8];
+  if ( stream.readRawData( magic, 8 ) != 8 || memcmp( magic, HIERARCHY_MAGIC, 8 ) != 0 )
+  {
+    setError( QObject::tr( "%1 is not a contraction hierarchy file" ).arg( path ) );
+    return QgsContractionHierarchy();
+  }
+
+  quint32 version = 0;
+  stream >> version;
+  if ( version != HIERARCHY_VERSION )
+  {
+    setError( QObject::tr( "Unsupported contraction hierarchy file version %1" ).arg( version ) );
+    return QgsContractionHierarchy();
+  }
+
+  const QString corruptedError = QObject::tr( "Contraction hierarchy file %1 is corrupted" ).arg( path );
+
+  QgsContractionHierarchy hierarchy;
+  QgsContractionHierarchyPrivate *hierarchyData = hierarchy.d.data();
+
+  qint32 vertexCount = 0;
+  qint32 strategyIndex = 0;
+  qint32 shortcutCount = 0;
+  quint32 edgeCount = 0;
+  stream >> hierarchyData->mFingerprint >> vertexCount >> strategyIndex >> shortcutCount >> edgeCount;
+  // each edge takes 28 bytes
+  if ( stream.status() != QDataStream::Ok || vertexCount < 0 || strategyIndex < 0 || static_cast< qint64 >( edgeCount ) * 28 > file.size() - file.pos() )
+  {
+    setError( corruptedError );
+    return QgsContractionHierarchy();
+  }
+
+  hierarchyData->mVertexCount = vertexCount;
+  hierarchyData->mStrategyIndex = strategyIndex;
+  hierarchyData->mShortcutCount = shortcutCount;
+
+  for ( quint32 edge = 0; edge < edgeCount; ++edge )
+  {
+    qint32 from = 0;
+    qint32 to = 0;
+    double cost = 0;
+    qint32 original = 0;
+    qint32 child1 = 0;
+    qint32 child2 = 0;
+    stream >> from >> to >> cost >> original >> child1 >> child2;
+
+    // children are always created before their shortcut, which guarantees that unpacking paths terminates
+    const bool validChildren = original >= 0 || ( child1 >= 0 && child2 >= 0 && static_cast< quint32 >( child1 ) < edge && static_cast< quint32 >( child2 ) < edge );
+    if ( stream.status() != QDataStream::Ok || from < 0 || from >= vertexCount || to < 0 || to >= vertexCount || !validChildren )
+    {
+      setError( corruptedError );
+      return QgsContractionHierarchy();
+    }
+
+    hierarchyData->mEdgeFrom.push_back( from );
+    hierarchyData->mEdgeTo.push_back( to );
+    hierarchyData->mEdgeCost.push_back( cost );
+    hierarchyData->mEdgeOriginal.push_back( original );
+    hierarchyData->mEdgeChild1.push_back( child1 );
+    hierarchyData->mEdgeChild2.push_back( child2 );
+  }
+
+  auto readArray = [&stream, &file]( std::vector< int > &values, int maxValue ) -> bool
+  {
+    quint32 size = 0;
+    stream >> size;
+    if ( stream.status() != QDataStream::Ok || static_cast< qint64 >( size ) * 4 > file.size() - file.pos() )
+      return false;
+
+    values.resize( size );
+    for ( quint32 i = 0; i < size; ++i )
+    {
+      qint32 value = 0;
+      stream >> value;
+      if ( value < 0 || value > maxValue )
+        return false;
+      values[ i ] = value;
+    }
+    return stream.status() == QDataStream::Ok;
+  };
+  auto validOffsets = []( const std::vector< int > &offsets, int vertexCount, std::size_t edgeCount ) -> bool
+  {
+    return offsets.size() == static_cast< std::size_t >( vertexCount ) + 1 && offsets.front() == 0
+           && static_cast< std::size_t >( offsets.back() ) == edgeCount && std::is_sorted( offsets.begin(), offsets.end() );
+  };
+
+  const int maxEdge = static_cast< int >( edgeCount ) - 1;
+  if ( !readArray( hierarchyData->mUpOffsets, std::numeric_limits< int >::max() )
+       || !readArray( hierarchyData->mUpEdges, maxEdge )
+       || !readArray( hierarchyData->mDownOffsets, std::numeric_limits< int >::max() )
+       || !readArray( hierarchyData->mDownEdges, maxEdge )
+       || !validOffsets( hierarchyData->mUpOffsets, vertexCount, hierarchyData->mUpEdges.size() )
+       || !validOffsets( hierarchyData->mDownOffsets, vertexCount, hierarchyData->mDownEdges.size() ) )
+  {
+    setError( corruptedError );
+    return QgsContractionHierarchy();
+  }
+
+  hierarchyData->buildSearchArrays();
+  hierarchyData->mValid = true;
+  return hierarchy;
+}
@@ -0,0 +1,173 @@
+/***************************************************************************
+  qgscontractionhierarchy.h
+  --------------------------------------
+  Date                 : October 2020
+  Copyright            : (C) 2020 by agent
+  Email                : agent at local
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCONTRACTIONHIERARCHY_H
+#define QGSCONTRACTIONHIERARCHY_H
+
+#include <QByteArray>
+#include <QSharedDataPointer>
+#include <QVector>
+
+#include "qgis_sip.h"
+#include "qgis_analysis.h"
+
+class QgsCompactGraph;
+class QgsFeedback;
+class QgsContractionHierarchyPrivate;
+
+/**
+ * \ingroup analysis
+ * \class QgsContractionHierarchy
+ * \brief Preprocessed version of a QgsCompactGraph, answering repeated shortest path queries
+ * between its vertices much faster than QgsGraphAnalyzer.
+ *
+ * Building the hierarchy contracts the vertices of the graph one by one, from the least to the
+ * most important, adding shortcut edges which preserve the shortest path costs between the remaining
+ * vertices. Queries then only need to search upward in the hierarchy from both ends of the path,
+ * which visits a few hundred vertices even on large road networks.
+ *
+ * A hierarchy is only valid for the graph and the strategy it was built for. Building it is far more
+ * expensive than a single Dijkstra search, so it should be stored with writeToFile() and reused when
+ * the same graph is queried again. The fingerprint() of the graph allows to check whether a stored
+ * hierarchy still matches a graph.
+ *
+ * Queries are read only, so a single QgsContractionHierarchy object can safely be used across multiple threads.
+ *
+ * QgsContractionHierarchy objects are implicitly shared and can be inexpensively copied.
+ *
+ * \since QGIS 3.18
+ */
+class ANALYSIS_EXPORT QgsContractionHierarchy
+{
+  public:
+
+    /**
+     * Constructor for an empty, invalid QgsContractionHierarchy.
+     */
+    QgsContractionHierarchy();
+
+    //! Copy constructor
+    QgsContractionHierarchy( const QgsContractionHierarchy &other );
+
+    //! Assignment operator
+    QgsContractionHierarchy &operator=( const QgsContractionHierarchy &other );
+
+    ~QgsContractionHierarchy();
+
+    /**
+     * Builds the hierarchy of a \a graph, for the strategy at index \a strategyIndex.
+     *
+     * Edges with a negative or non finite cost are ignored.
+     *
+     * The optional \a feedback object can be used to report progress and allow cancellation,
+     * in which case an invalid hierarchy is returned.
+     */
+    static QgsContractionHierarchy build( const QgsCompactGraph &graph, int strategyIndex, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns a hash of the vertices, edges and costs of a \a graph for the strategy at index \a strategyIndex.
+     *
+     * Graphs with the same fingerprint can share the same hierarchy.
+     *
+     * \see fingerprint()
+     */
+    static QByteArray graphFingerprint( const QgsCompactGraph &graph, int strategyIndex );
+
+    /**
+     * Returns TRUE if the hierarchy was successfully built or read.
+     */
+    bool isValid() const;
+
+    /**
+     * Returns the fingerprint of the graph the hierarchy was built from.
+     *
+     * \see graphFingerprint()
+     */
+    QByteArray fingerprint() const;
+
+    /**
+     * Returns the number of vertices of the graph the hierarchy was built from.
+     */
+    int vertexCount() const;
+
+    /**
+     * Returns the index of the strategy the hierarchy was built for.
+     */
+    int strategyIndex() const;
+
+    /**
+     * Returns the number of shortcut edges added when building the hierarchy.
+     */
+    int shortcutCount() const;
+
+    /**
+     * Returns the shortest path between two vertices, as the list of the indices of its edges
+     * in the original graph.
+     *
+     * \param startVertexIdx index of the start vertex
+     * \param endVertexIdx index of the end vertex
+     * \param cost if specified, will be set to the cost of the path, or to infinity if the end vertex cannot be reached
+     *
+     * \returns the indices of the path edges. An empty list is returned if the end vertex cannot be reached,
+     * or if it is the start vertex.
+     */
+    QVector< int > shortestPath( int startVertexIdx, int endVertexIdx, double *cost SIP_OUT = nullptr ) const;
+
+    /**
+     * Returns the cost of the shortest path between two vertices, or infinity if the end vertex cannot be reached.
+     *
+     * This is faster than shortestPath(), as the shortcut edges of the path do not need to be expanded.
+     */
+    double shortestPathCost( int startVertexIdx, int endVertexIdx ) const;
+
+    /**
+     * Returns the costs of the shortest paths from each of the \a sources vertices to each of the \a targets vertices.
+     *
+     * The returned matrix has one row per source vertex and one column per target vertex. Unreachable targets,
+     * as well as invalid vertex indices, have an infinite cost.
+     *
+     * The searches are run in parallel, and each vertex is only searched from once, so this is much faster than
+     * calling shortestPathCost() for every pair of vertices.
+     *
+     * The optional \a feedback object can be used to report progress and allow cancellation, in which case
+     * the rows of the remaining sources are left infinite.
+     */
+    QVector< QVector< double > > costMatrix( const QVector< int > &sources, const QVector< int > &targets, QgsFeedback *feedback = nullptr ) const;
+
+    /**
+     * Writes the hierarchy to the file at \a path.
+     *
+     * Returns FALSE if the file could not be written, in which case \a errorMessage will be set.
+     *
+     * \see fromFile()
+     */
+    bool writeToFile( const QString &path, QString *errorMessage SIP_OUT = nullptr ) const;
+
+    /**
+     * Reads a hierarchy previously written with writeToFile() from the file at \a path.
+     *
+     * If the file cannot be read, an invalid hierarchy is returned and \a errorMessage is set.
+     *
+     * \see writeToFile()
+     */
+    static QgsContractionHierarchy fromFile( const QString &path, QString *errorMessage SIP_OUT = nullptr );
+
+  private:
+
+    QSharedDataPointer< QgsContractionHierarchyPrivate > d;
+
+};
+
+#endif // QGSCONTRACTIONHIERARCHY_H
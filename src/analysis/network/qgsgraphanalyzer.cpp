@@ -13,15 +13,28 @@
 *                                                                          *
 ***************************************************************************/
 
+#include <cmath>
+#include <functional>
 #include <limits>
+#include <queue>
+#include <vector>
 
 #include <QMap>
 #include <QVector>
 #include <QPair>
 
+#include "qgscompactgraph.h"
 #include "qgsgraph.h"
 #include "qgsgraphanalyzer.h"
 
+///@cond PRIVATE
+
+//! Binary heap of vertices by cost. Entries are not updated when a vertex cost decreases: outdated entries are skipped when popped.
+typedef std::pair< double, int > QgsGraphQueueEntry;
+typedef std::priority_queue< QgsGraphQueueEntry, std::vector< QgsGraphQueueEntry >, std::greater< QgsGraphQueueEntry > > QgsGraphVertexQueue;
+
+///@endcond
+
 void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int criterionNum, QVector<int> *resultTree, QVector<double> *resultCost )
 {
   if ( startPointIdx < 0 || startPointIdx >= source->vertexCount() )
@@ -88,6 +101,276 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph *source, int startPointIdx, int
   }
 }
 
+void QgsGraphAnalyzer::dijkstra( const QgsCompactGraph *source, int startPointIdx, int criterionNum, QVector<int> *resultTree, QVector<double> *resultCost )
+{
+  if ( startPointIdx < 0 || startPointIdx >= source->vertexCount() )
+  {
+    // invalid start point
+    return;
+  }
+  if ( source->edgeCount() > 0 && ( criterionNum < 0 || criterionNum >= source->strategyCount() ) )
+  {
+    // invalid strategy
+    return;
+  }
+
+  const int vertexCount = source->vertexCount();
+  QVector< double > costVector( vertexCount, std::numeric_limits<double>::infinity() );
+  QVector< int > treeVector( resultTree ? vertexCount : 0, -1 );
+  double *costs = costVector.data();
+  int *tree = treeVector.data();
+  costs[ startPointIdx ] = 0.0;
+
+  const double *edgeCosts = source->edgeCount() > 0 ? source->mOutCosts[ criterionNum ].data() : nullptr;
+  const int *offsets = source->mOutOffsets.data();
+  const int *targets = source->mOutTargets.data();
+  const int *edges = source->mOutEdges.data();
+
+  QgsGraphVertexQueue queue;
+  queue.push( QgsGraphQueueEntry( 0.0, startPointIdx ) );
+  while ( !queue.empty() )
+  {
+    const QgsGraphQueueEntry entry = queue.top();
+    queue.pop();
+    const double curCost = entry.first;
+    const int curVertex = entry.second;
+    if ( curCost > costs[ curVertex ] )
+      continue;  // outdated entry, the vertex has already been reached with a lower cost
+
+    for ( int position = offsets[ curVertex ]; position < offsets[ curVertex + 1 ]; ++position )
+    {
+      const double cost = curCost + edgeCosts[ position ];
+      const int toVertex = targets[ position ];
+      if ( cost < costs[ toVertex ] )
+      {
+        costs[ toVertex ] = cost;
+        if ( resultTree )
+          tree[ toVertex ] = edges[ position ];
+        queue.push( QgsGraphQueueEntry( cost, toVertex ) );
+      }
+    }
+  }
+
+  if ( resultCost )
+    *resultCost = costVector;
+  if ( resultTree )
+    *resultTree = treeVector;
+}
+
+QVector<int> QgsGraphAnalyzer::shortestPath( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, int criterionNum, QgsGraphAnalyzer::ShortestPathAlgorithm algorithm, double *cost )
+{
+  QVector< int > path;
+  double pathCost = std::numeric_limits<double>::infinity();
+
+  if ( startVertexIdx >= 0 && startVertexIdx < source->vertexCount() && endVertexIdx >= 0 && endVertexIdx < source->vertexCount() )
+  {
+    if ( startVertexIdx == endVertexIdx )
+    {
+      pathCost = 0.0;
+    }
+    else if ( criterionNum >= 0 && criterionNum < source->strategyCount() )
+    {
+      switch ( algorithm )
+      {
+        case Dijkstra:
+          pathCost = pathDijkstra( source, startVertexIdx, endVertexIdx, criterionNum, path );
+          break;
+        case BidirectionalDijkstra:
+          pathCost = pathBidirectionalDijkstra( source, startVertexIdx, endVertexIdx, criterionNum, path );
+          break;
+        case AStar:
+          pathCost = pathAStar( source, startVertexIdx, endVertexIdx, criterionNum, path );
+          break;
+      }
+    }
+  }
+
+  if ( cost )
+    *cost = pathCost;
+  return path;
+}
+
+double QgsGraphAnalyzer::pathDijkstra( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, int criterionNum, QVector<int> &path )
+{
+  const double *edgeCosts = source->mOutCosts[ criterionNum ].data();
+  const int *offsets = source->mOutOffsets.data();
+  const int *targets = source->mOutTargets.data();
+  const int *edges = source->mOutEdges.data();
+
+  std::vector< double > costs( source->vertexCount(), std::numeric_limits<double>::infinity() );
+  std::vector< int > tree( source->vertexCount(), -1 );
+  costs[ startVertexIdx ] = 0.0;
+
+  QgsGraphVertexQueue queue;
+  queue.push( QgsGraphQueueEntry( 0.0, startVertexIdx ) );
+  while ( !queue.empty() )
+  {
+    const QgsGraphQueueEntry entry = queue.top();
+    queue.pop();
+    const int curVertex = entry.second;
+    if ( entry.first > costs[ curVertex ] )
+      continue;
+    if ( curVertex == endVertexIdx )
+      break;  // the cost of a vertex is final once it is popped from the queue
+
+    for ( int position = offsets[ curVertex ]; position < offsets[ curVertex + 1 ]; ++position )
+    {
+      const double cost = entry.first + edgeCosts[ position ];
+      const int toVertex = targets[ position ];
+      if ( cost < costs[ toVertex ] )
+      {
+        costs[ toVertex ] = cost;
+        tree[ toVertex ] = edges[ position ];
+        queue.push( QgsGraphQueueEntry( cost, toVertex ) );
+      }
+    }
+  }
+
+  if ( tree[ endVertexIdx ] == -1 )
+    return std::numeric_limits<double>::infinity();
+
+  for ( int vertex = endVertexIdx; vertex != startVertexIdx; vertex = source->mEdgeFrom[ tree[ vertex ] ] )
+    path.prepend( tree[ vertex ] );
+  return costs[ endVertexIdx ];
+}
+
+double QgsGraphAnalyzer::pathAStar( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, int criterionNum, QVector<int> &path )
+{
+  const double factor = source->minimumCostPerDistance( criterionNum );
+  if ( factor <= 0 )
+    return pathDijkstra( source, startVertexIdx, endVertexIdx, criterionNum, path );
+
+  const double *edgeCosts = source->mOutCosts[ criterionNum ].data();
+  const int *offsets = source->mOutOffsets.data();
+  const int *targets = source->mOutTargets.data();
+  const int *edges = source->mOutEdges.data();
+  const QgsPointXY endPoint = source->mPoints[ endVertexIdx ];
+
+  // lower bound of the cost from a vertex to the end vertex
+  auto heuristic = [source, factor, &endPoint]( int vertex ) -> double
+  {
+    return factor * std::sqrt( source->mPoints[ vertex ].sqrDist( endPoint ) );
+  };
+
+  std::vector< double > costs( source->vertexCount(), std::numeric_limits<double>::infinity() );
+  std::vector< int > tree( source->vertexCount(), -1 );
+  costs[ startVertexIdx ] = 0.0;
+
+  QgsGraphVertexQueue queue;
+  queue.push( QgsGraphQueueEntry( heuristic( startVertexIdx ), startVertexIdx ) );
+  while ( !queue.empty() )
+  {
+    const QgsGraphQueueEntry entry = queue.top();
+    queue.pop();
+    const int curVertex = entry.second;
+    const double curCost = costs[ curVertex ];
+    if ( entry.first > curCost + heuristic( curVertex ) )
+      continue;
+    if ( curVertex == endVertexIdx )
+      break;  // the heuristic is consistent, so the cost of a vertex is final once it is popped from the queue
+
+    for ( int position = offsets[ curVertex ]; position < offsets[ curVertex + 1 ]; ++position )
+    {
+      const double cost = curCost + edgeCosts[ position ];
+      const int toVertex = targets[ position ];
+      if ( cost < costs[ toVertex ] )
+      {
+        costs[ toVertex ] = cost;
+        tree[ toVertex ] = edges[ position ];
+        queue.push( QgsGraphQueueEntry( cost + heuristic( toVertex ), toVertex ) );
+      }
+    }
+  }
+
+  if ( tree[ endVertexIdx ] == -1 )
+    return std::numeric_limits<double>::infinity();
+
+  for ( int vertex = endVertexIdx; vertex != startVertexIdx; vertex = source->mEdgeFrom[ tree[ vertex ] ] )
+    path.prepend( tree[ vertex ] );
+  return costs[ endVertexIdx ];
+}
+
+double QgsGraphAnalyzer::pathBidirectionalDijkstra( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, int criterionNum, QVector<int> &path )
+{
+  const int vertexCount = source->vertexCount();
+
+  // forward search from the start vertex along outgoing edges, backward search from the end vertex along incoming edges
+  struct Search
+  {
+    const double *edgeCosts;
+    const int *offsets;
+    const int *neighbors;
+    const int *edges;
+    std::vector< double > costs;
+    std::vector< int > tree;
+    QgsGraphVertexQueue queue;
+
+    //! Removes outdated entries from the top of the queue, returns FALSE if the queue is empty
+    bool cleanTop()
+    {
+      while ( !queue.empty() && queue.top().first > costs[ queue.top().second ] )
+        queue.pop();
+      return !queue.empty();
+    }
+  };
+
+  Search forward { source->mOutCosts[ criterionNum ].data(), source->mOutOffsets.data(), source->mOutTargets.data(), source->mOutEdges.data(),
+                   std::vector< double >( vertexCount, std::numeric_limits<double>::infinity() ), std::vector< int >( vertexCount, -1 ), QgsGraphVertexQueue() };
+  Search backward { source->mInCosts[ criterionNum ].data(), source->mInOffsets.data(), source->mInSources.data(), source->mInEdges.data(),
+                    std::vector< double >( vertexCount, std::numeric_limits<double>::infinity() ), std::vector< int >( vertexCount, -1 ), QgsGraphVertexQueue() };
+
+  forward.costs[ startVertexIdx ] = 0.0;
+  forward.queue.push( QgsGraphQueueEntry( 0.0, startVertexIdx ) );
+  backward.costs[ endVertexIdx ] = 0.0;
+  backward.queue.push( QgsGraphQueueEntry( 0.0, endVertexIdx ) );
+
+  double bestCost = std::numeric_limits<double>::infinity();
+  int meetingVertex = -1;
+
+  while ( forward.cleanTop() && backward.cleanTop() )
+  {
+    // no path through unsettled vertices can be shorter than the best one found so far
+    if ( forward.queue.top().first + backward.queue.top().first >= bestCost )
+      break;
+
+    // expand the search with the lowest cost
+    const bool expandForward = forward.queue.top().first <= backward.queue.top().first;
+    Search &search = expandForward ? forward : backward;
+    const Search &other = expandForward ? backward : forward;
+
+    const QgsGraphQueueEntry entry = search.queue.top();
+    search.queue.pop();
+    const int curVertex = entry.second;
+
+    for ( int position = search.offsets[ curVertex ]; position < search.offsets[ curVertex + 1 ]; ++position )
+    {
+      const double cost = entry.first + search.edgeCosts[ position ];
+      const int toVertex = search.neighbors[ position ];
+      if ( cost < search.costs[ toVertex ] )
+      {
+        search.costs[ toVertex ] = cost;
+        search.tree[ toVertex ] = search.edges[ position ];
+        search.queue.push( QgsGraphQueueEntry( cost, toVertex ) );
+
+        if ( cost + other.costs[ toVertex ] < bestCost )
+        {
+          bestCost = cost + other.costs[ toVertex ];
+          meetingVertex = toVertex;
+        }
+      }
+    }
+  }
+
+  if ( meetingVertex == -1 )
+    return std::numeric_limits<double>::infinity();
+
+  for ( int vertex = meetingVertex; vertex != startVertexIdx; vertex = source->mEdgeFrom[ forward.tree[ vertex ] ] )
+    path.prepend( forward.tree[ vertex ] );
+  for ( int vertex = meetingVertex; vertex != endVertexIdx; vertex = source->mEdgeTo[ backward.tree[ vertex ] ] )
+    path.append( backward.tree[ vertex ] );
+  return bestCost;
+}
+
 QgsGraph *QgsGraphAnalyzer::shortestTree( const QgsGraph *source, int startVertexIdx, int criterionNum )
 {
   QgsGraph *treeResult = new QgsGraph();
@@ -22,6 +22,7 @@
 #include "qgis_analysis.h"
 
 class QgsGraph;
+class QgsCompactGraph;
 
 /**
  * \ingroup analysis
@@ -33,6 +34,17 @@ class ANALYSIS_EXPORT QgsGraphAnalyzer
 {
   public:
 
+    /**
+     * Algorithms available to compute the shortest path between two vertices of a QgsCompactGraph.
+     * \since QGIS 3.18
+     */
+    enum ShortestPathAlgorithm
+    {
+      Dijkstra, //!< Dijkstra algorithm, stopping as soon as the end vertex is reached
+      BidirectionalDijkstra, //!< Dijkstra algorithm searching simultaneously from the start vertex and backwards from the end vertex, until both searches meet
+      AStar, //!< A* algorithm, guided towards the end vertex by a lower bound of the remaining cost (see QgsCompactGraph::minimumCostPerDistance())
+    };
+
     /**
      * Solve shortest path problem using Dijkstra algorithm
      * \param source source graph
@@ -75,6 +87,72 @@ class ANALYSIS_EXPORT QgsGraphAnalyzer
     % End
 #endif
 
+    /**
+     * Solve shortest path problem using Dijkstra algorithm on a compact graph.
+     *
+     * This gives the same results as the QgsGraph variant of dijkstra() on the graph the compact graph was created from,
+     * but is much faster on large graphs.
+     *
+     * \param source source graph
+     * \param startVertexIdx index of the start vertex
+     * \param criterionNum index of the optimization strategy
+     * \param resultTree array that represents shortest path tree. resultTree[ vertexIndex ] == inboundingArcIndex if vertex reachable, otherwise resultTree[ vertexIndex ] == -1.
+     * Note that the startVertexIdx will also have a value of -1 and may need special handling by callers.
+     * \param resultCost array of the paths costs
+     * \since QGIS 3.18
+     */
+    static void SIP_PYALTERNATIVETYPE( SIP_PYLIST ) dijkstra( const QgsCompactGraph *source, int startVertexIdx, int criterionNum, QVector<int> *resultTree = nullptr, QVector<double> *resultCost = nullptr );
+
+#ifdef SIP_RUN
+    % MethodCode
+    QVector< int > treeResult;
+    QVector< double > costResult;
+    QgsGraphAnalyzer::dijkstra( a0, a1, a2, &treeResult, &costResult );
+
+    PyObject *l1 = PyList_New( treeResult.size() );
+    if ( l1 == NULL )
+    {
+      return NULL;
+    }
+    PyObject *l2 = PyList_New( costResult.size() );
+    if ( l2 == NULL )
+    {
+      return NULL;
+    }
+    int i;
+    for ( i = 0; i < costResult.size(); ++i )
+    {
+      PyObject *Int = PyLong_FromLong( treeResult[i] );
+      PyList_SET_ITEM( l1, i, Int );
+      PyObject *Float = PyFloat_FromDouble( costResult[i] );
+      PyList_SET_ITEM( l2, i, Float );
+    }
+
+    sipRes = PyTuple_New( 2 );
+    PyTuple_SET_ITEM( sipRes, 0, l1 );
+    PyTuple_SET_ITEM( sipRes, 1, l2 );
+    % End
+#endif
+
+    /**
+     * Returns the shortest path between two vertices of a compact graph, as the list of the indices of its edges.
+     *
+     * \param source source graph
+     * \param startVertexIdx index of the start vertex
+     * \param endVertexIdx index of the end vertex
+     * \param criterionNum index of the optimization strategy
+     * \param algorithm algorithm used to search the path. All of them return a path with the same
+     * minimal cost, but the A* and bidirectional algorithms usually visit far fewer vertices.
+     * \param cost if specified, will be set to the cost of the path, or to infinity if the end vertex cannot be reached
+     *
+     * An empty list is returned if the end vertex cannot be reached, or if it is the start vertex.
+     *
+     * \since QGIS 3.18
+     */
+    static QVector< int > shortestPath( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, int criterionNum,
+                                        QgsGraphAnalyzer::ShortestPathAlgorithm algorithm = QgsGraphAnalyzer::BidirectionalDijkstra,
+                                        double *cost SIP_OUT = nullptr );
+
     /**
      * Returns shortest path tree with root-node in startVertexIdx
      * \param source source graph
@@ -82,6 +160,12 @@ class ANALYSIS_EXPORT QgsGraphAnalyzer
      * \param criterionNum index of the optimization strategy
      */
     static QgsGraph *shortestTree( const QgsGraph *source, int startVertexIdx, int criterionNum );
+
+  private:
+
+    static double pathDijkstra( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, int criterionNum, QVector< int > &path );
+    static double pathBidirectionalDijkstra( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, int criterionNum, QVector< int > &path );
+    static double pathAStar( const QgsCompactGraph *source, int startVertexIdx, int endVertexIdx, int criterionNum, QVector< int > &path );
 };
 
 #endif // QGSGRAPHANALYZER_H
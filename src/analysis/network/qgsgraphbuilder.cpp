@@ -19,6 +19,7 @@
  */
 
 #include "qgsgraphbuilder.h"
+#include "qgscompactgraph.h"
 #include "qgsgraph.h"
 
 #include "qgsgeometry.h"
@@ -50,3 +51,11 @@ QgsGraph *QgsGraphBuilder::graph()
   mGraph = nullptr;
   return res;
 }
+
+QgsCompactGraph *QgsGraphBuilder::compactGraph() const
+{
+  if ( !mGraph )
+    return nullptr;
+
+  return new QgsCompactGraph( *mGraph );
+}
@@ -25,6 +25,7 @@
 class QgsDistanceArea;
 class QgsCoordinateTransform;
 class QgsGraph;
+class QgsCompactGraph;
 
 /**
 * \ingroup analysis
@@ -55,6 +56,17 @@ class ANALYSIS_EXPORT QgsGraphBuilder : public QgsGraphBuilderInterface SIP_NODE
      */
     QgsGraph *graph() SIP_FACTORY;
 
+    /**
+     * Returns a compact copy of the generated graph, for faster shortest path computations
+     * with QgsGraphAnalyzer.
+     *
+     * This must be called before graph(), which hands over the generated graph:
+     * NULLPTR is returned once graph() has been called.
+     *
+     * \since QGIS 3.18
+     */
+    QgsCompactGraph *compactGraph() const SIP_FACTORY;
+
   private:
 
     QgsGraph *mGraph = nullptr;
@@ -28,9 +28,21 @@
 #include "qgsgeometry.h"
 #include "qgsdistancearea.h"
 #include "qgswkbtypes.h"
+#include "qgscsexception.h"
+#include "qgsfeedback.h"
+#include "qgsnetworkdistancestrategy.h"
+#include "qgsnetworkspeedstrategy.h"
 
 #include <QString>
+#include <QThread>
 #include <QtAlgorithms>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <typeinfo>
 
 #include <spatialindex/SpatialIndex.h>
 
@@ -113,6 +125,10 @@ QgsVectorLayerDirector::Direction QgsVectorLayerDirector::directionForFeature( c
 }
 
 ///@cond PRIVATE
+
+// number of network features read before their geometries are processed over multiple threads
+static const int FEATURE_BATCH_SIZE = 4096;
+
 class QgsNetworkVisitor : public SpatialIndex::IVisitor
 {
   public:
@@ -134,38 +150,277 @@ class QgsNetworkVisitor : public SpatialIndex::IVisitor
     QVector< int > &mPoints;
 };
 
-///@endcond
+/**
+ * Graph vertices, deduplicated with a hash of grid cells as large as the topology tolerance.
+ *
+ * A point is merged with the first vertex whose coordinates are within the tolerance on both axes,
+ * which can only be found in the point's cell or in one of its 8 neighbors.
+ */
+class QgsNetworkVertexGrid
+{
+  public:
+
+    explicit QgsNetworkVertexGrid( double tolerance )
+      : mTolerance( tolerance )
+    {}
+
+    int count() const { return mVertices.size(); }
+
+    const QgsPointXY &vertex( int index ) const { return mVertices.at( index ); }
+
+    //! Returns the index of the first vertex within tolerance of \a point, or -1 if there is none
+    int find( const QgsPointXY &point ) const
+    {
+      const qint64 cellX = cell( point.x() );
+      const qint64 cellY = cell( point.y() );
+      int result = -1;
+      for ( qint64 x = cellX - 1; x <= cellX + 1; ++x )
+      {
+        for ( qint64 y = cellY - 1; y <= cellY + 1; ++y )
+        {
+          const auto it = mCells.constFind( qMakePair( x, y ) );
+          if ( it == mCells.constEnd() )
+            continue;
+
+          for ( int index = it.value(); index != -1; index = mNext.at( index ) )
+          {
+            const QgsPointXY &candidate = mVertices.at( index );
+            if ( ( result == -1 || index < result )
+                 && std::fabs( candidate.x() - point.x() ) <= mTolerance && std::fabs( candidate.y() - point.y() ) <= mTolerance )
+              result = index;
+          }
+        }
+      }
+      return result;
+    }
+
+    //! Adds a vertex at \a point unless one already exists within tolerance, and returns the index of the matching vertex
+    int add( const QgsPointXY &point )
+    {
+      const int existing = find( point );
+      if ( existing != -1 )
+        return existing;
+
+      const int index = mVertices.size();
+      mVertices.push_back( point );
+
+      // vertices of a cell are chained through mNext
+      const QPair< qint64, qint64 > key( cell( point.x() ), cell( point.y() ) );
+      auto it = mCells.find( key );
+      if ( it == mCells.end() )
+      {
+        mCells.insert( key, index );
+        mNext.push_back( -1 );
+      }
+      else
+      {
+        mNext.push_back( it.value() );
+        it.value() = index;
+      }
+      return index;
+    }
+
+  private:
+
+    qint64 cell( double coordinate ) const
+    {
+      // clamp to keep the conversion defined for huge or non finite coordinates
+      double cell = std::floor( coordinate / mTolerance );
+      if ( !( cell > -4e18 ) )
+        cell = -4e18;
+      else if ( cell > 4e18 )
+        cell = 4e18;
+      return static_cast< qint64 >( cell );
+    }
+
+    double mTolerance = 0;
+    QVector< QgsPointXY > mVertices;
+    //! First vertex of each occupied cell
+    QHash< QPair< qint64, qint64 >, int > mCells;
+    //! Next vertex in the same cell, for each vertex
+    QVector< int > mNext;
+};
 
-std::unique_ptr< SpatialIndex::ISpatialIndex > createVertexSpatialIndex( SpatialIndex::IStorageManager &storageManager )
+//! A segment of a network line, between two graph vertices
+struct QgsNetworkSegment
 {
-  // R-Tree parameters
-  double fillFactor = 0.7;
-  unsigned long indexCapacity = 10;
-  unsigned long leafCapacity = 10;
-  unsigned long dimension = 2;
-  RTree::RTreeVariant variant = RTree::RV_RSTAR;
-
-  // create R-tree
-  SpatialIndex::id_type indexId;
-  std::unique_ptr< SpatialIndex::ISpatialIndex > iRTree( RTree::createNewRTree( storageManager, fillFactor, indexCapacity,
-      leafCapacity, dimension, variant, indexId ) );
-  return iRTree;
+  QgsPointXY start;
+  QgsPointXY end;
+  QgsFeatureId featureId;
+};
+
+//! Returns the squared distance from \a point to \a segment, and the closest point of the segment
+static double sqrDistToNetworkSegment( const QgsPointXY &point, const QgsNetworkSegment &segment, QgsPointXY &closestPoint )
+{
+  if ( segment.start == segment.end )
+  {
+    closestPoint = segment.start;
+    return point.sqrDist( segment.start );
+  }
+  return point.sqrDistToSegment( segment.start.x(), segment.start.y(), segment.end.x(), segment.end.y(), closestPoint, 0 );
 }
 
-int findClosestVertex( const QgsPointXY &point, SpatialIndex::ISpatialIndex *index, double tolerance )
+/**
+ * Streams the bounding boxes of network segments, for bulk loading of the segment R-tree.
+ */
+class QgsNetworkSegmentStream : public IDataStream
 {
-  QVector< int > matching;
-  QgsNetworkVisitor visitor( matching );
+  public:
+    explicit QgsNetworkSegmentStream( const std::vector< QgsNetworkSegment > &segments )
+      : mSegments( segments )
+    {}
+
+    IData *getNext() override
+    {
+      const QgsNetworkSegment &segment = mSegments[ mIndex ];
+      double low[2] = { std::min( segment.start.x(), segment.end.x() ), std::min( segment.start.y(), segment.end.y() ) };
+      double high[2] = { std::max( segment.start.x(), segment.end.x() ), std::max( segment.start.y(), segment.end.y() ) };
+      return new RTree::Data( 0, nullptr, SpatialIndex::Region( low, high, 2 ), static_cast< SpatialIndex::id_type >( mIndex++ ) );
+    }
+
+    bool hasNext() override { return mIndex < mSegments.size(); }
+    uint32_t size() override { return static_cast< uint32_t >( mSegments.size() ); }
+    void rewind() override { mIndex = 0; }
+
+  private:
+    const std::vector< QgsNetworkSegment > &mSegments;
+    std::size_t mIndex = 0;
+};
+
+/**
+ * Nearest neighbor comparator using the exact distance to the segments, instead of the distance to their bounding box.
+ */
+class QgsNetworkSegmentComparator : public INearestNeighborComparator
+{
+  public:
+    QgsNetworkSegmentComparator( const std::vector< QgsNetworkSegment > &segments, const QgsPointXY &point )
+      : mSegments( segments )
+      , mPoint( point )
+    {}
 
-  double pt1[2] = { point.x() - tolerance, point.y() - tolerance },
-                  pt2[2] = { point.x() + tolerance, point.y() + tolerance };
-  SpatialIndex::Region searchRegion( pt1, pt2, 2 );
+    double getMinimumDistance( const IShape &query, const IShape &entry ) override
+    {
+      return query.getMinimumDistance( entry );
+    }
 
-  index->intersectsWithQuery( searchRegion, visitor );
+    double getMinimumDistance( const IShape &, const IData &data ) override
+    {
+      QgsPointXY closestPoint;
+      return std::sqrt( sqrDistToNetworkSegment( mPoint, mSegments[ static_cast< std::size_t >( data.getIdentifier() ) ], closestPoint ) );
+    }
 
-  return matching.empty() ? -1 : matching.at( 0 );
+  private:
+    const std::vector< QgsNetworkSegment > &mSegments;
+    QgsPointXY mPoint;
+};
+
+//! An arc between two graph vertices, from which edges are added to the graph
+struct QgsNetworkArc
+{
+  int pt1Idx;
+  QgsPointXY pt1;
+  int pt2Idx;
+  QgsPointXY pt2;
+  double distance;
+  //! Edge costs, only set for the strategies which can be called from worker threads
+  QVector< QVariant > costs;
+};
+
+//! A network feature read from the source, with its lines transformed to the graph CRS
+struct QgsNetworkFeature
+{
+  QgsFeature feature;
+  QgsMultiPolylineXY lines;
+  QVector< QgsNetworkArc > arcs;
+};
+
+//! Reads the next batch of features from \a iterator, returns FALSE once all features have been read
+static bool readNetworkFeatures( QgsFeatureIterator &iterator, QVector< QgsNetworkFeature > &batch )
+{
+  batch.clear();
+  QgsFeature feature;
+  while ( batch.size() < FEATURE_BATCH_SIZE && iterator.nextFeature( feature ) )
+  {
+    QgsNetworkFeature networkFeature;
+    networkFeature.feature = feature;
+    batch.append( networkFeature );
+  }
+  return !batch.isEmpty();
 }
 
+/**
+ * Extracts and transforms the lines of a batch of network features, then calls \a function for each feature.
+ * The features are split into one range per thread, and each range works on its own copies of \a transform
+ * and \a distanceArea.
+ */
+static void processNetworkFeatures( QVector< QgsNetworkFeature > &batch, const QgsCoordinateTransform &transform, const QgsDistanceArea &distanceArea,
+                                    const std::function< void( QgsNetworkFeature &, const QgsDistanceArea & ) > &function )
+{
+  struct Range
+  {
+    int begin;
+    int end;
+    QString error;
+  };
+
+  const int threads = std::max( 1, QThread::idealThreadCount() );
+  const int chunkSize = std::max( 1, ( batch.size() + threads - 1 ) / threads );
+  QVector< Range > ranges;
+  for ( int begin = 0; begin < batch.size(); begin += chunkSize )
+    ranges.append( Range { begin, std::min( begin + chunkSize, batch.size() ), QString() } );
+
+  QgsNetworkFeature *features = batch.data();
+  QtConcurrent::blockingMap( ranges, [features, &transform, &distanceArea, &function]( Range & range )
+  {
+    const QgsCoordinateTransform ct = transform;
+    const QgsDistanceArea da = distanceArea;
+    try
+    {
+      for ( int i = range.begin; i < range.end; ++i )
+      {
+        QgsNetworkFeature &networkFeature = features[ i ];
+        const QgsGeometry geometry = networkFeature.feature.geometry();
+        if ( QgsWkbTypes::flatType( geometry.wkbType() ) == QgsWkbTypes::MultiLineString )
+          networkFeature.lines = geometry.asMultiPolyline();
+        else if ( QgsWkbTypes::flatType( geometry.wkbType() ) == QgsWkbTypes::LineString )
+          networkFeature.lines.push_back( geometry.asPolyline() );
+
+        for ( QgsPolylineXY &line : networkFeature.lines )
+        {
+          for ( QgsPointXY &point : line )
+            point = ct.transform( point );
+        }
+
+        if ( function )
+          function( networkFeature, da );
+      }
+    }
+    catch ( QgsCsException &e )
+    {
+      range.error = e.what();
+    }
+  } );
+
+  // report transform errors from the calling thread, as they would be without threads
+  for ( const Range &range : qgis::as_const( ranges ) )
+  {
+    if ( !range.error.isEmpty() )
+      throw QgsCsException( range.error );
+  }
+}
+
+/**
+ * Returns TRUE if the costs of \a strategy can be computed from worker threads. Only the strategies
+ * of the analysis library are known to be thread safe, subclasses (e.g. implemented in Python) are not.
+ */
+static bool isThreadSafeStrategy( const QgsNetworkStrategy *strategy )
+{
+  return typeid( *strategy ) == typeid( QgsNetworkDistanceStrategy )
+         || typeid( *strategy ) == typeid( QgsNetworkSpeedStrategy );
+}
+
+///@endcond
+
 void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const QVector< QgsPointXY > &additionalPoints,
                                         QVector< QgsPointXY > &snappedPoints, QgsFeedback *feedback ) const
 {
@@ -185,98 +440,74 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
   QVector< TiePointInfo > additionalTiePoints( additionalPoints.size() );
 
   // graph's vertices = all vertices in graph, with vertices within builder's tolerance collapsed together
-  QVector< QgsPointXY > graphVertices;
+  QgsNetworkVertexGrid graphVertices( std::max( builder->topologyTolerance(), 1e-10 ) );
 
-  // spatial index for graph vertices
-  std::unique_ptr< SpatialIndex::IStorageManager > iStorage( StorageManager::createNewMemoryStorageManager() );
-  std::unique_ptr< SpatialIndex::ISpatialIndex > iRTree = createVertexSpatialIndex( *iStorage );
-
-  double tolerance = std::max( builder->topologyTolerance(), 1e-10 );
-  auto findPointWithinTolerance = [&iRTree, tolerance]( const QgsPointXY & point )->int
-  {
-    return findClosestVertex( point, iRTree.get(), tolerance );
-  };
-  auto addPointToIndex = [&iRTree]( const QgsPointXY & point, int index )
-  {
-    double coords[] = {point.x(), point.y()};
-    iRTree->insertData( 0, nullptr, SpatialIndex::Point( coords, 2 ), index );
-  };
+  // network segments between graph vertices, only needed to snap additional points
+  std::vector< QgsNetworkSegment > segments;
 
-  // first iteration - get all nodes from network, and snap additional points to network
+  // first iteration - get all nodes from network, and collect segments for snapping additional points
   QgsFeatureIterator fit = mSource->getFeatures( QgsFeatureRequest().setNoAttributes() );
-  QgsFeature feature;
-  while ( fit.nextFeature( feature ) )
+  QVector< QgsNetworkFeature > batch;
+  while ( readNetworkFeatures( fit, batch ) )
   {
     if ( feedback && feedback->isCanceled() )
       return;
 
-    QgsMultiPolylineXY mpl;
-    if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::MultiLineString )
-      mpl = feature.geometry().asMultiPolyline();
-    else if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::LineString )
-      mpl.push_back( feature.geometry().asPolyline() );
+    processNetworkFeatures( batch, ct, *builder->distanceArea(), nullptr );
 
-    for ( const QgsPolylineXY &line : qgis::as_const( mpl ) )
+    for ( const QgsNetworkFeature &networkFeature : qgis::as_const( batch ) )
     {
-      QgsPointXY pt1, pt2;
-      bool isFirstPoint = true;
-      for ( const QgsPointXY &point : line )
+      for ( const QgsPolylineXY &line : networkFeature.lines )
       {
-        pt2 = ct.transform( point );
-
-        int pt2Idx = findPointWithinTolerance( pt2 ) ;
-        if ( pt2Idx == -1 )
+        int previousIdx = -1;
+        for ( const QgsPointXY &point : line )
         {
-          // no vertex already exists within tolerance - add to points, and index
-          addPointToIndex( pt2, graphVertices.count() );
-          graphVertices.push_back( pt2 );
+          // reuse any vertex which already exists within tolerance
+          const int pointIdx = graphVertices.add( point );
+          if ( previousIdx != -1 && !additionalPoints.isEmpty() )
+            segments.push_back( QgsNetworkSegment { graphVertices.vertex( previousIdx ), graphVertices.vertex( pointIdx ), networkFeature.feature.id() } );
+          previousIdx = pointIdx;
         }
-        else
-        {
-          // vertex already exists within tolerance - use that
-          pt2 = graphVertices.at( pt2Idx );
-        }
-
-        if ( !isFirstPoint )
-        {
-          // check if this line segment is a candidate for being closest to each additional point
-          int i = 0;
-          for ( const QgsPointXY &additionalPoint : additionalPoints )
-          {
-
-            QgsPointXY snappedPoint;
-            double thisSegmentClosestDist = std::numeric_limits<double>::max();
-            if ( pt1 == pt2 )
-            {
-              thisSegmentClosestDist = additionalPoint.sqrDist( pt1 );
-              snappedPoint = pt1;
-            }
-            else
-            {
-              thisSegmentClosestDist = additionalPoint.sqrDistToSegment( pt1.x(), pt1.y(),
-                                       pt2.x(), pt2.y(), snappedPoint, 0 );
-            }
+      }
+      if ( feedback )
+        feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
+    }
+  }
 
-            if ( thisSegmentClosestDist < additionalTiePoints[ i ].mLength )
-            {
-              // found a closer segment for this additional point
-              TiePointInfo info( i, feature.id(), pt1, pt2 );
-              info.mLength = thisSegmentClosestDist;
-              info.mTiedPoint = snappedPoint;
+  // snap each additional point to the closest segment, found with an R-tree using exact segment distances
+  if ( !segments.empty() )
+  {
+    std::unique_ptr< SpatialIndex::IStorageManager > segmentStorage( StorageManager::createNewMemoryStorageManager() );
+    QgsNetworkSegmentStream stream( segments );
+    SpatialIndex::id_type indexId;
+    std::unique_ptr< SpatialIndex::ISpatialIndex > segmentIndex( RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, stream, *segmentStorage, 0.7, 10, 10, 2, RTree::RV_RSTAR, indexId ) );
 
-              additionalTiePoints[ i ] = info;
-              snappedPoints[ i ] = info.mTiedPoint;
-            }
-            i++;
-          }
-        }
-        pt1 = pt2;
-        isFirstPoint = false;
-      }
+    for ( int i = 0; i < additionalPoints.size(); ++i )
+    {
+      if ( feedback && feedback->isCanceled() )
+        return;
+
+      const QgsPointXY &additionalPoint = additionalPoints.at( i );
+      QVector< int > closestSegments;
+      QgsNetworkVisitor visitor( closestSegments );
+      QgsNetworkSegmentComparator comparator( segments, additionalPoint );
+      double coords[] = { additionalPoint.x(), additionalPoint.y() };
+      segmentIndex->nearestNeighborQuery( 1, SpatialIndex::Point( coords, 2 ), visitor, comparator );
+      if ( closestSegments.isEmpty() )
+        continue;
+
+      // among equidistant segments, keep the first one read from the network
+      const QgsNetworkSegment &segment = segments[ *std::min_element( closestSegments.constBegin(), closestSegments.constEnd() ) ];
+      QgsPointXY snappedPoint;
+      TiePointInfo info( i, segment.featureId, segment.start, segment.end );
+      info.mLength = sqrDistToNetworkSegment( additionalPoint, segment, snappedPoint );
+      info.mTiedPoint = snappedPoint;
+      additionalTiePoints[ i ] = info;
+      snappedPoints[ i ] = snappedPoint;
     }
-    if ( feedback )
-      feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
   }
+  segments.clear();
+  segments.shrink_to_fit();
 
   // build a hash of feature ids to tie points which depend on this feature
   QHash< QgsFeatureId, QList< int > > tiePointNetworkFeatures;
@@ -290,20 +521,8 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
   // add tied point to graph
   for ( int i = 0; i < snappedPoints.size(); ++i )
   {
-    // check index to see if vertex exists within tolerance of tie point
-    const QgsPointXY point = snappedPoints.at( i );
-    int ptIdx = findPointWithinTolerance( point );
-    if ( ptIdx == -1 )
-    {
-      // no vertex already within tolerance, add to index and network vertices
-      addPointToIndex( point, graphVertices.count() );
-      graphVertices.push_back( point );
-    }
-    else
-    {
-      // otherwise snap tie point to vertex
-      snappedPoints[ i ] = graphVertices.at( ptIdx );
-    }
+    // snap tie point to any vertex within tolerance, otherwise add it to the network vertices
+    snappedPoints[ i ] = graphVertices.vertex( graphVertices.add( snappedPoints.at( i ) ) );
   }
   // also need to update tie points - they need to be matched for snapped points
   for ( int i = 0; i < additionalTiePoints.count(); ++i )
@@ -315,41 +534,37 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
   // begin graph construction
 
   // add vertices to graph
+  for ( int i = 0; i < graphVertices.count(); ++i )
   {
-    int i = 0;
-    for ( const QgsPointXY &point : graphVertices )
-    {
-      builder->addVertex( i, point );
-      i++;
-    }
+    builder->addVertex( i, graphVertices.vertex( i ) );
   }
 
-  fit = mSource->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( requiredAttributes() ) );
-  while ( fit.nextFeature( feature ) )
+  // strategies which may not be thread safe (e.g. when implemented in Python) are only called from this thread
+  QVector< bool > threadSafeStrategies;
+  threadSafeStrategies.reserve( mStrategies.size() );
+  bool allStrategiesThreadSafe = true;
+  for ( const QgsNetworkStrategy *strategy : mStrategies )
   {
-    if ( feedback && feedback->isCanceled() )
-      return;
-
-    Direction direction = directionForFeature( feature );
+    threadSafeStrategies << isThreadSafeStrategy( strategy );
+    allStrategiesThreadSafe = allStrategiesThreadSafe && threadSafeStrategies.constLast();
+  }
 
-    // begin features segments and add arc to the Graph;
-    QgsMultiPolylineXY mpl;
-    if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::MultiLineString )
-      mpl = feature.geometry().asMultiPolyline();
-    else if ( QgsWkbTypes::flatType( feature.geometry().wkbType() ) == QgsWkbTypes::LineString )
-      mpl.push_back( feature.geometry().asPolyline() );
+  // splits the lines of a feature into measured and costed arcs, run over multiple threads: the vertex grid is not modified anymore
+  const QList< QgsNetworkStrategy * > &strategies = mStrategies;
+  auto buildArcs = [&graphVertices, &tiePointNetworkFeatures, &additionalTiePoints, &strategies, &threadSafeStrategies]( QgsNetworkFeature & networkFeature, const QgsDistanceArea & da )
+  {
+    const QgsFeature &feature = networkFeature.feature;
 
-    for ( const QgsPolylineXY &line : qgis::as_const( mpl ) )
+    for ( const QgsPolylineXY &line : qgis::as_const( networkFeature.lines ) )
     {
       QgsPointXY pt1, pt2;
 
       bool isFirstPoint = true;
       for ( const QgsPointXY &point : line )
       {
-        pt2 = ct.transform( point );
-        int pPt2idx = findPointWithinTolerance( pt2 );
+        int pPt2idx = graphVertices.find( point );
         Q_ASSERT_X( pPt2idx >= 0, "QgsVectorLayerDirectory::makeGraph", "encountered a vertex which was not present in graph" );
-        pt2 = graphVertices.at( pPt2idx );
+        pt2 = graphVertices.vertex( pPt2idx );
 
         if ( !isFirstPoint )
         {
@@ -376,30 +591,18 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
           {
             arcPt2 = arcPointIt.value();
 
-            pt2idx = findPointWithinTolerance( arcPt2 );
+            pt2idx = graphVertices.find( arcPt2 );
             Q_ASSERT_X( pt2idx >= 0, "QgsVectorLayerDirectory::makeGraph", "encountered a vertex which was not present in graph" );
-            arcPt2 = graphVertices.at( pt2idx );
+            arcPt2 = graphVertices.vertex( pt2idx );
 
             if ( !isFirstPoint && arcPt1 != arcPt2 )
             {
-              double distance = builder->distanceArea()->measureLine( arcPt1, arcPt2 );
-              QVector< QVariant > prop;
-              prop.reserve( mStrategies.size() );
-              for ( QgsNetworkStrategy *strategy : mStrategies )
-              {
-                prop.push_back( strategy->cost( distance, feature ) );
-              }
-
-              if ( direction == Direction::DirectionForward ||
-                   direction == Direction::DirectionBoth )
-              {
-                builder->addEdge( pt1idx, arcPt1, pt2idx, arcPt2, prop );
-              }
-              if ( direction == Direction::DirectionBackward ||
-                   direction == Direction::DirectionBoth )
-              {
-                builder->addEdge( pt2idx, arcPt2, pt1idx, arcPt1, prop );
-              }
+              const double distance = da.measureLine( arcPt1, arcPt2 );
+              QVector< QVariant > costs;
+              costs.reserve( strategies.size() );
+              for ( int strategyIdx = 0; strategyIdx < strategies.size(); ++strategyIdx )
+                costs << ( threadSafeStrategies.at( strategyIdx ) ? strategies.at( strategyIdx )->cost( distance, feature ) : QVariant() );
+              networkFeature.arcs.append( QgsNetworkArc { pt1idx, arcPt1, pt2idx, arcPt2, distance, costs } );
             }
             pt1idx = pt2idx;
             arcPt1 = arcPt2;
@@ -410,10 +613,50 @@ void QgsVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, const
         isFirstPoint = false;
       }
     }
-    if ( feedback )
+  };
+
+  fit = mSource->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( requiredAttributes() ) );
+  while ( readNetworkFeatures( fit, batch ) )
+  {
+    if ( feedback && feedback->isCanceled() )
+      return;
+
+    processNetworkFeatures( batch, ct, *builder->distanceArea(), buildArcs );
+
+    // edges are added in the order of the features, on the calling thread, so that
+    // the graph does not depend on the number of threads
+    for ( const QgsNetworkFeature &networkFeature : qgis::as_const( batch ) )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
-    }
+      const QgsFeature &feature = networkFeature.feature;
+      const Direction direction = directionForFeature( feature );
+      for ( const QgsNetworkArc &arc : networkFeature.arcs )
+      {
+        QVector< QVariant > prop = arc.costs;
+        if ( !allStrategiesThreadSafe )
+        {
+          for ( int strategyIdx = 0; strategyIdx < mStrategies.size(); ++strategyIdx )
+          {
+            if ( !threadSafeStrategies.at( strategyIdx ) )
+              prop[ strategyIdx ] = mStrategies.at( strategyIdx )->cost( arc.distance, feature );
+          }
+        }
+
+        if ( direction == Direction::DirectionForward ||
+             direction == Direction::DirectionBoth )
+        {
+          builder->addEdge( arc.pt1Idx, arc.pt1, arc.pt2Idx, arc.pt2, prop );
+        }
+        if ( direction == Direction::DirectionBackward ||
+             direction == Direction::DirectionBoth )
+        {
+          builder->addEdge( arc.pt2Idx, arc.pt2, arc.pt1Idx, arc.pt1, prop );
+        }
+      }
 
+      if ( feedback )
+      {
+        feedback->setProgress( 100.0 * static_cast< double >( ++step ) / featureCount );
+      }
+    }
   }
 }
@@ -28,6 +28,12 @@ class QgsFeatureSource;
 * \ingroup analysis
 * \class QgsVectorLayerDirector
 * \brief Determine making the graph from vector line layer
+*
+* Since QGIS 3.18, network features are processed in batches spread over multiple threads
+* when building the graph. QgsNetworkDistanceStrategy and QgsNetworkSpeedStrategy costs are computed
+* by these threads too, while other strategies are only called from the thread building the graph,
+* so they do not need to be thread safe.
+*
 * \since QGIS 3.0
 */
 class ANALYSIS_EXPORT QgsVectorLayerDirector : public QgsGraphDirector
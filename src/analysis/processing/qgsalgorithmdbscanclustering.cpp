@@ -18,6 +18,7 @@
 #include "qgsalgorithmdbscanclustering.h"
 #include "qgsspatialindexkdbush.h"
 #include <unordered_set>
+#include <vector>
 
 ///@cond PRIVATE
 
@@ -196,6 +197,8 @@ void QgsDbscanClusteringAlgorithm::dbscan( const std::size_t minSize,
   std::unordered_set< QgsFeatureId > visited;
   visited.reserve( index.size() );
 
+  std::vector< QgsSpatialIndexKDBushData > unvisitedNeighbours;
+
   QgsFeature feat;
   int i = 0;
   int clusterCount = 0;
@@ -234,9 +237,10 @@ void QgsDbscanClusteringAlgorithm::dbscan( const std::size_t minSize,
 
     if ( minSize > 1 )
     {
-      index.within( point, eps, [ &within]( const QgsSpatialIndexKDBushData & data )
+      index.visitWithin( point, eps, [ &within]( const QgsSpatialIndexKDBushData & data ) -> bool
       {
         within.insert( data );
+        return true;
       } );
       if ( within.size() < minSize )
         continue;
@@ -276,23 +280,23 @@ void QgsDbscanClusteringAlgorithm::dbscan( const std::size_t minSize,
       // check from this point
       QgsPointXY point2 = j.point();
 
-      std::unordered_set< QgsSpatialIndexKDBushData, KDBushDataHashById, KDBushDataEqualById > within2;
-      index.within( point2, eps, [&within2]( const QgsSpatialIndexKDBushData & data )
+      // count the neighbours and keep the unvisited ones while walking the index, instead of
+      // collecting the whole neighbourhood into a set first
+      std::size_t neighbourCount = 0;
+      unvisitedNeighbours.clear();
+      index.visitWithin( point2, eps, [&]( const QgsSpatialIndexKDBushData & data ) -> bool
       {
-        within2.insert( data );
+        neighbourCount++;
+        if ( visited.find( data.id ) == visited.end() )
+          unvisitedNeighbours.emplace_back( data );
+        return true;
       } );
-      if ( within2.size() >= minSize )
+      if ( neighbourCount >= minSize )
       {
         // expand neighbourhood
-        std::copy_if( within2.begin(),
-                      within2.end(),
-                      std::inserter( within, within.end() ),
-                      [&visited]( const QgsSpatialIndexKDBushData & needle )
-        {
-          return visited.find( needle.id ) == visited.end();
-        } );
+        within.insert( unvisitedNeighbours.begin(), unvisitedNeighbours.end() );
       }
-      if ( !borderPointsAreNoise || within2.size() >= minSize )
+      if ( !borderPointsAreNoise || neighbourCount >= minSize )
       {
         idToCluster[ j.id ] = clusterCount;
       }
@@ -17,12 +17,116 @@
 
 #include "qgsalgorithmdissolve.h"
 
+#include <QMutex>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
 ///@cond PRIVATE
 
 //
 // QgsCollectorAlgorithm
 //
 
+//! Spreads the lower 16 bits of \a v over the even bits of the result
+static quint32 interleaveBits( quint32 v )
+{
+  v &= 0x0000ffff;
+  v = ( v | ( v << 8 ) ) & 0x00ff00ff;
+  v = ( v | ( v << 4 ) ) & 0x0f0f0f0f;
+  v = ( v | ( v << 2 ) ) & 0x33333333;
+  v = ( v | ( v << 1 ) ) & 0x55555555;
+  return v;
+}
+
+//! Sorts \a geometries along a Z-order curve of their bounding box centers, so that neighboring geometries are next to each other
+static void sortSpatially( QVector< QgsGeometry > &geometries )
+{
+  std::vector< QgsRectangle > boxes;
+  boxes.reserve( geometries.size() );
+  QgsRectangle extent;
+  for ( const QgsGeometry &g : qgis::as_const( geometries ) )
+  {
+    boxes.emplace_back( g.boundingBox() );
+    extent.combineExtentWith( boxes.back() );
+  }
+
+  const double width = extent.width() > 0 ? extent.width() : 1;
+  const double height = extent.height() > 0 ? extent.height() : 1;
+  std::vector< std::pair< quint32, int > > keys;
+  keys.reserve( geometries.size() );
+  for ( int i = 0; i < geometries.size(); ++i )
+  {
+    const QgsPointXY center = boxes[i].center();
+    const quint32 x = static_cast< quint32 >( qBound( 0.0, 0xffff * ( center.x() - extent.xMinimum() ) / width, 65535.0 ) );
+    const quint32 y = static_cast< quint32 >( qBound( 0.0, 0xffff * ( center.y() - extent.yMinimum() ) / height, 65535.0 ) );
+    keys.emplace_back( interleaveBits( x ) | ( interleaveBits( y ) << 1 ), i );
+  }
+  std::sort( keys.begin(), keys.end() );
+
+  QVector< QgsGeometry > sorted;
+  sorted.reserve( geometries.size() );
+  for ( const std::pair< quint32, int > &key : keys )
+    sorted << geometries.at( key.second );
+  geometries = sorted;
+}
+
+QgsGeometry QgsCollectorAlgorithm::cascadedCollect( QVector<QgsGeometry> geometries, const std::function<QgsGeometry( const QVector<QgsGeometry> & )> &collector, int chunkSize, QgsProcessingFeedback *feedback )
+{
+  if ( chunkSize <= 0 || geometries.size() <= chunkSize )
+    return collector( geometries );
+
+  struct CollectJob
+  {
+    QVector< QgsGeometry > parts;
+    QgsGeometry result;
+    QString error;
+  };
+
+  // collect chunks of spatially close geometries in parallel, then reduce the partial results the same way, a few at a time
+  sortSpatially( geometries );
+  int size = chunkSize;
+  while ( geometries.size() > size )
+  {
+    if ( feedback && feedback->isCanceled() )
+      return QgsGeometry();
+
+    std::vector< CollectJob > jobs;
+    jobs.reserve( geometries.size() / size + 1 );
+    for ( int i = 0; i < geometries.size(); i += size )
+    {
+      CollectJob job;
+      job.parts = geometries.mid( i, size );
+      jobs.emplace_back( std::move( job ) );
+    }
+    geometries.clear();
+
+    QtConcurrent::blockingMap( jobs, [&collector]( CollectJob & job )
+    {
+      try
+      {
+        job.result = collector( job.parts );
+      }
+      catch ( QgsProcessingException &e )
+      {
+        job.error = e.what();
+      }
+      job.parts.clear();
+    } );
+
+    geometries.reserve( static_cast< int >( jobs.size() ) );
+    for ( const CollectJob &job : jobs )
+    {
+      if ( !job.error.isEmpty() )
+        throw QgsProcessingException( job.error );
+      if ( !job.result.isNull() )
+        geometries << job.result;
+    }
+    size = COLLECT_REDUCTION_FANOUT;
+  }
+
+  return collector( geometries );
+}
+
 QVariantMap QgsCollectorAlgorithm::processCollection( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback,
     const std::function<QgsGeometry( const QVector< QgsGeometry >& )> &collector, int maxQueueLength, QgsProcessingFeatureSource::Flags sourceFlags )
 {
@@ -41,19 +145,22 @@ QVariantMap QgsCollectorAlgorithm::processCollection( const QVariantMap &paramet
   long count = source->featureCount();
 
   QgsFeature f;
-  QgsFeatureIterator it = source->getFeatures( QgsFeatureRequest(), sourceFlags );
 
   double step = count > 0 ? 100.0 / count : 1;
   int current = 0;
 
+  // when collecting in blocks, enough geometries are queued to keep all threads busy
+  const int batchSize = maxQueueLength > 0 ? maxQueueLength * std::max( 1, QThreadPool::globalInstance()->maxThreadCount() ) : 0;
+
   if ( fields.isEmpty() )
   {
     // dissolve all - not using fields
     bool firstFeature = true;
-    // we dissolve geometries in blocks using unaryUnion
+    // we dissolve geometries in blocks, the previous result is carried over to the next block
     QVector< QgsGeometry > geomQueue;
     QgsFeature outputFeature;
 
+    QgsFeatureIterator it = source->getFeatures( QgsFeatureRequest(), sourceFlags );
     while ( it.nextFeature( f ) )
     {
       if ( feedback->isCanceled() )
@@ -70,10 +177,10 @@ QVariantMap QgsCollectorAlgorithm::processCollection( const QVariantMap &paramet
       if ( f.hasGeometry() && !f.geometry().isNull() )
       {
         geomQueue.append( f.geometry() );
-        if ( maxQueueLength > 0 && geomQueue.length() > maxQueueLength )
+        if ( batchSize > 0 && geomQueue.length() > batchSize )
         {
           // queue too long, combine it
-          QgsGeometry tempOutputGeometry = collector( geomQueue );
+          QgsGeometry tempOutputGeometry = cascadedCollect( geomQueue, collector, maxQueueLength, feedback );
           geomQueue.clear();
           geomQueue << tempOutputGeometry;
         }
@@ -83,7 +190,7 @@ QVariantMap QgsCollectorAlgorithm::processCollection( const QVariantMap &paramet
       current++;
     }
 
-    outputFeature.setGeometry( collector( geomQueue ) );
+    outputFeature.setGeometry( cascadedCollect( geomQueue, collector, maxQueueLength, feedback ) );
     sink->addFeature( outputFeature, QgsFeatureSink::FastInsert );
   }
   else
@@ -97,9 +204,19 @@ QVariantMap QgsCollectorAlgorithm::processCollection( const QVariantMap &paramet
         fieldIndexes << index;
     }
 
-    QHash< QVariant, QgsAttributes > attributeHash;
-    QHash< QVariant, QVector< QgsGeometry > > geometryHash;
-
+    struct CollectGroup
+    {
+      QgsAttributes attributes;
+      QVector< QgsFeatureId > ids;
+      QVector< QgsGeometry > geometries;
+      QgsGeometry result;
+      QString error;
+    };
+
+    // first pass: find the groups, in the order they first appear, without fetching any geometry
+    std::vector< CollectGroup > groups;
+    QHash< QVariant, int > groupIndex;
+    QgsFeatureIterator it = source->getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ), sourceFlags );
     while ( it.nextFeature( f ) )
     {
       if ( feedback->isCanceled() )
@@ -114,42 +231,104 @@ QVariantMap QgsCollectorAlgorithm::processCollection( const QVariantMap &paramet
         indexAttributes << f.attribute( index );
       }
 
-      if ( !attributeHash.contains( indexAttributes ) )
+      auto groupIt = groupIndex.constFind( indexAttributes );
+      if ( groupIt == groupIndex.constEnd() )
       {
         // keep attributes of first feature
-        attributeHash.insert( indexAttributes, f.attributes() );
+        CollectGroup group;
+        group.attributes = f.attributes();
+        groupIt = groupIndex.insert( indexAttributes, static_cast< int >( groups.size() ) );
+        groups.emplace_back( std::move( group ) );
       }
-
-      if ( f.hasGeometry() && !f.geometry().isNull() )
+      groups[ *groupIt ].ids << f.id();
+    }
+    groupIndex.clear();
+
+    // second pass: fetch the geometries of a few groups at a time and collect these groups in parallel, so that
+    // memory use is bounded by the largest group instead of the whole source
+    const int featureBudget = batchSize > GROUP_FEATURE_BUDGET ? batchSize : GROUP_FEATURE_BUDGET;
+    const int numberFeatures = static_cast< int >( groups.size() );
+    size_t first = 0;
+    while ( first < groups.size() && !feedback->isCanceled() )
+    {
+      size_t last = first;
+      int chunkFeatures = 0;
+      QHash< QgsFeatureId, int > featureGroup;
+      QgsFeatureIds ids;
+      while ( last < groups.size() && ( last == first || chunkFeatures + groups[last].ids.size() <= featureBudget ) )
       {
-        geometryHash[ indexAttributes ].append( f.geometry() );
+        for ( QgsFeatureId id : qgis::as_const( groups[last].ids ) )
+        {
+          featureGroup.insert( id, static_cast< int >( last ) );
+          ids.insert( id );
+        }
+        chunkFeatures += groups[last].ids.size();
+        ++last;
       }
-    }
 
-    int numberFeatures = attributeHash.count();
-    QHash< QVariant, QgsAttributes >::const_iterator attrIt = attributeHash.constBegin();
-    for ( ; attrIt != attributeHash.constEnd(); ++attrIt )
-    {
+      QgsFeatureRequest request;
+      request.setFilterFids( ids );
+      request.setNoAttributes();
+      QgsFeatureIterator groupFeatures = source->getFeatures( request, sourceFlags );
+      while ( groupFeatures.nextFeature( f ) )
+      {
+        if ( feedback->isCanceled() )
+        {
+          break;
+        }
+
+        if ( f.hasGeometry() && !f.geometry().isNull() )
+        {
+          groups[ featureGroup.value( f.id() ) ].geometries.append( f.geometry() );
+        }
+      }
       if ( feedback->isCanceled() )
       {
         break;
       }
 
-      QgsFeature outputFeature;
-      if ( geometryHash.contains( attrIt.key() ) )
+      QtConcurrent::blockingMap( groups.begin() + first, groups.begin() + last, [ =, &collector ]( CollectGroup & group )
       {
-        QgsGeometry geom = collector( geometryHash.value( attrIt.key() ) );
-        if ( !geom.isMultipart() )
+        if ( group.geometries.isEmpty() || feedback->isCanceled() )
+          return;
+
+        try
         {
-          geom.convertToMultiType();
+          group.result = cascadedCollect( group.geometries, collector, maxQueueLength, feedback );
         }
-        outputFeature.setGeometry( geom );
-      }
-      outputFeature.setAttributes( attrIt.value() );
-      sink->addFeature( outputFeature, QgsFeatureSink::FastInsert );
+        catch ( QgsProcessingException &e )
+        {
+          group.error = e.what();
+        }
+        group.geometries.clear();
+      } );
 
-      feedback->setProgress( current * 100.0 / numberFeatures );
-      current++;
+      for ( size_t i = first; i < last; ++i )
+      {
+        CollectGroup &group = groups[i];
+        if ( !group.error.isEmpty() )
+          throw QgsProcessingException( group.error );
+
+        QgsFeature outputFeature;
+        if ( !group.result.isNull() )
+        {
+          QgsGeometry geom = group.result;
+          if ( !geom.isMultipart() )
+          {
+            geom.convertToMultiType();
+          }
+          outputFeature.setGeometry( geom );
+        }
+        outputFeature.setAttributes( group.attributes );
+        sink->addFeature( outputFeature, QgsFeatureSink::FastInsert );
+
+        // release the memory of this group
+        group = CollectGroup();
+
+        feedback->setProgress( current * 100.0 / numberFeatures );
+        current++;
+      }
+      first = last;
     }
   }
 
@@ -214,6 +393,8 @@ QgsDissolveAlgorithm *QgsDissolveAlgorithm::createInstance() const
 
 QVariantMap QgsDissolveAlgorithm::processAlgorithm( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback )
 {
+  // parts are dissolved from multiple threads, so access to the feedback log must be serialized
+  QMutex feedbackMutex;
   return processCollection( parameters, context, feedback, [ & ]( const QVector< QgsGeometry > &parts )->QgsGeometry
   {
     QgsGeometry result( QgsGeometry::unaryUnion( parts ) );
@@ -226,7 +407,10 @@ QVariantMap QgsDissolveAlgorithm::processAlgorithm( const QVariantMap &parameter
       if ( feedback->isCanceled() )
         return result;
 
-      feedback->pushDebugInfo( QObject::tr( "GEOS exception: taking the slower route ..." ) );
+      {
+        QMutexLocker locker( &feedbackMutex );
+        feedback->pushDebugInfo( QObject::tr( "GEOS exception: taking the slower route ..." ) );
+      }
       result = QgsGeometry();
       for ( const auto &p : parts )
       {
@@ -239,7 +423,10 @@ QVariantMap QgsDissolveAlgorithm::processAlgorithm( const QVariantMap &parameter
     }
     if ( ! result.lastError().isEmpty() )
     {
-      feedback->reportError( result.lastError(), true );
+      {
+        QMutexLocker locker( &feedbackMutex );
+        feedback->reportError( result.lastError(), true );
+      }
       if ( result.isEmpty() )
         throw QgsProcessingException( QObject::tr( "The algorithm returned no output." ) );
     }
@@ -35,6 +35,21 @@ class QgsCollectorAlgorithm : public QgsProcessingAlgorithm
 
     QVariantMap processCollection( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback,
                                    const std::function<QgsGeometry( const QVector<QgsGeometry>& )> &collector, int maxQueueLength = 0, QgsProcessingFeatureSource::Flags sourceFlags = QgsProcessingFeatureSource::Flags() );
+
+    /**
+     * Collects \a geometries using \a collector. If there are more than \a chunkSize geometries, they are sorted
+     * spatially and collected in chunks of \a chunkSize geometries in parallel, and the partial results are then
+     * reduced hierarchically. The \a collector must be safe to call from multiple threads.
+     */
+    static QgsGeometry cascadedCollect( QVector<QgsGeometry> geometries, const std::function<QgsGeometry( const QVector<QgsGeometry>& )> &collector, int chunkSize, QgsProcessingFeedback *feedback );
+
+  private:
+
+    //! Number of partial results combined together at each reduction level of cascadedCollect()
+    static const int COLLECT_REDUCTION_FANOUT = 4;
+
+    //! Maximum number of features fetched at once when collecting by groups, unless a single group is larger
+    static const int GROUP_FEATURE_BUDGET = 100000;
 };
 
 /**
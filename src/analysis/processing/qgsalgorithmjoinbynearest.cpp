@@ -18,6 +18,7 @@
 #include "qgsalgorithmjoinbynearest.h"
 #include "qgsprocessingoutputs.h"
 #include "qgslinestring.h"
+#include "qgsspatialindexkdbush.h"
 
 #include <algorithm>
 
@@ -193,7 +194,7 @@ QVariantMap QgsJoinByNearestAlgorithm::processAlgorithm( const QVariantMap &para
   QHash< QgsFeatureId, QgsAttributes > input2AttributeCache;
   double step = input2->featureCount() > 0 ? 50.0 / input2->featureCount() : 1;
   int i = 0;
-  QgsSpatialIndex index( f2, [&]( const QgsFeature & f )->bool
+  auto cacheAttributes = [&]( const QgsFeature & f )->bool
   {
     i++;
     if ( feedback->isCanceled() )
@@ -215,7 +216,18 @@ QVariantMap QgsJoinByNearestAlgorithm::processAlgorithm( const QVariantMap &para
     input2AttributeCache.insert( f.id(), attributes );
 
     return true;
-  }, QgsSpatialIndex::FlagStoreFeatureGeometries );
+  };
+
+  // when joining points to points, a KDBush index gives the exact nearest points directly,
+  // without storing geometries or computing shortest lines
+  const bool pointsToPoints = QgsWkbTypes::flatType( input->wkbType() ) == QgsWkbTypes::Point
+                              && QgsWkbTypes::flatType( input2->wkbType() ) == QgsWkbTypes::Point;
+  std::unique_ptr< QgsSpatialIndexKDBush > pointIndex;
+  QgsSpatialIndex index;
+  if ( pointsToPoints )
+    pointIndex = qgis::make_unique< QgsSpatialIndexKDBush >( f2, cacheAttributes );
+  else
+    index = QgsSpatialIndex( f2, cacheAttributes, QgsSpatialIndex::FlagStoreFeatureGeometries );
 
   QgsFeature f;
 
@@ -264,7 +276,21 @@ QVariantMap QgsJoinByNearestAlgorithm::processAlgorithm( const QVariantMap &para
       // if the user didn't specify a distance (isnan), then use 0 for nearestNeighbor() parameter
       // if the user specified 0 exactly, then use the smallest positive double value instead
       const double searchDistance = std::isnan( maxDistance ) ? 0 : std::max( std::numeric_limits<double>::min(), maxDistance );
-      const QList< QgsFeatureId > nearest = index.nearestNeighbor( f.geometry(), neighbors + ( sameSourceAndTarget ? 1 : 0 ), searchDistance );
+      QList< QgsFeatureId > nearest;
+      QHash< QgsFeatureId, QgsPointXY > nearestPoints;
+      if ( pointIndex )
+      {
+        pointIndex->nearestNeighbors( f.geometry().asPoint(), neighbors + ( sameSourceAndTarget ? 1 : 0 ), searchDistance,
+                                      [&nearest, &nearestPoints]( const QgsSpatialIndexKDBushData & data, double )
+        {
+          nearest << data.id;
+          nearestPoints.insert( data.id, data.point() );
+        } );
+      }
+      else
+      {
+        nearest = index.nearestNeighbor( f.geometry(), neighbors + ( sameSourceAndTarget ? 1 : 0 ), searchDistance );
+      }
 
       if ( nearest.count() > neighbors + ( sameSourceAndTarget ? 1 : 0 ) )
       {
@@ -284,6 +310,20 @@ QVariantMap QgsJoinByNearestAlgorithm::processAlgorithm( const QVariantMap &para
           attr.append( input2AttributeCache.value( id ) );
           attr.append( j );
 
+          if ( pointIndex )
+          {
+            const QgsPointXY start = f.geometry().asPoint();
+            const QgsPointXY end = nearestPoints.value( id );
+            attr.append( start.distance( end ) );
+            attr.append( start.x() );
+            attr.append( start.y() );
+            attr.append( end.x() );
+            attr.append( end.y() );
+            out.setAttributes( attr );
+            sink->addFeature( out, QgsFeatureSink::FastInsert );
+            continue;
+          }
+
           const QgsGeometry closestLine = f.geometry().shortestLine( index.geometry( id ) );
           if ( const QgsLineString *line = qgsgeometry_cast< const QgsLineString *>( closestLine.constGet() ) )
           {
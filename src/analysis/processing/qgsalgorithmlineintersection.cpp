@@ -107,7 +107,8 @@ QVariantMap QgsLineIntersectionAlgorithm::processAlgorithm( const QVariantMap &p
   if ( !sink )
     throw QgsProcessingException( invalidSinkError( parameters, QStringLiteral( "OUTPUT" ) ) );
 
-  QgsSpatialIndex spatialIndex( sourceB->getFeatures( QgsFeatureRequest().setNoAttributes().setDestinationCrs( sourceA->sourceCrs(), context.transformContext() ) ), feedback );
+  QgsSpatialIndex spatialIndex = QgsProcessingUtils::createSpatialIndex( *sourceB, parameterAsVectorLayer( parameters, QStringLiteral( "INTERSECT" ), context ),
+                                 QgsFeatureRequest().setNoAttributes().setDestinationCrs( sourceA->sourceCrs(), context.transformContext() ), feedback );
   QgsFeature outFeature;
   QgsFeatureIterator features = sourceA->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( fieldIndicesA ) );
   double step = sourceA->featureCount() > 0 ? 100.0 / sourceA->featureCount() : 1;
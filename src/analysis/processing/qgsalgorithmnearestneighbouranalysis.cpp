@@ -17,6 +17,7 @@
 
 #include "qgsalgorithmnearestneighbouranalysis.h"
 #include "qgsapplication.h"
+#include "qgsspatialindexkdbush.h"
 
 ///@cond PRIVATE
 
@@ -87,7 +88,14 @@ QVariantMap QgsNearestNeighbourAnalysisAlgorithm::processAlgorithm( const QVaria
 
   QString outputFile = parameterAsFileOutput( parameters, QStringLiteral( "OUTPUT_HTML_FILE" ), context );
 
-  QgsSpatialIndex spatialIndex( *source, feedback, QgsSpatialIndex::FlagStoreFeatureGeometries );
+  // single point sources use a KDBush index, which gives exact nearest neighbors and point coordinates directly
+  std::unique_ptr< QgsSpatialIndexKDBush > pointIndex;
+  QgsSpatialIndex spatialIndex;
+  if ( QgsWkbTypes::flatType( source->wkbType() ) == QgsWkbTypes::Point )
+    pointIndex = qgis::make_unique< QgsSpatialIndexKDBush >( *source, feedback );
+  else
+    spatialIndex = QgsProcessingUtils::createSpatialIndex( *source, parameterAsVectorLayer( parameters, QStringLiteral( "INPUT" ), context ),
+                   QgsFeatureRequest().setNoAttributes(), feedback, QgsSpatialIndex::FlagStoreFeatureGeometries );
   QgsDistanceArea da;
   da.setSourceCrs( source->sourceCrs(), context.transformContext() );
   da.setEllipsoid( context.ellipsoid() );
@@ -109,8 +117,30 @@ QVariantMap QgsNearestNeighbourAnalysisAlgorithm::processAlgorithm( const QVaria
       break;
     }
 
-    QgsFeatureId neighbourId = spatialIndex.nearestNeighbor( f.geometry().asPoint(), 2 ).at( 1 );
-    sumDist += da.measureLine( spatialIndex.geometry( neighbourId ).asPoint(), f.geometry().asPoint() );
+    const QgsPointXY point = f.geometry().asPoint();
+    if ( pointIndex )
+    {
+      // the feature itself is always one of the two nearest neighbors, but not necessarily the first one
+      // when there are duplicate points
+      bool found = false;
+      QgsPointXY neighbour;
+      pointIndex->nearestNeighbors( point, 2, 0, [&]( const QgsSpatialIndexKDBushData & data, double )
+      {
+        if ( !found && data.id != f.id() )
+        {
+          neighbour = data.point();
+          found = true;
+        }
+      } );
+      if ( found )
+        sumDist += da.measureLine( neighbour, point );
+    }
+    else
+    {
+      const QList< QgsFeatureId > neighbours = spatialIndex.nearestNeighbor( point, 2 );
+      if ( neighbours.size() > 1 )
+        sumDist += da.measureLine( spatialIndex.geometry( neighbours.at( 1 ) ).asPoint(), point );
+    }
 
     i++;
     feedback->setProgress( i * step );
@@ -18,9 +18,12 @@
 #include "qgsalgorithmnetworkanalysisbase.h"
 
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
 #include "qgsnetworkspeedstrategy.h"
 #include "qgsnetworkdistancestrategy.h"
 
+#include <QDir>
+
 ///@cond PRIVATE
 
 //
@@ -135,6 +138,63 @@ void QgsNetworkAnalysisAlgorithmBase::loadCommonParams( const QVariantMap &param
   mBuilder = qgis::make_unique< QgsGraphBuilder >( mNetwork->sourceCrs(), true, tolerance );
 }
 
+void QgsNetworkAnalysisAlgorithmBase::addContractionHierarchyParams()
+{
+  std::unique_ptr< QgsProcessingParameterBoolean > useHierarchy = qgis::make_unique< QgsProcessingParameterBoolean >( QStringLiteral( "CONTRACTION_HIERARCHY" ),
+      QObject::tr( "Preprocess network as contraction hierarchy (faster for many paths)" ), false, true );
+  useHierarchy->setFlags( useHierarchy->flags() | QgsProcessingParameterDefinition::FlagAdvanced );
+  addParameter( useHierarchy.release() );
+
+  std::unique_ptr< QgsProcessingParameterFile > cacheDirectory = qgis::make_unique< QgsProcessingParameterFile >( QStringLiteral( "CONTRACTION_HIERARCHY_CACHE" ),
+      QObject::tr( "Contraction hierarchy cache directory" ), QgsProcessingParameterFile::Folder, QString(), QVariant(), true );
+  cacheDirectory->setFlags( cacheDirectory->flags() | QgsProcessingParameterDefinition::FlagAdvanced );
+  addParameter( cacheDirectory.release() );
+}
+
+QgsContractionHierarchy QgsNetworkAnalysisAlgorithmBase::loadContractionHierarchy( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback )
+{
+  if ( !parameterAsBoolean( parameters, QStringLiteral( "CONTRACTION_HIERARCHY" ), context ) )
+    return QgsContractionHierarchy();
+
+  std::unique_ptr< QgsCompactGraph > compactGraph( mBuilder->compactGraph() );
+  if ( !compactGraph )
+    return QgsContractionHierarchy();
+  const QgsCompactGraph &graph = *compactGraph;
+
+  // the graph includes the vertices snapped from the input points, so hierarchies are keyed on the whole graph
+  // rather than only on the network source and strategy
+  const QString cacheDirectory = parameterAsFile( parameters, QStringLiteral( "CONTRACTION_HIERARCHY_CACHE" ), context );
+  QString cachePath;
+  if ( !cacheDirectory.isEmpty() )
+  {
+    const QByteArray fingerprint = QgsContractionHierarchy::graphFingerprint( graph, 0 );
+    cachePath = QDir( cacheDirectory ).filePath( QStringLiteral( "%1.qgsch" ).arg( QString::fromLatin1( fingerprint.toHex() ) ) );
+    if ( QFile::exists( cachePath ) )
+    {
+      QString error;
+      const QgsContractionHierarchy hierarchy = QgsContractionHierarchy::fromFile( cachePath, &error );
+      // the file name is not trusted, the stored hierarchy must have been built from the same graph and strategy
+      if ( hierarchy.isValid() && hierarchy.vertexCount() == graph.vertexCount()
+           && hierarchy.fingerprint() == fingerprint && hierarchy.strategyIndex() == 0 )
+      {
+        feedback->pushInfo( QObject::tr( "Using cached contraction hierarchy %1" ).arg( QDir::toNativeSeparators( cachePath ) ) );
+        return hierarchy;
+      }
+      feedback->reportError( error.isEmpty() ? QObject::tr( "Ignoring outdated contraction hierarchy %1" ).arg( QDir::toNativeSeparators( cachePath ) ) : error );
+    }
+  }
+
+  feedback->pushInfo( QObject::tr( "Building contraction hierarchy…" ) );
+  const QgsContractionHierarchy hierarchy = QgsContractionHierarchy::build( graph, 0, feedback );
+  if ( !hierarchy.isValid() || cachePath.isEmpty() )
+    return hierarchy;
+
+  QString error;
+  if ( !QDir().mkpath( cacheDirectory ) || !hierarchy.writeToFile( cachePath, &error ) )
+    feedback->reportError( error.isEmpty() ? QObject::tr( "Could not create directory %1" ).arg( QDir::toNativeSeparators( cacheDirectory ) ) : error );
+  return hierarchy;
+}
+
 void QgsNetworkAnalysisAlgorithmBase::loadPoints( QgsFeatureSource *source, QVector< QgsPointXY > &points, QHash< int, QgsAttributes > &attributes, QgsProcessingContext &context, QgsProcessingFeedback *feedback )
 {
   feedback->pushInfo( QObject::tr( "Loading points…" ) );
@@ -25,6 +25,7 @@
 
 #include "qgsgraph.h"
 #include "qgsgraphbuilder.h"
+#include "qgscontractionhierarchy.h"
 #include "qgsvectorlayerdirector.h"
 #include "qgsapplication.h"
 
@@ -55,6 +56,20 @@ class QgsNetworkAnalysisAlgorithmBase : public QgsProcessingAlgorithm
      */
     void loadCommonParams( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback );
 
+    /**
+     * Adds the parameters controlling the use of a contraction hierarchy for shortest path queries.
+     */
+    void addContractionHierarchyParams();
+
+    /**
+     * Returns the contraction hierarchy of the graph generated by the builder, or an invalid hierarchy
+     * if the algorithm should run plain Dijkstra searches. Must be called before taking the graph from the builder.
+     *
+     * When a cache directory is set, hierarchies are stored there keyed on the graph fingerprint, and
+     * reused by later runs on the same network and strategy.
+     */
+    QgsContractionHierarchy loadContractionHierarchy( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback );
+
     /**
      * Loads point from the feature source for further processing.
      */
@@ -0,0 +1,257 @@
+/***************************************************************************
+                         qgsalgorithmodmatrixfromlayers.cpp
+                         ---------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsalgorithmodmatrixfromlayers.h"
+
+#include "qgscompactgraph.h"
+#include "qgsgraphanalyzer.h"
+
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+///@cond PRIVATE
+
+//! Costs from one origin to all the destinations
+struct OdMatrixRow
+{
+  int originVertex;
+  QVector< double > costs;
+};
+
+//! Number of origins searched from before their rows are written to the sink
+static int odMatrixBatchSize( bool useHierarchy )
+{
+  // hierarchy queries repeat the backward searches from the destinations for each batch, so larger batches pay off
+  return std::max( 1, QThread::idealThreadCount() ) * ( useHierarchy ? 256 : 16 );
+}
+
+QString QgsOdMatrixFromLayersAlgorithm::name() const
+{
+  return QStringLiteral( "odmatrixfromlayers" );
+}
+
+QString QgsOdMatrixFromLayersAlgorithm::displayName() const
+{
+  return QObject::tr( "Origin-destination cost matrix (from layers)" );
+}
+
+QStringList QgsOdMatrixFromLayersAlgorithm::tags() const
+{
+  return QObject::tr( "network,path,shortest,fastest,od,matrix,origin,destination,distance,cost" ).split( ',' );
+}
+
+QString QgsOdMatrixFromLayersAlgorithm::shortHelpString() const
+{
+  return QObject::tr( "This algorithm computes the cost of the optimal (shortest or fastest) route from each point of an origin layer "
+                      "to each point of a destination layer.\n\n"
+                      "The network graph is built once, and the searches from the origins run in parallel. "
+                      "The output table contains one row per origin and destination pair, with a NULL cost "
+                      "when the destination cannot be reached from the origin.\n\n"
+                      "Origins and destinations are identified by the value of the selected ID field, or by their feature ID "
+                      "when no field is selected. Multipoint features contribute one origin or destination per point." );
+}
+
+QgsOdMatrixFromLayersAlgorithm *QgsOdMatrixFromLayersAlgorithm::createInstance() const
+{
+  return new QgsOdMatrixFromLayersAlgorithm();
+}
+
+void QgsOdMatrixFromLayersAlgorithm::initAlgorithm( const QVariantMap & )
+{
+  addCommonParams();
+  addParameter( new QgsProcessingParameterFeatureSource( QStringLiteral( "ORIGINS" ), QObject::tr( "Vector layer with origin points" ), QList< int >() << QgsProcessing::TypeVectorPoint ) );
+  addParameter( new QgsProcessingParameterField( QStringLiteral( "ORIGINS_ID_FIELD" ), QObject::tr( "Origin ID field" ), QVariant(), QStringLiteral( "ORIGINS" ), QgsProcessingParameterField::Any, false, true ) );
+  addParameter( new QgsProcessingParameterFeatureSource( QStringLiteral( "DESTINATIONS" ), QObject::tr( "Vector layer with destination points" ), QList< int >() << QgsProcessing::TypeVectorPoint ) );
+  addParameter( new QgsProcessingParameterField( QStringLiteral( "DESTINATIONS_ID_FIELD" ), QObject::tr( "Destination ID field" ), QVariant(), QStringLiteral( "DESTINATIONS" ), QgsProcessingParameterField::Any, false, true ) );
+  addContractionHierarchyParams();
+
+  addParameter( new QgsProcessingParameterFeatureSink( QStringLiteral( "OUTPUT" ), QObject::tr( "OD matrix" ), QgsProcessing::TypeVector ) );
+}
+
+//! Loads the points of a \a source, with the value of the \a idField of their feature, or its feature ID if \a idField is -1
+static void loadOdPoints( QgsFeatureSource *source, int idField, const QgsCoordinateReferenceSystem &crs, QVector< QgsPointXY > &points, QVector< QVariant > &ids, QgsProcessingContext &context, QgsProcessingFeedback *feedback )
+{
+  QgsFeatureRequest request;
+  request.setDestinationCrs( crs, context.transformContext() );
+  if ( idField >= 0 )
+    request.setSubsetOfAttributes( QgsAttributeList() << idField );
+  else
+    request.setNoAttributes();
+
+  const double step = source->featureCount() > 0 ? 100.0 / source->featureCount() : 0;
+  QgsFeatureIterator features = source->getFeatures( request );
+  QgsFeature feat;
+  int i = 0;
+  while ( features.nextFeature( feat ) )
+  {
+    if ( feedback->isCanceled() )
+      break;
+
+    feedback->setProgress( ++i * step );
+    if ( !feat.hasGeometry() )
+      continue;
+
+    const QVariant id = idField >= 0 ? feat.attribute( idField ) : QVariant( feat.id() );
+    const QgsGeometry geom = feat.geometry();
+    for ( auto it = geom.vertices_begin(); it != geom.vertices_end(); ++it )
+    {
+      points.push_back( QgsPointXY( *it ) );
+      ids.push_back( id );
+    }
+  }
+}
+
+QVariantMap QgsOdMatrixFromLayersAlgorithm::processAlgorithm( const QVariantMap &parameters, QgsProcessingContext &context, QgsProcessingFeedback *feedback )
+{
+  loadCommonParams( parameters, context, feedback );
+
+  std::unique_ptr< QgsFeatureSource > origins( parameterAsSource( parameters, QStringLiteral( "ORIGINS" ), context ) );
+  if ( !origins )
+    throw QgsProcessingException( invalidSourceError( parameters, QStringLiteral( "ORIGINS" ) ) );
+
+  std::unique_ptr< QgsFeatureSource > destinations( parameterAsSource( parameters, QStringLiteral( "DESTINATIONS" ), context ) );
+  if ( !destinations )
+    throw QgsProcessingException( invalidSourceError( parameters, QStringLiteral( "DESTINATIONS" ) ) );
+
+  const QString originIdFieldName = parameterAsString( parameters, QStringLiteral( "ORIGINS_ID_FIELD" ), context );
+  const int originIdField = originIdFieldName.isEmpty() ? -1 : origins->fields().lookupField( originIdFieldName );
+  const QString destinationIdFieldName = parameterAsString( parameters, QStringLiteral( "DESTINATIONS_ID_FIELD" ), context );
+  const int destinationIdField = destinationIdFieldName.isEmpty() ? -1 : destinations->fields().lookupField( destinationIdFieldName );
+
+  QgsField originIdOutputField = originIdField >= 0 ? origins->fields().at( originIdField ) : QgsField( QString(), QVariant::LongLong );
+  originIdOutputField.setName( QStringLiteral( "origin_id" ) );
+  QgsField destinationIdOutputField = destinationIdField >= 0 ? destinations->fields().at( destinationIdField ) : QgsField( QString(), QVariant::LongLong );
+  destinationIdOutputField.setName( QStringLiteral( "destination_id" ) );
+
+  QgsFields fields;
+  fields.append( originIdOutputField );
+  fields.append( destinationIdOutputField );
+  fields.append( QgsField( QStringLiteral( "cost" ), QVariant::Double ) );
+
+  QString dest;
+  std::unique_ptr< QgsFeatureSink > sink( parameterAsSink( parameters, QStringLiteral( "OUTPUT" ), context, dest, fields, QgsWkbTypes::NoGeometry, QgsCoordinateReferenceSystem() ) );
+  if ( !sink )
+    throw QgsProcessingException( invalidSinkError( parameters, QStringLiteral( "OUTPUT" ) ) );
+
+  feedback->pushInfo( QObject::tr( "Loading points…" ) );
+  QVector< QgsPointXY > points;
+  QVector< QVariant > originIds;
+  loadOdPoints( origins.get(), originIdField, mNetwork->sourceCrs(), points, originIds, context, feedback );
+  const int originCount = points.size();
+  QVector< QVariant > destinationIds;
+  loadOdPoints( destinations.get(), destinationIdField, mNetwork->sourceCrs(), points, destinationIds, context, feedback );
+  const int destinationCount = points.size() - originCount;
+  if ( feedback->isCanceled() )
+    return QVariantMap();
+
+  feedback->pushInfo( QObject::tr( "Building graph…" ) );
+  QVector< QgsPointXY > snappedPoints;
+  mDirector->makeGraph( mBuilder.get(), points, snappedPoints, feedback );
+  if ( feedback->isCanceled() )
+    return QVariantMap();
+
+  const QgsContractionHierarchy hierarchy = loadContractionHierarchy( parameters, context, feedback );
+  if ( feedback->isCanceled() )
+    return QVariantMap();
+
+  std::unique_ptr< QgsGraph > graph( mBuilder->graph() );
+  QVector< int > destinationVertices;
+  destinationVertices.reserve( destinationCount );
+  for ( int i = originCount; i < points.size(); ++i )
+    destinationVertices.append( graph->findVertex( snappedPoints.at( i ) ) );
+
+  QVector< OdMatrixRow > rows;
+  rows.reserve( originCount );
+  for ( int i = 0; i < originCount; ++i )
+    rows.append( OdMatrixRow { graph->findVertex( snappedPoints.at( i ) ), QVector< double >() } );
+
+  // searches only need the flat arrays of the compact graph
+  std::unique_ptr< QgsCompactGraph > compactGraph;
+  if ( !hierarchy.isValid() )
+    compactGraph = qgis::make_unique< QgsCompactGraph >( *graph );
+  graph.reset();
+
+  feedback->pushInfo( QObject::tr( "Calculating OD matrix…" ) );
+  const int batchSize = odMatrixBatchSize( hierarchy.isValid() );
+  for ( int first = 0; first < originCount; first += batchSize )
+  {
+    if ( feedback->isCanceled() )
+      break;
+
+    const int last = std::min( first + batchSize, originCount );
+    if ( hierarchy.isValid() )
+    {
+      QVector< int > batchVertices;
+      batchVertices.reserve( last - first );
+      for ( int i = first; i < last; ++i )
+        batchVertices.append( rows.at( i ).originVertex );
+
+      const QVector< QVector< double > > matrix = hierarchy.costMatrix( batchVertices, destinationVertices );
+      for ( int i = first; i < last; ++i )
+        rows[ i ].costs = matrix.at( i - first );
+    }
+    else
+    {
+      const QgsCompactGraph *searchGraph = compactGraph.get();
+      QtConcurrent::blockingMap( rows.begin() + first, rows.begin() + last, [searchGraph, &destinationVertices, feedback]( OdMatrixRow & row )
+      {
+        row.costs.fill( std::numeric_limits< double >::infinity(), destinationVertices.size() );
+        if ( row.originVertex < 0 || feedback->isCanceled() )
+          return;
+
+        QVector< double > vertexCosts;
+        QgsGraphAnalyzer::dijkstra( searchGraph, row.originVertex, 0, nullptr, &vertexCosts );
+        for ( int j = 0; j < destinationVertices.size(); ++j )
+        {
+          const int destinationVertex = destinationVertices.at( j );
+          if ( destinationVertex >= 0 )
+            row.costs[ j ] = vertexCosts.at( destinationVertex );
+        }
+      } );
+    }
+    if ( feedback->isCanceled() )
+      break;
+
+    // rows are streamed to the sink batch by batch, so the whole matrix is never held in memory
+    QgsFeature feat;
+    feat.setFields( fields );
+    for ( int i = first; i < last; ++i )
+    {
+      OdMatrixRow &row = rows[ i ];
+      for ( int j = 0; j < destinationCount; ++j )
+      {
+        const double cost = row.costs.at( j );
+        feat.setAttributes( QgsAttributes() << originIds.at( i ) << destinationIds.at( j )
+                            << ( std::isfinite( cost ) ? QVariant( cost / mMultiplier ) : QVariant() ) );
+        sink->addFeature( feat, QgsFeatureSink::FastInsert );
+      }
+      row.costs = QVector< double >();
+    }
+
+    feedback->setProgress( 100.0 * last / originCount );
+  }
+
+  QVariantMap outputs;
+  outputs.insert( QStringLiteral( "OUTPUT" ), dest );
+  return outputs;
+}
+
+///@endcond
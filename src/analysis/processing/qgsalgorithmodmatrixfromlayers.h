@@ -0,0 +1,53 @@
+/***************************************************************************
+                         qgsalgorithmodmatrixfromlayers.h
+                         ---------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSALGORITHMODMATRIXFROMLAYERS_H
+#define QGSALGORITHMODMATRIXFROMLAYERS_H
+
+#define SIP_NO_FILE
+
+#include "qgis_sip.h"
+#include "qgsalgorithmnetworkanalysisbase.h"
+
+///@cond PRIVATE
+
+/**
+ * Native origin-destination cost matrix algorithm.
+ */
+class QgsOdMatrixFromLayersAlgorithm : public QgsNetworkAnalysisAlgorithmBase
+{
+
+  public:
+
+    QgsOdMatrixFromLayersAlgorithm() = default;
+    void initAlgorithm( const QVariantMap &configuration = QVariantMap() ) override;
+    QString name() const override;
+    QString displayName() const override;
+    QStringList tags() const override;
+    QString shortHelpString() const override;
+    QgsOdMatrixFromLayersAlgorithm *createInstance() const override SIP_FACTORY;
+
+  protected:
+
+    QVariantMap processAlgorithm( const QVariantMap &parameters,
+                                  QgsProcessingContext &context, QgsProcessingFeedback *feedback ) override;
+
+};
+
+///@endcond PRIVATE
+
+#endif // QGSALGORITHMODMATRIXFROMLAYERS_H
@@ -53,6 +53,7 @@ void QgsShortestPathLayerToPointAlgorithm::initAlgorithm( const QVariantMap & )
   addCommonParams();
   addParameter( new QgsProcessingParameterFeatureSource( QStringLiteral( "START_POINTS" ), QObject::tr( "Vector layer with start points" ), QList< int >() << QgsProcessing::TypeVectorPoint ) );
   addParameter( new QgsProcessingParameterPoint( QStringLiteral( "END_POINT" ), QObject::tr( "End point" ) ) );
+  addContractionHierarchyParams();
 
   addParameter( new QgsProcessingParameterFeatureSink( QStringLiteral( "OUTPUT" ), QObject::tr( "Shortest path" ), QgsProcessing::TypeVectorLine ) );
 }
@@ -86,6 +87,10 @@ QVariantMap QgsShortestPathLayerToPointAlgorithm::processAlgorithm( const QVaria
   QVector< QgsPointXY > snappedPoints;
   mDirector->makeGraph( mBuilder.get(), points, snappedPoints, feedback );
 
+  const QgsContractionHierarchy hierarchy = loadContractionHierarchy( parameters, context, feedback );
+  if ( feedback->isCanceled() )
+    return QVariantMap();
+
   feedback->pushInfo( QObject::tr( "Calculating shortest paths…" ) );
   QgsGraph *graph = mBuilder->graph();
   int idxEnd = graph->findVertex( snappedPoints[0] );
@@ -111,9 +116,35 @@ QVariantMap QgsShortestPathLayerToPointAlgorithm::processAlgorithm( const QVaria
     }
 
     idxStart = graph->findVertex( snappedPoints[i] );
-    QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
+    route.clear();
+    if ( hierarchy.isValid() )
+    {
+      const QVector< int > path = hierarchy.shortestPath( idxStart, idxEnd, &cost );
+      // as with Dijkstra searches, a start vertex matching the end vertex has no route
+      if ( !path.isEmpty() )
+      {
+        route.push_back( graph->vertex( idxStart ).point() );
+        for ( int edgeIdx : path )
+          route.push_back( graph->vertex( graph->edge( edgeIdx ).toVertex() ).point() );
+      }
+    }
+    else
+    {
+      QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
+      if ( tree.at( idxEnd ) != -1 )
+      {
+        route.push_front( graph->vertex( idxEnd ).point() );
+        cost = costs.at( idxEnd );
+        currentIdx = idxEnd;
+        while ( currentIdx != idxStart )
+        {
+          currentIdx = graph->edge( tree.at( currentIdx ) ).fromVertex();
+          route.push_front( graph->vertex( currentIdx ).point() );
+        }
+      }
+    }
 
-    if ( tree.at( idxEnd ) == -1 )
+    if ( route.isEmpty() )
     {
       feedback->reportError( QObject::tr( "There is no route from start point (%1) to end point (%2)." )
                              .arg( points[i].toString(),
@@ -126,16 +157,6 @@ QVariantMap QgsShortestPathLayerToPointAlgorithm::processAlgorithm( const QVaria
       continue;
     }
 
-    route.clear();
-    route.push_front( graph->vertex( idxEnd ).point() );
-    cost = costs.at( idxEnd );
-    currentIdx = idxEnd;
-    while ( currentIdx != idxStart )
-    {
-      currentIdx = graph->edge( tree.at( currentIdx ) ).fromVertex();
-      route.push_front( graph->vertex( currentIdx ).point() );
-    }
-
     QgsGeometry geom = QgsGeometry::fromPolylineXY( route );
     QgsFeature feat;
     feat.setFields( fields );
@@ -53,6 +53,7 @@ void QgsShortestPathPointToLayerAlgorithm::initAlgorithm( const QVariantMap & )
   addCommonParams();
   addParameter( new QgsProcessingParameterPoint( QStringLiteral( "START_POINT" ), QObject::tr( "Start point" ) ) );
   addParameter( new QgsProcessingParameterFeatureSource( QStringLiteral( "END_POINTS" ), QObject::tr( "Vector layer with end points" ), QList< int >() << QgsProcessing::TypeVectorPoint ) );
+  addContractionHierarchyParams();
 
   addParameter( new QgsProcessingParameterFeatureSink( QStringLiteral( "OUTPUT" ), QObject::tr( "Shortest path" ), QgsProcessing::TypeVectorLine ) );
 }
@@ -86,6 +87,13 @@ QVariantMap QgsShortestPathPointToLayerAlgorithm::processAlgorithm( const QVaria
   QVector< QgsPointXY > snappedPoints;
   mDirector->makeGraph( mBuilder.get(), points, snappedPoints, feedback );
 
+  // a single search from the start point reaches all the end points, so a hierarchy only pays off when it is cached
+  QgsContractionHierarchy hierarchy;
+  if ( !parameterAsFile( parameters, QStringLiteral( "CONTRACTION_HIERARCHY_CACHE" ), context ).isEmpty() )
+    hierarchy = loadContractionHierarchy( parameters, context, feedback );
+  if ( feedback->isCanceled() )
+    return QVariantMap();
+
   feedback->pushInfo( QObject::tr( "Calculating shortest paths…" ) );
   QgsGraph *graph = mBuilder->graph();
   int idxStart = graph->findVertex( snappedPoints[0] );
@@ -93,7 +101,8 @@ QVariantMap QgsShortestPathPointToLayerAlgorithm::processAlgorithm( const QVaria
 
   QVector< int > tree;
   QVector< double > costs;
-  QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
+  if ( !hierarchy.isValid() )
+    QgsGraphAnalyzer::dijkstra( graph, idxStart, 0, &tree, &costs );
 
   QVector<QgsPointXY> route;
   double cost;
@@ -111,7 +120,30 @@ QVariantMap QgsShortestPathPointToLayerAlgorithm::processAlgorithm( const QVaria
     }
 
     idxEnd = graph->findVertex( snappedPoints[i] );
-    if ( tree.at( idxEnd ) == -1 )
+    route.clear();
+    if ( hierarchy.isValid() )
+    {
+      const QVector< int > path = hierarchy.shortestPath( idxStart, idxEnd, &cost );
+      // as with Dijkstra searches, an end vertex matching the start vertex has no route
+      if ( !path.isEmpty() )
+      {
+        route.push_back( graph->vertex( idxStart ).point() );
+        for ( int edgeIdx : path )
+          route.push_back( graph->vertex( graph->edge( edgeIdx ).toVertex() ).point() );
+      }
+    }
+    else if ( tree.at( idxEnd ) != -1 )
+    {
+      route.push_front( graph->vertex( idxEnd ).point() );
+      cost = costs.at( idxEnd );
+      while ( idxEnd != idxStart )
+      {
+        idxEnd = graph->edge( tree.at( idxEnd ) ).fromVertex();
+        route.push_front( graph->vertex( idxEnd ).point() );
+      }
+    }
+
+    if ( route.isEmpty() )
     {
       feedback->reportError( QObject::tr( "There is no route from start point (%1) to end point (%2)." )
                              .arg( startPoint.toString(),
@@ -125,15 +157,6 @@ QVariantMap QgsShortestPathPointToLayerAlgorithm::processAlgorithm( const QVaria
       continue;
     }
 
-    route.clear();
-    route.push_front( graph->vertex( idxEnd ).point() );
-    cost = costs.at( idxEnd );
-    while ( idxEnd != idxStart )
-    {
-      idxEnd = graph->edge( tree.at( idxEnd ) ).fromVertex();
-      route.push_front( graph->vertex( idxEnd ).point() );
-    }
-
     QgsGeometry geom = QgsGeometry::fromPolylineXY( route );
     QgsFeature feat;
     feat.setFields( fields );
@@ -106,10 +106,10 @@ QVariantMap QgsSplitWithLinesAlgorithm::processAlgorithm( const QVariantMap &par
   request.setNoAttributes();
   request.setDestinationCrs( source->sourceCrs(), context.transformContext() );
 
-  QgsFeatureIterator splitLines = linesSource->getFeatures( request );
   QgsFeature aSplitFeature;
 
-  const QgsSpatialIndex splitLinesIndex( splitLines, feedback, QgsSpatialIndex::FlagStoreFeatureGeometries );
+  const QgsSpatialIndex splitLinesIndex = QgsProcessingUtils::createSpatialIndex( *linesSource, parameterAsVectorLayer( parameters, QStringLiteral( "LINES" ), context ),
+                                          request, feedback, QgsSpatialIndex::FlagStoreFeatureGeometries );
 
   QgsFeature outFeat;
   QgsFeatureIterator features = source->getFeatures();
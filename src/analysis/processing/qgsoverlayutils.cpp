@@ -18,6 +18,10 @@
 #include "qgsgeometryengine.h"
 #include "qgsprocessingalgorithm.h"
 
+#include <QThreadPool>
+#include <QtConcurrentMap>
+#include <functional>
+
 ///@cond PRIVATE
 
 bool QgsOverlayUtils::sanitizeIntersectionResult( QgsGeometry &geom, QgsWkbTypes::GeometryType geometryType )
@@ -82,6 +86,187 @@ static bool sanitizeDifferenceResult( QgsGeometry &geom, QgsWkbTypes::GeometryTy
 }
 
 
+namespace
+{
+  /**
+   * A feature from the first source, the candidate features from the second source which
+   * may overlap it and the output features resulting from the overlay.
+   */
+  struct OverlayJob
+  {
+    QgsFeature feature;
+    QList< QgsFeatureId > candidates;
+    QgsFeatureList results;
+    QString error;
+  };
+}
+
+//! Reads the next batch of up to \a batchSize features from \a fit and collects the ids of their candidates from \a index
+static bool nextOverlayBatch( QgsFeatureIterator &fit, const QgsSpatialIndex &index, int batchSize, std::vector< OverlayJob > &jobs, QgsFeatureIds &candidateIds )
+{
+  jobs.clear();
+  candidateIds.clear();
+
+  QgsFeature f;
+  while ( static_cast< int >( jobs.size() ) < batchSize && fit.nextFeature( f ) )
+  {
+    OverlayJob job;
+    job.feature = f;
+    if ( f.hasGeometry() )
+    {
+      job.candidates = index.intersects( f.geometry().boundingBox() );
+      // candidates are always processed in the same order, so that the output does not depend on the spatial index
+      std::sort( job.candidates.begin(), job.candidates.end() );
+      for ( QgsFeatureId id : qgis::as_const( job.candidates ) )
+        candidateIds.insert( id );
+    }
+    jobs.emplace_back( std::move( job ) );
+  }
+  return !jobs.empty();
+}
+
+//! Fetches the candidate features with the given \a ids, so that they can be shared by all the worker threads
+static QHash< QgsFeatureId, QgsFeature > fetchOverlayCandidates( const QgsFeatureSource &source, const QgsFeatureIds &ids, const QgsFeatureRequest &request, QgsProcessingFeedback *feedback )
+{
+  QHash< QgsFeatureId, QgsFeature > features;
+  if ( ids.isEmpty() )
+    return features;
+
+  features.reserve( ids.size() );
+  QgsFeatureRequest candidatesRequest( request );
+  candidatesRequest.setFilterFids( ids );
+  QgsFeature f;
+  QgsFeatureIterator it = source.getFeatures( candidatesRequest );
+  while ( it.nextFeature( f ) )
+  {
+    if ( feedback->isCanceled() )
+      break;
+
+    if ( !f.hasGeometry() )
+      continue;
+
+    // the geometries are read concurrently by the workers, so fill the lazily calculated bounding box cache now
+    f.geometry().constGet()->boundingBox();
+    features.insert( f.id(), f );
+  }
+  return features;
+}
+
+//! Returns the number of features of the first source overlaid in one batch by the worker threads
+static int overlayBatchSize()
+{
+  return 256 * std::max( 1, QThreadPool::globalInstance()->maxThreadCount() );
+}
+
+//! Runs \a overlay over all \a jobs in parallel, storing any processing error in the job
+static void runOverlayJobs( std::vector< OverlayJob > &jobs, QgsProcessingFeedback *feedback, const std::function< void( OverlayJob & ) > &overlay )
+{
+  QtConcurrent::blockingMap( jobs, [feedback, &overlay]( OverlayJob & job )
+  {
+    if ( feedback->isCanceled() )
+      return;
+
+    try
+    {
+      overlay( job );
+    }
+    catch ( QgsProcessingException &e )
+    {
+      job.error = e.what();
+    }
+  } );
+}
+
+//! Writes the results of \a jobs to \a sink, in the order the features were read from the first source
+static void writeOverlayResults( std::vector< OverlayJob > &jobs, QgsFeatureSink &sink, QgsProcessingFeedback *feedback, int &count, int totalCount )
+{
+  for ( OverlayJob &job : jobs )
+  {
+    if ( !job.error.isEmpty() )
+      throw QgsProcessingException( job.error );
+
+    if ( !job.results.isEmpty() )
+      sink.addFeatures( job.results, QgsFeatureSink::FastInsert );
+
+    ++count;
+  }
+  feedback->setProgress( count / ( double ) totalCount * 100. );
+}
+
+static void differenceFeature( OverlayJob &job, const QHash< QgsFeatureId, QgsFeature > &featuresB, QgsWkbTypes::GeometryType geometryType, QgsOverlayUtils::DifferenceOutput outputAttrs, int fieldsCountA, int fieldsCountB )
+{
+  const QgsFeature &featA = job.feature;
+  if ( !featA.hasGeometry() )
+  {
+    // TODO: should we write out features that do not have geometry?
+    job.results << featA;
+    return;
+  }
+
+  QgsGeometry geom( featA.geometry() );
+
+  std::unique_ptr< QgsGeometryEngine > engine;
+  if ( !job.candidates.isEmpty() )
+  {
+    // use prepared geometries for faster intersection tests
+    engine.reset( QgsGeometry::createGeometryEngine( geom.constGet() ) );
+    engine->prepareGeometry();
+  }
+
+  QVector<QgsGeometry> geometriesB;
+  for ( QgsFeatureId id : qgis::as_const( job.candidates ) )
+  {
+    auto featB = featuresB.constFind( id );
+    if ( featB == featuresB.constEnd() )
+      continue;
+
+    const QgsGeometry geomB = featB->geometry();
+    if ( engine->intersects( geomB.constGet() ) )
+      geometriesB << geomB;
+  }
+
+  if ( !geometriesB.isEmpty() )
+  {
+    QgsGeometry geomB = QgsGeometry::unaryUnion( geometriesB );
+    if ( !geomB.lastError().isEmpty() )
+    {
+      // This may happen if input geometries from a layer do not line up well (for example polygons
+      // that are nearly touching each other, but there is a very tiny overlap or gap at one of the edges).
+      // It is possible to get rid of this issue in two steps:
+      // 1. snap geometries with a small tolerance (e.g. 1cm) using QgsGeometrySnapperSingleSource
+      // 2. fix geometries (removes polygons collapsed to lines etc.) using MakeValid
+      throw QgsProcessingException( QStringLiteral( "%1\n\n%2" ).arg( QObject::tr( "GEOS geoprocessing error: unary union failed." ), geomB.lastError() ) );
+    }
+    geom = geom.difference( geomB );
+  }
+
+  if ( !sanitizeDifferenceResult( geom, geometryType ) )
+    return;
+
+  QgsAttributes attrs;
+  attrs.resize( outputAttrs == QgsOverlayUtils::OutputA ? fieldsCountA : ( fieldsCountA + fieldsCountB ) );
+  const QgsAttributes attrsA( featA.attributes() );
+  switch ( outputAttrs )
+  {
+    case QgsOverlayUtils::OutputA:
+      attrs = attrsA;
+      break;
+    case QgsOverlayUtils::OutputAB:
+      for ( int i = 0; i < fieldsCountA; ++i )
+        attrs[i] = attrsA[i];
+      break;
+    case QgsOverlayUtils::OutputBA:
+      for ( int i = 0; i < fieldsCountA; ++i )
+        attrs[i + fieldsCountB] = attrsA[i];
+      break;
+  }
+
+  QgsFeature outFeat;
+  outFeat.setGeometry( geom );
+  outFeat.setAttributes( attrs );
+  job.results << outFeat;
+}
+
 void QgsOverlayUtils::difference( const QgsFeatureSource &sourceA, const QgsFeatureSource &sourceB, QgsFeatureSink &sink, QgsProcessingContext &context, QgsProcessingFeedback *feedback, int &count, int totalCount, QgsOverlayUtils::DifferenceOutput outputAttrs )
 {
   QgsWkbTypes::GeometryType geometryType = QgsWkbTypes::geometryType( QgsWkbTypes::multiType( sourceA.wkbType() ) );
@@ -91,179 +276,116 @@ void QgsOverlayUtils::difference( const QgsFeatureSource &sourceA, const QgsFeat
     requestB.setDestinationCrs( sourceA.sourceCrs(), context.transformContext() );
   QgsSpatialIndex indexB( sourceB.getFeatures( requestB ), feedback );
 
-  int fieldsCountA = sourceA.fields().count();
-  int fieldsCountB = sourceB.fields().count();
-  QgsAttributes attrs;
-  attrs.resize( outputAttrs == OutputA ? fieldsCountA : ( fieldsCountA + fieldsCountB ) );
+  const int fieldsCountA = sourceA.fields().count();
+  const int fieldsCountB = sourceB.fields().count();
 
   if ( totalCount == 0 )
     totalCount = 1;  // avoid division by zero
 
-  QgsFeature featA;
   QgsFeatureRequest requestA;
   requestA.setInvalidGeometryCheck( context.invalidGeometryCheck() );
   if ( outputAttrs == OutputBA )
     requestA.setDestinationCrs( sourceB.sourceCrs(), context.transformContext() );
   QgsFeatureIterator fitA = sourceA.getFeatures( requestA );
-  while ( fitA.nextFeature( featA ) )
+
+  // features from A are read in batches. The candidate features from B are fetched once for the whole batch,
+  // the GEOS operations are spread over worker threads and the results are written in the order A was read
+  std::vector< OverlayJob > jobs;
+  QgsFeatureIds candidateIds;
+  const int batchSize = overlayBatchSize();
+  while ( !feedback->isCanceled() && nextOverlayBatch( fitA, indexB, batchSize, jobs, candidateIds ) )
   {
-    if ( feedback->isCanceled() )
-      break;
+    const QHash< QgsFeatureId, QgsFeature > featuresB = fetchOverlayCandidates( sourceB, candidateIds, requestB, feedback );
 
-    if ( featA.hasGeometry() )
+    runOverlayJobs( jobs, feedback, [ &, geometryType, outputAttrs, fieldsCountA, fieldsCountB ]( OverlayJob & job )
     {
-      QgsGeometry geom( featA.geometry() );
-      QgsFeatureIds intersects = qgis::listToSet( indexB.intersects( geom.boundingBox() ) );
+      differenceFeature( job, featuresB, geometryType, outputAttrs, fieldsCountA, fieldsCountB );
+    } );
 
-      QgsFeatureRequest request;
-      request.setFilterFids( intersects );
-      request.setNoAttributes();
-      if ( outputAttrs != OutputBA )
-        request.setDestinationCrs( sourceA.sourceCrs(), context.transformContext() );
+    if ( feedback->isCanceled() )
+      break;
 
-      std::unique_ptr< QgsGeometryEngine > engine;
-      if ( !intersects.isEmpty() )
-      {
-        // use prepared geometries for faster intersection tests
-        engine.reset( QgsGeometry::createGeometryEngine( geom.constGet() ) );
-        engine->prepareGeometry();
-      }
+    writeOverlayResults( jobs, sink, feedback, count, totalCount );
+  }
+}
 
-      QVector<QgsGeometry> geometriesB;
-      QgsFeature featB;
-      QgsFeatureIterator fitB = sourceB.getFeatures( request );
-      while ( fitB.nextFeature( featB ) )
-      {
-        if ( feedback->isCanceled() )
-          break;
+static void intersectFeature( OverlayJob &job, const QHash< QgsFeatureId, QgsFeature > &featuresB, QgsWkbTypes::GeometryType geometryType, int attrCount, const QList<int> &fieldIndicesA, const QList<int> &fieldIndicesB )
+{
+  const QgsFeature &featA = job.feature;
+  if ( !featA.hasGeometry() || job.candidates.isEmpty() )
+    return;
 
-        if ( engine->intersects( featB.geometry().constGet() ) )
-          geometriesB << featB.geometry();
-      }
+  QgsGeometry geom( featA.geometry() );
+  // geom is tested and intersected with every candidate, so keep its prepared GEOS representation around
+  geom.setGeosCachingEnabled( true );
 
-      if ( !geometriesB.isEmpty() )
-      {
-        QgsGeometry geomB = QgsGeometry::unaryUnion( geometriesB );
-        if ( !geomB.lastError().isEmpty() )
-        {
-          // This may happen if input geometries from a layer do not line up well (for example polygons
-          // that are nearly touching each other, but there is a very tiny overlap or gap at one of the edges).
-          // It is possible to get rid of this issue in two steps:
-          // 1. snap geometries with a small tolerance (e.g. 1cm) using QgsGeometrySnapperSingleSource
-          // 2. fix geometries (removes polygons collapsed to lines etc.) using MakeValid
-          throw QgsProcessingException( QStringLiteral( "%1\n\n%2" ).arg( QObject::tr( "GEOS geoprocessing error: unary union failed." ), geomB.lastError() ) );
-        }
-        geom = geom.difference( geomB );
-      }
+  QgsAttributes outAttributes( attrCount );
+  const QgsAttributes attrsA( featA.attributes() );
+  for ( int i = 0; i < fieldIndicesA.count(); ++i )
+    outAttributes[i] = attrsA[fieldIndicesA[i]];
 
-      if ( !sanitizeDifferenceResult( geom, geometryType ) )
-        continue;
+  for ( QgsFeatureId id : qgis::as_const( job.candidates ) )
+  {
+    auto featB = featuresB.constFind( id );
+    if ( featB == featuresB.constEnd() )
+      continue;
 
-      const QgsAttributes attrsA( featA.attributes() );
-      switch ( outputAttrs )
-      {
-        case OutputA:
-          attrs = attrsA;
-          break;
-        case OutputAB:
-          for ( int i = 0; i < fieldsCountA; ++i )
-            attrs[i] = attrsA[i];
-          break;
-        case OutputBA:
-          for ( int i = 0; i < fieldsCountA; ++i )
-            attrs[i + fieldsCountB] = attrsA[i];
-          break;
-      }
+    const QgsGeometry tmpGeom( featB->geometry() );
+    if ( !geom.intersects( tmpGeom ) )
+      continue;
 
-      QgsFeature outFeat;
-      outFeat.setGeometry( geom );
-      outFeat.setAttributes( attrs );
-      sink.addFeature( outFeat, QgsFeatureSink::FastInsert );
-    }
-    else
-    {
-      // TODO: should we write out features that do not have geometry?
-      sink.addFeature( featA, QgsFeatureSink::FastInsert );
-    }
+    QgsGeometry intGeom = geom.intersection( tmpGeom );
+    if ( !QgsOverlayUtils::sanitizeIntersectionResult( intGeom, geometryType ) )
+      continue;
 
-    ++count;
-    feedback->setProgress( count / ( double ) totalCount * 100. );
+    const QgsAttributes attrsB( featB->attributes() );
+    for ( int i = 0; i < fieldIndicesB.count(); ++i )
+      outAttributes[fieldIndicesA.count() + i] = attrsB[fieldIndicesB[i]];
+
+    QgsFeature outFeat;
+    outFeat.setGeometry( intGeom );
+    outFeat.setAttributes( outAttributes );
+    job.results << outFeat;
   }
 }
 
-
 void QgsOverlayUtils::intersection( const QgsFeatureSource &sourceA, const QgsFeatureSource &sourceB, QgsFeatureSink &sink, QgsProcessingContext &context, QgsProcessingFeedback *feedback, int &count, int totalCount, const QList<int> &fieldIndicesA, const QList<int> &fieldIndicesB )
 {
   QgsWkbTypes::GeometryType geometryType = QgsWkbTypes::geometryType( QgsWkbTypes::multiType( sourceA.wkbType() ) );
-  int attrCount = fieldIndicesA.count() + fieldIndicesB.count();
+  const int attrCount = fieldIndicesA.count() + fieldIndicesB.count();
 
   QgsFeatureRequest request;
   request.setNoAttributes();
   request.setDestinationCrs( sourceA.sourceCrs(), context.transformContext() );
 
-  QgsFeature outFeat;
   QgsSpatialIndex indexB( sourceB.getFeatures( request ), feedback );
 
   if ( totalCount == 0 )
     totalCount = 1;  // avoid division by zero
 
-  QgsFeature featA;
-  QgsFeatureIterator fitA = sourceA.getFeatures( QgsFeatureRequest().setSubsetOfAttributes( fieldIndicesA ) );
-  while ( fitA.nextFeature( featA ) )
-  {
-    if ( feedback->isCanceled() )
-      break;
-
-    if ( !featA.hasGeometry() )
-      continue;
-
-    QgsGeometry geom( featA.geometry() );
-    QgsFeatureIds intersects = qgis::listToSet( indexB.intersects( geom.boundingBox() ) );
-
-    QgsFeatureRequest request;
-    request.setFilterFids( intersects );
-    request.setDestinationCrs( sourceA.sourceCrs(), context.transformContext() );
-    request.setSubsetOfAttributes( fieldIndicesB );
+  QgsFeatureRequest requestB;
+  requestB.setDestinationCrs( sourceA.sourceCrs(), context.transformContext() );
+  requestB.setSubsetOfAttributes( fieldIndicesB );
 
-    std::unique_ptr< QgsGeometryEngine > engine;
-    if ( !intersects.isEmpty() )
-    {
-      // use prepared geometries for faster intersection tests
-      engine.reset( QgsGeometry::createGeometryEngine( geom.constGet() ) );
-      engine->prepareGeometry();
-    }
+  QgsFeatureIterator fitA = sourceA.getFeatures( QgsFeatureRequest().setSubsetOfAttributes( fieldIndicesA ) );
 
-    QgsAttributes outAttributes( attrCount );
-    const QgsAttributes attrsA( featA.attributes() );
-    for ( int i = 0; i < fieldIndicesA.count(); ++i )
-      outAttributes[i] = attrsA[fieldIndicesA[i]];
+  // see difference() for how the batches are processed
+  std::vector< OverlayJob > jobs;
+  QgsFeatureIds candidateIds;
+  const int batchSize = overlayBatchSize();
+  while ( !feedback->isCanceled() && nextOverlayBatch( fitA, indexB, batchSize, jobs, candidateIds ) )
+  {
+    const QHash< QgsFeatureId, QgsFeature > featuresB = fetchOverlayCandidates( sourceB, candidateIds, requestB, feedback );
 
-    QgsFeature featB;
-    QgsFeatureIterator fitB = sourceB.getFeatures( request );
-    while ( fitB.nextFeature( featB ) )
+    runOverlayJobs( jobs, feedback, [ &, geometryType, attrCount ]( OverlayJob & job )
     {
-      if ( feedback->isCanceled() )
-        break;
-
-      QgsGeometry tmpGeom( featB.geometry() );
-      if ( !engine->intersects( tmpGeom.constGet() ) )
-        continue;
+      intersectFeature( job, featuresB, geometryType, attrCount, fieldIndicesA, fieldIndicesB );
+    } );
 
-      QgsGeometry intGeom = geom.intersection( tmpGeom );
-      if ( !sanitizeIntersectionResult( intGeom, geometryType ) )
-        continue;
-
-      const QgsAttributes attrsB( featB.attributes() );
-      for ( int i = 0; i < fieldIndicesB.count(); ++i )
-        outAttributes[fieldIndicesA.count() + i] = attrsB[fieldIndicesB[i]];
-
-      outFeat.setGeometry( intGeom );
-      outFeat.setAttributes( outAttributes );
-      sink.addFeature( outFeat, QgsFeatureSink::FastInsert );
-    }
+    if ( feedback->isCanceled() )
+      break;
 
-    ++count;
-    feedback->setProgress( count / ( double ) totalCount * 100. );
+    writeOverlayResults( jobs, sink, feedback, count, totalCount );
   }
 }
 
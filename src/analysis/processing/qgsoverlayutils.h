@@ -41,8 +41,19 @@ namespace QgsOverlayUtils
     OutputBA,  //!< Write attributes of both layers, inverted (first attributes of B, then attributes of A)
   };
 
+  /**
+   * Writes the parts of features from \a sourceA which are not covered by any feature from \a sourceB to the \a sink.
+   *
+   * Features from \a sourceA are processed in batches, with the GEOS operations spread over the global thread pool.
+   * The output features are written in the same order as the input features, regardless of the number of threads.
+   */
   void difference( const QgsFeatureSource &sourceA, const QgsFeatureSource &sourceB, QgsFeatureSink &sink, QgsProcessingContext &context, QgsProcessingFeedback *feedback, int &count, int totalCount, DifferenceOutput outputAttrs );
 
+  /**
+   * Writes the intersections of features from \a sourceA with features from \a sourceB to the \a sink.
+   *
+   * Like difference(), this runs the GEOS operations in parallel while keeping the output order deterministic.
+   */
   void intersection( const QgsFeatureSource &sourceA, const QgsFeatureSource &sourceB, QgsFeatureSink &sink, QgsProcessingContext &context, QgsProcessingFeedback *feedback, int &count, int totalCount, const QList<int> &fieldIndicesA, const QList<int> &fieldIndicesB );
 
   //! Makes sure that what came out from intersection of two geometries is good to be used in the output
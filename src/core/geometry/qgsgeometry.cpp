@@ -48,13 +48,63 @@ email                : morb at ozemail dot com dot au
 #include "qgscircle.h"
 #include "qgscurve.h"
 
+#include <QMutex>
+
 struct QgsGeometryPrivate
 {
   QgsGeometryPrivate(): ref( 1 ) {}
   QAtomicInt ref;
   std::unique_ptr< QgsAbstractGeometry > geometry;
+
+  //! TRUE if the GEOS representation of the geometry is kept between GEOS based operations
+  bool cacheGeos = false;
+  //! Serializes the use of the cached GEOS engine, which may be shared between threads through implicit copies
+  QMutex geosMutex;
+  //! GEOS engine (holding the GEOS and prepared geometries), created on first use when cacheGeos is TRUE
+  std::unique_ptr< QgsGeos > geosEngine;
+};
+
+///@cond PRIVATE
+
+/**
+ * Gives access to a GEOS engine for a geometry. When GEOS caching is enabled for the geometry, its cached
+ * engine is used (and created if needed), and locked for the lifetime of this object. Otherwise a temporary
+ * engine is created.
+ */
+class QgsGeometryGeosEngine
+{
+  public:
+
+    explicit QgsGeometryGeosEngine( QgsGeometryPrivate *d )
+    {
+      if ( d->cacheGeos )
+      {
+        mLocker = qgis::make_unique< QMutexLocker >( &d->geosMutex );
+        if ( !d->geosEngine )
+        {
+          d->geosEngine = qgis::make_unique< QgsGeos >( d->geometry.get() );
+          d->geosEngine->prepareGeometry();
+        }
+        mEngine = d->geosEngine.get();
+      }
+      else
+      {
+        mTemporaryEngine = qgis::make_unique< QgsGeos >( d->geometry.get() );
+        mEngine = mTemporaryEngine.get();
+      }
+    }
+
+    QgsGeos *operator->() const { return mEngine; }
+
+  private:
+
+    std::unique_ptr< QMutexLocker > mLocker;
+    std::unique_ptr< QgsGeos > mTemporaryEngine;
+    QgsGeos *mEngine = nullptr;
 };
 
+///@endcond
+
 QgsGeometry::QgsGeometry()
   : d( new QgsGeometryPrivate() )
 {
@@ -106,7 +156,11 @@ QgsGeometry &QgsGeometry::operator=( QgsGeometry const &other )
 void QgsGeometry::detach()
 {
   if ( d->ref <= 1 )
+  {
+    // the geometry is about to be modified in place
+    d->geosEngine.reset();
     return;
+  }
 
   std::unique_ptr< QgsAbstractGeometry > cGeom;
   if ( d->geometry )
@@ -119,12 +173,28 @@ void QgsGeometry::reset( std::unique_ptr<QgsAbstractGeometry> newGeometry )
 {
   if ( d->ref > 1 )
   {
+    const bool cacheGeos = d->cacheGeos;
     ( void )d->ref.deref();
     d = new QgsGeometryPrivate();
+    d->cacheGeos = cacheGeos;
   }
+  d->geosEngine.reset();
   d->geometry = std::move( newGeometry );
 }
 
+void QgsGeometry::setGeosCachingEnabled( bool enabled )
+{
+  QMutexLocker locker( &d->geosMutex );
+  d->cacheGeos = enabled;
+  if ( !enabled )
+    d->geosEngine.reset();
+}
+
+bool QgsGeometry::geosCachingEnabled() const
+{
+  return d->cacheGeos;
+}
+
 const QgsAbstractGeometry *QgsGeometry::constGet() const
 {
   return d->geometry.get();
@@ -614,9 +684,9 @@ QgsGeometry QgsGeometry::nearestPoint( const QgsGeometry &other ) const
     return QgsGeometry( qgsgeometry_cast< const QgsPoint * >( d->geometry.get() )->clone() );
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  QgsGeometry result = geos.closestPoint( other );
+  QgsGeometry result = geos->closestPoint( other );
   result.mLastError = mLastError;
   return result;
 }
@@ -629,9 +699,9 @@ QgsGeometry QgsGeometry::shortestLine( const QgsGeometry &other ) const
     return QgsGeometry( qgis::make_unique< QgsLineString >( *qgsgeometry_cast< const QgsPoint * >( d->geometry.get() ), *qgsgeometry_cast< const QgsPoint * >( other.constGet() ) ) );
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  QgsGeometry result = geos.shortestLine( other, &mLastError );
+  QgsGeometry result = geos->shortestLine( other, &mLastError );
   result.mLastError = mLastError;
   return result;
 }
@@ -978,10 +1048,10 @@ QgsGeometry QgsGeometry::makeDifference( const QgsGeometry &other ) const
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
 
   mLastError.clear();
-  std::unique_ptr< QgsAbstractGeometry > diffGeom( geos.intersection( other.constGet(), &mLastError ) );
+  std::unique_ptr< QgsAbstractGeometry > diffGeom( geos->intersection( other.constGet(), &mLastError ) );
   if ( !diffGeom )
   {
     QgsGeometry result;
@@ -1148,9 +1218,9 @@ bool QgsGeometry::intersects( const QgsGeometry &geometry ) const
     return false;
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.intersects( geometry.d->geometry.get(), &mLastError );
+  return geos->intersects( geometry.d->geometry.get(), &mLastError );
 }
 
 bool QgsGeometry::boundingBoxIntersects( const QgsRectangle &rectangle ) const
@@ -1188,9 +1258,9 @@ bool QgsGeometry::contains( const QgsPointXY *p ) const
   }
 
   QgsPoint pt( p->x(), p->y() );
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.contains( &pt, &mLastError );
+  return geos->contains( &pt, &mLastError );
 }
 
 bool QgsGeometry::contains( const QgsGeometry &geometry ) const
@@ -1200,9 +1270,9 @@ bool QgsGeometry::contains( const QgsGeometry &geometry ) const
     return false;
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.contains( geometry.d->geometry.get(), &mLastError );
+  return geos->contains( geometry.d->geometry.get(), &mLastError );
 }
 
 bool QgsGeometry::disjoint( const QgsGeometry &geometry ) const
@@ -1212,9 +1282,9 @@ bool QgsGeometry::disjoint( const QgsGeometry &geometry ) const
     return false;
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.disjoint( geometry.d->geometry.get(), &mLastError );
+  return geos->disjoint( geometry.d->geometry.get(), &mLastError );
 }
 
 bool QgsGeometry::equals( const QgsGeometry &geometry ) const
@@ -1243,9 +1313,9 @@ bool QgsGeometry::touches( const QgsGeometry &geometry ) const
     return false;
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.touches( geometry.d->geometry.get(), &mLastError );
+  return geos->touches( geometry.d->geometry.get(), &mLastError );
 }
 
 bool QgsGeometry::overlaps( const QgsGeometry &geometry ) const
@@ -1255,9 +1325,9 @@ bool QgsGeometry::overlaps( const QgsGeometry &geometry ) const
     return false;
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.overlaps( geometry.d->geometry.get(), &mLastError );
+  return geos->overlaps( geometry.d->geometry.get(), &mLastError );
 }
 
 bool QgsGeometry::within( const QgsGeometry &geometry ) const
@@ -1267,9 +1337,9 @@ bool QgsGeometry::within( const QgsGeometry &geometry ) const
     return false;
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.within( geometry.d->geometry.get(), &mLastError );
+  return geos->within( geometry.d->geometry.get(), &mLastError );
 }
 
 bool QgsGeometry::crosses( const QgsGeometry &geometry ) const
@@ -1279,9 +1349,9 @@ bool QgsGeometry::crosses( const QgsGeometry &geometry ) const
     return false;
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.crosses( geometry.d->geometry.get(), &mLastError );
+  return geos->crosses( geometry.d->geometry.get(), &mLastError );
 }
 
 QString QgsGeometry::asWkt( int precision ) const
@@ -1803,9 +1873,9 @@ double QgsGeometry::distance( const QgsGeometry &geom ) const
     return qgsgeometry_cast< const QgsPoint * >( d->geometry.get() )->distance( *qgsgeometry_cast< const QgsPoint * >( geom.constGet() ) );
   }
 
-  QgsGeos g( d->geometry.get() );
+  QgsGeometryGeosEngine g( d );
   mLastError.clear();
-  return g.distance( geom.d->geometry.get(), &mLastError );
+  return g->distance( geom.d->geometry.get(), &mLastError );
 }
 
 double QgsGeometry::hausdorffDistance( const QgsGeometry &geom ) const
@@ -1815,9 +1885,9 @@ double QgsGeometry::hausdorffDistance( const QgsGeometry &geom ) const
     return -1.0;
   }
 
-  QgsGeos g( d->geometry.get() );
+  QgsGeometryGeosEngine g( d );
   mLastError.clear();
-  return g.hausdorffDistance( geom.d->geometry.get(), &mLastError );
+  return g->hausdorffDistance( geom.d->geometry.get(), &mLastError );
 }
 
 double QgsGeometry::hausdorffDistanceDensify( const QgsGeometry &geom, double densifyFraction ) const
@@ -1827,9 +1897,9 @@ double QgsGeometry::hausdorffDistanceDensify( const QgsGeometry &geom, double de
     return -1.0;
   }
 
-  QgsGeos g( d->geometry.get() );
+  QgsGeometryGeosEngine g( d );
   mLastError.clear();
-  return g.hausdorffDistanceDensify( geom.d->geometry.get(), densifyFraction, &mLastError );
+  return g->hausdorffDistanceDensify( geom.d->geometry.get(), densifyFraction, &mLastError );
 }
 
 QgsAbstractGeometry::vertex_iterator QgsGeometry::vertices_begin() const
@@ -1907,9 +1977,9 @@ QgsGeometry QgsGeometry::buffer( double distance, int segments ) const
     return QgsGeometry();
   }
 
-  QgsGeos g( d->geometry.get() );
+  QgsGeometryGeosEngine g( d );
   mLastError.clear();
-  std::unique_ptr<QgsAbstractGeometry> geom( g.buffer( distance, segments, &mLastError ) );
+  std::unique_ptr<QgsAbstractGeometry> geom( g->buffer( distance, segments, &mLastError ) );
   if ( !geom )
   {
     QgsGeometry result;
@@ -1926,9 +1996,9 @@ QgsGeometry QgsGeometry::buffer( double distance, int segments, EndCapStyle endC
     return QgsGeometry();
   }
 
-  QgsGeos g( d->geometry.get() );
+  QgsGeometryGeosEngine g( d );
   mLastError.clear();
-  QgsAbstractGeometry *geom = g.buffer( distance, segments, endCapStyle, joinStyle, miterLimit, &mLastError );
+  QgsAbstractGeometry *geom = g->buffer( distance, segments, endCapStyle, joinStyle, miterLimit, &mLastError );
   if ( !geom )
   {
     QgsGeometry result;
@@ -1968,13 +2038,13 @@ QgsGeometry QgsGeometry::offsetCurve( double distance, int segments, JoinStyle j
   }
   else
   {
-    QgsGeos geos( d->geometry.get() );
+    QgsGeometryGeosEngine geos( d );
     mLastError.clear();
 
     // GEOS can flip the curve orientation in some circumstances. So record previous orientation and correct if required
     const QgsCurve::Orientation prevOrientation = qgsgeometry_cast< const QgsCurve * >( d->geometry.get() )->orientation();
 
-    std::unique_ptr< QgsAbstractGeometry > offsetGeom( geos.offsetCurve( distance, segments, joinStyle, miterLimit, &mLastError ) );
+    std::unique_ptr< QgsAbstractGeometry > offsetGeom( geos->offsetCurve( distance, segments, joinStyle, miterLimit, &mLastError ) );
     if ( !offsetGeom )
     {
       QgsGeometry result;
@@ -2026,9 +2096,9 @@ QgsGeometry QgsGeometry::singleSidedBuffer( double distance, int segments, Buffe
   }
   else
   {
-    QgsGeos geos( d->geometry.get() );
+    QgsGeometryGeosEngine geos( d );
     mLastError.clear();
-    std::unique_ptr< QgsAbstractGeometry > bufferGeom = geos.singleSidedBuffer( distance, segments, side,
+    std::unique_ptr< QgsAbstractGeometry > bufferGeom = geos->singleSidedBuffer( distance, segments, side,
         joinStyle, miterLimit, &mLastError );
     if ( !bufferGeom )
     {
@@ -2101,9 +2171,9 @@ QgsGeometry QgsGeometry::simplify( double tolerance ) const
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  std::unique_ptr< QgsAbstractGeometry > simplifiedGeom( geos.simplify( tolerance, &mLastError ) );
+  std::unique_ptr< QgsAbstractGeometry > simplifiedGeom( geos->simplify( tolerance, &mLastError ) );
   if ( !simplifiedGeom )
   {
     QgsGeometry result;
@@ -2150,10 +2220,10 @@ QgsGeometry QgsGeometry::centroid() const
     return c;
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
 
   mLastError.clear();
-  QgsGeometry result( geos.centroid( &mLastError ) );
+  QgsGeometry result( geos->centroid( &mLastError ) );
   result.mLastError = mLastError;
   return result;
 }
@@ -2165,10 +2235,10 @@ QgsGeometry QgsGeometry::pointOnSurface() const
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
 
   mLastError.clear();
-  QgsGeometry result( geos.pointOnSurface( &mLastError ) );
+  QgsGeometry result( geos->pointOnSurface( &mLastError ) );
   result.mLastError = mLastError;
   return result;
 }
@@ -2186,9 +2256,9 @@ QgsGeometry QgsGeometry::convexHull() const
   {
     return QgsGeometry();
   }
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  std::unique_ptr< QgsAbstractGeometry > cHull( geos.convexHull( &mLastError ) );
+  std::unique_ptr< QgsAbstractGeometry > cHull( geos->convexHull( &mLastError ) );
   if ( !cHull )
   {
     QgsGeometry geom;
@@ -2317,9 +2387,9 @@ double QgsGeometry::lineLocatePoint( const QgsGeometry &point ) const
     segmentized = QgsGeometry( static_cast< QgsCurve * >( d->geometry.get() )->segmentize() );
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.lineLocatePoint( *( static_cast< QgsPoint * >( point.d->geometry.get() ) ), &mLastError );
+  return geos->lineLocatePoint( *( static_cast< QgsPoint * >( point.d->geometry.get() ) ), &mLastError );
 }
 
 double QgsGeometry::interpolateAngle( double distance ) const
@@ -2383,10 +2453,10 @@ QgsGeometry QgsGeometry::intersection( const QgsGeometry &geometry ) const
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
 
   mLastError.clear();
-  std::unique_ptr< QgsAbstractGeometry > resultGeom( geos.intersection( geometry.d->geometry.get(), &mLastError ) );
+  std::unique_ptr< QgsAbstractGeometry > resultGeom( geos->intersection( geometry.d->geometry.get(), &mLastError ) );
 
   if ( !resultGeom )
   {
@@ -2405,9 +2475,9 @@ QgsGeometry QgsGeometry::combine( const QgsGeometry &geometry ) const
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  std::unique_ptr< QgsAbstractGeometry > resultGeom( geos.combine( geometry.d->geometry.get(), &mLastError ) );
+  std::unique_ptr< QgsAbstractGeometry > resultGeom( geos->combine( geometry.d->geometry.get(), &mLastError ) );
   if ( !resultGeom )
   {
     QgsGeometry geom;
@@ -2444,10 +2514,10 @@ QgsGeometry QgsGeometry::difference( const QgsGeometry &geometry ) const
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
 
   mLastError.clear();
-  std::unique_ptr< QgsAbstractGeometry > resultGeom( geos.difference( geometry.d->geometry.get(), &mLastError ) );
+  std::unique_ptr< QgsAbstractGeometry > resultGeom( geos->difference( geometry.d->geometry.get(), &mLastError ) );
   if ( !resultGeom )
   {
     QgsGeometry geom;
@@ -2464,10 +2534,10 @@ QgsGeometry QgsGeometry::symDifference( const QgsGeometry &geometry ) const
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
 
   mLastError.clear();
-  std::unique_ptr< QgsAbstractGeometry > resultGeom( geos.symDifference( geometry.d->geometry.get(), &mLastError ) );
+  std::unique_ptr< QgsAbstractGeometry > resultGeom( geos->symDifference( geometry.d->geometry.get(), &mLastError ) );
   if ( !resultGeom )
   {
     QgsGeometry geom;
@@ -2753,9 +2823,9 @@ bool QgsGeometry::isGeosEqual( const QgsGeometry &g ) const
   if ( d->geometry->boundingBox() != g.d->geometry->boundingBox() )
     return false;
 
-  QgsGeos geos( d->geometry.get() );
+  QgsGeometryGeosEngine geos( d );
   mLastError.clear();
-  return geos.isEqual( g.d->geometry.get(), &mLastError );
+  return geos->isEqual( g.d->geometry.get(), &mLastError );
 }
 
 QgsGeometry QgsGeometry::unaryUnion( const QVector<QgsGeometry> &geometries )
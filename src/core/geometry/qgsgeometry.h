@@ -2448,6 +2448,31 @@ class CORE_EXPORT QgsGeometry
      */
     static QgsGeometryEngine *createGeometryEngine( const QgsAbstractGeometry *geometry ) SIP_FACTORY;
 
+    /**
+     * Sets whether the GEOS representation of the geometry should be cached.
+     *
+     * When enabled, the geometry is converted to GEOS and prepared the first time a GEOS based
+     * predicate or operation is called (e.g. intersects(), contains(), distance(), buffer()), and the
+     * converted geometry is reused for subsequent calls. This speeds up repeated tests of the same
+     * geometry against many other geometries. Only the GEOS form of this geometry is cached, the
+     * other geometry passed to the predicate is still converted on every call.
+     *
+     * The cache is discarded whenever the geometry is modified. The setting is shared with
+     * implicitly shared copies of the geometry.
+     *
+     * \see geosCachingEnabled()
+     * \since QGIS 3.18
+     */
+    void setGeosCachingEnabled( bool enabled );
+
+    /**
+     * Returns TRUE if the GEOS representation of the geometry is cached.
+     *
+     * \see setGeosCachingEnabled()
+     * \since QGIS 3.18
+     */
+    bool geosCachingEnabled() const;
+
     /**
      * Upgrades a point list from QgsPointXY to QgsPoint
      * \param input list of QgsPointXY objects to be upgraded
@@ -14,6 +14,7 @@ email                : marco.hugentobler at sourcepole dot com
  ***************************************************************************/
 
 #include "qgsgeos.h"
+#include "qgsconfig.h"
 #include "qgsabstractgeometry.h"
 #include "qgsgeometrycollection.h"
 #include "qgsgeometryfactory.h"
@@ -28,6 +29,10 @@ email                : marco.hugentobler at sourcepole dot com
 #include <limits>
 #include <cstdio>
 
+#if !defined(USE_THREAD_LOCAL) || defined(Q_OS_WIN)
+#include <QThreadStorage>
+#endif
+
 #define DEFAULT_QUADRANT_SEGMENTS 8
 
 #define CATCH_GEOS(r) \
@@ -113,7 +118,27 @@ class GEOSInit
     GEOSInit &operator=( const GEOSInit &rh ) = delete;
 };
 
-Q_GLOBAL_STATIC( GEOSInit, geosinit )
+/*
+ * GEOS context handles must not be used concurrently, so every thread
+ * gets its own context. This allows GEOS operations to run in parallel,
+ * e.g. from QtConcurrent based processing algorithms.
+ */
+#if defined(USE_THREAD_LOCAL) && !defined(Q_OS_WIN)
+static GEOSInit *geosinit()
+{
+  static thread_local GEOSInit sGeosInit;
+  return &sGeosInit;
+}
+#else
+static QThreadStorage< GEOSInit * > sGeosInit;
+
+static GEOSInit *geosinit()
+{
+  if ( !sGeosInit.hasLocalData() )
+    sGeosInit.setLocalData( new GEOSInit() );
+  return sGeosInit.localData();
+}
+#endif
 
 void geos::GeosDeleter::operator()( GEOSGeometry *geom )
 {
@@ -139,6 +164,9 @@ void geos::GeosDeleter::operator()( GEOSCoordSequence *sequence )
 ///@endcond
 
 
+std::atomic< quint64 > QgsGeos::sToGeosConversionCount( 0 );
+std::atomic< quint64 > QgsGeos::sFromGeosConversionCount( 0 );
+
 QgsGeos::QgsGeos( const QgsAbstractGeometry *geometry, double precision )
   : QgsGeometryEngine( geometry )
   , mGeos( nullptr )
@@ -160,6 +188,22 @@ QgsGeometry QgsGeos::geometryFromGeos( const geos::unique_ptr &geos )
   return g;
 }
 
+quint64 QgsGeos::toGeosConversionCount()
+{
+  return sToGeosConversionCount.load( std::memory_order_relaxed );
+}
+
+quint64 QgsGeos::fromGeosConversionCount()
+{
+  return sFromGeosConversionCount.load( std::memory_order_relaxed );
+}
+
+void QgsGeos::resetConversionCounts()
+{
+  sToGeosConversionCount.store( 0, std::memory_order_relaxed );
+  sFromGeosConversionCount.store( 0, std::memory_order_relaxed );
+}
+
 geos::unique_ptr QgsGeos::asGeos( const QgsGeometry &geometry, double precision )
 {
   if ( geometry.isNull() )
@@ -1096,6 +1140,13 @@ geos::unique_ptr QgsGeos::createGeosCollection( int typeId, const QVector<GEOSGe
 }
 
 std::unique_ptr<QgsAbstractGeometry> QgsGeos::fromGeos( const GEOSGeometry *geos )
+{
+  if ( geos )
+    sFromGeosConversionCount.fetch_add( 1, std::memory_order_relaxed );
+  return convertFromGeos( geos );
+}
+
+std::unique_ptr<QgsAbstractGeometry> QgsGeos::convertFromGeos( const GEOSGeometry *geos )
 {
   if ( !geos )
   {
@@ -1180,7 +1231,7 @@ std::unique_ptr<QgsAbstractGeometry> QgsGeos::fromGeos( const GEOSGeometry *geos
       geomCollection->reserve( nParts );
       for ( int i = 0; i < nParts; ++i )
       {
-        std::unique_ptr< QgsAbstractGeometry > geom( fromGeos( GEOSGetGeometryN_r( geosinit()->ctxt, geos, i ) ) );
+        std::unique_ptr< QgsAbstractGeometry > geom( convertFromGeos( GEOSGetGeometryN_r( geosinit()->ctxt, geos, i ) ) );
         if ( geom )
         {
           geomCollection->addGeometry( geom.release() );
@@ -1328,6 +1379,15 @@ QgsPoint QgsGeos::coordSeqPoint( const GEOSCoordSequence *cs, int i, bool hasZ,
 }
 
 geos::unique_ptr QgsGeos::asGeos( const QgsAbstractGeometry *geom, double precision )
+{
+  if ( !geom )
+    return nullptr;
+
+  sToGeosConversionCount.fetch_add( 1, std::memory_order_relaxed );
+  return convertToGeos( geom, precision );
+}
+
+geos::unique_ptr QgsGeos::convertToGeos( const QgsAbstractGeometry *geom, double precision )
 {
   if ( !geom )
     return nullptr;
@@ -1378,7 +1438,7 @@ geos::unique_ptr QgsGeos::asGeos( const QgsAbstractGeometry *geom, double precis
     QVector< GEOSGeometry * > geomVector( c->numGeometries() );
     for ( int i = 0; i < c->numGeometries(); ++i )
     {
-      geomVector[i] = asGeos( c->geometryN( i ), precision ).release();
+      geomVector[i] = convertToGeos( c->geometryN( i ), precision ).release();
     }
     return createGeosCollection( geosType, geomVector );
   }
@@ -22,6 +22,7 @@ email                : marco.hugentobler at sourcepole dot com
 #include "qgsgeometryengine.h"
 #include "qgsgeometry.h"
 #include <geos_c.h>
+#include <atomic>
 
 #if defined(GEOS_VERSION_MAJOR) && (GEOS_VERSION_MAJOR<3)
 #define GEOSGeometry struct GEOSGeom_t
@@ -356,10 +357,46 @@ class CORE_EXPORT QgsGeos: public QgsGeometryEngine
     static geos::unique_ptr asGeos( const QgsAbstractGeometry *geometry, double precision = 0 );
     static QgsPoint coordSeqPoint( const GEOSCoordSequence *cs, int i, bool hasZ, bool hasM );
 
+    /**
+     * Returns the GEOS context handle for the current thread.
+     *
+     * Since QGIS 3.18 each thread has its own GEOS context, so the returned handle must not be
+     * shared with other threads.
+     */
     static GEOSContextHandle_t getGEOSHandler();
 
+    /**
+     * Returns the number of QGIS geometries converted to GEOS geometries (with asGeos()) since the
+     * counters were last reset, across all threads.
+     *
+     * \see fromGeosConversionCount()
+     * \see resetConversionCounts()
+     * \since QGIS 3.18
+     */
+    static quint64 toGeosConversionCount();
+
+    /**
+     * Returns the number of GEOS geometries converted to QGIS geometries (with fromGeos()) since the
+     * counters were last reset, across all threads.
+     *
+     * \see toGeosConversionCount()
+     * \see resetConversionCounts()
+     * \since QGIS 3.18
+     */
+    static quint64 fromGeosConversionCount();
+
+    /**
+     * Resets the counters returned by toGeosConversionCount() and fromGeosConversionCount().
+     *
+     * \since QGIS 3.18
+     */
+    static void resetConversionCounts();
+
 
   private:
+    static std::atomic< quint64 > sToGeosConversionCount;
+    static std::atomic< quint64 > sFromGeosConversionCount;
+
     mutable geos::unique_ptr mGeos;
     geos::prepared_unique_ptr mGeosPrepared;
     double mPrecision = 0.0;
@@ -385,6 +422,13 @@ class CORE_EXPORT QgsGeos: public QgsGeometryEngine
 
     //geos util functions
     void cacheGeos() const;
+
+    //! Converts \a geometry to GEOS, without counting the conversion
+    static geos::unique_ptr convertToGeos( const QgsAbstractGeometry *geometry, double precision );
+
+    //! Converts \a geos to a QGIS geometry, without counting the conversion
+    static std::unique_ptr< QgsAbstractGeometry > convertFromGeos( const GEOSGeometry *geos );
+
     std::unique_ptr< QgsAbstractGeometry > overlay( const QgsAbstractGeometry *geom, Overlay op, QString *errorMsg = nullptr ) const;
     bool relation( const QgsAbstractGeometry *geom, Relation r, QString *errorMsg = nullptr ) const;
     static GEOSCoordSequence *createCoordinateSequence( const QgsCurve *curve, double precision, bool forceClose = false );
@@ -514,9 +514,7 @@ QByteArray QgsLineString::asWkb( WkbFlags flags ) const
   QgsWkbPtr wkb( wkbArray );
   wkb << static_cast<char>( QgsApplication::endian() );
   wkb << static_cast<quint32>( wkbType() );
-  QgsPointSequence pts;
-  points( pts );
-  QgsGeometryUtils::pointsToWKB( wkb, pts, is3D(), isMeasure() );
+  exportVerticesToWkb( wkb );
   return wkbArray;
 }
 
@@ -1518,30 +1516,25 @@ void QgsLineString::importVerticesFromWkb( const QgsConstWkbPtr &wkb )
   bool hasM = isMeasure();
   int nVertices = 0;
   wkb >> nVertices;
+  // check the vertex count before allocating anything for it
+  if ( !wkb.vertexCountFits( nVertices, 2 + hasZ + hasM ) )
+    throw QgsWkbException( QStringLiteral( "wkb access out of bounds" ) );
+
   mX.resize( nVertices );
   mY.resize( nVertices );
   hasZ ? mZ.resize( nVertices ) : mZ.clear();
   hasM ? mM.resize( nVertices ) : mM.clear();
-  double *x = mX.data();
-  double *y = mY.data();
-  double *m = hasM ? mM.data() : nullptr;
-  double *z = hasZ ? mZ.data() : nullptr;
-  for ( int i = 0; i < nVertices; ++i )
-  {
-    wkb >> *x++;
-    wkb >> *y++;
-    if ( hasZ )
-    {
-      wkb >> *z++;
-    }
-    if ( hasM )
-    {
-      wkb >> *m++;
-    }
-  }
+  wkb.readVertices( nVertices, mX.data(), mY.data(), hasZ ? mZ.data() : nullptr, hasM ? mM.data() : nullptr );
   clearCache(); //set bounding box invalid
 }
 
+void QgsLineString::exportVerticesToWkb( QgsWkbPtr &wkb ) const
+{
+  const int nVertices = mX.size();
+  wkb << static_cast<quint32>( nVertices );
+  wkb.writeVertices( nVertices, mX.constData(), mY.constData(), is3D() ? mZ.constData() : nullptr, isMeasure() ? mM.constData() : nullptr );
+}
+
 /***************************************************************************
  * This class is considered CRITICAL and any change MUST be accompanied with
  * full unit tests.
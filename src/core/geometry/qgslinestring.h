@@ -27,6 +27,7 @@
 #include "qgscompoundcurve.h"
 
 class QgsLineSegment2D;
+class QgsWkbPtr;
 
 /***************************************************************************
  * This class is considered CRITICAL and any change MUST be accompanied with
@@ -794,6 +795,9 @@ class CORE_EXPORT QgsLineString: public QgsCurve
 
     void importVerticesFromWkb( const QgsConstWkbPtr &wkb );
 
+    //! Writes the vertex count followed by the interleaved vertex coordinates
+    void exportVerticesToWkb( QgsWkbPtr &wkb ) const;
+
     /**
      * Resets the line string to match the line string in a WKB geometry.
      * \param type WKB type
@@ -169,17 +169,27 @@ QByteArray QgsPolygon::asWkb( QgsAbstractGeometry::WkbFlags flags ) const
   wkb << static_cast<quint32>( type );
 
   wkb << static_cast<quint32>( ( nullptr != mExteriorRing ) + mInteriorRings.size() );
+  auto writeRing = [&wkb]( const QgsCurve * ring )
+  {
+    if ( const QgsLineString *line = qgsgeometry_cast< const QgsLineString * >( ring ) )
+    {
+      line->exportVerticesToWkb( wkb );
+    }
+    else
+    {
+      QgsPointSequence pts;
+      ring->points( pts );
+      QgsGeometryUtils::pointsToWKB( wkb, pts, ring->is3D(), ring->isMeasure() );
+    }
+  };
+
   if ( mExteriorRing )
   {
-    QgsPointSequence pts;
-    mExteriorRing->points( pts );
-    QgsGeometryUtils::pointsToWKB( wkb, pts, mExteriorRing->is3D(), mExteriorRing->isMeasure() );
+    writeRing( mExteriorRing.get() );
   }
   for ( const QgsCurve *curve : mInteriorRings )
   {
-    QgsPointSequence pts;
-    curve->points( pts );
-    QgsGeometryUtils::pointsToWKB( wkb, pts, curve->is3D(), curve->isMeasure() );
+    writeRing( curve );
   }
 
   return wkbArray;
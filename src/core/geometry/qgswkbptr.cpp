@@ -35,6 +35,44 @@ void QgsWkbPtr::verifyBound( int size ) const
     throw QgsWkbException( QStringLiteral( "wkb access out of bounds" ) );
 }
 
+void QgsWkbPtr::writeVertices( int count, const double *x, const double *y, const double *z, const double *m )
+{
+  const int dimensions = 2 + ( z ? 1 : 0 ) + ( m ? 1 : 0 );
+  if ( count < 0 || static_cast< qint64 >( count ) * dimensions * static_cast< qint64 >( sizeof( double ) ) > remaining() )
+    throw QgsWkbException( QStringLiteral( "wkb access out of bounds" ) );
+
+  unsigned char *dest = mP;
+  if ( !z && !m )
+  {
+    for ( int i = 0; i < count; ++i, dest += 2 * sizeof( double ) )
+    {
+      memcpy( dest, x + i, sizeof( double ) );
+      memcpy( dest + sizeof( double ), y + i, sizeof( double ) );
+    }
+  }
+  else
+  {
+    for ( int i = 0; i < count; ++i )
+    {
+      memcpy( dest, x + i, sizeof( double ) );
+      dest += sizeof( double );
+      memcpy( dest, y + i, sizeof( double ) );
+      dest += sizeof( double );
+      if ( z )
+      {
+        memcpy( dest, z + i, sizeof( double ) );
+        dest += sizeof( double );
+      }
+      if ( m )
+      {
+        memcpy( dest, m + i, sizeof( double ) );
+        dest += sizeof( double );
+      }
+    }
+  }
+  mP = dest;
+}
+
 QgsConstWkbPtr::QgsConstWkbPtr( const QByteArray &wkb )
 {
   mP = reinterpret_cast< unsigned char * >( const_cast<char *>( wkb.constData() ) );
@@ -99,3 +137,48 @@ const QgsConstWkbPtr &QgsConstWkbPtr::operator>>( QPolygonF &points ) const
   }
   return *this;
 }
+
+bool QgsConstWkbPtr::vertexCountFits( int count, int dimensions ) const
+{
+  return mP && count >= 0 && static_cast< qint64 >( count ) * dimensions * static_cast< qint64 >( sizeof( double ) ) <= remaining();
+}
+
+void QgsConstWkbPtr::readVertices( int count, double *x, double *y, double *z, double *m ) const
+{
+  const int dimensions = 2 + ( z ? 1 : 0 ) + ( m ? 1 : 0 );
+  if ( !vertexCountFits( count, dimensions ) )
+    throw QgsWkbException( QStringLiteral( "wkb access out of bounds" ) );
+
+  unsigned char *src = mP;
+  if ( !mEndianSwap && !z && !m )
+  {
+    // plain 2D coordinates in host byte order: a straight deinterleaving copy
+    for ( int i = 0; i < count; ++i, src += 2 * sizeof( double ) )
+    {
+      memcpy( x + i, src, sizeof( double ) );
+      memcpy( y + i, src + sizeof( double ), sizeof( double ) );
+    }
+  }
+  else
+  {
+    const bool swap = mEndianSwap;
+    auto readValue = [this, swap, &src]( double & v )
+    {
+      memcpy( &v, src, sizeof( double ) );
+      src += sizeof( double );
+      if ( swap )
+        endian_swap( v );
+    };
+
+    for ( int i = 0; i < count; ++i )
+    {
+      readValue( x[i] );
+      readValue( y[i] );
+      if ( z )
+        readValue( z[i] );
+      if ( m )
+        readValue( m[i] );
+    }
+  }
+  mP = src;
+}
@@ -96,6 +96,17 @@ class CORE_EXPORT QgsWkbPtr
     //! Append data from a byte array
     inline QgsWkbPtr &operator<<( const QByteArray &data ) { write( data ); return *this; } SIP_SKIP
 
+    /**
+     * Writes \a count vertices, interleaving the coordinates from the \a x, \a y and
+     * optional \a z and \a m arrays.
+     *
+     * The bounds are checked once for the whole block of coordinates.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.18
+     */
+    void writeVertices( int count, const double *x, const double *y, const double *z, const double *m ) SIP_SKIP;
+
     inline void operator+=( int n ) { verifyBound( n ); mP += n; } SIP_SKIP
 
     inline operator unsigned char *() const { return mP; } SIP_SKIP
@@ -173,6 +184,29 @@ class CORE_EXPORT QgsConstWkbPtr
     //! Read a point array
     const QgsConstWkbPtr &operator>>( QPolygonF &points ) const; SIP_SKIP
 
+    /**
+     * Reads \a count vertices, deinterleaving their coordinates into the \a x, \a y and
+     * optional \a z and \a m arrays, which must have room for \a count values.
+     *
+     * The bounds are checked once for the whole block of coordinates, and little-endian
+     * data on a little-endian host (or big-endian on a big-endian one) is copied without
+     * any per value conversion.
+     *
+     * \throws QgsWkbException if the block of coordinates exceeds the WKB size.
+     * \see vertexCountFits()
+     * \note not available in Python bindings
+     * \since QGIS 3.18
+     */
+    void readVertices( int count, double *x, double *y, double *z, double *m ) const SIP_SKIP;
+
+    /**
+     * Returns TRUE if \a count vertices with \a dimensions coordinates each fit in the remaining WKB.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.18
+     */
+    bool vertexCountFits( int count, int dimensions ) const SIP_SKIP;
+
     inline void operator+=( int n ) { verifyBound( n ); mP += n; } SIP_SKIP
     inline void operator-=( int n ) { mP -= n; } SIP_SKIP
 
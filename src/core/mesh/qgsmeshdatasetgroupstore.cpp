@@ -22,6 +22,32 @@
 #include "qgsmeshvirtualdatasetgroup.h"
 #include "qgslogger.h"
 
+#include <algorithm>
+#include <limits>
+
+//! Count of values, or of active face flags, read at once from the persistent provider and stored in the cache
+static const int DATASET_BLOCK_SIZE = 16384;
+
+//! Maximum count of datasets waiting to be read ahead
+static const int MAX_PREFETCH_REQUESTS = 4;
+
+//! Returns the indexes of the blocks containing at least one value flagged in \a required
+static QList<int> requiredBlocks( const QVector<bool> &required, int totalCount )
+{
+  QList<int> blocks;
+  const int count = std::min( required.size(), totalCount );
+  for ( int i = 0; i < count; ++i )
+  {
+    if ( required.at( i ) )
+    {
+      const int block = i / DATASET_BLOCK_SIZE;
+      blocks.append( block );
+      i = ( block + 1 ) * DATASET_BLOCK_SIZE - 1;
+    }
+  }
+  return blocks;
+}
+
 QList<int> QgsMeshDatasetGroupStore::datasetGroupIndexes() const
 {
   return mRegistery.keys();
@@ -46,7 +72,20 @@ QgsMeshDatasetGroupStore::QgsMeshDatasetGroupStore( QgsMeshLayer *layer ):
   mLayer( layer ),
   mExtraDatasets( new QgsMeshExtraDatasetStore ),
   mDatasetGroupTreeRootItem( new QgsMeshDatasetGroupTreeItem )
-{}
+{
+  // cost of the blocks is in kilobytes
+  mBlockCache.setMaxCost( 128 * 1024 );
+
+  // blocks are read ahead one at a time when the event loop is idle, so that the provider is only used from the main thread
+  mPrefetchTimer.setSingleShot( true );
+  mPrefetchTimer.setInterval( 0 );
+  connect( &mPrefetchTimer, &QTimer::timeout, this, &QgsMeshDatasetGroupStore::processNextPrefetchBlock );
+}
+
+QgsMeshDatasetGroupStore::~QgsMeshDatasetGroupStore()
+{
+  clearDatasetCache();
+}
 
 void QgsMeshDatasetGroupStore::setPersistentProvider( QgsMeshDataProvider *provider )
 {
@@ -55,6 +94,7 @@ void QgsMeshDatasetGroupStore::setPersistentProvider( QgsMeshDataProvider *provi
   if ( !mPersistentProvider )
     return;
   connect( mPersistentProvider, &QgsMeshDataProvider::datasetGroupsAdded, this, &QgsMeshDatasetGroupStore::onPersistentDatasetAdded );
+  connect( mPersistentProvider, &QgsMeshDataProvider::dataChanged, this, &QgsMeshDatasetGroupStore::clearDatasetCache );
   onPersistentDatasetAdded( mPersistentProvider->datasetGroupCount() );
 }
 
@@ -172,12 +212,25 @@ QgsMeshDatasetValue QgsMeshDatasetGroupStore::datasetValue( const QgsMeshDataset
 QgsMeshDataBlock QgsMeshDatasetGroupStore::datasetValues( const QgsMeshDatasetIndex &index, int valueIndex, int count ) const
 {
   QgsMeshDatasetGroupStore::DatasetGroup  group = datasetGroup( index.group() );
-  if ( group.first )
+  if ( group.first == mPersistentProvider && mPersistentProvider )
+    return assembleBlocks( group.second, index.dataset(), valueIndex, count, nullptr, false );
+  else if ( group.first )
     return group.first->datasetValues( QgsMeshDatasetIndex( group.second, index.dataset() ), valueIndex, count );
   else
     return QgsMeshDataBlock();
 }
 
+QgsMeshDataBlock QgsMeshDatasetGroupStore::datasetValues( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredValues ) const
+{
+  QgsMeshDatasetGroupStore::DatasetGroup  group = datasetGroup( index.group() );
+  if ( group.first == mPersistentProvider && mPersistentProvider )
+    return assembleBlocks( group.second, index.dataset(), 0, requiredValues.size(), &requiredValues, false );
+  else if ( group.first )
+    return group.first->datasetValues( QgsMeshDatasetIndex( group.second, index.dataset() ), 0, requiredValues.size() );
+  else
+    return QgsMeshDataBlock();
+}
+
 QgsMesh3dDataBlock QgsMeshDatasetGroupStore::dataset3dValues( const QgsMeshDatasetIndex &index, int faceIndex, int count ) const
 {
   QgsMeshDatasetGroupStore::DatasetGroup  group = datasetGroup( index.group() );
@@ -190,12 +243,233 @@ QgsMesh3dDataBlock QgsMeshDatasetGroupStore::dataset3dValues( const QgsMeshDatas
 QgsMeshDataBlock QgsMeshDatasetGroupStore::areFacesActive( const QgsMeshDatasetIndex &index, int faceIndex, int count ) const
 {
   QgsMeshDatasetGroupStore::DatasetGroup  group = datasetGroup( index.group() );
-  if ( group.first )
+  if ( group.first == mPersistentProvider && mPersistentProvider )
+    return assembleBlocks( group.second, index.dataset(), faceIndex, count, nullptr, true );
+  else if ( group.first )
     return group.first->areFacesActive( QgsMeshDatasetIndex( group.second, index.dataset() ), faceIndex, count );
   else
     return QgsMeshDataBlock();
 }
 
+QgsMeshDataBlock QgsMeshDatasetGroupStore::areFacesActive( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredFaces ) const
+{
+  QgsMeshDatasetGroupStore::DatasetGroup  group = datasetGroup( index.group() );
+  if ( group.first == mPersistentProvider && mPersistentProvider )
+    return assembleBlocks( group.second, index.dataset(), 0, requiredFaces.size(), &requiredFaces, true );
+  else if ( group.first )
+    return group.first->areFacesActive( QgsMeshDatasetIndex( group.second, index.dataset() ), 0, requiredFaces.size() );
+  else
+    return QgsMeshDataBlock();
+}
+
+void QgsMeshDatasetGroupStore::prefetchDataset( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredValues, const QVector<bool> &requiredFaces )
+{
+  QgsMeshDatasetGroupStore::DatasetGroup  group = datasetGroup( index.group() );
+  if ( !mPersistentProvider || group.first != mPersistentProvider )
+    return;
+
+  if ( index.dataset() < 0 || index.dataset() >= mPersistentProvider->datasetCount( group.second ) )
+    return;
+
+  PrefetchRequest request;
+  request.group = group.second;
+  request.dataset = index.dataset();
+  request.valueCount = blockedValueCount( group.second, false );
+  if ( request.valueCount >= 0 )
+    request.valueBlocks = requiredBlocks( requiredValues, request.valueCount );
+  request.faceCount = blockedValueCount( group.second, true );
+  request.faceBlocks = requiredBlocks( requiredFaces, request.faceCount );
+
+  // when the reads are slower than the requests, e.g. during a fast animation, the oldest requests are outdated
+  while ( mPrefetchRequests.size() >= MAX_PREFETCH_REQUESTS )
+    mPrefetchRequests.removeFirst();
+  mPrefetchRequests.append( request );
+
+  if ( !mPrefetchTimer.isActive() )
+    mPrefetchTimer.start();
+}
+
+void QgsMeshDatasetGroupStore::processNextPrefetchBlock()
+{
+  while ( !mPrefetchRequests.isEmpty() )
+  {
+    PrefetchRequest &request = mPrefetchRequests.first();
+    const bool activeFlags = request.valueBlocks.isEmpty();
+    QList<int> &blocks = activeFlags ? request.faceBlocks : request.valueBlocks;
+    if ( blocks.isEmpty() )
+    {
+      mPrefetchRequests.removeFirst();
+      continue;
+    }
+
+    const BlockKey key{ request.group, request.dataset, blocks.takeFirst(), activeFlags };
+    if ( mBlockCache.contains( key ) )
+      continue;
+
+    cachedBlock( key.group, key.dataset, key.block, activeFlags, activeFlags ? request.faceCount : request.valueCount );
+    // let the other events be processed before reading the next block
+    mPrefetchTimer.start();
+    return;
+  }
+}
+
+qint64 QgsMeshDatasetGroupStore::datasetCacheMaximumSize() const
+{
+  return static_cast< qint64 >( mBlockCache.maxCost() ) * 1024;
+}
+
+void QgsMeshDatasetGroupStore::setDatasetCacheMaximumSize( qint64 size )
+{
+  mBlockCache.setMaxCost( static_cast< int >( std::min< qint64 >( std::max< qint64 >( size, 0 ) / 1024, std::numeric_limits<int>::max() ) ) );
+}
+
+void QgsMeshDatasetGroupStore::clearDatasetCache()
+{
+  mPrefetchRequests.clear();
+  mPrefetchTimer.stop();
+  mBlockCache.clear();
+}
+
+qint64 QgsMeshDatasetGroupStore::datasetCacheHitCount() const
+{
+  return mBlockCacheHits;
+}
+
+qint64 QgsMeshDatasetGroupStore::datasetCacheMissCount() const
+{
+  return mBlockCacheMisses;
+}
+
+int QgsMeshDatasetGroupStore::blockedValueCount( int group, bool activeFlags ) const
+{
+  if ( activeFlags )
+    return mPersistentProvider->faceCount();
+
+  switch ( mPersistentProvider->datasetGroupMetadata( group ).dataType() )
+  {
+    case QgsMeshDatasetGroupMetadata::DataOnFaces:
+      return mPersistentProvider->faceCount();
+    case QgsMeshDatasetGroupMetadata::DataOnVertices:
+      return mPersistentProvider->vertexCount();
+    case QgsMeshDatasetGroupMetadata::DataOnEdges:
+      return mPersistentProvider->edgeCount();
+    case QgsMeshDatasetGroupMetadata::DataOnVolumes:
+      break;
+  }
+  return -1;
+}
+
+QgsMeshDataBlock QgsMeshDatasetGroupStore::cachedBlock( int group, int dataset, int block, bool activeFlags, int totalCount ) const
+{
+  const BlockKey key{ group, dataset, block, activeFlags };
+
+  if ( const QgsMeshDataBlock *cachedValues = mBlockCache.object( key ) )
+  {
+    mBlockCacheHits++;
+    return *cachedValues;
+  }
+
+  mBlockCacheMisses++;
+  const int first = block * DATASET_BLOCK_SIZE;
+  const int count = std::min( DATASET_BLOCK_SIZE, totalCount - first );
+  const QgsMeshDatasetIndex nativeIndex( group, dataset );
+  const QgsMeshDataBlock values = activeFlags ? mPersistentProvider->areFacesActive( nativeIndex, first, count ) :
+                                  mPersistentProvider->datasetValues( nativeIndex, first, count );
+
+  if ( values.isValid() )
+  {
+    const qint64 size = activeFlags ? values.active().size() * static_cast< qint64 >( sizeof( int ) ) :
+                        values.values().size() * static_cast< qint64 >( sizeof( double ) );
+    mBlockCache.insert( key, new QgsMeshDataBlock( values ), static_cast< int >( size / 1024 ) + 1 );
+  }
+
+  return values;
+}
+
+QgsMeshDataBlock QgsMeshDatasetGroupStore::assembleBlocks( int group, int dataset, int valueIndex, int count, const QVector<bool> *required, bool activeFlags ) const
+{
+  const QgsMeshDatasetIndex nativeIndex( group, dataset );
+  const int totalCount = blockedValueCount( group, activeFlags );
+  if ( totalCount < 0 || count <= 0 || valueIndex < 0 || valueIndex + count > totalCount )
+  {
+    // not read by blocks, let the provider handle the request
+    return activeFlags ? mPersistentProvider->areFacesActive( nativeIndex, valueIndex, count ) :
+           mPersistentProvider->datasetValues( nativeIndex, valueIndex, count );
+  }
+
+  QgsMeshDataBlock::DataType type = QgsMeshDataBlock::ActiveFlagInteger;
+  if ( !activeFlags )
+    type = mPersistentProvider->datasetGroupMetadata( group ).isScalar() ? QgsMeshDataBlock::ScalarDouble : QgsMeshDataBlock::Vector2DDouble;
+  const int valueSize = type == QgsMeshDataBlock::Vector2DDouble ? 2 : 1;
+
+  QVector<double> values;
+  QVector<int> flags;
+  bool allActive = true;
+  if ( activeFlags )
+    flags.resize( count );
+  else
+    values = QVector<double>( count * valueSize, std::numeric_limits<double>::quiet_NaN() );
+
+  const int firstBlock = valueIndex / DATASET_BLOCK_SIZE;
+  const int lastBlock = ( valueIndex + count - 1 ) / DATASET_BLOCK_SIZE;
+  for ( int block = firstBlock; block <= lastBlock; ++block )
+  {
+    const int blockStart = block * DATASET_BLOCK_SIZE;
+    const int from = std::max( blockStart, valueIndex );
+    const int to = std::min( blockStart + DATASET_BLOCK_SIZE, valueIndex + count );
+
+    if ( required )
+    {
+      const bool isRequired = std::any_of( required->constBegin() + ( from - valueIndex ), required->constBegin() + ( to - valueIndex ), []( bool flag ) { return flag; } );
+      if ( !isRequired )
+      {
+        // skipped faces are considered as inactive
+        allActive = false;
+        continue;
+      }
+    }
+
+    const QgsMeshDataBlock blockValues = cachedBlock( group, dataset, block, activeFlags, totalCount );
+    if ( !blockValues.isValid() )
+      return QgsMeshDataBlock( type, count );
+
+    if ( activeFlags )
+    {
+      const QVector<int> blockFlags = blockValues.active();
+      if ( !blockFlags.isEmpty() && blockFlags.size() < to - blockStart )
+        return QgsMeshDataBlock( type, count );
+
+      if ( blockFlags.isEmpty() )
+      {
+        std::fill( flags.begin() + ( from - valueIndex ), flags.begin() + ( to - valueIndex ), 1 );
+      }
+      else
+      {
+        allActive = false;
+        std::copy( blockFlags.constBegin() + ( from - blockStart ), blockFlags.constBegin() + ( to - blockStart ), flags.begin() + ( from - valueIndex ) );
+      }
+    }
+    else
+    {
+      const QVector<double> blockDoubles = blockValues.values();
+      if ( blockDoubles.size() < ( to - blockStart ) * valueSize )
+        return QgsMeshDataBlock( type, count );
+
+      std::copy( blockDoubles.constBegin() + ( from - blockStart ) * valueSize, blockDoubles.constBegin() + ( to - blockStart ) * valueSize,
+                 values.begin() + ( from - valueIndex ) * valueSize );
+    }
+  }
+
+  QgsMeshDataBlock result( type, count );
+  if ( !activeFlags )
+    result.setValues( values );
+  else if ( allActive )
+    result.setValid( true );
+  else
+    result.setActive( flags );
+  return result;
+}
+
 bool QgsMeshDatasetGroupStore::isFaceActive( const QgsMeshDatasetIndex &index, int faceIndex ) const
 {
   QgsMeshDatasetGroupStore::DatasetGroup  group = datasetGroup( index.group() );
@@ -377,7 +651,10 @@ void QgsMeshDatasetGroupStore::removePersistentProvider()
   if ( !mPersistentProvider )
     return;
 
+  clearDatasetCache();
+
   disconnect( mPersistentProvider, &QgsMeshDataProvider::datasetGroupsAdded, this, &QgsMeshDatasetGroupStore::onPersistentDatasetAdded );
+  disconnect( mPersistentProvider, &QgsMeshDataProvider::dataChanged, this, &QgsMeshDatasetGroupStore::clearDatasetCache );
 
   QMap < int, DatasetGroup>::iterator it = mRegistery.begin();
   while ( it != mRegistery.end() )
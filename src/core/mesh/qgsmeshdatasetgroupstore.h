@@ -20,6 +20,9 @@
 
 #define SIP_NO_FILE
 
+#include <QCache>
+#include <QTimer>
+
 #include "qgsmeshdataprovider.h"
 #include "qgsmeshdataset.h"
 
@@ -127,6 +130,8 @@ class QgsMeshDatasetGroupStore: public QObject
     //! Constructor
     QgsMeshDatasetGroupStore( QgsMeshLayer *layer );
 
+    ~QgsMeshDatasetGroupStore() override;
+
     //! Sets the persistent mesh data provider
     void setPersistentProvider( QgsMeshDataProvider *provider );
 
@@ -184,12 +189,89 @@ class QgsMeshDatasetGroupStore: public QObject
     //! Returns \a count values of the dataset with global \a index and from \a valueIndex
     QgsMeshDataBlock datasetValues( const QgsMeshDatasetIndex &index, int valueIndex, int count ) const;
 
+    /**
+     * Returns the values of the dataset with global \a index, from the first value, where only the values
+     * flagged in \a requiredValues are read. The count of returned values is the size of \a requiredValues.
+     *
+     * Values are read by blocks, so some values not flagged may also be read, others are set to NaN.
+     *
+     * \since QGIS 3.18
+     */
+    QgsMeshDataBlock datasetValues( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredValues ) const;
+
     //! Returns \a count 3D values of the dataset with global \a index and from \a valueIndex
     QgsMesh3dDataBlock dataset3dValues( const QgsMeshDatasetIndex &index, int faceIndex, int count ) const;
 
     //! Returns whether faces are active for particular dataset
     QgsMeshDataBlock areFacesActive( const QgsMeshDatasetIndex &index, int faceIndex, int count ) const;
 
+    /**
+     * Returns whether faces are active for the dataset with global \a index, from the first face, where only the faces
+     * flagged in \a requiredFaces are read. The count of returned flags is the size of \a requiredFaces.
+     *
+     * Flags are read by blocks, so some faces not flagged may also be read, others are considered as inactive.
+     *
+     * \since QGIS 3.18
+     */
+    QgsMeshDataBlock areFacesActive( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredFaces ) const;
+
+    /**
+     * Queues the blocks of values and active face flags of the dataset with global \a index which contain
+     * the values flagged in \a requiredValues and the faces flagged in \a requiredFaces, so that they are read
+     * and available in the cache when requested later.
+     *
+     * The blocks are read one at a time by the event loop of the store's thread, when it is idle, so the provider
+     * is never used from another thread. Requests are read in order, only the most recent ones are kept if the
+     * previous ones are not read yet.
+     * Does nothing if the dataset does not come from the persistent provider.
+     *
+     * \since QGIS 3.18
+     */
+    void prefetchDataset( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredValues, const QVector<bool> &requiredFaces );
+
+    /**
+     * Returns the maximum size in bytes of the cache of dataset values read from the persistent provider.
+     *
+     * \see setDatasetCacheMaximumSize()
+     * \since QGIS 3.18
+     */
+    qint64 datasetCacheMaximumSize() const;
+
+    /**
+     * Sets the maximum size in bytes of the cache of dataset values read from the persistent provider.
+     * The least recently used blocks of values are removed when the cache is full.
+     *
+     * \see datasetCacheMaximumSize()
+     * \since QGIS 3.18
+     */
+    void setDatasetCacheMaximumSize( qint64 size );
+
+    /**
+     * Cancels the pending read ahead requests and removes all the values from the cache.
+     *
+     * Must be called before the persistent provider is reloaded or deleted.
+     *
+     * \since QGIS 3.18
+     */
+    void clearDatasetCache();
+
+    /**
+     * Returns the number of blocks of values or active face flags which were found in the cache.
+     *
+     * \see datasetCacheMissCount()
+     * \since QGIS 3.18
+     */
+    qint64 datasetCacheHitCount() const;
+
+    /**
+     * Returns the number of blocks of values or active face flags which were read from the persistent provider,
+     * including the blocks read ahead.
+     *
+     * \see datasetCacheHitCount()
+     * \since QGIS 3.18
+     */
+    qint64 datasetCacheMissCount() const;
+
     //! Returns whether face is active for particular dataset
     bool isFaceActive( const QgsMeshDatasetIndex &index, int faceIndex ) const;
 
@@ -216,14 +298,62 @@ class QgsMeshDatasetGroupStore: public QObject
 
   private slots:
     void onPersistentDatasetAdded( int count );
+    //! Reads the next block of the queued prefetch requests
+    void processNextPrefetchBlock();
 
   private:
+
+    //! Key of a block of values or active face flags of a dataset of the persistent provider
+    struct BlockKey
+    {
+      int group; //!< Native index of the group in the persistent provider
+      int dataset;
+      int block;
+      bool activeFlags;
+
+      bool operator==( const BlockKey &other ) const
+      {
+        return group == other.group && dataset == other.dataset && block == other.block && activeFlags == other.activeFlags;
+      }
+
+      friend uint qHash( const BlockKey &key, uint seed = 0 )
+      {
+        return qHash( key.group, seed ) ^ qHash( key.dataset, seed + 1 ) ^ qHash( key.block, seed + 2 ) ^ ( key.activeFlags ? 0x9e3779b9 : 0 );
+      }
+    };
+
+    //! Blocks of a dataset of the persistent provider to read ahead
+    struct PrefetchRequest
+    {
+      int group;
+      int dataset;
+      int valueCount;
+      QList<int> valueBlocks;
+      int faceCount;
+      QList<int> faceBlocks;
+    };
+
+    //! Returns the count of values, or of active face flags, of the datasets of the persistent provider \a group, -1 if they are not read by blocks
+    int blockedValueCount( int group, bool activeFlags ) const;
+    //! Returns the block of values, or of active face flags, from the cache or read from the persistent provider
+    QgsMeshDataBlock cachedBlock( int group, int dataset, int block, bool activeFlags, int totalCount ) const;
+    //! Returns \a count values, or active face flags, of a dataset of the persistent provider, skipping the blocks without any value flagged in \a required
+    QgsMeshDataBlock assembleBlocks( int group, int dataset, int valueIndex, int count, const QVector<bool> *required, bool activeFlags ) const;
+
     QgsMeshLayer *mLayer = nullptr;
     QgsMeshDataProvider *mPersistentProvider = nullptr;
     std::unique_ptr<QgsMeshExtraDatasetStore> mExtraDatasets;
     QMap < int, DatasetGroup> mRegistery;
     std::unique_ptr<QgsMeshDatasetGroupTreeItem> mDatasetGroupTreeRootItem;
 
+    //! Blocks of values and active face flags, with their size in kilobytes as cost
+    mutable QCache<BlockKey, QgsMeshDataBlock> mBlockCache;
+    mutable qint64 mBlockCacheHits = 0;
+    mutable qint64 mBlockCacheMisses = 0;
+
+    QList<PrefetchRequest> mPrefetchRequests;
+    QTimer mPrefetchTimer;
+
     void removePersistentProvider();
 
     DatasetGroup datasetGroup( int index ) const;
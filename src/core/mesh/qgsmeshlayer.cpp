@@ -19,6 +19,7 @@
 #include <limits>
 
 #include <QUuid>
+#include <QtConcurrentRun>
 
 #include "qgscolorramp.h"
 #include "qgslogger.h"
@@ -128,8 +129,20 @@ void QgsMeshLayer::setDefaultRendererSettings( const QList<int> &groupIndexes )
 
 void QgsMeshLayer::createSimplifiedMeshes()
 {
-  if ( mSimplificationSettings.isEnabled() && !hasSimplifiedMeshes() )
+  if ( !mSimplificationSettings.isEnabled() || mTriangularMeshes.empty() )
+    return;
+
+  // use the simplified meshes computed in the background, if they are for the current base mesh
+  if ( !hasSimplifiedMeshes() && mSimplificationPending && mSimplificationGeneration == mTriangularMeshesGeneration )
+  {
+    mSimplificationWatcher->waitForFinished();
+    collectSimplifiedMeshes();
+  }
+
+  // the simplification of this base mesh already gave no simplified mesh
+  if ( !hasSimplifiedMeshes() && mSimplificationAttemptedGeneration != mTriangularMeshesGeneration )
   {
+    mSimplificationAttemptedGeneration = mTriangularMeshesGeneration;
     double reductionFactor = mSimplificationSettings.reductionFactor();
 
     QVector<QgsTriangularMesh *> simplifyMeshes =
@@ -142,6 +155,89 @@ void QgsMeshLayer::createSimplifiedMeshes()
   }
 }
 
+void QgsMeshLayer::startSimplifiedMeshesComputation()
+{
+  if ( !mSimplificationSettings.isEnabled() || mTriangularMeshes.empty() || hasSimplifiedMeshes() )
+    return;
+
+  // only one computation at a time, the next one is started when it finishes
+  if ( mSimplificationPending )
+    return;
+
+  // meshes with edges cannot be simplified, and there is nothing to reduce with a factor up to 1
+  if ( !mTriangularMeshes[0]->edges().isEmpty() || !( mSimplificationSettings.reductionFactor() > 1 ) )
+    return;
+
+  // each base mesh is only simplified once, even if this gives no simplified mesh
+  if ( mSimplificationAttemptedGeneration == mTriangularMeshesGeneration )
+    return;
+
+  if ( !mSimplificationWatcher )
+  {
+    mSimplificationWatcher.reset( new QFutureWatcher<QVector<QgsTriangularMesh *>>() );
+    connect( mSimplificationWatcher.get(), &QFutureWatcherBase::finished, this, [ = ]
+    {
+      if ( collectSimplifiedMeshes() )
+        triggerRepaint();
+      startSimplifiedMeshesComputation();
+    } );
+  }
+
+  // the copy shares the mesh data, and is not affected by later updates of the layer meshes
+  const QgsTriangularMesh baseMesh = *mTriangularMeshes[0];
+  const double reductionFactor = mSimplificationSettings.reductionFactor();
+  mSimplificationGeneration = mTriangularMeshesGeneration;
+  mSimplificationAttemptedGeneration = mTriangularMeshesGeneration;
+  mSimplificationPending = true;
+  mSimplificationWatcher->setFuture( QtConcurrent::run( [baseMesh, reductionFactor]
+  {
+    return baseMesh.simplifyMesh( reductionFactor );
+  } ) );
+}
+
+bool QgsMeshLayer::collectSimplifiedMeshes()
+{
+  if ( !mSimplificationPending )
+    return false;
+  mSimplificationPending = false;
+
+  const QVector<QgsTriangularMesh *> simplifiedMeshes = mSimplificationWatcher->result();
+
+  // the base mesh may have been moved to the cache, or discarded, meanwhile
+  std::vector<std::unique_ptr<QgsTriangularMesh>> *meshes = nullptr;
+  if ( mSimplificationGeneration == mTriangularMeshesGeneration )
+  {
+    meshes = &mTriangularMeshes;
+  }
+  else
+  {
+    for ( CachedTriangularMeshes &cached : mTriangularMeshCache )
+    {
+      if ( cached.generation == mSimplificationGeneration )
+      {
+        meshes = &cached.meshes;
+        break;
+      }
+    }
+  }
+
+  if ( !meshes || meshes->size() != 1 )
+  {
+    qDeleteAll( simplifiedMeshes );
+    return false;
+  }
+
+  for ( QgsTriangularMesh *simplifiedMesh : simplifiedMeshes )
+    meshes->emplace_back( simplifiedMesh );
+
+  if ( meshes != &mTriangularMeshes )
+  {
+    trimTriangularMeshCache();
+    return false;
+  }
+  return !simplifiedMeshes.isEmpty();
+}
+
 bool QgsMeshLayer::hasSimplifiedMeshes() const
 {
   //First mesh is the base mesh, so if size>1, there is no simplified meshes
@@ -150,6 +246,14 @@ bool QgsMeshLayer::hasSimplifiedMeshes() const
 
 QgsMeshLayer::~QgsMeshLayer()
 {
+  if ( mSimplificationPending )
+  {
+    mSimplificationWatcher->waitForFinished();
+    qDeleteAll( mSimplificationWatcher->result() );
+  }
+
+  // pending reads ahead of the datasets must be canceled before the provider is deleted
+  mDatasetGroupStore->clearDatasetCache();
   delete mDataProvider;
 }
 
@@ -277,7 +381,37 @@ QgsTriangularMesh *QgsMeshLayer::triangularMeshByLodIndex( int lodIndex ) const
   return mTriangularMeshes.at( lodIndex ).get();
 }
 
+//! Returns TRUE if triangular meshes built with the transform \a a can be reused for the transform \a b
+static bool triangularMeshTransformsMatch( const QgsCoordinateTransform &a, const QgsCoordinateTransform &b )
+{
+  // same criteria as QgsTriangularMesh::update()
+  if ( !a.isValid() && !b.isValid() )
+    return true;
+
+  return a.isValid() == b.isValid() &&
+         a.sourceCrs() == b.sourceCrs() &&
+         a.destinationCrs() == b.destinationCrs();
+}
+
+//! Returns the approximate memory used by the arrays and spatial indexes of a triangular mesh
+static qint64 triangularMeshMemoryUsage( const QgsTriangularMesh &mesh )
+{
+  // each triangle is a separate QVector, and has an entry in the spatial index and in the mapping to native faces
+  const qint64 triangleSize = sizeof( QgsMeshFace ) + 3 * sizeof( int ) + 24 + sizeof( int ) + 64;
+  return static_cast< qint64 >( mesh.vertices().size() ) * sizeof( QgsMeshVertex ) +
+         static_cast< qint64 >( mesh.triangles().size() ) * triangleSize +
+         static_cast< qint64 >( mesh.faceCentroids().size() ) * sizeof( QgsMeshVertex ) +
+         static_cast< qint64 >( mesh.edges().size() ) * ( sizeof( QgsMeshEdge ) + sizeof( int ) + 64 ) +
+         static_cast< qint64 >( mesh.edgeCentroids().size() ) * sizeof( QgsMeshVertex );
+}
+
 void  QgsMeshLayer::updateTriangularMesh( const QgsCoordinateTransform &transform )
+{
+  updateBaseTriangularMesh( transform );
+  createSimplifiedMeshes();
+}
+
+void QgsMeshLayer::updateBaseTriangularMesh( const QgsCoordinateTransform &transform )
 {
   // Native mesh
   if ( !mNativeMesh )
@@ -286,17 +420,76 @@ void  QgsMeshLayer::updateTriangularMesh( const QgsCoordinateTransform &transfor
     fillNativeMesh();
   }
 
+  // Keep the meshes of the previous transform, and reuse the ones of the new transform if they are cached
+  if ( !mTriangularMeshes.empty() && !triangularMeshTransformsMatch( mTriangularMeshesTransform, transform ) )
+  {
+    CachedTriangularMeshes previous;
+    previous.transform = mTriangularMeshesTransform;
+    previous.generation = mTriangularMeshesGeneration;
+    previous.meshes = std::move( mTriangularMeshes );
+    mTriangularMeshes.clear();
+
+    for ( auto it = mTriangularMeshCache.begin(); it != mTriangularMeshCache.end(); ++it )
+    {
+      if ( triangularMeshTransformsMatch( it->transform, transform ) )
+      {
+        mTriangularMeshes = std::move( it->meshes );
+        mTriangularMeshesGeneration = it->generation;
+        mTriangularMeshCache.erase( it );
+        break;
+      }
+    }
+
+    mTriangularMeshCache.push_front( std::move( previous ) );
+    trimTriangularMeshCache();
+  }
+  mTriangularMeshesTransform = transform;
+
   // Triangular mesh
   if ( mTriangularMeshes.empty() )
   {
     QgsTriangularMesh *baseMesh = new QgsTriangularMesh;
     mTriangularMeshes.emplace_back( baseMesh );
+    mTriangularMeshesGeneration = ++mLastTriangularMeshesGeneration;
   }
 
   if ( mTriangularMeshes[0].get()->update( mNativeMesh.get(), transform ) )
+  {
     mTriangularMeshes.resize( 1 ); //if the base triangular mesh is effectivly updated, remove simplified meshes
+    mTriangularMeshesGeneration = ++mLastTriangularMeshesGeneration;
+  }
+}
 
-  createSimplifiedMeshes();
+void QgsMeshLayer::trimTriangularMeshCache()
+{
+  qint64 cacheSize = 0;
+  for ( auto it = mTriangularMeshCache.begin(); it != mTriangularMeshCache.end(); )
+  {
+    qint64 entrySize = 0;
+    for ( const std::unique_ptr<QgsTriangularMesh> &mesh : it->meshes )
+      entrySize += triangularMeshMemoryUsage( *mesh );
+
+    if ( cacheSize + entrySize > mTriangularMeshCacheMaximumSize )
+    {
+      it = mTriangularMeshCache.erase( it );
+    }
+    else
+    {
+      cacheSize += entrySize;
+      ++it;
+    }
+  }
+}
+
+qint64 QgsMeshLayer::triangularMeshCacheMaximumSize() const
+{
+  return mTriangularMeshCacheMaximumSize;
+}
+
+void QgsMeshLayer::setTriangularMeshCacheMaximumSize( qint64 size )
+{
+  mTriangularMeshCacheMaximumSize = size;
+  trimTriangularMeshCache();
 }
 
 QgsMeshLayerRendererCache *QgsMeshLayer::rendererCache()
@@ -399,6 +592,41 @@ QgsMeshDataBlock QgsMeshLayer::areFacesActive( const QgsMeshDatasetIndex &index,
   return mDatasetGroupStore->areFacesActive( index, faceIndex, count );
 }
 
+QgsMeshDataBlock QgsMeshLayer::datasetValues( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredValues ) const
+{
+  return mDatasetGroupStore->datasetValues( index, requiredValues );
+}
+
+QgsMeshDataBlock QgsMeshLayer::areFacesActive( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredFaces ) const
+{
+  return mDatasetGroupStore->areFacesActive( index, requiredFaces );
+}
+
+void QgsMeshLayer::prefetchDataset( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredValues, const QVector<bool> &requiredFaces )
+{
+  mDatasetGroupStore->prefetchDataset( index, requiredValues, requiredFaces );
+}
+
+qint64 QgsMeshLayer::datasetCacheMaximumSize() const
+{
+  return mDatasetGroupStore->datasetCacheMaximumSize();
+}
+
+void QgsMeshLayer::setDatasetCacheMaximumSize( qint64 size )
+{
+  mDatasetGroupStore->setDatasetCacheMaximumSize( size );
+}
+
+qint64 QgsMeshLayer::datasetCacheHitCount() const
+{
+  return mDatasetGroupStore->datasetCacheHitCount();
+}
+
+qint64 QgsMeshLayer::datasetCacheMissCount() const
+{
+  return mDatasetGroupStore->datasetCacheMissCount();
+}
+
 bool QgsMeshLayer::isFaceActive( const QgsMeshDatasetIndex &index, int faceIndex ) const
 {
   return mDatasetGroupStore->isFaceActive( index, faceIndex );
@@ -966,6 +1194,9 @@ QgsMeshSimplificationSettings QgsMeshLayer::meshSimplificationSettings() const
 void QgsMeshLayer::setMeshSimplificationSettings( const QgsMeshSimplificationSettings &simplifySettings )
 {
   mSimplificationSettings = simplifySettings;
+  // the new settings may give simplified meshes where the previous ones did not
+  mSimplificationAttemptedGeneration = -1;
+  startSimplifiedMeshesComputation();
 }
 
 static QgsColorRamp *_createDefaultColorRamp()
@@ -1023,10 +1254,10 @@ void QgsMeshLayer::assignDefaultStyleToDatasetGroup( int groupIndex )
 QgsMapLayerRenderer *QgsMeshLayer::createMapRenderer( QgsRenderContext &rendererContext )
 {
   // Triangular mesh
-  updateTriangularMesh( rendererContext.coordinateTransform() );
+  updateBaseTriangularMesh( rendererContext.coordinateTransform() );
 
-  // Build overview triangular meshes if needed
-  createSimplifiedMeshes();
+  // Build overview triangular meshes in the background if needed, the base mesh is rendered until they are available
+  startSimplifiedMeshesComputation();
 
   // Cache
   if ( !mRendererCache )
@@ -1273,6 +1504,7 @@ void QgsMeshLayer::reload()
 {
   if ( mDataProvider && mDataProvider->isValid() )
   {
+    mDatasetGroupStore->clearDatasetCache();
     mDataProvider->reloadData();
 
     //reload the mesh structure
@@ -1283,6 +1515,7 @@ void QgsMeshLayer::reload()
 
     //clear the TriangularMeshes
     mTriangularMeshes.clear();
+    mTriangularMeshCache.clear();
 
     //clear the rendererCache
     mRendererCache.reset( new QgsMeshLayerRendererCache() );
@@ -1409,6 +1642,7 @@ QString QgsMeshLayer::htmlMetadata() const
 
 bool QgsMeshLayer::setDataProvider( QString const &provider, const QgsDataProvider::ProviderOptions &options, QgsDataProvider::ReadFlags flags )
 {
+  mDatasetGroupStore->clearDatasetCache();
   delete mDataProvider;
 
   mProviderKey = provider;
@@ -266,12 +266,36 @@ class CORE_EXPORT QgsMeshLayer : public QgsMapLayer
     /**
      * Gets native mesh and updates (creates if it doesn't exist) the base triangular mesh
      *
+     * The triangular meshes of the previous transform are kept in a cache, so that switching back
+     * to a previously used CRS does not need to transform and triangulate the native mesh again.
+     *
      * \param transform Transformation from layer CRS to destination (e.g. map) CRS. With invalid transform, it keeps the native mesh CRS
      *
+     * \see setTriangularMeshCacheMaximumSize()
      * \since QGIS 3.14
      */
     void updateTriangularMesh( const QgsCoordinateTransform &transform = QgsCoordinateTransform() );
 
+    /**
+     * Returns the maximum memory, in bytes, used to keep the triangular meshes (including their simplified
+     * levels of detail) of the coordinate transforms which are not currently used.
+     *
+     * \see setTriangularMeshCacheMaximumSize()
+     * \since QGIS 3.18
+     */
+    qint64 triangularMeshCacheMaximumSize() const;
+
+    /**
+     * Sets the maximum memory, in bytes, used to keep the triangular meshes (including their simplified
+     * levels of detail) of the coordinate transforms which are not currently used.
+     *
+     * The least recently used meshes are discarded first when the cache exceeds this size. A size of 0 disables the cache.
+     *
+     * \see triangularMeshCacheMaximumSize()
+     * \since QGIS 3.18
+     */
+    void setTriangularMeshCacheMaximumSize( qint64 size );
+
     /**
      * Returns native mesh (NULLPTR before rendering)
      *
@@ -427,6 +451,21 @@ class CORE_EXPORT QgsMeshLayer : public QgsMapLayer
      */
     QgsMeshDataBlock datasetValues( const QgsMeshDatasetIndex &index, int valueIndex, int count ) const;
 
+    /**
+     * Returns the vector/scalar values of the dataset, where only the values flagged in \a requiredValues
+     * are guaranteed to be read, e.g. the values of the elements visible in the map extent.
+     *
+     * The count of returned values is the size of \a requiredValues. Values are read by blocks,
+     * some values not flagged can be read too, the others are set to NaN.
+     *
+     * Returns invalid block for DataOnVolumes.
+     *
+     * \note Not available in Python bindings
+     * \see prefetchDataset()
+     * \since QGIS 3.18
+     */
+    QgsMeshDataBlock datasetValues( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredValues ) const SIP_SKIP;
+
     /**
      * Returns N vector/scalar values from the face index from the dataset for 3d stacked meshes
      *
@@ -468,6 +507,69 @@ class CORE_EXPORT QgsMeshLayer : public QgsMapLayer
      */
     QgsMeshDataBlock areFacesActive( const QgsMeshDatasetIndex &index, int faceIndex, int count ) const;
 
+    /**
+     * Returns whether the faces are active for particular dataset, where only the faces flagged
+     * in \a requiredFaces are guaranteed to be read.
+     *
+     * The count of returned flags is the size of \a requiredFaces. Flags are read by blocks,
+     * the faces which are not read are considered as inactive.
+     *
+     * \note Not available in Python bindings
+     * \see prefetchDataset()
+     * \since QGIS 3.18
+     */
+    QgsMeshDataBlock areFacesActive( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredFaces ) const SIP_SKIP;
+
+    /**
+     * Queues the reading of the values flagged in \a requiredValues and the active flags of the faces flagged
+     * in \a requiredFaces of the dataset with \a index, so they are already cached when they are requested.
+     *
+     * This is used to read ahead the next time step of a temporal animation. Values are read by blocks when
+     * the event loop of the layer's thread is idle, so this must be called from the thread the layer lives in.
+     * It does nothing if the dataset does not come from the data provider.
+     *
+     * \note Not available in Python bindings
+     * \see datasetCacheMaximumSize()
+     * \since QGIS 3.18
+     */
+    void prefetchDataset( const QgsMeshDatasetIndex &index, const QVector<bool> &requiredValues, const QVector<bool> &requiredFaces ) SIP_SKIP;
+
+    /**
+     * Returns the maximum memory, in bytes, used to cache the dataset values read from the data provider.
+     *
+     * \see setDatasetCacheMaximumSize()
+     * \since QGIS 3.18
+     */
+    qint64 datasetCacheMaximumSize() const;
+
+    /**
+     * Sets the maximum memory, in bytes, used to cache the dataset values read from the data provider.
+     *
+     * Values are read and cached by blocks, the least recently used blocks are discarded first when the cache
+     * exceeds this size. A size of 0 disables the cache.
+     *
+     * \see datasetCacheMaximumSize()
+     * \since QGIS 3.18
+     */
+    void setDatasetCacheMaximumSize( qint64 size );
+
+    /**
+     * Returns the number of blocks of dataset values or active face flags which were found in the cache.
+     *
+     * \see datasetCacheMissCount()
+     * \since QGIS 3.18
+     */
+    qint64 datasetCacheHitCount() const;
+
+    /**
+     * Returns the number of blocks of dataset values or active face flags which were read from the data provider,
+     * including the blocks read ahead with prefetchDataset().
+     *
+     * \see datasetCacheHitCount()
+     * \since QGIS 3.18
+     */
+    qint64 datasetCacheMissCount() const;
+
     /**
       * Interpolates the value on the given point from given dataset.
       * For 3D datasets, it uses dataset3dValue(), \n
@@ -774,6 +876,15 @@ class CORE_EXPORT QgsMeshLayer : public QgsMapLayer
     void assignDefaultStyleToDatasetGroup( int groupIndex );
     void setDefaultRendererSettings( const QList<int> &groupIndexes );
     void createSimplifiedMeshes();
+    void updateBaseTriangularMesh( const QgsCoordinateTransform &transform );
+    void startSimplifiedMeshesComputation();
+
+    /**
+     * Adds the simplified meshes computed in the background to the base mesh they were computed for.
+     * Returns TRUE if simplified meshes were added to the current base mesh.
+     */
+    bool collectSimplifiedMeshes();
+    void trimTriangularMeshCache();
     int levelsOfDetailsIndex( double partOfMeshInView ) const;
 
     bool hasSimplifiedMeshes() const;
@@ -796,6 +907,40 @@ class CORE_EXPORT QgsMeshLayer : public QgsMapLayer
     //! Pointer to derived mesh structures (the first one is the base mesh, others are simplified meshes with decreasing level of detail)
     std::vector<std::unique_ptr<QgsTriangularMesh>> mTriangularMeshes;
 
+    //! Coordinate transform of the triangular meshes
+    QgsCoordinateTransform mTriangularMeshesTransform;
+
+    //! Identifies the base triangular mesh, changed every time it is recomputed
+    int mTriangularMeshesGeneration = 0;
+
+    //! Last generation given to a base triangular mesh
+    int mLastTriangularMeshesGeneration = 0;
+
+    //! Triangular meshes of a coordinate transform which is not currently used
+    struct CachedTriangularMeshes
+    {
+      QgsCoordinateTransform transform;
+      int generation = 0;
+      std::vector<std::unique_ptr<QgsTriangularMesh>> meshes;
+    };
+
+    //! Triangular meshes of the previously used coordinate transforms, the most recently used first
+    std::list<CachedTriangularMeshes> mTriangularMeshCache;
+
+    qint64 mTriangularMeshCacheMaximumSize = 256 * 1024 * 1024;
+
+    //! Computes the simplified meshes of a base triangular mesh in the background
+    std::unique_ptr<QFutureWatcher<QVector<QgsTriangularMesh *>>> mSimplificationWatcher;
+
+    //! Generation of the base triangular mesh being simplified in the background
+    int mSimplificationGeneration = 0;
+
+    //! Whether the result of the background simplification has not been collected yet
+    bool mSimplificationPending = false;
+
+    //! Generation of the last base triangular mesh simplified, to avoid simplifying it again when this gave no simplified mesh
+    int mSimplificationAttemptedGeneration = -1;
+
     //! Pointer to the cache with data used for last rendering
     std::unique_ptr<QgsMeshLayerRendererCache> mRendererCache;
 
@@ -825,6 +970,8 @@ class CORE_EXPORT QgsMeshLayer : public QgsMapLayer
     QgsPointXY snapOnFace( const QgsPointXY &point, double searchRadius );
 
     void updateActiveDatasetGroups();
+
+    friend class TestQgsMeshLayer;
 };
 
 #endif //QGSMESHLAYER_H
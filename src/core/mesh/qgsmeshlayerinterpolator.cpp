@@ -19,6 +19,11 @@
 
 #include <memory>
 #include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include "qgsmeshlayerinterpolator.h"
 
@@ -68,6 +73,82 @@ int QgsMeshLayerInterpolator::bandCount() const
   return 1;
 }
 
+//! Pixel bounding box of a triangle to rasterize
+struct QgsMeshRasterTriangle
+{
+  int triangleIndex;
+  int leftLim;
+  int rightLim;
+  int topLim;
+  int bottomLim;
+};
+
+//! Triangles overlapping a band of rows of the output block
+struct QgsMeshRasterBand
+{
+  int topRow;
+  int bottomRow;
+  QVector< QgsMeshRasterTriangle > triangles;
+};
+
+//! Minimum number of rows of the bands rasterized in parallel
+static const int MESH_RASTER_MIN_BAND_HEIGHT = 16;
+
+//! Number of triangles prepared by each parallel task
+static const int MESH_RASTER_TRIANGLE_CHUNK_SIZE = 4096;
+
+/**
+ * Rasterizes the rows \a firstRow to \a lastRow of a triangle with barycentric edge functions.
+ *
+ * Barycentric coordinates are affine in pixel coordinates, so they are evaluated once at the start
+ * of each row and then incremented pixel by pixel. Pixels are considered inside the triangle with the
+ * same tolerance as QgsMeshLayerUtils::interpolateFromVerticesData().
+ */
+static void rasterizeTriangle( double *data, int width, const QgsMeshRasterTriangle &triangle, int firstRow, int lastRow,
+                               const QgsPointXY &origin, const QgsVector &columnStep, const QgsVector &rowStep,
+                               const QgsPointXY &p1, const QgsPointXY &p2, const QgsPointXY &p3,
+                               bool dataOnVertices, double value1, double value2, double value3 )
+{
+  const double area = ( p2.x() - p1.x() ) * ( p3.y() - p1.y() ) - ( p2.y() - p1.y() ) * ( p3.x() - p1.x() );
+  if ( area == 0 )
+    return;  // degenerate triangle
+
+  // gradients of the barycentric coordinates of the first two vertices, the third one is 1 - lambda1 - lambda2
+  const double invArea = 1.0 / area;
+  const double grad1X = ( p2.y() - p3.y() ) * invArea;
+  const double grad1Y = ( p3.x() - p2.x() ) * invArea;
+  const double grad2X = ( p3.y() - p1.y() ) * invArea;
+  const double grad2Y = ( p1.x() - p3.x() ) * invArea;
+  const double step1 = grad1X * columnStep.x() + grad1Y * columnStep.y();
+  const double step2 = grad2X * columnStep.x() + grad2Y * columnStep.y();
+
+  const double eps = 1e-6;
+  for ( int j = firstRow; j <= lastRow; ++j )
+  {
+    const double x = origin.x() + triangle.leftLim * columnStep.x() + j * rowStep.x();
+    const double y = origin.y() + triangle.leftLim * columnStep.y() + j * rowStep.y();
+    double lambda1 = ( ( p2.x() - x ) * ( p3.y() - y ) - ( p2.y() - y ) * ( p3.x() - x ) ) * invArea;
+    double lambda2 = ( ( p3.x() - x ) * ( p1.y() - y ) - ( p3.y() - y ) * ( p1.x() - x ) ) * invArea;
+
+    double *line = data + static_cast< qgssize >( j ) * width;
+    for ( int k = triangle.leftLim; k <= triangle.rightLim; ++k, lambda1 += step1, lambda2 += step2 )
+    {
+      const double lambda3 = 1.0 - lambda1 - lambda2;
+      if ( lambda1 <= -eps || lambda2 <= -eps || lambda3 <= -eps )
+        continue;
+
+      double val;
+      if ( dataOnVertices )
+        val = std::max( lambda1, 0.0 ) * value1 + std::max( lambda2, 0.0 ) * value2 + std::max( lambda3, 0.0 ) * value3;
+      else
+        val = value1;
+
+      if ( !std::isnan( val ) )
+        line[k] = val;
+    }
+  }
+}
+
 QgsRasterBlock *QgsMeshLayerInterpolator::block( int, const QgsRectangle &extent, int width, int height, QgsRasterBlockFeedback *feedback )
 {
   std::unique_ptr<QgsRasterBlock> outputBlock( new QgsRasterBlock( Qgis::Float64, width, height ) );
@@ -94,91 +175,104 @@ QgsRasterBlock *QgsMeshLayerInterpolator::block( int, const QgsRectangle &extent
   }
 
   const QVector<QgsMeshVertex> &vertices = mTriangularMesh.vertices();
+  const QVector<QgsMeshFace> &triangles = mTriangularMesh.triangles();
+  const QVector<int> &trianglesToNativeFaces = mTriangularMesh.trianglesToNativeFaces();
 
   // currently expecting that triangulation does not add any new extra vertices on the way
   if ( mDataType == QgsMeshDatasetGroupMetadata::DataType::DataOnVertices )
     Q_ASSERT( mDatasetValues.count() == mTriangularMesh.vertices().count() );
 
-  for ( int i = 0; i < indexCount; ++i )
-  {
-    if ( feedback && feedback->isCanceled() )
-      break;
-
-    if ( mContext.renderingStopped() )
-      break;
-
-    int triangleIndex;
-    if ( mSpatialIndexActive )
-      triangleIndex = spatialIndexTriangles[i];
-    else
-      triangleIndex = i;
-
-    const QgsMeshFace &face = mTriangularMesh.triangles()[triangleIndex];
-
-    const int v1 = face[0], v2 = face[1], v3 = face[2];
-    const QgsPointXY &p1 = vertices[v1], &p2 = vertices[v2], &p3 = vertices[v3];
+  const QgsMapToPixel &mapToPixel = mContext.mapToPixel();
+  const QSize outputSize = mOutputSize;
 
-    const int nativeFaceIndex = mTriangularMesh.trianglesToNativeFaces()[triangleIndex];
-    const bool isActive = mActiveFaceFlagValues.active( nativeFaceIndex );
-    if ( !isActive )
-      continue;
+  // first pass: pixel bounding boxes of the visible triangles, computed in parallel chunks
+  QVector< QVector< QgsMeshRasterTriangle > > chunks( ( indexCount + MESH_RASTER_TRIANGLE_CHUNK_SIZE - 1 ) / MESH_RASTER_TRIANGLE_CHUNK_SIZE );
+  QVector< int > chunkStarts;
+  chunkStarts.reserve( chunks.size() );
+  for ( int i = 0; i < chunks.size(); ++i )
+    chunkStarts.append( i * MESH_RASTER_TRIANGLE_CHUNK_SIZE );
 
-    QgsRectangle bbox = QgsMeshLayerUtils::triangleBoundingBox( p1, p2, p3 );
-    if ( !extent.intersects( bbox ) )
-      continue;
+  QtConcurrent::blockingMap( chunkStarts, [ &, this ]( int & chunkStart )
+  {
+    QVector< QgsMeshRasterTriangle > &chunk = chunks[ chunkStart / MESH_RASTER_TRIANGLE_CHUNK_SIZE ];
+    const int chunkEnd = std::min( chunkStart + MESH_RASTER_TRIANGLE_CHUNK_SIZE, indexCount );
+    for ( int i = chunkStart; i < chunkEnd; ++i )
+    {
+      if ( ( feedback && feedback->isCanceled() ) || mContext.renderingStopped() )
+        return;
+
+      const int triangleIndex = mSpatialIndexActive ? spatialIndexTriangles.at( i ) : i;
+      if ( !mActiveFaceFlagValues.active( trianglesToNativeFaces.at( triangleIndex ) ) )
+        continue;
+
+      const QgsMeshFace &face = triangles.at( triangleIndex );
+      const QgsRectangle bbox = QgsMeshLayerUtils::triangleBoundingBox( vertices.at( face[0] ), vertices.at( face[1] ), vertices.at( face[2] ) );
+      if ( !extent.intersects( bbox ) )
+        continue;
+
+      QgsMeshRasterTriangle triangle;
+      triangle.triangleIndex = triangleIndex;
+      QgsMeshLayerUtils::boundingBoxToScreenRectangle( mapToPixel, outputSize, bbox, triangle.leftLim, triangle.rightLim, triangle.topLim, triangle.bottomLim );
+      if ( triangle.leftLim <= triangle.rightLim && triangle.topLim <= triangle.bottomLim )
+        chunk.append( triangle );
+    }
+  } );
 
-    // Get the BBox of the element in pixels
-    int topLim, bottomLim, leftLim, rightLim;
-    QgsMeshLayerUtils::boundingBoxToScreenRectangle( mContext.mapToPixel(), mOutputSize, bbox, leftLim, rightLim, topLim, bottomLim );
+  if ( ( feedback && feedback->isCanceled() ) || mContext.renderingStopped() )
+    return outputBlock.release();
 
-    double value( 0 ), value1( 0 ), value2( 0 ), value3( 0 );
-    const int faceIdx = mTriangularMesh.trianglesToNativeFaces()[triangleIndex];
+  // second pass: the block is split in bands of rows, which are rasterized in parallel. Each band keeps the
+  // triangles in their original order, so overlapping triangles are painted in the same order as a serial pass.
+  const int bandHeight = std::max( MESH_RASTER_MIN_BAND_HEIGHT, height / ( 4 * std::max( 1, QThread::idealThreadCount() ) ) + 1 );
+  QVector< QgsMeshRasterBand > bands;
+  for ( int topRow = 0; topRow < height; topRow += bandHeight )
+    bands.append( QgsMeshRasterBand { topRow, std::min( topRow + bandHeight, height ) - 1, QVector< QgsMeshRasterTriangle >() } );
 
-    if ( mDataType == QgsMeshDatasetGroupMetadata::DataType::DataOnVertices )
+  for ( const QVector< QgsMeshRasterTriangle > &chunk : qgis::as_const( chunks ) )
+  {
+    for ( const QgsMeshRasterTriangle &triangle : chunk )
     {
-      value1 = mDatasetValues[v1];
-      value2 = mDatasetValues[v2];
-      value3 = mDatasetValues[v3];
+      const int lastBand = std::min( triangle.bottomLim / bandHeight, bands.size() - 1 );
+      for ( int band = triangle.topLim / bandHeight; band <= lastBand; ++band )
+        bands[ band ].triangles.append( triangle );
     }
-    else
-      value = mDatasetValues[faceIdx];
+  }
+  chunks.clear();
 
-    // interpolate in the bounding box of the face
-    for ( int j = topLim; j <= bottomLim; j++ )
+  // pixel coordinates to map coordinates is an affine transform
+  const QgsPointXY origin = mapToPixel.toMapCoordinates( 0, 0 );
+  const QgsVector columnStep = mapToPixel.toMapCoordinates( 1, 0 ) - origin;
+  const QgsVector rowStep = mapToPixel.toMapCoordinates( 0, 1 ) - origin;
+  const bool dataOnVertices = mDataType == QgsMeshDatasetGroupMetadata::DataType::DataOnVertices;
+
+  QtConcurrent::blockingMap( bands, [ &, this ]( QgsMeshRasterBand & band )
+  {
+    for ( const QgsMeshRasterTriangle &triangle : qgis::as_const( band.triangles ) )
     {
-      double *line = data + ( j * width );
-      for ( int k = leftLim; k <= rightLim; k++ )
+      if ( ( feedback && feedback->isCanceled() ) || mContext.renderingStopped() )
+        break;
+
+      const QgsMeshFace &face = triangles.at( triangle.triangleIndex );
+      const int v1 = face[0], v2 = face[1], v3 = face[2];
+
+      double value1, value2 = 0, value3 = 0;
+      if ( dataOnVertices )
       {
-        double val;
-        const QgsPointXY p = mContext.mapToPixel().toMapCoordinates( k, j );
-        if ( mDataType == QgsMeshDatasetGroupMetadata::DataType::DataOnVertices )
-          val = QgsMeshLayerUtils::interpolateFromVerticesData(
-                  p1,
-                  p2,
-                  p3,
-                  value1,
-                  value2,
-                  value3,
-                  p );
-        else
-        {
-          val = QgsMeshLayerUtils::interpolateFromFacesData(
-                  p1,
-                  p2,
-                  p3,
-                  value,
-                  p
-                );
-        }
-        if ( !std::isnan( val ) )
-        {
-          line[k] = val;
-          outputBlock->setIsData( j, k );
-        }
+        value1 = mDatasetValues.at( v1 );
+        value2 = mDatasetValues.at( v2 );
+        value3 = mDatasetValues.at( v3 );
+      }
+      else
+      {
+        value1 = mDatasetValues.at( trianglesToNativeFaces.at( triangle.triangleIndex ) );
       }
-    }
 
-  }
+      rasterizeTriangle( data, width, triangle, std::max( triangle.topLim, band.topRow ), std::min( triangle.bottomLim, band.bottomRow ),
+                         origin, columnStep, rowStep, vertices.at( v1 ), vertices.at( v2 ), vertices.at( v3 ),
+                         dataOnVertices, value1, value2, value3 );
+    }
+    band.triangles.clear();
+  } );
 
   return outputBlock.release();
 }
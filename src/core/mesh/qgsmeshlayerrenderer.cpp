@@ -80,16 +80,122 @@ void QgsMeshLayerRenderer::copyTriangularMeshes( QgsMeshLayer *layer, QgsRenderC
 {
   // handle level of details of mesh
   QgsMeshSimplificationSettings simplificationSettings = layer->meshSimplificationSettings();
+  bool isBaseTriangularMesh = true;
   if ( simplificationSettings.isEnabled() )
   {
     double triangleSize = simplificationSettings.meshResolution() * context.mapToPixel().mapUnitsPerPixel();
-    mTriangularMesh = *( layer->triangularMesh( triangleSize ) );
+    const QgsTriangularMesh *triangularMesh = layer->triangularMesh( triangleSize );
+    mTriangularMesh = *triangularMesh;
+    isBaseTriangularMesh = triangularMesh == layer->triangularMesh();
     mIsMeshSimplificationActive = true;
   }
   else
   {
     mTriangularMesh = *( layer->triangularMesh() );
   }
+
+  calculateRequiredElements( isBaseTriangularMesh );
+}
+
+void QgsMeshLayerRenderer::calculateRequiredElements( bool isBaseTriangularMesh )
+{
+  const int faceCount = mNativeMesh.faceCount();
+  const int vertexCount = mNativeMesh.vertexCount();
+  const int edgeCount = mNativeMesh.edgeCount();
+
+  if ( !isBaseTriangularMesh )
+  {
+    // simplified meshes do not contain all the native faces, so the neighbors of the visible faces are unknown
+    mRequiredFaces = QVector<bool>( faceCount, true );
+    mRequiredVertices = QVector<bool>( vertexCount, true );
+    mRequiredEdges = QVector<bool>( edgeCount, true );
+    return;
+  }
+
+  mRequiredFaces = QVector<bool>( faceCount, false );
+  mRequiredVertices = QVector<bool>( vertexCount, false );
+  mRequiredEdges = QVector<bool>( edgeCount, false );
+
+  const QgsRectangle extent = renderContext()->mapExtent();
+  QList<int> trianglesInExtent = mTriangularMesh.faceIndexesForRectangle( extent );
+  if ( !trianglesInExtent.isEmpty() )
+  {
+    // values on vertices can be interpolated from the faces around them, which all intersect the extent of the visible faces
+    const QVector<QgsMeshFace> &triangles = mTriangularMesh.triangles();
+    const QVector<QgsMeshVertex> &vertices = mTriangularMesh.vertices();
+    QgsRectangle facesExtent;
+    facesExtent.setMinimal();
+    for ( int triangleIndex : qgis::as_const( trianglesInExtent ) )
+    {
+      for ( int vertexIndex : triangles.at( triangleIndex ) )
+        facesExtent.combineExtentWith( vertices.at( vertexIndex ).x(), vertices.at( vertexIndex ).y() );
+    }
+    trianglesInExtent = mTriangularMesh.faceIndexesForRectangle( facesExtent );
+  }
+
+  const QVector<int> &trianglesToNativeFaces = mTriangularMesh.trianglesToNativeFaces();
+  for ( int triangleIndex : qgis::as_const( trianglesInExtent ) )
+  {
+    const int nativeFaceIndex = trianglesToNativeFaces.at( triangleIndex );
+    mRequiredFaces[nativeFaceIndex] = true;
+    for ( int vertexIndex : mNativeMesh.face( nativeFaceIndex ) )
+      mRequiredVertices[vertexIndex] = true;
+  }
+
+  const QList<int> edgesInExtent = mTriangularMesh.edgeIndexesForRectangle( extent );
+  const QVector<int> &edgesToNativeEdges = mTriangularMesh.edgesToNativeEdges();
+  for ( int edgeIndex : edgesInExtent )
+  {
+    const int nativeEdgeIndex = edgesToNativeEdges.at( edgeIndex );
+    mRequiredEdges[nativeEdgeIndex] = true;
+    const QgsMeshEdge &edge = mNativeMesh.edge( nativeEdgeIndex );
+    mRequiredVertices[edge.first] = true;
+    mRequiredVertices[edge.second] = true;
+  }
+}
+
+const QVector<bool> &QgsMeshLayerRenderer::requiredValues( QgsMeshDatasetGroupMetadata::DataType type ) const
+{
+  switch ( type )
+  {
+    case QgsMeshDatasetGroupMetadata::DataOnVertices:
+      return mRequiredVertices;
+    case QgsMeshDatasetGroupMetadata::DataOnEdges:
+      return mRequiredEdges;
+    case QgsMeshDatasetGroupMetadata::DataOnFaces:
+    case QgsMeshDatasetGroupMetadata::DataOnVolumes:
+      break;
+  }
+  return mRequiredFaces;
+}
+
+void QgsMeshLayerRenderer::prefetchNextDataset( QgsMeshLayer *layer, const QgsMeshDatasetIndex &previousIndex, const QgsMeshDatasetIndex &index,
+    const QVector<bool> &requiredValues, const QVector<bool> &requiredFaces )
+{
+  // during a temporal animation, read ahead the dataset following the rendered one in the direction of the animation
+  if ( !renderContext()->isTemporal() || !index.isValid() || !previousIndex.isValid() || previousIndex.group() != index.group() )
+    return;
+
+  const int step = index.dataset() - previousIndex.dataset();
+  const int nextDataset = index.dataset() + step;
+  if ( step == 0 || nextDataset < 0 || nextDataset >= layer->datasetCount( index ) )
+    return;
+
+  layer->prefetchDataset( QgsMeshDatasetIndex( index.group(), nextDataset ), requiredValues, requiredFaces );
+}
+
+//! Returns TRUE if all the elements flagged in \a required are flagged in \a available
+static bool containsRequiredElements( const QVector<bool> &available, const QVector<bool> &required )
+{
+  if ( available.size() != required.size() )
+    return false;
+
+  for ( int i = 0; i < required.size(); ++i )
+  {
+    if ( required.at( i ) && !available.at( i ) )
+      return false;
+  }
+  return true;
 }
 
 QgsFeedback *QgsMeshLayerRenderer::feedback() const
@@ -117,6 +223,11 @@ void QgsMeshLayerRenderer::copyScalarDatasetValues( QgsMeshLayer *layer )
   else
     datasetIndex = layer->staticScalarDatasetIndex();
 
+  // only the values of the elements in the map extent are read
+  QVector<bool> requiredScalarValues;
+  if ( datasetIndex.isValid() )
+    requiredScalarValues = requiredValues( QgsMeshLayerUtils::datasetValuesType( layer->datasetGroupMetadata( datasetIndex.group() ).dataType() ) );
+
   // Find out if we can use cache up to date. If yes, use it and return
   const int datasetGroupCount = layer->datasetGroupCount();
   const QgsMeshRendererScalarSettings::DataResamplingMethod method = mRendererSettings.scalarSettings( datasetIndex.group() ).dataResamplingMethod();
@@ -124,7 +235,9 @@ void QgsMeshLayerRenderer::copyScalarDatasetValues( QgsMeshLayer *layer )
   if ( ( cache->mDatasetGroupsCount == datasetGroupCount ) &&
        ( cache->mActiveScalarDatasetIndex == datasetIndex ) &&
        ( cache->mDataInterpolationMethod ==  method ) &&
-       ( QgsMesh3dAveragingMethod::equals( cache->mScalarAveragingMethod.get(), mRendererSettings.averagingMethod() ) )
+       ( QgsMesh3dAveragingMethod::equals( cache->mScalarAveragingMethod.get(), mRendererSettings.averagingMethod() ) ) &&
+       containsRequiredElements( cache->mScalarRequiredValues, requiredScalarValues ) &&
+       containsRequiredElements( cache->mScalarRequiredFaces, mRequiredFaces )
      )
   {
     mScalarDatasetValues = cache->mScalarDatasetValues;
@@ -146,8 +259,7 @@ void QgsMeshLayerRenderer::copyScalarDatasetValues( QgsMeshLayer *layer )
     QgsMeshDataBlock vals = QgsMeshLayerUtils::datasetValues(
                               layer,
                               datasetIndex,
-                              0,
-                              count );
+                              requiredScalarValues );
 
     if ( vals.isValid() )
     {
@@ -162,8 +274,9 @@ void QgsMeshLayerRenderer::copyScalarDatasetValues( QgsMeshLayer *layer )
     // populate face active flag, always defined on faces
     mScalarActiveFaceFlagValues = layer->areFacesActive(
                                     datasetIndex,
-                                    0,
-                                    mNativeMesh.faces.count() );
+                                    mRequiredFaces );
+
+    prefetchNextDataset( layer, cache->mActiveScalarDatasetIndex, datasetIndex, requiredScalarValues, mRequiredFaces );
 
     // for data on faces, there could be request to interpolate the data to vertices
     if ( method != QgsMeshRendererScalarSettings::None )
@@ -208,6 +321,8 @@ void QgsMeshLayerRenderer::copyScalarDatasetValues( QgsMeshLayer *layer )
   cache->mScalarDatasetMinimum = mScalarDatasetMinimum;
   cache->mScalarDatasetMaximum = mScalarDatasetMaximum;
   cache->mScalarAveragingMethod.reset( mRendererSettings.averagingMethod() ? mRendererSettings.averagingMethod()->clone() : nullptr );
+  cache->mScalarRequiredValues = requiredScalarValues;
+  cache->mScalarRequiredFaces = mRequiredFaces;
 }
 
 
@@ -219,12 +334,18 @@ void QgsMeshLayerRenderer::copyVectorDatasetValues( QgsMeshLayer *layer )
   else
     datasetIndex = layer->staticVectorDatasetIndex();
 
+  // only the values of the elements in the map extent are read
+  QVector<bool> requiredVectorValues;
+  if ( datasetIndex.isValid() )
+    requiredVectorValues = requiredValues( QgsMeshLayerUtils::datasetValuesType( layer->datasetGroupMetadata( datasetIndex.group() ).dataType() ) );
+
   // Find out if we can use cache up to date. If yes, use it and return
   const int datasetGroupCount = layer->datasetGroupCount();
   QgsMeshLayerRendererCache *cache = layer->rendererCache();
   if ( ( cache->mDatasetGroupsCount == datasetGroupCount ) &&
        ( cache->mActiveVectorDatasetIndex == datasetIndex ) &&
-       ( QgsMesh3dAveragingMethod::equals( cache->mVectorAveragingMethod.get(), mRendererSettings.averagingMethod() ) )
+       ( QgsMesh3dAveragingMethod::equals( cache->mVectorAveragingMethod.get(), mRendererSettings.averagingMethod() ) ) &&
+       containsRequiredElements( cache->mVectorRequiredValues, requiredVectorValues )
      )
   {
     mVectorDatasetValues = cache->mVectorDatasetValues;
@@ -258,8 +379,9 @@ void QgsMeshLayerRenderer::copyVectorDatasetValues( QgsMeshLayer *layer )
       mVectorDatasetValues = QgsMeshLayerUtils::datasetValues(
                                layer,
                                datasetIndex,
-                               0,
-                               count );
+                               requiredVectorValues );
+
+      prefetchNextDataset( layer, cache->mActiveVectorDatasetIndex, datasetIndex, requiredVectorValues, QVector<bool>() );
 
       if ( mVectorDatasetValues.isValid() )
         mVectorDatasetValuesMag = QgsMeshLayerUtils::calculateMagnitudes( mVectorDatasetValues );
@@ -283,6 +405,7 @@ void QgsMeshLayerRenderer::copyVectorDatasetValues( QgsMeshLayer *layer )
   cache->mVectorDatasetGroupMagMaximum = mVectorDatasetMagMaximum;
   cache->mVectorDataType = mVectorDataType;
   cache->mVectorAveragingMethod.reset( mRendererSettings.averagingMethod() ? mRendererSettings.averagingMethod()->clone() : nullptr );
+  cache->mVectorRequiredValues = requiredVectorValues;
 }
 
 bool QgsMeshLayerRenderer::render()
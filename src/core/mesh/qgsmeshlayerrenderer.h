@@ -66,6 +66,9 @@ struct CORE_NO_EXPORT QgsMeshLayerRendererCache
   double mScalarDatasetMaximum = std::numeric_limits<double>::quiet_NaN();
   QgsMeshRendererScalarSettings::DataResamplingMethod mDataInterpolationMethod = QgsMeshRendererScalarSettings::None;
   std::unique_ptr<QgsMesh3dAveragingMethod> mScalarAveragingMethod;
+  // elements which have been read, other values are NaN
+  QVector<bool> mScalarRequiredValues;
+  QVector<bool> mScalarRequiredFaces;
 
   // vector dataset
   QgsMeshDatasetIndex mActiveVectorDatasetIndex;
@@ -77,6 +80,7 @@ struct CORE_NO_EXPORT QgsMeshLayerRendererCache
   double mVectorDatasetGroupMagMaximum = std::numeric_limits<double>::quiet_NaN();
   QgsMeshDatasetGroupMetadata::DataType mVectorDataType = QgsMeshDatasetGroupMetadata::DataType::DataOnVertices;
   std::unique_ptr<QgsMesh3dAveragingMethod> mVectorAveragingMethod;
+  QVector<bool> mVectorRequiredValues;
 };
 
 
@@ -109,6 +113,10 @@ class QgsMeshLayerRenderer : public QgsMapLayerRenderer
 
     void renderVectorDataset();
     void copyTriangularMeshes( QgsMeshLayer *layer, QgsRenderContext &context );
+    void calculateRequiredElements( bool isBaseTriangularMesh );
+    const QVector<bool> &requiredValues( QgsMeshDatasetGroupMetadata::DataType type ) const;
+    void prefetchNextDataset( QgsMeshLayer *layer, const QgsMeshDatasetIndex &previousIndex, const QgsMeshDatasetIndex &index,
+                              const QVector<bool> &requiredValues, const QVector<bool> &requiredFaces );
     void copyScalarDatasetValues( QgsMeshLayer *layer );
     void copyVectorDatasetValues( QgsMeshLayer *layer );
     void calculateOutputSize();
@@ -129,6 +137,11 @@ class QgsMeshLayerRenderer : public QgsMapLayerRenderer
     // copy from mesh layer
     QgsRectangle mLayerExtent;
 
+    // elements of the native mesh needed to render the map extent
+    QVector<bool> mRequiredFaces;
+    QVector<bool> mRequiredVertices;
+    QVector<bool> mRequiredEdges;
+
     // copy of the scalar dataset
     QVector<double> mScalarDatasetValues;
     QgsMeshDataBlock mScalarActiveFaceFlagValues;
@@ -97,6 +97,28 @@ QgsMeshDataBlock QgsMeshLayerUtils::datasetValues(
   return block;
 }
 
+QgsMeshDataBlock QgsMeshLayerUtils::datasetValues(
+  const QgsMeshLayer *meshLayer,
+  QgsMeshDatasetIndex index,
+  const QVector<bool> &requiredValues )
+{
+  QgsMeshDataBlock block;
+  if ( !meshLayer )
+    return block;
+
+  if ( !meshLayer->datasetCount( index ) )
+    return block;
+
+  if ( !index.isValid() )
+    return block;
+
+  const QgsMeshDatasetGroupMetadata meta = meshLayer->datasetGroupMetadata( index.group() );
+  if ( meta.dataType() == QgsMeshDatasetGroupMetadata::DataType::DataOnVolumes )
+    return datasetValues( meshLayer, index, 0, requiredValues.size() );
+
+  return meshLayer->datasetValues( index, requiredValues );
+}
+
 QVector<QgsVector> QgsMeshLayerUtils::griddedVectorValues( const QgsMeshLayer *meshLayer,
     const QgsMeshDatasetIndex index,
     double xSpacing,
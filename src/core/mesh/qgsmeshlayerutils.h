@@ -82,6 +82,21 @@ class CORE_EXPORT QgsMeshLayerUtils
       int valueIndex,
       int count );
 
+    /**
+     * \brief Returns the vector/scalar values from the dataset, where only the values flagged in \a requiredValues
+     * are guaranteed to be read, e.g. the values of the elements visible in the map extent
+     *
+     * The count of returned values is the size of \a requiredValues. Values which are not read are set to NaN.
+     * For 3D stacked meshes, all the values are read and averaged.
+     *
+     * \see QgsMeshLayer::datasetValues()
+     * \since QGIS 3.18
+     */
+    static QgsMeshDataBlock datasetValues(
+      const QgsMeshLayer *meshLayer,
+      QgsMeshDatasetIndex index,
+      const QVector<bool> &requiredValues );
+
     /**
      * \brief Returns gridded vector values, if extentInMap is default, uses the triangular mesh extent
      *
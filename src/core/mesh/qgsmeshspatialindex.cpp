@@ -21,15 +21,21 @@
 #include <spatialindex/SpatialIndex.h>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QtConcurrentMap>
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 using namespace SpatialIndex;
 
 ///@cond PRIVATE
 
-static Region faceToRegion( const QgsMesh &mesh, int id )
+//! Number of mesh elements whose bounding boxes are computed by each parallel task
+static const int MESH_INDEX_CHUNK_SIZE = 8192;
+
+static void faceBounds( const QgsMesh &mesh, int id, double *bounds )
 {
-  const QgsMeshFace face = mesh.face( id );
+  const QgsMeshFace &face = mesh.faces.at( id );
   const QVector<QgsMeshVertex> &vertices = mesh.vertices;
   Q_ASSERT( face.size() > 0 );
   double xMinimum = vertices[face[0]].x();
@@ -45,23 +51,45 @@ static Region faceToRegion( const QgsMesh &mesh, int id )
     yMaximum = std::max( vertices[face[i]].y(), yMaximum );
   }
 
-  double pt1[2] = { xMinimum, yMinimum };
-  double pt2[2] = { xMaximum, yMaximum };
-  return SpatialIndex::Region( pt1, pt2, 2 );
+  bounds[0] = xMinimum;
+  bounds[1] = yMinimum;
+  bounds[2] = xMaximum;
+  bounds[3] = yMaximum;
 }
 
-static Region edgeToRegion( const QgsMesh &mesh, int id )
+static void edgeBounds( const QgsMesh &mesh, int id, double *bounds )
 {
-  const QgsMeshEdge edge = mesh.edge( id );
-  const QgsMeshVertex firstVertex = mesh.vertices[edge.first];
-  const QgsMeshVertex secondVertex = mesh.vertices[edge.second];
-  double xMinimum = std::min( firstVertex.x(), secondVertex.x() );
-  double yMinimum = std::min( firstVertex.y(), secondVertex.y() );
-  double xMaximum = std::max( firstVertex.x(), secondVertex.x() );
-  double yMaximum = std::max( firstVertex.y(), secondVertex.y() );
-  double pt1[2] = { xMinimum, yMinimum };
-  double pt2[2] = { xMaximum, yMaximum };
-  return SpatialIndex::Region( pt1, pt2, 2 );
+  const QgsMeshEdge &edge = mesh.edges.at( id );
+  const QgsMeshVertex &firstVertex = mesh.vertices[edge.first];
+  const QgsMeshVertex &secondVertex = mesh.vertices[edge.second];
+  bounds[0] = std::min( firstVertex.x(), secondVertex.x() );
+  bounds[1] = std::min( firstVertex.y(), secondVertex.y() );
+  bounds[2] = std::max( firstVertex.x(), secondVertex.x() );
+  bounds[3] = std::max( firstVertex.y(), secondVertex.y() );
+}
+
+/**
+ * Returns the bounding boxes of the \a count first faces or edges of a \a mesh, as consecutive
+ * (xmin, ymin, xmax, ymax) values. The bounding boxes are computed in parallel.
+ */
+static std::vector<double> meshElementBounds( const QgsMesh &mesh, int count, void ( *elementBounds )( const QgsMesh &, int, double * ), QgsFeedback *feedback )
+{
+  std::vector<double> bounds( 4 * static_cast<size_t>( count ) );
+  QVector<int> chunkStarts;
+  for ( int start = 0; start < count; start += MESH_INDEX_CHUNK_SIZE )
+    chunkStarts.append( start );
+
+  double *boundsData = bounds.data();
+  QtConcurrent::blockingMap( chunkStarts, [ &mesh, count, elementBounds, feedback, boundsData ]( int start )
+  {
+    if ( feedback && feedback->isCanceled() )
+      return;
+
+    const int end = std::min( start + MESH_INDEX_CHUNK_SIZE, count );
+    for ( int id = start; id < end; ++id )
+      elementBounds( mesh, id, boundsData + 4 * static_cast<size_t>( id ) );
+  } );
+  return bounds;
 }
 
 static Region rectToRegion( const QgsRectangle &rect )
@@ -131,20 +159,17 @@ class QgsMeshSpatialIndexCopyVisitor : public SpatialIndex::IVisitor
 /**
  * \ingroup core
  * \class QgsMeshFaceIteratorDataStream
- * \brief Utility class for bulk loading of R-trees. Not a part of public API.
+ * \brief Utility class for bulk loading of R-trees from precomputed bounding boxes. Not a part of public API.
  * \note not available in Python bindings
 */
 class QgsMeshIteratorDataStream : public IDataStream
 {
   public:
-    //! constructor - needs to load all data to a vector for later access when bulk loading
-    explicit QgsMeshIteratorDataStream( const QgsMesh &mesh,
-                                        int featuresCount,
-                                        std::function<Region( const QgsMesh &mesh, int id )> featureToRegionFunction,
+    //! constructor - \a bounds contains the (xmin, ymin, xmax, ymax) values of each element
+    explicit QgsMeshIteratorDataStream( const std::vector<double> &bounds,
                                         QgsFeedback *feedback = nullptr )
-      : mMesh( mesh )
-      , mFeaturesCount( featuresCount )
-      , mFeatureToRegionFunction( featureToRegionFunction )
+      : mBounds( bounds )
+      , mFeaturesCount( static_cast<int>( bounds.size() / 4 ) )
       , mFeedback( feedback )
     {
       readNextEntry();
@@ -188,10 +213,10 @@ class QgsMeshIteratorDataStream : public IDataStream
   protected:
     void readNextEntry()
     {
-      SpatialIndex::Region r;
       if ( mIterator < mFeaturesCount )
       {
-        r = mFeatureToRegionFunction( mMesh, mIterator );
+        const double *bounds = mBounds.data() + 4 * static_cast<size_t>( mIterator );
+        SpatialIndex::Region r( bounds, bounds + 2, 2 );
         mNextData = new RTree::Data(
           0,
           nullptr,
@@ -203,9 +228,8 @@ class QgsMeshIteratorDataStream : public IDataStream
 
   private:
     int mIterator = 0;
-    const QgsMesh &mMesh;
+    const std::vector<double> &mBounds;
     int mFeaturesCount = 0;
-    std::function<Region( const QgsMesh &mesh, int id )> mFeatureToRegionFunction;
     RTree::Data *mNextData = nullptr;
     QgsFeedback *mFeedback = nullptr;
 };
@@ -238,13 +262,15 @@ class QgsMeshSpatialIndexData : public QSharedData
       {
         case QgsMesh::ElementType::Edge:
         {
-          QgsMeshIteratorDataStream fids( fi, fi.edgeCount(), edgeToRegion, feedback );
+          const std::vector<double> bounds = meshElementBounds( fi, fi.edgeCount(), edgeBounds, feedback );
+          QgsMeshIteratorDataStream fids( bounds, feedback );
           initTree( &fids );
         }
         break;
         case QgsMesh::ElementType::Face:
         {
-          QgsMeshIteratorDataStream fids( fi, fi.faceCount(), faceToRegion, feedback );
+          const std::vector<double> bounds = meshElementBounds( fi, fi.faceCount(), faceBounds, feedback );
+          QgsMeshIteratorDataStream fids( bounds, feedback );
           initTree( &fids );
         }
         break;
@@ -45,6 +45,8 @@ QgsEptPointCloudIndex::~QgsEptPointCloudIndex() = default;
 
 void QgsEptPointCloudIndex::load( const QString &fileName )
 {
+  mUri = fileName;
+
   QFile f( fileName );
   if ( !f.open( QIODevice::ReadOnly ) )
   {
@@ -265,25 +267,32 @@ QgsPointCloudBlock *QgsEptPointCloudIndex::nodeData( const IndexedPointCloudNode
   if ( !mHierarchy.contains( n ) )
     return nullptr;
 
+  if ( QgsPointCloudBlock *cached = nodeDataFromCache( n, request ) )
+    return cached;
+
+  QgsPointCloudBlock *block = nullptr;
   if ( mDataType == QLatin1String( "binary" ) )
   {
     QString filename = QStringLiteral( "%1/ept-data/%2.bin" ).arg( mDirectory, n.toString() );
-    return QgsEptDecoder::decompressBinary( filename, attributes(), request.attributes() );
+    block = QgsEptDecoder::decompressBinary( filename, attributes(), request.attributes() );
   }
   else if ( mDataType == QLatin1String( "zstandard" ) )
   {
     QString filename = QStringLiteral( "%1/ept-data/%2.zst" ).arg( mDirectory, n.toString() );
-    return QgsEptDecoder::decompressZStandard( filename, attributes(), request.attributes() );
+    block = QgsEptDecoder::decompressZStandard( filename, attributes(), request.attributes() );
   }
   else if ( mDataType == QLatin1String( "laszip" ) )
   {
     QString filename = QStringLiteral( "%1/ept-data/%2.laz" ).arg( mDirectory, n.toString() );
-    return QgsEptDecoder::decompressLaz( filename, attributes(), request.attributes() );
+    block = QgsEptDecoder::decompressLaz( filename, attributes(), request.attributes() );
   }
   else
   {
     return nullptr;  // unsupported
   }
+
+  storeNodeDataToCache( block, n, request );
+  return block;
 }
 
 QgsCoordinateReferenceSystem QgsEptPointCloudIndex::crs() const
@@ -0,0 +1,61 @@
+/***************************************************************************
+                         qgspointcloudattribute_p.h
+                         --------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPOINTCLOUDATTRIBUTE_PRIVATE_H
+#define QGSPOINTCLOUDATTRIBUTE_PRIVATE_H
+
+#define SIP_NO_FILE
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include "qgspointcloudattribute.h"
+
+/**
+ * Returns the value of an attribute of the specified \a type stored at \a data, converted to a double.
+ */
+inline double pointCloudAttributeValueAsDouble( const char *data, QgsPointCloudAttribute::DataType type )
+{
+  switch ( type )
+  {
+    case QgsPointCloudAttribute::Char:
+      return *data;
+    case QgsPointCloudAttribute::Short:
+      return *reinterpret_cast< const short * >( data );
+    case QgsPointCloudAttribute::UShort:
+      return *reinterpret_cast< const unsigned short * >( data );
+    case QgsPointCloudAttribute::Int32:
+      return *reinterpret_cast< const qint32 * >( data );
+    case QgsPointCloudAttribute::Float:
+      return *reinterpret_cast< const float * >( data );
+    case QgsPointCloudAttribute::Double:
+      return *reinterpret_cast< const double * >( data );
+  }
+  return 0;
+}
+
+/// @endcond
+
+#endif // QGSPOINTCLOUDATTRIBUTE_PRIVATE_H
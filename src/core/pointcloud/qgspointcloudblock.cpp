@@ -33,6 +33,11 @@ QgsPointCloudBlock::QgsPointCloudBlock(
 
 QgsPointCloudBlock::~QgsPointCloudBlock() = default;
 
+QgsPointCloudBlock *QgsPointCloudBlock::clone() const
+{
+  return new QgsPointCloudBlock( mPointCount, mAttributes, mStorage );
+}
+
 const char *QgsPointCloudBlock::data() const
 {
   return mStorage.data();
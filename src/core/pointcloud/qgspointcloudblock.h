@@ -45,6 +45,14 @@ class CORE_EXPORT QgsPointCloudBlock
     //! Dtor
     ~QgsPointCloudBlock();
 
+    /**
+     * Returns a copy of the block. The data of the copy is implicitly shared with the original block,
+     * so this is inexpensive.
+     *
+     * \since QGIS 3.18
+     */
+    QgsPointCloudBlock *clone() const SIP_FACTORY;
+
     //! Returns raw pointer to data
     const char *data() const;
 
@@ -21,6 +21,7 @@
 #include "qgsgeometry.h"
 #include "qgspointcloudrequest.h"
 #include "qgsgeometryengine.h"
+#include "qgspointcloudidentifyresults.h"
 #include <mutex>
 
 #include <QtConcurrent/QtConcurrentMap>
@@ -232,82 +233,24 @@ static void _pointXYZ( const char *ptr, int i, std::size_t pointRecordSize, int
   z = indexOffset.z() + indexScale.z() * z;
 }
 
-/**
-* Retrieves all the attributes of a point
-*/
-QVariantMap _attributeMap( const char *data, std::size_t recordOffset, const QgsPointCloudAttributeCollection &attributeCollection )
+struct IdentifyIndexedPointCloudNode
 {
-  QVariantMap map;
-  const QVector<QgsPointCloudAttribute> attributes = attributeCollection.attributes();
-  for ( const QgsPointCloudAttribute &attr : attributes )
-  {
-    QString attributeName = attr.name();
-    int attributeOffset;
-    attributeCollection.find( attributeName, attributeOffset );
-    switch ( attr.type() )
-    {
-      case QgsPointCloudAttribute::Char:
-      {
-        const char value = *( data + recordOffset + attributeOffset );
-        map[ attributeName ] = value;
-      }
-      break;
-
-      case QgsPointCloudAttribute::Int32:
-      {
-        const qint32 value = *reinterpret_cast< const qint32 * >( data + recordOffset + attributeOffset );
-        map[ attributeName ] = value;
-      }
-      break;
-
-      case QgsPointCloudAttribute::Short:
-      {
-        const short value = *reinterpret_cast< const short * >( data + recordOffset + attributeOffset );
-        map[ attributeName ] = value;
-      }
-      break;
-
-      case QgsPointCloudAttribute::UShort:
-      {
-        const unsigned short value = *reinterpret_cast< const unsigned short * >( data + recordOffset + attributeOffset );
-        map[ attributeName ] = value;
-      }
-      break;
-
-      case QgsPointCloudAttribute::Float:
-      {
-        const float value = *reinterpret_cast< const float * >( data + recordOffset + attributeOffset );
-        map[ attributeName ] = value;
-      }
-      break;
+  typedef QPair< std::shared_ptr< QgsPointCloudBlock >, QVector< int > > result_type;
 
-      case QgsPointCloudAttribute::Double:
-      {
-        const double value = *reinterpret_cast< const double * >( data + recordOffset + attributeOffset );
-        map[ attributeName ] = value;
-      }
-      break;
-    }
-  }
-  return map;
-}
-
-struct MapIndexedPointCloudNode
-{
-  typedef QVector<QMap<QString, QVariant>> result_type;
-
-  MapIndexedPointCloudNode( QgsPointCloudRequest &request, const QgsVector3D &indexScale, const QgsVector3D &indexOffset,
-                            const QgsGeometry &extentGeometry, const QgsDoubleRange &zRange, QgsPointCloudIndex *index, int pointsLimit )
-    : mRequest( request ), mIndexScale( indexScale ), mIndexOffset( indexOffset ), mExtentGeometry( extentGeometry ), mZRange( zRange ), mIndex( index ), mPointsLimit( pointsLimit )
+  IdentifyIndexedPointCloudNode( const QgsPointCloudRequest &request, const QgsVector3D &indexScale, const QgsVector3D &indexOffset,
+                                 const QgsGeometry &extentGeometry, const QgsDoubleRange &zRange, QgsPointCloudIndex *index, int pointsLimit, QAtomicInt *pointsCount )
+    : mRequest( request ), mIndexScale( indexScale ), mIndexOffset( indexOffset ), mExtentGeometry( extentGeometry ), mZRange( zRange ), mIndex( index ), mPointsLimit( pointsLimit ), mPointsCount( pointsCount )
   { }
 
-  QVector<QVariantMap> operator()( IndexedPointCloudNode n )
+  result_type operator()( const IndexedPointCloudNode &n ) const
   {
-    QVector<QVariantMap> acceptedPoints;
-    std::unique_ptr<QgsPointCloudBlock> block( mIndex->nodeData( n, mRequest ) );
+    QVector<int> acceptedPoints;
+    if ( mPointsCount->loadAcquire() >= mPointsLimit )
+      return result_type();
 
-    if ( !block || pointsCount == mPointsLimit )
-      return acceptedPoints;
+    std::shared_ptr<QgsPointCloudBlock> block( mIndex->nodeData( n, mRequest ) );
+    if ( !block )
+      return result_type();
 
     const char *ptr = block->data();
     QgsPointCloudAttributeCollection blockAttributes = block->attributes();
@@ -318,7 +261,7 @@ struct MapIndexedPointCloudNode
     const QgsPointCloudAttribute::DataType zType = blockAttributes.find( QStringLiteral( "Z" ), zOffset )->type();
     std::unique_ptr< QgsGeometryEngine > extentEngine( QgsGeometry::createGeometryEngine( mExtentGeometry.constGet() ) );
     extentEngine->prepareGeometry();
-    for ( int i = 0; i < block->pointCount() && pointsCount < mPointsLimit; ++i )
+    for ( int i = 0; i < block->pointCount() && mPointsCount->loadAcquire() < mPointsLimit; ++i )
     {
       double x, y, z;
       _pointXYZ( ptr, i, recordSize, xOffset, xType, yOffset, yType, zOffset, zType, mIndexScale, mIndexOffset, x, y, z );
@@ -326,25 +269,21 @@ struct MapIndexedPointCloudNode
 
       if ( mZRange.contains( z ) && extentEngine->contains( &pointXY ) )
       {
-        QVariantMap pointAttr = _attributeMap( ptr, i * recordSize, blockAttributes );
-        pointAttr[ QStringLiteral( "X" ) ] = x;
-        pointAttr[ QStringLiteral( "Y" ) ] = y;
-        pointAttr[ QStringLiteral( "Z" ) ] = z;
-        pointsCount++;
-        acceptedPoints.push_back( pointAttr );
+        mPointsCount->fetchAndAddOrdered( 1 );
+        acceptedPoints.push_back( i );
       }
     }
-    return acceptedPoints;
+    return qMakePair( block, acceptedPoints );
   }
 
-  QgsPointCloudRequest &mRequest;
+  const QgsPointCloudRequest &mRequest;
   QgsVector3D mIndexScale;
   QgsVector3D mIndexOffset;
   const QgsGeometry &mExtentGeometry;
   const QgsDoubleRange &mZRange;
   QgsPointCloudIndex *mIndex = nullptr;
   int mPointsLimit;
-  int pointsCount = 0;
+  QAtomicInt *mPointsCount = nullptr;
 };
 
 QVector<QVariantMap> QgsPointCloudDataProvider::identify(
@@ -352,8 +291,21 @@ QVector<QVariantMap> QgsPointCloudDataProvider::identify(
   const QgsGeometry &extentGeometry,
   const QgsDoubleRange &extentZRange, int pointsLimit )
 {
+  const QgsPointCloudIdentifyResults results = identifyPoints( maxError, extentGeometry, extentZRange, pointsLimit );
+
   QVector<QVariantMap> acceptedPoints;
+  acceptedPoints.reserve( results.pointCount() );
+  for ( int i = 0; i < results.pointCount(); ++i )
+    acceptedPoints.append( results.point( i ) );
+
+  return acceptedPoints;
+}
 
+QgsPointCloudIdentifyResults QgsPointCloudDataProvider::identifyPoints(
+  double maxError,
+  const QgsGeometry &extentGeometry,
+  const QgsDoubleRange &extentZRange, int pointsLimit )
+{
   QgsPointCloudIndex *index = this->index();
   const IndexedPointCloudNode root = index->root();
 
@@ -366,12 +318,21 @@ QVector<QVariantMap> QgsPointCloudDataProvider::identify(
   QgsPointCloudRequest request;
   request.setAttributes( attributeCollection );
 
-  acceptedPoints = QtConcurrent::blockingMappedReduced( nodes,
-                   MapIndexedPointCloudNode( request, index->scale(), index->offset(), extentGeometry, extentZRange, index, pointsLimit ),
-                   qgis::overload<const QVector<QMap<QString, QVariant>>&>::of( &QVector<QMap<QString, QVariant>>::append ),
-                   QtConcurrent::UnorderedReduce );
+  // blocks are kept in the order of the nodes, only their matching points are collected
+  QAtomicInt pointsCount;
+  const QVector< IdentifyIndexedPointCloudNode::result_type > nodePoints = QtConcurrent::blockingMapped< QVector< IdentifyIndexedPointCloudNode::result_type > >( nodes,
+      IdentifyIndexedPointCloudNode( request, index->scale(), index->offset(), extentGeometry, extentZRange, index, pointsLimit, &pointsCount ) );
 
-  return acceptedPoints;
+  QgsPointCloudIdentifyResults results( index->scale(), index->offset() );
+  for ( const IdentifyIndexedPointCloudNode::result_type &points : nodePoints )
+  {
+    const int remaining = pointsLimit - results.pointCount();
+    if ( remaining <= 0 )
+      break;
+    results.addBlockPoints( points.first, points.second.mid( 0, remaining ) );
+  }
+
+  return results;
 }
 
 QVector<IndexedPointCloudNode> QgsPointCloudDataProvider::traverseTree(
@@ -22,6 +22,7 @@
 #include "qgsdataprovider.h"
 #include "qgspointcloudattribute.h"
 #include "qgsstatisticalsummary.h"
+#include "qgspointcloudidentifyresults.h"
 #include <memory>
 
 class IndexedPointCloudNode;
@@ -121,6 +122,21 @@ class CORE_EXPORT QgsPointCloudDataProvider: public QgsDataProvider
     % End
 #endif
 
+    /**
+     * Returns the points of the point cloud according to a zoom level
+     * defined by \a maxError (in layer coordinates), an extent \a geometry in the 2D plane
+     * and a range \a extentZRange for z values. At most \a pointsLimit points are returned.
+     *
+     * Unlike identify(), the attributes of the points are not converted to maps, but read from
+     * the decoded point cloud blocks when needed. This is much faster when many points are identified.
+     *
+     * \note this function does not handle elevation properties and you need to
+     * change elevation coordinates yourself after returning from the function
+     *
+     * \since QGIS 3.18
+     */
+    QgsPointCloudIdentifyResults identifyPoints( double maxError, const QgsGeometry &extentGeometry, const QgsDoubleRange &extentZRange = QgsDoubleRange(), int pointsLimit = 1000 );
+
     /**
      * Returns flags containing the supported capabilities for the data provider.
      */
@@ -0,0 +1,176 @@
+/***************************************************************************
+                         qgspointcloudidentifyresults.cpp
+                         --------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgspointcloudidentifyresults.h"
+#include "qgspointcloudblock.h"
+#include "qgspointcloudattribute_p.h"
+
+#include <algorithm>
+
+/**
+* Retrieves all the attributes of a point
+*/
+static QVariantMap _attributeMap( const char *data, std::size_t recordOffset, const QgsPointCloudAttributeCollection &attributeCollection )
+{
+  QVariantMap map;
+  const QVector<QgsPointCloudAttribute> attributes = attributeCollection.attributes();
+  for ( const QgsPointCloudAttribute &attr : attributes )
+  {
+    QString attributeName = attr.name();
+    int attributeOffset;
+    attributeCollection.find( attributeName, attributeOffset );
+    switch ( attr.type() )
+    {
+      case QgsPointCloudAttribute::Char:
+      {
+        const char value = *( data + recordOffset + attributeOffset );
+        map[ attributeName ] = value;
+      }
+      break;
+
+      case QgsPointCloudAttribute::Int32:
+      {
+        const qint32 value = *reinterpret_cast< const qint32 * >( data + recordOffset + attributeOffset );
+        map[ attributeName ] = value;
+      }
+      break;
+
+      case QgsPointCloudAttribute::Short:
+      {
+        const short value = *reinterpret_cast< const short * >( data + recordOffset + attributeOffset );
+        map[ attributeName ] = value;
+      }
+      break;
+
+      case QgsPointCloudAttribute::UShort:
+      {
+        const unsigned short value = *reinterpret_cast< const unsigned short * >( data + recordOffset + attributeOffset );
+        map[ attributeName ] = value;
+      }
+      break;
+
+      case QgsPointCloudAttribute::Float:
+      {
+        const float value = *reinterpret_cast< const float * >( data + recordOffset + attributeOffset );
+        map[ attributeName ] = value;
+      }
+      break;
+
+      case QgsPointCloudAttribute::Double:
+      {
+        const double value = *reinterpret_cast< const double * >( data + recordOffset + attributeOffset );
+        map[ attributeName ] = value;
+      }
+      break;
+    }
+  }
+  return map;
+}
+
+QgsPointCloudIdentifyResults::QgsPointCloudIdentifyResults( const QgsVector3D &scale, const QgsVector3D &offset )
+  : mScale( scale )
+  , mOffset( offset )
+{
+}
+
+void QgsPointCloudIdentifyResults::addBlockPoints( const std::shared_ptr<QgsPointCloudBlock> &block, const QVector<int> &pointIndices )
+{
+  if ( !block || pointIndices.isEmpty() )
+    return;
+
+  Part part;
+  part.block = block;
+  part.pointIndices = pointIndices;
+  mParts.append( part );
+  mPartOffsets.append( mPointCount );
+  mPointCount += pointIndices.size();
+}
+
+QgsPointCloudAttributeCollection QgsPointCloudIdentifyResults::attributes() const
+{
+  return mParts.isEmpty() ? QgsPointCloudAttributeCollection() : mParts.constFirst().block->attributes();
+}
+
+QVector<double> QgsPointCloudIdentifyResults::attributeValues( const QString &name ) const
+{
+  QVector<double> values;
+  if ( mParts.isEmpty() )
+    return values;
+
+  const QgsPointCloudAttributeCollection blockAttributes = attributes();
+  int attributeOffset = 0;
+  const QgsPointCloudAttribute *attribute = blockAttributes.find( name, attributeOffset );
+  if ( !attribute )
+    return values;
+
+  const QgsPointCloudAttribute::DataType type = attribute->type();
+  const std::size_t recordSize = blockAttributes.pointRecordSize();
+
+  // coordinates are stored as integers in the index
+  double scale = 1;
+  double offset = 0;
+  if ( name == QLatin1String( "X" ) )
+  {
+    scale = mScale.x();
+    offset = mOffset.x();
+  }
+  else if ( name == QLatin1String( "Y" ) )
+  {
+    scale = mScale.y();
+    offset = mOffset.y();
+  }
+  else if ( name == QLatin1String( "Z" ) )
+  {
+    scale = mScale.z();
+    offset = mOffset.z();
+  }
+
+  values.resize( mPointCount );
+  double *value = values.data();
+  for ( const Part &part : mParts )
+  {
+    const char *data = part.block->data() + attributeOffset;
+    for ( int i : part.pointIndices )
+      *value++ = offset + scale * pointCloudAttributeValueAsDouble( data + i * recordSize, type );
+  }
+  return values;
+}
+
+QVariantMap QgsPointCloudIdentifyResults::point( int index ) const
+{
+  if ( index < 0 || index >= mPointCount )
+    return QVariantMap();
+
+  const int partIndex = static_cast< int >( std::upper_bound( mPartOffsets.constBegin(), mPartOffsets.constEnd(), index ) - mPartOffsets.constBegin() ) - 1;
+  const Part &part = mParts.at( partIndex );
+  const int pointIndex = part.pointIndices.at( index - mPartOffsets.at( partIndex ) );
+
+  const QgsPointCloudAttributeCollection blockAttributes = part.block->attributes();
+  const std::size_t recordSize = blockAttributes.pointRecordSize();
+  const char *data = part.block->data();
+
+  QVariantMap map = _attributeMap( data, pointIndex * recordSize, blockAttributes );
+
+  int xOffset, yOffset, zOffset;
+  if ( const QgsPointCloudAttribute *attribute = blockAttributes.find( QStringLiteral( "X" ), xOffset ) )
+    map[ QStringLiteral( "X" ) ] = mOffset.x() + mScale.x() * pointCloudAttributeValueAsDouble( data + pointIndex * recordSize + xOffset, attribute->type() );
+  if ( const QgsPointCloudAttribute *attribute = blockAttributes.find( QStringLiteral( "Y" ), yOffset ) )
+    map[ QStringLiteral( "Y" ) ] = mOffset.y() + mScale.y() * pointCloudAttributeValueAsDouble( data + pointIndex * recordSize + yOffset, attribute->type() );
+  if ( const QgsPointCloudAttribute *attribute = blockAttributes.find( QStringLiteral( "Z" ), zOffset ) )
+    map[ QStringLiteral( "Z" ) ] = mOffset.z() + mScale.z() * pointCloudAttributeValueAsDouble( data + pointIndex * recordSize + zOffset, attribute->type() );
+  return map;
+}
@@ -0,0 +1,113 @@
+/***************************************************************************
+                         qgspointcloudidentifyresults.h
+                         --------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPOINTCLOUDIDENTIFYRESULTS_H
+#define QGSPOINTCLOUDIDENTIFYRESULTS_H
+
+#include "qgis_core.h"
+#include "qgis_sip.h"
+#include "qgsvector3d.h"
+#include "qgspointcloudattribute.h"
+
+#include <QVariantMap>
+#include <QVector>
+#include <memory>
+
+class QgsPointCloudBlock;
+
+/**
+ * \ingroup core
+ *
+ * Points identified in a point cloud, stored by columns.
+ *
+ * The attribute values are not copied: they are read from the decoded blocks of the
+ * point cloud nodes when requested, either one attribute at a time for all the points
+ * with attributeValues(), or one point at a time with point().
+ *
+ * QgsPointCloudIdentifyResults objects are inexpensive to copy, as the blocks are shared.
+ *
+ * \note The API is considered EXPERIMENTAL and can be changed without a notice
+ *
+ * \see QgsPointCloudDataProvider::identifyPoints()
+ * \since QGIS 3.18
+ */
+class CORE_EXPORT QgsPointCloudIdentifyResults
+{
+  public:
+
+    /**
+     * Constructor for empty results.
+     */
+    QgsPointCloudIdentifyResults() = default;
+
+    /**
+     * Constructor for empty results, for the points of an index with the given \a scale and \a offset.
+     *
+     * \note Not available in Python bindings
+     */
+    QgsPointCloudIdentifyResults( const QgsVector3D &scale, const QgsVector3D &offset ) SIP_SKIP;
+
+    /**
+     * Adds the points of a \a block at the given \a pointIndices to the results.
+     *
+     * All the blocks must have the same attributes.
+     *
+     * \note Not available in Python bindings
+     */
+    void addBlockPoints( const std::shared_ptr< QgsPointCloudBlock > &block, const QVector< int > &pointIndices ) SIP_SKIP;
+
+    /**
+     * Returns the number of identified points.
+     */
+    int pointCount() const { return mPointCount; }
+
+    /**
+     * Returns the attributes stored for the identified points.
+     */
+    QgsPointCloudAttributeCollection attributes() const;
+
+    /**
+     * Returns the values of the attribute with the specified \a name for all the identified points.
+     *
+     * X, Y and Z values are returned in layer coordinates. An empty vector is returned if
+     * the attribute does not exist.
+     */
+    QVector< double > attributeValues( const QString &name ) const;
+
+    /**
+     * Returns all the attributes of the point at the specified \a index, in the same form
+     * as QgsPointCloudDataProvider::identify().
+     */
+    QVariantMap point( int index ) const;
+
+  private:
+
+    struct Part
+    {
+      std::shared_ptr< QgsPointCloudBlock > block;
+      QVector< int > pointIndices;
+    };
+
+    QgsVector3D mScale = QgsVector3D( 1, 1, 1 );
+    QgsVector3D mOffset;
+    QVector< Part > mParts;
+    //! Index of the first point of each part
+    QVector< int > mPartOffsets;
+    int mPointCount = 0;
+};
+
+#endif // QGSPOINTCLOUDIDENTIFYRESULTS_H
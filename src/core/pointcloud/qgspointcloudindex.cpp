@@ -16,6 +16,8 @@
  ***************************************************************************/
 
 #include "qgspointcloudindex.h"
+#include "qgspointcloudrequest.h"
+#include <QCache>
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
@@ -24,6 +26,11 @@
 #include <QJsonObject>
 #include <QTime>
 #include <QtDebug>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <limits>
 
 IndexedPointCloudNode::IndexedPointCloudNode():
   mD( -1 ),
@@ -142,6 +149,49 @@ QgsDoubleRange QgsPointCloudDataBounds::zRange( const QgsVector3D &offset, const
 ///@endcond
 
 
+//
+// Node data cache
+//
+
+///@cond PRIVATE
+
+//! Identifies a decoded node data block in the cache
+struct QgsPointCloudNodeDataCacheKey
+{
+  QString uri;
+  IndexedPointCloudNode node;
+  QString attributes;
+
+  bool operator==( const QgsPointCloudNodeDataCacheKey &other ) const
+  {
+    return node == other.node && uri == other.uri && attributes == other.attributes;
+  }
+};
+
+static uint qHash( const QgsPointCloudNodeDataCacheKey &key )
+{
+  return qHash( key.uri ) ^ qHash( key.node ) ^ qHash( key.attributes );
+}
+
+//! Returns a string identifying the attributes requested for a node, in order
+static QString requestedAttributesKey( const QgsPointCloudRequest &request )
+{
+  const QVector<QgsPointCloudAttribute> attributes = request.attributes().attributes();
+  QStringList parts;
+  parts.reserve( attributes.size() );
+  for ( const QgsPointCloudAttribute &attribute : attributes )
+    parts << QStringLiteral( "%1:%2" ).arg( attribute.name() ).arg( static_cast< int >( attribute.type() ) );
+  return parts.join( ',' );
+}
+
+//! Decoded node data blocks of all the indexes, cost is in kilobytes
+static QCache< QgsPointCloudNodeDataCacheKey, QgsPointCloudBlock > sNodeDataCache( 256 * 1024 );
+static QMutex sNodeDataCacheMutex;
+static qint64 sNodeDataCacheHits = 0;
+static qint64 sNodeDataCacheMisses = 0;
+
+///@endcond
+
 //
 // QgsPointCloudIndex
 //
@@ -228,3 +278,61 @@ int QgsPointCloudIndex::span() const
 {
   return mSpan;
 }
+
+qint64 QgsPointCloudIndex::nodeDataCacheMaximumSize()
+{
+  QMutexLocker locker( &sNodeDataCacheMutex );
+  return static_cast< qint64 >( sNodeDataCache.maxCost() ) * 1024;
+}
+
+void QgsPointCloudIndex::setNodeDataCacheMaximumSize( qint64 size )
+{
+  QMutexLocker locker( &sNodeDataCacheMutex );
+  sNodeDataCache.setMaxCost( static_cast< int >( std::min< qint64 >( std::max< qint64 >( size, 0 ) / 1024, std::numeric_limits< int >::max() ) ) );
+}
+
+QgsPointCloudIndex::CacheStatistics QgsPointCloudIndex::nodeDataCacheStatistics()
+{
+  QMutexLocker locker( &sNodeDataCacheMutex );
+  CacheStatistics statistics;
+  statistics.hits = sNodeDataCacheHits;
+  statistics.misses = sNodeDataCacheMisses;
+  statistics.blockCount = sNodeDataCache.count();
+  statistics.size = static_cast< qint64 >( sNodeDataCache.totalCost() ) * 1024;
+  return statistics;
+}
+
+void QgsPointCloudIndex::clearNodeDataCache()
+{
+  QMutexLocker locker( &sNodeDataCacheMutex );
+  sNodeDataCache.clear();
+  sNodeDataCacheHits = 0;
+  sNodeDataCacheMisses = 0;
+}
+
+QgsPointCloudBlock *QgsPointCloudIndex::nodeDataFromCache( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request ) const
+{
+  const QgsPointCloudNodeDataCacheKey key { mUri, n, requestedAttributesKey( request ) };
+
+  QMutexLocker locker( &sNodeDataCacheMutex );
+  if ( const QgsPointCloudBlock *cached = sNodeDataCache.object( key ) )
+  {
+    ++sNodeDataCacheHits;
+    return cached->clone();
+  }
+
+  ++sNodeDataCacheMisses;
+  return nullptr;
+}
+
+void QgsPointCloudIndex::storeNodeDataToCache( const QgsPointCloudBlock *data, const IndexedPointCloudNode &n, const QgsPointCloudRequest &request ) const
+{
+  if ( !data || mUri.isEmpty() )
+    return;
+
+  const QgsPointCloudNodeDataCacheKey key { mUri, n, requestedAttributesKey( request ) };
+  const qint64 size = static_cast< qint64 >( data->pointCount() ) * data->attributes().pointRecordSize();
+
+  QMutexLocker locker( &sNodeDataCacheMutex );
+  sNodeDataCache.insert( key, data->clone(), static_cast< int >( size / 1024 ) + 1 );
+}
@@ -179,10 +179,66 @@ class CORE_EXPORT QgsPointCloudIndex: public QObject
      *
      * It is caller responsibility to free the block.
      *
+     * Implementations should keep the decoded blocks in the node data cache shared by all the indexes,
+     * see nodeDataFromCache() and storeNodeDataToCache().
+     *
      * May return nullptr in case the node is not present or any other problem with loading
      */
     virtual QgsPointCloudBlock *nodeData( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request ) = 0;
 
+    /**
+     * Statistics of the cache of decoded node data blocks
+     *
+     * \since QGIS 3.18
+     */
+    struct CacheStatistics
+    {
+      //! Number of requests answered from the cache
+      qint64 hits = 0;
+      //! Number of requests which had to be decoded
+      qint64 misses = 0;
+      //! Number of blocks in the cache
+      int blockCount = 0;
+      //! Approximate memory used by the blocks in the cache, in bytes
+      qint64 size = 0;
+    };
+
+    /**
+     * Returns the maximum memory, in bytes, used by the cache of decoded node data blocks.
+     *
+     * The cache is shared by all the point cloud indexes, so that 2D rendering, identify and
+     * 3D views of the same data reuse the blocks decoded by each other.
+     *
+     * \see setNodeDataCacheMaximumSize()
+     * \since QGIS 3.18
+     */
+    static qint64 nodeDataCacheMaximumSize();
+
+    /**
+     * Sets the maximum memory, in bytes, used by the cache of decoded node data blocks.
+     *
+     * The least recently used blocks are discarded first when the cache exceeds this size. A size of 0 disables the cache.
+     *
+     * \see nodeDataCacheMaximumSize()
+     * \since QGIS 3.18
+     */
+    static void setNodeDataCacheMaximumSize( qint64 size );
+
+    /**
+     * Returns the statistics of the cache of decoded node data blocks.
+     *
+     * \see clearNodeDataCache()
+     * \since QGIS 3.18
+     */
+    static CacheStatistics nodeDataCacheStatistics();
+
+    /**
+     * Removes all the blocks from the cache of decoded node data blocks, and resets its statistics.
+     *
+     * \since QGIS 3.18
+     */
+    static void clearNodeDataCache();
+
     //! Returns extent of the data
     QgsRectangle extent() const { return mExtent; }
 
@@ -226,6 +282,25 @@ class CORE_EXPORT QgsPointCloudIndex: public QObject
     //! Sets native attributes of the data
     void setAttributes( const QgsPointCloudAttributeCollection &attributes );
 
+    /**
+     * Returns a copy of the data block of node \a n for the \a request from the node data cache,
+     * or nullptr if it is not cached. It is caller responsibility to free the block.
+     *
+     * \see storeNodeDataToCache()
+     * \since QGIS 3.18
+     */
+    QgsPointCloudBlock *nodeDataFromCache( const IndexedPointCloudNode &n, const QgsPointCloudRequest &request ) const;
+
+    /**
+     * Stores a copy of the \a data block of node \a n decoded for the \a request in the node data cache.
+     *
+     * \see nodeDataFromCache()
+     * \since QGIS 3.18
+     */
+    void storeNodeDataToCache( const QgsPointCloudBlock *data, const IndexedPointCloudNode &n, const QgsPointCloudRequest &request ) const;
+
+    QString mUri; //!< Identifies the data of the index in the node data cache
+
     QgsRectangle mExtent;  //!< 2D extent of data
     double mZMin = 0, mZMax = 0;   //!< Vertical extent of data
 
@@ -16,6 +16,8 @@
  ***************************************************************************/
 
 #include <QElapsedTimer>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include "qgspointcloudlayerrenderer.h"
 #include "qgspointcloudlayer.h"
@@ -33,10 +35,47 @@
 #include "qgscircle.h"
 #include "qgsmapclippingutils.h"
 
+#include <algorithm>
+
+///@cond PRIVATE
+
+/**
+ * Loads the data of point cloud nodes, called from worker threads.
+ *
+ * Blocks are returned as shared pointers, so that blocks loaded after the rendering
+ * was canceled are freed when their result is discarded.
+ */
+class QgsPointCloudNodeLoader
+{
+  public:
+    typedef std::shared_ptr< QgsPointCloudBlock > result_type;
+
+    QgsPointCloudNodeLoader( QgsPointCloudIndex *index, const QgsPointCloudRequest &request, const QgsRenderContext *context )
+      : mIndex( index )
+      , mRequest( request )
+      , mContext( context )
+    {}
+
+    std::shared_ptr< QgsPointCloudBlock > operator()( const IndexedPointCloudNode &node ) const
+    {
+      if ( mContext->renderingStopped() )
+        return nullptr;
+      return std::shared_ptr< QgsPointCloudBlock >( mIndex->nodeData( node, mRequest ) );
+    }
+
+  private:
+    QgsPointCloudIndex *mIndex = nullptr;
+    QgsPointCloudRequest mRequest;
+    const QgsRenderContext *mContext = nullptr;
+};
+
+///@endcond
+
 QgsPointCloudLayerRenderer::QgsPointCloudLayerRenderer( QgsPointCloudLayer *layer, QgsRenderContext &context )
   : QgsMapLayerRenderer( layer->id(), &context )
   , mLayer( layer )
   , mLayerAttributes( layer->attributes() )
+  , mNodeBatchSize( 4 * std::max( 1, QThread::idealThreadCount() ) )
 {
   // TODO: we must not keep pointer to mLayer (it's dangerous) - we must copy anything we need for rendering
   // or use some locking to prevent read/write from multiple threads
@@ -152,30 +191,19 @@ bool QgsPointCloudLayerRenderer::render()
     return false;
   }
   double rootErrorPixels = rootErrorInMapCoordinates / mapUnitsPerPixel; // in pixels
-  const QVector<IndexedPointCloudNode> nodes = traverseTree( pc, context.renderContext(), pc->root(), maximumError, rootErrorPixels );
+  QVector<IndexedPointCloudNode> nodes = traverseTree( pc, context.renderContext(), pc->root(), maximumError, rootErrorPixels );
+
+  // coarsest nodes first, so that the whole extent is covered early and refined afterwards
+  std::stable_sort( nodes.begin(), nodes.end(), []( const IndexedPointCloudNode & a, const IndexedPointCloudNode & b )
+  {
+    return a.d() < b.d();
+  } );
 
   QgsPointCloudRequest request;
   request.setAttributes( mAttributes );
 
   // drawing
-  int nodesDrawn = 0;
-  for ( const IndexedPointCloudNode &n : nodes )
-  {
-    if ( context.renderContext().renderingStopped() )
-    {
-      QgsDebugMsgLevel( "canceled", 2 );
-      break;
-    }
-    std::unique_ptr<QgsPointCloudBlock> block( pc->nodeData( n, request ) );
-
-    if ( !block )
-      continue;
-
-    context.setAttributes( block->attributes() );
-
-    mRenderer->renderBlock( block.get(), context );
-    ++nodesDrawn;
-  }
+  const int nodesDrawn = renderNodes( pc, context, request, nodes );
 
   QgsDebugMsgLevel( QStringLiteral( "totals: %1 nodes | %2 points | %3ms" ).arg( nodesDrawn )
                     .arg( context.pointsRendered() )
@@ -193,6 +221,65 @@ bool QgsPointCloudLayerRenderer::forceRasterRender() const
   return mRenderer ? mRenderer->type() != QLatin1String( "extent" ) : false;
 }
 
+void QgsPointCloudLayerRenderer::setNodeBatchSize( int size )
+{
+  mNodeBatchSize = std::max( 1, size );
+}
+
+int QgsPointCloudLayerRenderer::nodeBatchSize() const
+{
+  return mNodeBatchSize;
+}
+
+int QgsPointCloudLayerRenderer::renderNodes( QgsPointCloudIndex *pc, QgsPointCloudRenderContext &context, const QgsPointCloudRequest &request, const QVector<IndexedPointCloudNode> &nodes )
+{
+  // nodes are loaded in batches, with the next batch loading while the current one is drawn.
+  // This keeps the workers busy while limiting the number of decoded blocks held in memory.
+  const int batchSize = mNodeBatchSize;
+  const QgsPointCloudNodeLoader loader( pc, request, &context.renderContext() );
+
+  int nodesDrawn = 0;
+  QFuture< std::shared_ptr< QgsPointCloudBlock > > batch = QtConcurrent::mapped( nodes.mid( 0, batchSize ), loader );
+  for ( int batchStart = 0; batchStart < nodes.size(); batchStart += batchSize )
+  {
+    QFuture< std::shared_ptr< QgsPointCloudBlock > > nextBatch;
+    if ( batchStart + batchSize < nodes.size() )
+      nextBatch = QtConcurrent::mapped( nodes.mid( batchStart + batchSize, batchSize ), loader );
+
+    const int batchCount = std::min( batchSize, nodes.size() - batchStart );
+    for ( int i = 0; i < batchCount; ++i )
+    {
+      if ( context.renderContext().renderingStopped() )
+        break;
+
+      // blocks until the node is loaded, results are reported in the order of the nodes
+      const std::shared_ptr< QgsPointCloudBlock > block = batch.resultAt( i );
+      if ( !block )
+        continue;
+
+      context.setAttributes( block->attributes() );
+
+      mRenderer->renderBlock( block.get(), context );
+      ++nodesDrawn;
+    }
+
+    if ( context.renderContext().renderingStopped() )
+    {
+      QgsDebugMsgLevel( "canceled", 2 );
+      // workers must be done with the index and the render context before returning
+      batch.cancel();
+      nextBatch.cancel();
+      batch.waitForFinished();
+      nextBatch.waitForFinished();
+      break;
+    }
+
+    batch = nextBatch;
+  }
+
+  return nodesDrawn;
+}
+
 QVector<IndexedPointCloudNode> QgsPointCloudLayerRenderer::traverseTree( const QgsPointCloudIndex *pc,
     const QgsRenderContext &context,
     IndexedPointCloudNode n,
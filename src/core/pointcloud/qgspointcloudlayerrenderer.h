@@ -39,6 +39,7 @@ class QgsRenderContext;
 class QgsPointCloudLayer;
 class QgsPointCloudRenderer;
 class QgsPointCloudRenderContext;
+class QgsPointCloudRequest;
 
 #define SIP_NO_FILE
 
@@ -63,9 +64,34 @@ class CORE_EXPORT QgsPointCloudLayerRenderer: public QgsMapLayerRenderer
     bool render() override;
     bool forceRasterRender() const override;
 
+    /**
+     * Sets the number of nodes which are loaded together in worker threads, while the
+     * previously loaded nodes are drawn.
+     *
+     * By default, four nodes are loaded per available thread.
+     *
+     * \see nodeBatchSize()
+     * \since QGIS 3.18
+     */
+    void setNodeBatchSize( int size );
+
+    /**
+     * Returns the number of nodes which are loaded together in worker threads.
+     *
+     * \see setNodeBatchSize()
+     * \since QGIS 3.18
+     */
+    int nodeBatchSize() const;
+
   private:
     QVector<IndexedPointCloudNode> traverseTree( const QgsPointCloudIndex *pc, const QgsRenderContext &context, IndexedPointCloudNode n, double maxErrorPixels, double nodeErrorPixels );
 
+    /**
+     * Loads the data of \a nodes in worker threads, and renders the blocks in the order of the nodes
+     * as soon as they are ready. Returns the number of rendered nodes.
+     */
+    int renderNodes( QgsPointCloudIndex *pc, QgsPointCloudRenderContext &context, const QgsPointCloudRequest &request, const QVector<IndexedPointCloudNode> &nodes );
+
     QgsPointCloudLayer *mLayer = nullptr;
 
     std::unique_ptr< QgsPointCloudRenderer > mRenderer;
@@ -80,6 +106,8 @@ class CORE_EXPORT QgsPointCloudLayerRenderer: public QgsMapLayerRenderer
     QgsGeometry mCloudExtent;
     QList< QgsMapClippingRegion > mClippingRegions;
 
+    int mNodeBatchSize = 1;
+
 };
 
 #endif // QGSPOINTCLOUDLAYERRENDERER_H
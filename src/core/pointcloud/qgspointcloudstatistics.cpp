@@ -0,0 +1,292 @@
+/***************************************************************************
+                         qgspointcloudstatistics.cpp
+                         --------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgspointcloudstatistics.h"
+#include "qgspointcloudindex.h"
+#include "qgspointcloudrequest.h"
+#include "qgspointcloudattribute_p.h"
+#include "qgsfeedback.h"
+
+#include <QtConcurrentMap>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+void QgsPointCloudAttributeStatistics::setHistogramRange( double minimum, double maximum, int binCount )
+{
+  mHistogramMinimum = minimum;
+  mHistogramMaximum = maximum;
+  mHistogram = maximum > minimum ? QVector< qint64 >( std::max( 0, binCount ), 0 ) : QVector< qint64 >();
+}
+
+void QgsPointCloudAttributeStatistics::addValue( double value )
+{
+  ++mCount;
+  const double delta = value - mMean;
+  mMean += delta / mCount;
+  mM2 += delta * ( value - mMean );
+
+  if ( value < mMinimum )
+    mMinimum = value;
+  if ( value > mMaximum )
+    mMaximum = value;
+
+  if ( !mHistogram.isEmpty() && value >= mHistogramMinimum && value <= mHistogramMaximum )
+  {
+    const int binCount = mHistogram.size();
+    const int bin = std::min( binCount - 1, static_cast< int >( ( value - mHistogramMinimum ) / ( mHistogramMaximum - mHistogramMinimum ) * binCount ) );
+    ++mHistogram[ bin ];
+  }
+
+  if ( mCountClasses )
+    ++mClassCounts[ static_cast< int >( value ) ];
+}
+
+void QgsPointCloudAttributeStatistics::merge( const QgsPointCloudAttributeStatistics &other )
+{
+  if ( other.mCount == 0 )
+    return;
+
+  if ( mCount == 0 )
+  {
+    *this = other;
+    return;
+  }
+
+  // combine the means and squared differences of both sets of values
+  const double count = static_cast< double >( mCount + other.mCount );
+  const double delta = other.mMean - mMean;
+  mMean += delta * other.mCount / count;
+  mM2 += other.mM2 + delta * delta * mCount * other.mCount / count;
+  mCount += other.mCount;
+
+  mMinimum = std::min( mMinimum, other.mMinimum );
+  mMaximum = std::max( mMaximum, other.mMaximum );
+
+  if ( mHistogram.size() == other.mHistogram.size() )
+  {
+    for ( int i = 0; i < mHistogram.size(); ++i )
+      mHistogram[ i ] += other.mHistogram.at( i );
+  }
+
+  for ( auto it = other.mClassCounts.constBegin(); it != other.mClassCounts.constEnd(); ++it )
+    mClassCounts[ it.key() ] += it.value();
+}
+
+double QgsPointCloudAttributeStatistics::stDev() const
+{
+  return mCount ? std::sqrt( mM2 / mCount ) : std::numeric_limits< double >::quiet_NaN();
+}
+
+///@cond PRIVATE
+
+struct StatisticsIndexedPointCloudNode
+{
+  typedef QVector< QgsPointCloudAttributeStatistics > result_type;
+
+  StatisticsIndexedPointCloudNode( QgsPointCloudIndex *index, const QgsPointCloudRequest &request, const QStringList &attributes,
+                                   const QVector< QgsPointCloudAttributeStatistics > &configuration, const QgsRectangle &filterExtent,
+                                   QgsFeedback *feedback, int nodeCount, QAtomicInt *processedNodes )
+    : mIndex( index ), mRequest( request ), mAttributes( attributes ), mConfiguration( configuration ), mFilterExtent( filterExtent )
+    , mFeedback( feedback ), mNodeCount( nodeCount ), mProcessedNodes( processedNodes )
+  { }
+
+  result_type operator()( const IndexedPointCloudNode &n ) const
+  {
+    QVector< QgsPointCloudAttributeStatistics > statistics = mConfiguration;
+    if ( mFeedback && mFeedback->isCanceled() )
+      return statistics;
+
+    std::unique_ptr< QgsPointCloudBlock > block( mIndex->nodeData( n, mRequest ) );
+    if ( block )
+    {
+      const QgsPointCloudAttributeCollection blockAttributes = block->attributes();
+      const std::size_t recordSize = blockAttributes.pointRecordSize();
+      const int pointCount = block->pointCount();
+      const char *data = block->data();
+      const QgsVector3D scale = mIndex->scale();
+      const QgsVector3D offset = mIndex->offset();
+
+      // points outside of the filter extent are flagged first, so that the attributes can be processed one after another
+      QVector< bool > accepted;
+      if ( !mFilterExtent.isNull() )
+      {
+        int xOffset = 0;
+        int yOffset = 0;
+        const QgsPointCloudAttribute::DataType xType = blockAttributes.find( QStringLiteral( "X" ), xOffset )->type();
+        const QgsPointCloudAttribute::DataType yType = blockAttributes.find( QStringLiteral( "Y" ), yOffset )->type();
+        accepted.resize( pointCount );
+        for ( int i = 0; i < pointCount; ++i )
+        {
+          const char *record = data + i * recordSize;
+          const double x = offset.x() + scale.x() * pointCloudAttributeValueAsDouble( record + xOffset, xType );
+          const double y = offset.y() + scale.y() * pointCloudAttributeValueAsDouble( record + yOffset, yType );
+          accepted[ i ] = mFilterExtent.contains( QgsPointXY( x, y ) );
+        }
+      }
+
+      for ( int attributeIndex = 0; attributeIndex < mAttributes.size(); ++attributeIndex )
+      {
+        const QString &name = mAttributes.at( attributeIndex );
+        int attributeOffset = 0;
+        const QgsPointCloudAttribute *attribute = blockAttributes.find( name, attributeOffset );
+        if ( !attribute )
+          continue;
+
+        const QgsPointCloudAttribute::DataType type = attribute->type();
+        double valueScale = 1;
+        double valueOffset = 0;
+        if ( name == QLatin1String( "X" ) )
+        {
+          valueScale = scale.x();
+          valueOffset = offset.x();
+        }
+        else if ( name == QLatin1String( "Y" ) )
+        {
+          valueScale = scale.y();
+          valueOffset = offset.y();
+        }
+        else if ( name == QLatin1String( "Z" ) )
+        {
+          valueScale = scale.z();
+          valueOffset = offset.z();
+        }
+
+        QgsPointCloudAttributeStatistics &attributeStatistics = statistics[ attributeIndex ];
+        const char *value = data + attributeOffset;
+        for ( int i = 0; i < pointCount; ++i, value += recordSize )
+        {
+          if ( !accepted.isEmpty() && !accepted.at( i ) )
+            continue;
+          attributeStatistics.addValue( valueOffset + valueScale * pointCloudAttributeValueAsDouble( value, type ) );
+        }
+      }
+    }
+
+    const int processedNodes = mProcessedNodes->fetchAndAddOrdered( 1 ) + 1;
+    if ( mFeedback )
+      mFeedback->setProgress( 100.0 * processedNodes / mNodeCount );
+
+    return statistics;
+  }
+
+  QgsPointCloudIndex *mIndex = nullptr;
+  const QgsPointCloudRequest &mRequest;
+  const QStringList &mAttributes;
+  const QVector< QgsPointCloudAttributeStatistics > &mConfiguration;
+  const QgsRectangle &mFilterExtent;
+  QgsFeedback *mFeedback = nullptr;
+  int mNodeCount = 0;
+  QAtomicInt *mProcessedNodes = nullptr;
+};
+
+static void _mergeStatistics( QVector< QgsPointCloudAttributeStatistics > &result, const QVector< QgsPointCloudAttributeStatistics > &nodeStatistics )
+{
+  if ( result.isEmpty() )
+  {
+    result = nodeStatistics;
+    return;
+  }
+
+  for ( int i = 0; i < result.size(); ++i )
+    result[ i ].merge( nodeStatistics.at( i ) );
+}
+
+static void _collectNodes( const QgsPointCloudIndex *index, const IndexedPointCloudNode &n, const QgsRectangle &filterExtent, int maximumDepth, QVector< IndexedPointCloudNode > &nodes )
+{
+  if ( !filterExtent.isNull() && !filterExtent.intersects( index->nodeMapExtent( n ) ) )
+    return;
+
+  nodes.append( n );
+
+  if ( maximumDepth >= 0 && n.d() >= maximumDepth )
+    return;
+
+  const QList< IndexedPointCloudNode > children = index->nodeChildren( n );
+  for ( const IndexedPointCloudNode &child : children )
+    _collectNodes( index, child, filterExtent, maximumDepth, nodes );
+}
+
+///@endcond
+
+QgsPointCloudStatisticsCalculator::QgsPointCloudStatisticsCalculator( QgsPointCloudIndex *index, const QStringList &attributes )
+  : mIndex( index )
+  , mAttributes( attributes )
+  , mConfiguration( attributes.size() )
+  , mStatistics( attributes.size() )
+{
+}
+
+void QgsPointCloudStatisticsCalculator::setHistogram( const QString &attribute, double minimum, double maximum, int binCount )
+{
+  const int attributeIndex = mAttributes.indexOf( attribute );
+  if ( attributeIndex >= 0 )
+    mConfiguration[ attributeIndex ].setHistogramRange( minimum, maximum, binCount );
+}
+
+void QgsPointCloudStatisticsCalculator::setCountClasses( const QString &attribute, bool count )
+{
+  const int attributeIndex = mAttributes.indexOf( attribute );
+  if ( attributeIndex >= 0 )
+    mConfiguration[ attributeIndex ].setCountClasses( count );
+}
+
+bool QgsPointCloudStatisticsCalculator::calculate( QgsFeedback *feedback )
+{
+  mStatistics = mConfiguration;
+  if ( !mIndex || !mIndex->isValid() )
+    return false;
+
+  // only read the attributes which are needed
+  const QgsPointCloudAttributeCollection indexAttributes = mIndex->attributes();
+  QgsPointCloudAttributeCollection requestAttributes;
+  QStringList requestAttributeNames = mAttributes;
+  if ( !mFilterExtent.isNull() )
+    requestAttributeNames << QStringLiteral( "X" ) << QStringLiteral( "Y" );
+  requestAttributeNames.removeDuplicates();
+  for ( const QString &name : qgis::as_const( requestAttributeNames ) )
+  {
+    const int attributeIndex = indexAttributes.indexOf( name );
+    if ( attributeIndex >= 0 )
+      requestAttributes.push_back( indexAttributes.at( attributeIndex ) );
+  }
+
+  QgsPointCloudRequest request;
+  request.setAttributes( requestAttributes );
+
+  QVector< IndexedPointCloudNode > nodes;
+  _collectNodes( mIndex, mIndex->root(), mFilterExtent, mMaximumDepth, nodes );
+  if ( nodes.isEmpty() )
+    return true;
+
+  QAtomicInt processedNodes;
+  const QVector< QgsPointCloudAttributeStatistics > statistics = QtConcurrent::blockingMappedReduced< QVector< QgsPointCloudAttributeStatistics > >( nodes,
+      StatisticsIndexedPointCloudNode( mIndex, request, mAttributes, mConfiguration, mFilterExtent, feedback, nodes.size(), &processedNodes ),
+      _mergeStatistics, QtConcurrent::UnorderedReduce );
+
+  if ( feedback && feedback->isCanceled() )
+    return false;
+
+  mStatistics = statistics;
+  return true;
+}
+
+QgsPointCloudAttributeStatistics QgsPointCloudStatisticsCalculator::statistics( const QString &attribute ) const
+{
+  const int attributeIndex = mAttributes.indexOf( attribute );
+  return attributeIndex >= 0 ? mStatistics.at( attributeIndex ) : QgsPointCloudAttributeStatistics();
+}
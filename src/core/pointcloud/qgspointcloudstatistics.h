@@ -0,0 +1,227 @@
+/***************************************************************************
+                         qgspointcloudstatistics.h
+                         --------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPOINTCLOUDSTATISTICS_H
+#define QGSPOINTCLOUDSTATISTICS_H
+
+#include "qgis_core.h"
+#include "qgsrectangle.h"
+
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+#include <limits>
+
+#define SIP_NO_FILE
+
+class QgsFeedback;
+class QgsPointCloudIndex;
+
+/**
+ * \ingroup core
+ *
+ * Statistics of the values of a point cloud attribute.
+ *
+ * Values are added one at a time with addValue(), and statistics calculated over separate
+ * sets of points can be combined with merge(), so the values never need to be stored.
+ *
+ * \note The API is considered EXPERIMENTAL and can be changed without a notice
+ * \note Not available in Python bindings
+ *
+ * \since QGIS 3.18
+ */
+class CORE_EXPORT QgsPointCloudAttributeStatistics
+{
+  public:
+
+    /**
+     * Sets the range and the number of bins of the histogram of the values.
+     *
+     * Values outside of the range are not counted in the histogram. The histogram is
+     * not calculated if \a binCount is 0, which is the default.
+     *
+     * This resets the histogram, so it must be called before adding values.
+     */
+    void setHistogramRange( double minimum, double maximum, int binCount );
+
+    /**
+     * Sets whether the number of points for each distinct value should be counted.
+     *
+     * This is meant for classification attributes, values are truncated to integers.
+     *
+     * \see classCounts()
+     */
+    void setCountClasses( bool count ) { mCountClasses = count; }
+
+    /**
+     * Adds a \a value to the statistics.
+     */
+    void addValue( double value );
+
+    /**
+     * Adds the values of \a other statistics, which must use the same histogram range.
+     */
+    void merge( const QgsPointCloudAttributeStatistics &other );
+
+    /**
+     * Returns the number of values.
+     */
+    qint64 count() const { return mCount; }
+
+    /**
+     * Returns the minimum value, or NaN if there are no values.
+     */
+    double minimum() const { return mCount ? mMinimum : std::numeric_limits< double >::quiet_NaN(); }
+
+    /**
+     * Returns the maximum value, or NaN if there are no values.
+     */
+    double maximum() const { return mCount ? mMaximum : std::numeric_limits< double >::quiet_NaN(); }
+
+    /**
+     * Returns the mean of the values, or NaN if there are no values.
+     */
+    double mean() const { return mCount ? mMean : std::numeric_limits< double >::quiet_NaN(); }
+
+    /**
+     * Returns the population standard deviation of the values, or NaN if there are no values.
+     */
+    double stDev() const;
+
+    /**
+     * Returns the number of values in each bin of the histogram.
+     *
+     * \see setHistogramRange()
+     */
+    QVector< qint64 > histogram() const { return mHistogram; }
+
+    //! Returns the lower bound of the histogram range
+    double histogramMinimum() const { return mHistogramMinimum; }
+
+    //! Returns the upper bound of the histogram range
+    double histogramMaximum() const { return mHistogramMaximum; }
+
+    /**
+     * Returns the number of values for each distinct value, if class counting is enabled.
+     *
+     * \see setCountClasses()
+     */
+    QMap< int, qint64 > classCounts() const { return mClassCounts; }
+
+  private:
+
+    qint64 mCount = 0;
+    double mMinimum = std::numeric_limits< double >::max();
+    double mMaximum = std::numeric_limits< double >::lowest();
+    double mMean = 0;
+    //! Sum of the squared differences to the mean
+    double mM2 = 0;
+
+    double mHistogramMinimum = 0;
+    double mHistogramMaximum = 0;
+    QVector< qint64 > mHistogram;
+
+    bool mCountClasses = false;
+    QMap< int, qint64 > mClassCounts;
+};
+
+/**
+ * \ingroup core
+ *
+ * Calculates statistics of attributes of a point cloud index, over all the points of
+ * its nodes.
+ *
+ * The nodes are read and processed in parallel, and each attribute is processed as a
+ * column of values in the decoded blocks, without converting points to QVariant maps.
+ *
+ * \note The API is considered EXPERIMENTAL and can be changed without a notice
+ * \note Not available in Python bindings
+ *
+ * \since QGIS 3.18
+ */
+class CORE_EXPORT QgsPointCloudStatisticsCalculator
+{
+  public:
+
+    /**
+     * Constructor for QgsPointCloudStatisticsCalculator, for the specified \a attributes of an \a index.
+     */
+    QgsPointCloudStatisticsCalculator( QgsPointCloudIndex *index, const QStringList &attributes );
+
+    /**
+     * Sets an \a extent (in layer coordinates) to restrict the statistics to the points inside it.
+     *
+     * A null rectangle, which is the default, includes all the points.
+     */
+    void setFilterExtent( const QgsRectangle &extent ) { mFilterExtent = extent; }
+
+    //! Returns the extent the statistics are restricted to
+    QgsRectangle filterExtent() const { return mFilterExtent; }
+
+    /**
+     * Sets the maximum \a depth of the nodes to read. Reading only the coarsest levels gives
+     * approximate statistics much faster.
+     *
+     * A negative depth, which is the default, reads all the nodes.
+     */
+    void setMaximumDepth( int depth ) { mMaximumDepth = depth; }
+
+    //! Returns the maximum depth of the nodes to read
+    int maximumDepth() const { return mMaximumDepth; }
+
+    /**
+     * Sets the histogram range and number of bins for an \a attribute.
+     *
+     * \see QgsPointCloudAttributeStatistics::setHistogramRange()
+     */
+    void setHistogram( const QString &attribute, double minimum, double maximum, int binCount );
+
+    /**
+     * Sets whether the number of points for each distinct value of an \a attribute should be counted.
+     *
+     * \see QgsPointCloudAttributeStatistics::setCountClasses()
+     */
+    void setCountClasses( const QString &attribute, bool count = true );
+
+    /**
+     * Calculates the statistics.
+     *
+     * The optional \a feedback object can be used to report progress and allow cancellation.
+     * Returns FALSE if the index is not valid or if the calculation was canceled.
+     */
+    bool calculate( QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns the statistics calculated for an \a attribute.
+     *
+     * X, Y and Z statistics are in layer coordinates. Empty statistics are returned
+     * for attributes which do not exist in the index.
+     */
+    QgsPointCloudAttributeStatistics statistics( const QString &attribute ) const;
+
+  private:
+
+    QgsPointCloudIndex *mIndex = nullptr;
+    QStringList mAttributes;
+    //! Configured statistics for each attribute, without values
+    QVector< QgsPointCloudAttributeStatistics > mConfiguration;
+    QVector< QgsPointCloudAttributeStatistics > mStatistics;
+    QgsRectangle mFilterExtent;
+    int mMaximumDepth = -1;
+};
+
+#endif // QGSPOINTCLOUDSTATISTICS_H
@@ -34,6 +34,11 @@
 #include "qgsreferencedgeometry.h"
 #include "qgsrasterfilewriter.h"
 #include "qgsvectortilelayer.h"
+#include "qgslogger.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
 
 QList<QgsRasterLayer *> QgsProcessingUtils::compatibleRasterLayers( QgsProject *project, bool sort )
 {
@@ -1205,6 +1210,48 @@ QgsFields QgsProcessingUtils::indicesToFields( const QList<int> &indices, const
   return fieldsSubset;
 }
 
+QgsSpatialIndex QgsProcessingUtils::createSpatialIndex( const QgsFeatureSource &source, const QgsVectorLayer *layer, const QgsFeatureRequest &request, QgsFeedback *feedback, QgsSpatialIndex::Flags flags )
+{
+  QString indexPath;
+  QDateTime lastModified;
+  const long featureCount = source.featureCount();
+  if ( layer && layer->isValid() && !layer->isEditable() && layer->featureCount() == featureCount
+       && request.filterType() == QgsFeatureRequest::FilterNone && request.filterRect().isNull() )
+  {
+    const QVariantMap parts = QgsProviderRegistry::instance()->decodeUri( layer->providerType(), layer->source() );
+    const QFileInfo fileInfo( parts.value( QStringLiteral( "path" ) ).toString() );
+    if ( fileInfo.isFile() )
+    {
+      // changes to SQLite based formats may only have reached the write-ahead log yet
+      lastModified = fileInfo.lastModified();
+      const QFileInfo walFileInfo( fileInfo.filePath() + QStringLiteral( "-wal" ) );
+      if ( walFileInfo.exists() && walFileInfo.lastModified() > lastModified )
+        lastModified = walFileInfo.lastModified();
+
+      QCryptographicHash hash( QCryptographicHash::Sha1 );
+      hash.addData( layer->providerType().toUtf8() );
+      hash.addData( layer->source().toUtf8() );
+      hash.addData( layer->subsetString().toUtf8() );
+      hash.addData( request.destinationCrs().toWkt( QgsCoordinateReferenceSystem::WKT_PREFERRED ).toUtf8() );
+      hash.addData( QByteArray::number( static_cast< int >( flags ) ) );
+      indexPath = QDir( tempFolder() ).filePath( QStringLiteral( "%1.qsidx" ).arg( QString::fromLatin1( hash.result().toHex() ) ) );
+
+      QgsSpatialIndex index( flags );
+      if ( QFile::exists( indexPath ) && index.readFromFile( indexPath, featureCount, lastModified ) )
+        return index;
+    }
+  }
+
+  QgsSpatialIndex index( source.getFeatures( request ), feedback, flags );
+  if ( !indexPath.isEmpty() && !( feedback && feedback->isCanceled() ) )
+  {
+    QString error;
+    if ( !index.writeToFile( indexPath, featureCount, lastModified, &error ) )
+      QgsDebugMsg( error );
+  }
+  return index;
+}
+
 QString QgsProcessingUtils::defaultVectorExtension()
 {
   QgsSettings settings;
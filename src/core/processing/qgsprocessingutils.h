@@ -388,6 +388,24 @@ class CORE_EXPORT QgsProcessingUtils
      */
     static QgsFields indicesToFields( const QList<int> &indices, const QgsFields &fields );
 
+    /**
+     * Creates a spatial index for the features from a \a source, fetched with the specified \a request.
+     *
+     * If the source comes from a \a layer stored in a local file, the index is also saved in the processing
+     * temporary folder, and later calls for the same layer, destination CRS and index \a flags load it
+     * back instead of rebuilding it, as long as the layer feature count and file modification time
+     * are unchanged. This avoids rebuilding the same index each time a model runs an algorithm against
+     * a static reference layer.
+     *
+     * The \a layer argument can be NULLPTR, in which case the index is always built from the \a source.
+     * Requests with a filter, layers in edit mode and sources which do not contain all the
+     * layer features (e.g. selected features only) are not cached either.
+     *
+     * \since QGIS 3.18
+     */
+    static QgsSpatialIndex createSpatialIndex( const QgsFeatureSource &source, const QgsVectorLayer *layer, const QgsFeatureRequest &request,
+        QgsFeedback *feedback = nullptr, QgsSpatialIndex::Flags flags = QgsSpatialIndex::Flags() );
+
     /**
      * Returns the default vector extension to use, in the absence of all other constraints (e.g.
      * provider based support for extensions).
@@ -31,6 +31,11 @@
 
 #include <QTextCodec>
 #include <QFile>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QAtomicInt>
 
 // using from provider:
 // - setRelevantFields(), mRelevantFieldsForNextFeature
@@ -41,6 +46,130 @@
 
 ///@cond PRIVATE
 
+/**
+ * Producer thread of the read ahead mode of QgsOgrFeatureIterator.
+ *
+ * Reads features from the layer of the iterator, decodes them and pushes them
+ * by batches into a bounded queue, from which the consumer pops them with nextFeature().
+ * While the thread runs, it is the only user of the OGR layer of the iterator.
+ */
+class QgsOgrFeatureReadAhead : public QThread
+{
+  public:
+
+    explicit QgsOgrFeatureReadAhead( QgsOgrFeatureIterator *iterator )
+      : mIterator( iterator )
+    {}
+
+    ~QgsOgrFeatureReadAhead() override
+    {
+      stop();
+    }
+
+    /**
+     * Returns the next decoded feature, waiting for the producer if no batch is queued yet.
+     * Returns FALSE once all features have been read.
+     */
+    bool nextFeature( QgsFeature &feature )
+    {
+      if ( mCurrentIndex >= mCurrentBatch.size() )
+      {
+        QMutexLocker locker( &mMutex );
+        while ( mQueue.isEmpty() && !mFinished )
+          mBatchQueued.wait( &mMutex );
+
+        if ( mQueue.isEmpty() )
+          return false;
+
+        mCurrentBatch = mQueue.dequeue();
+        mCurrentIndex = 0;
+        mBatchDequeued.wakeOne();
+      }
+
+      feature = mCurrentBatch.at( mCurrentIndex++ );
+      return true;
+    }
+
+    //! Asks the producer to stop, and waits until it does
+    void stop()
+    {
+      mStopRequested.storeRelease( 1 );
+      {
+        QMutexLocker locker( &mMutex );
+        mBatchDequeued.wakeOne();
+      }
+      wait();
+    }
+
+  protected:
+
+    void run() override
+    {
+      QgsCPLHTTPFetchOverrider oCPLHTTPFetcher( mIterator->mAuthCfg, mIterator->mInterruptionChecker );
+      QgsSetCPLHTTPFetchOverriderInitiatorClass( oCPLHTTPFetcher, QStringLiteral( "QgsOgrFeatureIterator" ) );
+
+      QgsFeatureList batch;
+      batch.reserve( BATCH_SIZE );
+      gdal::ogr_feature_unique_ptr fet;
+      while ( !mStopRequested.loadAcquire() && ( fet.reset( OGR_L_GetNextFeature( mIterator->mOgrLayer ) ), fet ) )
+      {
+        QgsFeature feature;
+        if ( !mIterator->checkFeature( fet, feature ) )
+          continue;
+
+        batch << feature;
+        if ( batch.size() >= BATCH_SIZE )
+        {
+          enqueue( batch );
+          batch.clear();
+          batch.reserve( BATCH_SIZE );
+        }
+      }
+
+      if ( !batch.isEmpty() )
+        enqueue( batch );
+
+      QMutexLocker locker( &mMutex );
+      mFinished = true;
+      mBatchQueued.wakeOne();
+    }
+
+  private:
+
+    //! Number of features decoded before handing them to the consumer
+    static const int BATCH_SIZE = 256;
+
+    //! Maximum number of batches waiting for the consumer
+    static const int MAX_QUEUED_BATCHES = 4;
+
+    //! Queues a batch, waiting for the consumer if the queue is full
+    void enqueue( const QgsFeatureList &batch )
+    {
+      QMutexLocker locker( &mMutex );
+      while ( mQueue.size() >= MAX_QUEUED_BATCHES && !mStopRequested.loadAcquire() )
+        mBatchDequeued.wait( &mMutex );
+
+      if ( mStopRequested.loadAcquire() )
+        return;
+
+      mQueue.enqueue( batch );
+      mBatchQueued.wakeOne();
+    }
+
+    QgsOgrFeatureIterator *mIterator = nullptr;
+
+    QMutex mMutex;
+    QWaitCondition mBatchQueued;
+    QWaitCondition mBatchDequeued;
+    QQueue< QgsFeatureList > mQueue;
+    bool mFinished = false;
+    QAtomicInt mStopRequested = 0;
+
+    // only accessed by the consumer
+    QgsFeatureList mCurrentBatch;
+    int mCurrentIndex = 0;
+};
+
 
 QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource *source, bool ownSource, const QgsFeatureRequest &request, QgsTransaction *transaction )
   : QgsAbstractFeatureIteratorFromSource<QgsOgrFeatureSource>( source, ownSource, request )
@@ -247,6 +376,13 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource *source, bool
     OGR_L_SetAttributeFilter( mOgrLayer, nullptr );
   }
 
+  // the producer thread only handles plain sequential reads on a connection owned by this iterator,
+  // and must not call back into the request
+  mUseReadAhead = mSource->mReadAhead && mConn && mAllowResetReading
+                  && ( mRequest.filterType() == QgsFeatureRequest::FilterNone || mRequest.filterType() == QgsFeatureRequest::FilterExpression )
+                  && !mRequest.transformErrorCallback()
+                  && QgsOgrProviderUtils::canDriverShareSameDatasetAmongLayers( mSource->mDriverName );
+
   //start with first feature
   rewind();
 
@@ -375,6 +511,18 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature &feature )
     return false;
   }
 
+  if ( mUseReadAhead && !mReadAhead )
+    startReadAhead();
+
+  if ( mReadAhead )
+  {
+    if ( mReadAhead->nextFeature( feature ) )
+      return true;
+
+    close();
+    return false;
+  }
+
   gdal::ogr_feature_unique_ptr fet;
 
   // OSM layers (especially large ones) need the GDALDataset::GetNextFeature() call rather than OGRLayer::GetNextFeature()
@@ -435,16 +583,34 @@ bool QgsOgrFeatureIterator::rewind()
   if ( mClosed || !mOgrLayer )
     return false;
 
+  stopReadAhead();
+
   resetReading();
 
   mFilterFidsIt = mFilterFids.begin();
 
+  // the read ahead thread is started by the next fetchFeature() call, once the interruption checker is set
   return true;
 }
 
+void QgsOgrFeatureIterator::startReadAhead()
+{
+  mReadAhead = qgis::make_unique< QgsOgrFeatureReadAhead >( this );
+  mReadAhead->start();
+}
+
+void QgsOgrFeatureIterator::stopReadAhead()
+{
+  // the destructor stops the thread
+  mReadAhead.reset();
+}
+
 
 bool QgsOgrFeatureIterator::close()
 {
+  // the producer thread must be done with the layer before it gets released
+  stopReadAhead();
+
   if ( mSharedDS )
   {
     iteratorClosed();
@@ -593,6 +759,7 @@ QgsOgrFeatureSource::QgsOgrFeatureSource( const QgsOgrProvider *p )
   , mCrs( p->crs() )
   , mWkbType( p->wkbType() )
   , mSharedDS( nullptr )
+  , mReadAhead( p->mReadAhead )
 {
   if ( p->mTransaction )
   {
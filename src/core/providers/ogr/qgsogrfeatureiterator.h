@@ -29,6 +29,7 @@
 #define SIP_NO_FILE
 
 class QgsOgrFeatureIterator;
+class QgsOgrFeatureReadAhead;
 class QgsOgrProvider;
 class QgsOgrDataset;
 using QgsOgrDatasetSharedPtr = std::shared_ptr< QgsOgrDataset>;
@@ -58,6 +59,7 @@ class QgsOgrFeatureSource final: public QgsAbstractFeatureSource
     QgsWkbTypes::Type mWkbType = QgsWkbTypes::Unknown;
     QgsOgrDatasetSharedPtr mSharedDS = nullptr;
     QgsTransaction *mTransaction = nullptr;
+    bool mReadAhead = false;
 
     friend class QgsOgrFeatureIterator;
     friend class QgsOgrExpressionCompiler;
@@ -117,6 +119,20 @@ class QgsOgrFeatureIterator final: public QgsAbstractFeatureIteratorFromSource<Q
     bool fetchFeatureWithId( QgsFeatureId id, QgsFeature &feature ) const;
 
     void resetReading();
+
+    /* Whether sequential reads are done by a producer thread, which reads and decodes
+     * batches of features ahead of the consumer. Only plain OGR_L_GetNextFeature() reads
+     * on a connection owned by the iterator are eligible */
+    bool mUseReadAhead = false;
+    std::unique_ptr< QgsOgrFeatureReadAhead > mReadAhead;
+
+    //! Starts reading ahead from the current reading position
+    void startReadAhead();
+
+    //! Stops the read ahead thread, waiting for it to release the layer
+    void stopReadAhead();
+
+    friend class QgsOgrFeatureReadAhead;
 };
 
 ///@endcond
@@ -480,6 +480,10 @@ QgsOgrProvider::QgsOgrProvider( QString const &uri, const ProviderOptions &optio
   //   a user does want/need to manually specify the encoding
   CPLSetConfigOption( "SHAPE_ENCODING", "" );
 
+  // decode features of sequential reads in a background thread, overlapping I/O and
+  // geometry decoding with the work done by the consumer of the features
+  mReadAhead = settings.value( QStringLiteral( "qgis/ogrReadAhead" ), false ).toBool();
+
 #ifndef QT_NO_NETWORKPROXY
   QgsGdalUtils::setupProxy();
 #endif
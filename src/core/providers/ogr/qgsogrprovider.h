@@ -291,6 +291,9 @@ class QgsOgrProvider final: public QgsVectorDataProvider
     //! Whether we can share the same dataset handle among different layers
     bool mShareSameDatasetAmongLayers = true;
 
+    //! Whether sequential feature reads are decoded ahead of time in a background thread
+    bool mReadAhead = false;
+
     bool mValid = false;
 
     OGRwkbGeometryType mOGRGeomType = wkbUnknown;
@@ -53,7 +53,11 @@ QgsCachedFeatureIterator::QgsCachedFeatureIterator( QgsVectorLayerCache *vlCache
       break;
 
     default:
-      mFeatureIds = qgis::listToSet( mVectorLayerCache->mCache.keys() );
+      // only visit the features around the rectangle when the cache has a spatial index
+      if ( !mFilterRect.isNull() && mVectorLayerCache->spatialIndexEnabled() )
+        mFeatureIds = mVectorLayerCache->cachedFeatureIdsInRectangle( mFilterRect );
+      else
+        mFeatureIds = qgis::listToSet( mVectorLayerCache->mCache.keys() );
       break;
   }
 
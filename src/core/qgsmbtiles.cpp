@@ -207,6 +207,40 @@ void QgsMbTiles::setTileData( int z, int x, int y, const QByteArray &data )
   }
 }
 
+bool QgsMbTiles::beginTransaction()
+{
+  if ( !mDatabase )
+  {
+    QgsDebugMsg( QStringLiteral( "MBTiles database not open: " ) + mFilename );
+    return false;
+  }
+
+  QString errorMessage;
+  if ( mDatabase.exec( QStringLiteral( "BEGIN TRANSACTION" ), errorMessage ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QStringLiteral( "MBTiles failed to begin transaction: " ) + errorMessage );
+    return false;
+  }
+  return true;
+}
+
+bool QgsMbTiles::commitTransaction()
+{
+  if ( !mDatabase )
+  {
+    QgsDebugMsg( QStringLiteral( "MBTiles database not open: " ) + mFilename );
+    return false;
+  }
+
+  QString errorMessage;
+  if ( mDatabase.exec( QStringLiteral( "COMMIT TRANSACTION" ), errorMessage ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QStringLiteral( "MBTiles failed to commit transaction: " ) + errorMessage );
+    return false;
+  }
+  return true;
+}
+
 bool QgsMbTiles::decodeGzip( const QByteArray &bytesIn, QByteArray &bytesOut )
 {
   unsigned char *bytesInPtr = reinterpret_cast<unsigned char *>( const_cast<char *>( bytesIn.constData() ) );
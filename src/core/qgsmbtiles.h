@@ -78,6 +78,23 @@ class CORE_EXPORT QgsMbTiles
      */
     void setTileData( int z, int x, int y, const QByteArray &data );
 
+    /**
+     * Starts a transaction, so that the following setTileData() calls are written together
+     * when commitTransaction() is called. Adding many tiles within a single transaction
+     * is much faster than committing each of them separately.
+     * Returns TRUE on success.
+     * \note the database has to be opened in read-write mode (currently only when opened with create()
+     * \since QGIS 3.18
+     */
+    bool beginTransaction();
+
+    /**
+     * Commits the transaction started with beginTransaction().
+     * Returns TRUE on success.
+     * \since QGIS 3.18
+     */
+    bool commitTransaction();
+
     //! Decodes gzip byte stream, returns true on success. Useful for reading vector tiles.
     static bool decodeGzip( const QByteArray &bytesIn, QByteArray &bytesOut );
     //! Encodes gzip byte stream, returns true on success. Useful for writing vector tiles.
@@ -0,0 +1,719 @@
+/***************************************************************************
+                             qgspackedspatialindex.cpp
+                             -------------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgspackedspatialindex.h"
+#include "qgspackedspatialindex_p.h"
+#include "qgsfeature.h"
+#include "qgsfeatureiterator.h"
+#include "qgsfeedback.h"
+#include "qgsfeaturesource.h"
+#include "qgsgeometry.h"
+#include "qgspointxy.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <QSysInfo>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <queue>
+
+///@cond PRIVATE
+
+// below this number of items, building and querying is not worth spreading over multiple threads
+static const qgssize PARALLEL_THRESHOLD = 65536;
+
+static const char PACKED_INDEX_MAGIC[] = "QGSPSIDX";
+static const quint32 PACKED_INDEX_VERSION = 1;
+
+// QDataStream raw reads and writes take an int size, so large arrays are transferred in chunks
+static const qgssize RAW_DATA_CHUNK_SIZE = 64 * 1024 * 1024;
+
+static bool writeRawArray( QDataStream &stream, const char *data, qgssize size )
+{
+  while ( size > 0 )
+  {
+    const int chunkSize = static_cast< int >( std::min( size, RAW_DATA_CHUNK_SIZE ) );
+    if ( stream.writeRawData( data, chunkSize ) != chunkSize )
+      return false;
+    data += chunkSize;
+    size -= chunkSize;
+  }
+  return true;
+}
+
+static bool readRawArray( QDataStream &stream, char *data, qgssize size )
+{
+  while ( size > 0 )
+  {
+    const int chunkSize = static_cast< int >( std::min( size, RAW_DATA_CHUNK_SIZE ) );
+    if ( stream.readRawData( data, chunkSize ) != chunkSize )
+      return false;
+    data += chunkSize;
+    size -= chunkSize;
+  }
+  return true;
+}
+
+// cumulative node counts at the end of each tree level, from the leaves up to the root
+static std::vector< qgssize > levelBoundsForItems( qgssize numItems, qgssize nodeSize )
+{
+  std::vector< qgssize > levelBounds;
+  if ( numItems == 0 )
+    return levelBounds;
+
+  qgssize n = numItems;
+  qgssize numNodes = n;
+  levelBounds.push_back( numNodes );
+  do
+  {
+    n = ( n + nodeSize - 1 ) / nodeSize;
+    numNodes += n;
+    levelBounds.push_back( numNodes );
+  }
+  while ( n != 1 );
+  return levelBounds;
+}
+
+namespace
+{
+  struct Range
+  {
+    qgssize begin;
+    qgssize end;
+  };
+
+  /**
+   * Splits [0, count) into ranges, one per available thread.
+   */
+  QVector< Range > splitRange( qgssize count )
+  {
+    const qgssize threads = static_cast< qgssize >( std::max( 1, QThread::idealThreadCount() ) );
+    const qgssize chunkSize = std::max< qgssize >( 1, ( count + threads - 1 ) / threads );
+    QVector< Range > ranges;
+    for ( qgssize begin = 0; begin < count; begin += chunkSize )
+      ranges << Range { begin, std::min( begin + chunkSize, count ) };
+    return ranges;
+  }
+
+  /**
+   * Runs \a function over [0, count), in parallel when \a count is large enough.
+   */
+  void parallelFor( qgssize count, const std::function< void( qgssize, qgssize ) > &function )
+  {
+    if ( count < PARALLEL_THRESHOLD )
+    {
+      function( 0, count );
+      return;
+    }
+
+    QVector< Range > ranges = splitRange( count );
+    QtConcurrent::blockingMap( ranges, [&function]( const Range & range ) { function( range.begin, range.end ); } );
+  }
+
+  /**
+   * Returns the position along a 2^16 x 2^16 Hilbert curve of the cell (\a x, \a y).
+   *
+   * From "Fast Hilbert curve generation, sorting, and range queries" by rawrunprotected.
+   */
+  quint32 hilbert( quint32 x, quint32 y )
+  {
+    quint32 a = x ^ y;
+    quint32 b = 0xFFFF ^ a;
+    quint32 c = 0xFFFF ^ ( x | y );
+    quint32 d = x & ( y ^ 0xFFFF );
+
+    quint32 A = a | ( b >> 1 );
+    quint32 B = ( a >> 1 ) ^ a;
+    quint32 C = ( ( c >> 1 ) ^ ( b & ( d >> 1 ) ) ) ^ c;
+    quint32 D = ( ( a & ( c >> 1 ) ) ^ ( d >> 1 ) ) ^ d;
+
+    a = A;
+    b = B;
+    c = C;
+    d = D;
+    A = ( ( a & ( a >> 2 ) ) ^ ( b & ( b >> 2 ) ) );
+    B = ( ( a & ( b >> 2 ) ) ^ ( b & ( ( a ^ b ) >> 2 ) ) );
+    C ^= ( ( a & ( c >> 2 ) ) ^ ( b & ( d >> 2 ) ) );
+    D ^= ( ( b & ( c >> 2 ) ) ^ ( ( a ^ b ) & ( d >> 2 ) ) );
+
+    a = A;
+    b = B;
+    c = C;
+    d = D;
+    A = ( ( a & ( a >> 4 ) ) ^ ( b & ( b >> 4 ) ) );
+    B = ( ( a & ( b >> 4 ) ) ^ ( b & ( ( a ^ b ) >> 4 ) ) );
+    C ^= ( ( a & ( c >> 4 ) ) ^ ( b & ( d >> 4 ) ) );
+    D ^= ( ( b & ( c >> 4 ) ) ^ ( ( a ^ b ) & ( d >> 4 ) ) );
+
+    a = A;
+    b = B;
+    c = C;
+    d = D;
+    C ^= ( ( a & ( c >> 8 ) ) ^ ( b & ( d >> 8 ) ) );
+    D ^= ( ( b & ( c >> 8 ) ) ^ ( ( a ^ b ) & ( d >> 8 ) ) );
+
+    a = C ^ ( C >> 1 );
+    b = D ^ ( D >> 1 );
+
+    quint32 i0 = x ^ y;
+    quint32 i1 = b | ( 0xFFFF ^ ( i0 | a ) );
+
+    i0 = ( i0 | ( i0 << 8 ) ) & 0x00FF00FF;
+    i0 = ( i0 | ( i0 << 4 ) ) & 0x0F0F0F0F;
+    i0 = ( i0 | ( i0 << 2 ) ) & 0x33333333;
+    i0 = ( i0 | ( i0 << 1 ) ) & 0x55555555;
+
+    i1 = ( i1 | ( i1 << 8 ) ) & 0x00FF00FF;
+    i1 = ( i1 | ( i1 << 4 ) ) & 0x0F0F0F0F;
+    i1 = ( i1 | ( i1 << 2 ) ) & 0x33333333;
+    i1 = ( i1 | ( i1 << 1 ) ) & 0x55555555;
+
+    return ( i1 << 1 ) | i0;
+  }
+
+  double axisDistance( double k, double min, double max )
+  {
+    return k < min ? min - k : ( k <= max ? 0 : k - max );
+  }
+}
+
+QgsPackedSpatialIndexPrivate::QgsPackedSpatialIndexPrivate( int nodeSize )
+  : mNodeSize( std::max( 2, nodeSize ) )
+{
+}
+
+void QgsPackedSpatialIndexPrivate::load( QgsFeatureIterator &fi, QgsFeedback *feedback, qgssize expectedCount )
+{
+  std::vector< double > itemBoxes;
+  std::vector< QgsFeatureId > itemIds;
+  itemBoxes.reserve( expectedCount * 4 );
+  itemIds.reserve( expectedCount );
+
+  QgsFeature f;
+  while ( fi.nextFeature( f ) )
+  {
+    if ( feedback && feedback->isCanceled() )
+      return;
+
+    if ( !f.hasGeometry() )
+      continue;
+
+    const QgsRectangle bbox = f.geometry().boundingBox();
+    if ( bbox.isNull() )
+      continue;
+
+    itemBoxes.push_back( bbox.xMinimum() );
+    itemBoxes.push_back( bbox.yMinimum() );
+    itemBoxes.push_back( bbox.xMaximum() );
+    itemBoxes.push_back( bbox.yMaximum() );
+    itemIds.push_back( f.id() );
+  }
+
+  build( std::move( itemBoxes ), std::move( itemIds ) );
+}
+
+void QgsPackedSpatialIndexPrivate::build( std::vector< double > &&itemBoxes, std::vector< QgsFeatureId > &&itemIds )
+{
+  mNumItems = itemIds.size();
+  mBoxes.clear();
+  mIndices.clear();
+  mExtent = QgsRectangle();
+  // compute the number of nodes of each level
+  mLevelBounds = levelBoundsForItems( mNumItems, static_cast< qgssize >( mNodeSize ) );
+  if ( mNumItems == 0 )
+    return;
+
+  double minX = std::numeric_limits< double >::max();
+  double minY = std::numeric_limits< double >::max();
+  double maxX = -std::numeric_limits< double >::max();
+  double maxY = -std::numeric_limits< double >::max();
+  for ( qgssize i = 0; i < mNumItems; ++i )
+  {
+    minX = std::min( minX, itemBoxes[4 * i] );
+    minY = std::min( minY, itemBoxes[4 * i + 1] );
+    maxX = std::max( maxX, itemBoxes[4 * i + 2] );
+    maxY = std::max( maxY, itemBoxes[4 * i + 3] );
+  }
+  mExtent = QgsRectangle( minX, minY, maxX, maxY, false );
+
+  // sort the items along the Hilbert curve, so that neighbouring items end up in the same nodes
+  std::vector< qgssize > order( mNumItems );
+  std::iota( order.begin(), order.end(), 0 );
+  if ( mNumItems > static_cast< qgssize >( mNodeSize ) )
+  {
+    std::vector< quint32 > hilbertValues( mNumItems );
+    const double width = maxX - minX;
+    const double height = maxY - minY;
+    const double hilbertMax = ( 1 << 16 ) - 1;
+    parallelFor( mNumItems, [&]( qgssize begin, qgssize end )
+    {
+      for ( qgssize i = begin; i < end; ++i )
+      {
+        const double x = hilbertMax * ( ( itemBoxes[4 * i] + itemBoxes[4 * i + 2] ) / 2 - minX ) / ( width > 0 ? width : 1 );
+        const double y = hilbertMax * ( ( itemBoxes[4 * i + 1] + itemBoxes[4 * i + 3] ) / 2 - minY ) / ( height > 0 ? height : 1 );
+        hilbertValues[i] = hilbert( static_cast< quint32 >( x ), static_cast< quint32 >( y ) );
+      }
+    } );
+
+    auto compare = [&hilbertValues]( qgssize a, qgssize b ) { return hilbertValues[a] < hilbertValues[b]; };
+    if ( mNumItems < PARALLEL_THRESHOLD )
+    {
+      std::sort( order.begin(), order.end(), compare );
+    }
+    else
+    {
+      // sort chunks in parallel, then merge them pairwise
+      QVector< Range > ranges = splitRange( mNumItems );
+      QtConcurrent::blockingMap( ranges, [&order, &compare]( const Range & range )
+      {
+        std::sort( order.begin() + range.begin, order.begin() + range.end, compare );
+      } );
+      while ( ranges.size() > 1 )
+      {
+        QVector< Range > merged;
+        QVector< QPair< Range, Range > > pairs;
+        for ( int i = 0; i + 1 < ranges.size(); i += 2 )
+        {
+          pairs << qMakePair( ranges.at( i ), ranges.at( i + 1 ) );
+          merged << Range { ranges.at( i ).begin, ranges.at( i + 1 ).end };
+        }
+        if ( ranges.size() % 2 )
+          merged << ranges.last();
+
+        QtConcurrent::blockingMap( pairs, [&order, &compare]( const QPair< Range, Range > &pair )
+        {
+          std::inplace_merge( order.begin() + pair.first.begin, order.begin() + pair.second.begin, order.begin() + pair.second.end, compare );
+        } );
+        ranges = merged;
+      }
+    }
+  }
+
+  mBoxes.resize( 4 * numNodes );
+  mIndices.resize( numNodes );
+
+  // leaves
+  parallelFor( mNumItems, [&]( qgssize begin, qgssize end )
+  {
+    for ( qgssize i = begin; i < end; ++i )
+    {
+      const qgssize item = order[i];
+      std::copy( itemBoxes.begin() + 4 * item, itemBoxes.begin() + 4 * item + 4, mBoxes.begin() + 4 * i );
+      mIndices[i] = itemIds[item];
+    }
+  } );
+  itemBoxes.clear();
+  itemIds.clear();
+
+  // upper levels, each node covering up to mNodeSize nodes of the level below
+  qgssize levelStart = 0;
+  for ( std::size_t level = 0; level + 1 < mLevelBounds.size(); ++level )
+  {
+    const qgssize levelEnd = mLevelBounds[level];
+    const qgssize parentStart = levelEnd;
+    const qgssize parentCount = mLevelBounds[level + 1] - parentStart;
+    const qgssize nodeSize = static_cast< qgssize >( mNodeSize );
+    parallelFor( parentCount, [&]( qgssize begin, qgssize end )
+    {
+      for ( qgssize p = begin; p < end; ++p )
+      {
+        const qgssize firstChild = levelStart + p * nodeSize;
+        const qgssize lastChild = std::min( firstChild + nodeSize, levelEnd );
+        double nodeMinX = std::numeric_limits< double >::max();
+        double nodeMinY = std::numeric_limits< double >::max();
+        double nodeMaxX = -std::numeric_limits< double >::max();
+        double nodeMaxY = -std::numeric_limits< double >::max();
+        for ( qgssize child = firstChild; child < lastChild; ++child )
+        {
+          nodeMinX = std::min( nodeMinX, mBoxes[4 * child] );
+          nodeMinY = std::min( nodeMinY, mBoxes[4 * child + 1] );
+          nodeMaxX = std::max( nodeMaxX, mBoxes[4 * child + 2] );
+          nodeMaxY = std::max( nodeMaxY, mBoxes[4 * child + 3] );
+        }
+        const qgssize node = parentStart + p;
+        mBoxes[4 * node] = nodeMinX;
+        mBoxes[4 * node + 1] = nodeMinY;
+        mBoxes[4 * node + 2] = nodeMaxX;
+        mBoxes[4 * node + 3] = nodeMaxY;
+        mIndices[node] = static_cast< qint64 >( firstChild );
+      }
+    } );
+    levelStart = levelEnd;
+  }
+}
+
+qgssize QgsPackedSpatialIndexPrivate::upperBound( qgssize position ) const
+{
+  return *std::upper_bound( mLevelBounds.begin(), mLevelBounds.end(), position );
+}
+
+void QgsPackedSpatialIndexPrivate::search( double minX, double minY, double maxX, double maxY, const std::function< bool( QgsFeatureId ) > &visitor ) const
+{
+  if ( mNumItems == 0 )
+    return;
+
+  std::vector< qgssize > stack;
+  stack.reserve( 16 );
+  qgssize nodeIndex = mIndices.size() - 1;
+  while ( true )
+  {
+    const qgssize end = std::min( nodeIndex + mNodeSize, upperBound( nodeIndex ) );
+    for ( qgssize pos = nodeIndex; pos < end; ++pos )
+    {
+      if ( maxX < mBoxes[4 * pos] || maxY < mBoxes[4 * pos + 1] || minX > mBoxes[4 * pos + 2] || minY > mBoxes[4 * pos + 3] )
+        continue;
+
+      if ( nodeIndex < mNumItems )
+      {
+        if ( !visitor( mIndices[pos] ) )
+          return;
+      }
+      else
+      {
+        stack.push_back( static_cast< qgssize >( mIndices[pos] ) );
+      }
+    }
+
+    if ( stack.empty() )
+      break;
+    nodeIndex = stack.back();
+    stack.pop_back();
+  }
+}
+
+QList< QgsFeatureId > QgsPackedSpatialIndexPrivate::neighbors( double x, double y, int maxResults, double maxDistance ) const
+{
+  QList< QgsFeatureId > results;
+  if ( mNumItems == 0 || maxResults <= 0 )
+    return results;
+
+  struct Candidate
+  {
+    double distance;
+    qint64 index;
+    bool isLeaf;
+    bool operator<( const Candidate &other ) const { return distance > other.distance; }
+  };
+
+  const double maxDistanceSquared = maxDistance > 0 ? maxDistance * maxDistance : std::numeric_limits< double >::max();
+  std::priority_queue< Candidate > queue;
+  double lastDistance = 0;
+  qgssize nodeIndex = mIndices.size() - 1;
+  while ( true )
+  {
+    const qgssize end = std::min( nodeIndex + mNodeSize, upperBound( nodeIndex ) );
+    for ( qgssize pos = nodeIndex; pos < end; ++pos )
+    {
+      const double dx = axisDistance( x, mBoxes[4 * pos], mBoxes[4 * pos + 2] );
+      const double dy = axisDistance( y, mBoxes[4 * pos + 1], mBoxes[4 * pos + 3] );
+      const double distance = dx * dx + dy * dy;
+      if ( distance > maxDistanceSquared )
+        continue;
+
+      queue.push( Candidate { distance, mIndices[pos], nodeIndex < mNumItems } );
+    }
+
+    // pop the leaves which are closer than any remaining node
+    while ( !queue.empty() && queue.top().isLeaf )
+    {
+      const Candidate candidate = queue.top();
+      if ( results.size() >= maxResults && candidate.distance > lastDistance )
+        return results;
+
+      queue.pop();
+      results << candidate.index;
+      lastDistance = candidate.distance;
+    }
+
+    if ( queue.empty() )
+      break;
+    nodeIndex = static_cast< qgssize >( queue.top().index );
+    queue.pop();
+  }
+  return results;
+}
+
+bool QgsPackedSpatialIndexPrivate::write( const QString &path, QString &error ) const
+{
+  QFile file( path );
+  if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+  {
+    error = QObject::tr( "Could not open %1 for writing: %2" ).arg( path, file.errorString() );
+    return false;
+  }
+
+  QDataStream stream( &file );
+  stream.setByteOrder( QDataStream::LittleEndian );
+  stream.writeRawData( PACKED_INDEX_MAGIC, 8 );
+  stream << PACKED_INDEX_VERSION;
+  // arrays are written as is, so remember the byte order they were written with
+  stream << static_cast< quint8 >( QSysInfo::ByteOrder == QSysInfo::LittleEndian ? 1 : 0 );
+  stream << static_cast< qint32 >( mNodeSize );
+  stream << static_cast< quint64 >( mNumItems );
+  stream << mExtent.xMinimum() << mExtent.yMinimum() << mExtent.xMaximum() << mExtent.yMaximum();
+  stream << static_cast< quint32 >( mLevelBounds.size() );
+  for ( qgssize bound : mLevelBounds )
+    stream << static_cast< quint64 >( bound );
+  const bool arraysWritten = writeRawArray( stream, reinterpret_cast< const char * >( mBoxes.data() ), mBoxes.size() * sizeof( double ) )
+                             && writeRawArray( stream, reinterpret_cast< const char * >( mIndices.data() ), mIndices.size() * sizeof( qint64 ) );
+
+  if ( !arraysWritten || stream.status() != QDataStream::Ok || !file.flush() )
+  {
+    error = QObject::tr( "Could not write spatial index to %1: %2" ).arg( path, file.errorString() );
+    return false;
+  }
+  return true;
+}
+
+bool QgsPackedSpatialIndexPrivate::read( const QString &path, QString &error )
+{
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+  {
+    error = QObject::tr( "Could not open %1 for reading: %2" ).arg( path, file.errorString() );
+    return false;
+  }
+
+  QDataStream stream( &file );
+  stream.setByteOrder( QDataStream::LittleEndian );
+
+  char magic[8];
+  quint32 version = 0;
+  if ( stream.readRawData( magic, 8 ) != 8 || memcmp( magic, PACKED_INDEX_MAGIC, 8 ) != 0 )
+  {
+    error = QObject::tr( "%1 is not a spatial index file" ).arg( path );
+    return false;
+  }
+  stream >> version;
+  if ( version != PACKED_INDEX_VERSION )
+  {
+    error = QObject::tr( "Unsupported spatial index file version %1" ).arg( version );
+    return false;
+  }
+
+  quint8 littleEndian = 0;
+  qint32 nodeSize = 0;
+  quint64 numItems = 0;
+  double xMin = 0, yMin = 0, xMax = 0, yMax = 0;
+  quint32 levelCount = 0;
+  stream >> littleEndian >> nodeSize >> numItems >> xMin >> yMin >> xMax >> yMax >> levelCount;
+  if ( ( littleEndian != 0 ) != ( QSysInfo::ByteOrder == QSysInfo::LittleEndian ) )
+  {
+    error = QObject::tr( "Spatial index file %1 was written on a platform with a different byte order" ).arg( path );
+    return false;
+  }
+
+  // validate the header against the file size before allocating anything, the tree shape
+  // only depends on the item count and node size so the level bounds must match exactly
+  const qint64 nodeRecordSize = 4 * sizeof( double ) + sizeof( qint64 );
+  if ( stream.status() != QDataStream::Ok || nodeSize < 2
+       || numItems > static_cast< quint64 >( std::max( file.size() - file.pos(), qint64( 0 ) ) / nodeRecordSize ) )
+  {
+    error = QObject::tr( "Spatial index file %1 is corrupted" ).arg( path );
+    return false;
+  }
+  std::vector< qgssize > levelBounds = levelBoundsForItems( numItems, static_cast< qgssize >( nodeSize ) );
+  if ( levelCount != levelBounds.size() )
+  {
+    error = QObject::tr( "Spatial index file %1 is corrupted" ).arg( path );
+    return false;
+  }
+  for ( quint32 i = 0; i < levelCount; ++i )
+  {
+    quint64 bound = 0;
+    stream >> bound;
+    if ( bound != levelBounds[i] )
+    {
+      error = QObject::tr( "Spatial index file %1 is corrupted" ).arg( path );
+      return false;
+    }
+  }
+
+  const qgssize numNodes = levelBounds.empty() ? 0 : levelBounds.back();
+  const qint64 expectedSize = file.pos() + static_cast< qint64 >( numNodes ) * nodeRecordSize;
+  if ( stream.status() != QDataStream::Ok || file.size() != expectedSize )
+  {
+    error = QObject::tr( "Spatial index file %1 is corrupted" ).arg( path );
+    return false;
+  }
+
+  std::vector< double > boxes( 4 * numNodes );
+  std::vector< qint64 > indices( numNodes );
+  const bool arraysRead = readRawArray( stream, reinterpret_cast< char * >( boxes.data() ), boxes.size() * sizeof( double ) )
+                          && readRawArray( stream, reinterpret_cast< char * >( indices.data() ), indices.size() * sizeof( qint64 ) );
+  if ( !arraysRead || stream.status() != QDataStream::Ok )
+  {
+    error = QObject::tr( "Spatial index file %1 is corrupted" ).arg( path );
+    return false;
+  }
+
+  mNodeSize = nodeSize;
+  mNumItems = numItems;
+  mExtent = numItems > 0 ? QgsRectangle( xMin, yMin, xMax, yMax, false ) : QgsRectangle();
+  mLevelBounds = std::move( levelBounds );
+  mBoxes = std::move( boxes );
+  mIndices = std::move( indices );
+  return true;
+}
+
+///@endcond
+
+//
+// QgsPackedSpatialIndex
+//
+
+QgsPackedSpatialIndex::QgsPackedSpatialIndex()
+  : d( new QgsPackedSpatialIndexPrivate() )
+{
+}
+
+QgsPackedSpatialIndex::QgsPackedSpatialIndex( QgsFeatureIterator &fi, QgsFeedback *feedback, int nodeSize )
+  : d( new QgsPackedSpatialIndexPrivate( nodeSize ) )
+{
+  d->load( fi, feedback );
+}
+
+QgsPackedSpatialIndex::QgsPackedSpatialIndex( const QgsFeatureSource &source, QgsFeedback *feedback, int nodeSize )
+  : d( new QgsPackedSpatialIndexPrivate( nodeSize ) )
+{
+  QgsFeatureIterator it = source.getFeatures( QgsFeatureRequest().setNoAttributes() );
+  const long count = source.featureCount();
+  d->load( it, feedback, count > 0 ? static_cast< qgssize >( count ) : 0 );
+}
+
+QgsPackedSpatialIndex::QgsPackedSpatialIndex( const QgsPackedSpatialIndex &other )
+  : d( other.d )
+{
+  d->ref.ref();
+}
+
+QgsPackedSpatialIndex &QgsPackedSpatialIndex::operator=( const QgsPackedSpatialIndex &other )
+{
+  if ( this != &other )
+  {
+    if ( !d->ref.deref() )
+    {
+      delete d;
+    }
+
+    d = other.d;
+    d->ref.ref();
+  }
+  return *this;
+}
+
+QgsPackedSpatialIndex::~QgsPackedSpatialIndex()
+{
+  if ( !d->ref.deref() )
+    delete d;
+}
+
+QList<QgsFeatureId> QgsPackedSpatialIndex::intersects( const QgsRectangle &rectangle ) const
+{
+  QList<QgsFeatureId> result;
+  d->search( rectangle.xMinimum(), rectangle.yMinimum(), rectangle.xMaximum(), rectangle.yMaximum(), [&result]( QgsFeatureId id ) -> bool
+  {
+    result << id;
+    return true;
+  } );
+  return result;
+}
+
+void QgsPackedSpatialIndex::intersects( const QgsRectangle &rectangle, const std::function<bool ( QgsFeatureId )> &visitor ) const
+{
+  d->search( rectangle.xMinimum(), rectangle.yMinimum(), rectangle.xMaximum(), rectangle.yMaximum(), visitor );
+}
+
+QVector<QList<QgsFeatureId> > QgsPackedSpatialIndex::intersects( const QVector<QgsRectangle> &rectangles ) const
+{
+  QVector< QList<QgsFeatureId> > results( rectangles.size() );
+  const QgsPackedSpatialIndexPrivate *index = d;
+  auto searchRange = [index, &rectangles, &results]( qgssize begin, qgssize end )
+  {
+    for ( qgssize i = begin; i < end; ++i )
+    {
+      const QgsRectangle &rectangle = rectangles.at( static_cast< int >( i ) );
+      QList<QgsFeatureId> &result = results[ static_cast< int >( i ) ];
+      index->search( rectangle.xMinimum(), rectangle.yMinimum(), rectangle.xMaximum(), rectangle.yMaximum(), [&result]( QgsFeatureId id ) -> bool
+      {
+        result << id;
+        return true;
+      } );
+    }
+  };
+
+  // rectangle queries are far more expensive than a plain loop iteration, so a few hundred are enough to spread them
+  if ( rectangles.size() < 256 )
+  {
+    searchRange( 0, rectangles.size() );
+  }
+  else
+  {
+    QVector< Range > ranges = splitRange( rectangles.size() );
+    QtConcurrent::blockingMap( ranges, [&searchRange]( const Range & range ) { searchRange( range.begin, range.end ); } );
+  }
+  return results;
+}
+
+QList<QgsFeatureId> QgsPackedSpatialIndex::nearestNeighbor( const QgsPointXY &point, int neighbors, double maxDistance ) const
+{
+  return d->neighbors( point.x(), point.y(), neighbors, maxDistance );
+}
+
+qgssize QgsPackedSpatialIndex::size() const
+{
+  return d->mNumItems;
+}
+
+int QgsPackedSpatialIndex::nodeSize() const
+{
+  return d->mNodeSize;
+}
+
+QgsRectangle QgsPackedSpatialIndex::extent() const
+{
+  return d->mExtent;
+}
+
+bool QgsPackedSpatialIndex::writeToFile( const QString &path, QString *errorMessage ) const
+{
+  QString error;
+  const bool res = d->write( path, error );
+  if ( errorMessage )
+    *errorMessage = error;
+  return res;
+}
+
+QgsPackedSpatialIndex QgsPackedSpatialIndex::fromFile( const QString &path, QString *errorMessage )
+{
+  QgsPackedSpatialIndex index;
+  QString error;
+  if ( !index.d->read( path, error ) )
+  {
+    if ( errorMessage )
+      *errorMessage = error;
+    return QgsPackedSpatialIndex();
+  }
+  if ( errorMessage )
+    errorMessage->clear();
+  return index;
+}
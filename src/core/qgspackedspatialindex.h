@@ -0,0 +1,186 @@
+/***************************************************************************
+                             qgspackedspatialindex.h
+                             -----------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPACKEDSPATIALINDEX_H
+#define QGSPACKEDSPATIALINDEX_H
+
+class QgsFeatureIterator;
+class QgsFeedback;
+class QgsFeatureSource;
+class QgsPackedSpatialIndexPrivate;
+class QgsPointXY;
+
+#include "qgis_core.h"
+#include "qgis_sip.h"
+#include "qgsfeatureid.h"
+#include "qgsrectangle.h"
+#include <QList>
+#include <QVector>
+#include <functional>
+
+/**
+ * \class QgsPackedSpatialIndex
+ * \ingroup core
+ *
+ * A static spatial index for feature bounding boxes, stored as a packed Hilbert R-tree.
+ *
+ * The whole tree is kept in a few flat arrays, built in a single bulk load where the
+ * features are sorted along a Hilbert curve. Compared to QgsSpatialIndex, this index:
+ *
+ * - is static (features cannot be added or removed from the index after construction)
+ * - is much faster to build and uses far less memory, as there is no per-node allocation
+ * - sorts and packs the tree across multiple threads for large feature sources
+ * - can answer many rectangle queries at once, spread over multiple threads
+ * - can be saved to a file and loaded back without being rebuilt
+ *
+ * Queries are read only, so a single QgsPackedSpatialIndex object can safely be used across multiple threads.
+ *
+ * QgsPackedSpatialIndex objects are implicitly shared and can be inexpensively copied.
+ *
+ * \see QgsSpatialIndex, which is a general, mutable index for geometry bounding boxes.
+ * \see QgsSpatialIndexKDBush, which is an optimised non-mutable index for point geometries only.
+ * \since QGIS 3.18
+*/
+class CORE_EXPORT QgsPackedSpatialIndex
+{
+  public:
+
+    //! Default number of entries per tree node
+    static const int DEFAULT_NODE_SIZE = 16;
+
+    /**
+     * Constructor for an empty QgsPackedSpatialIndex.
+     */
+    QgsPackedSpatialIndex();
+
+    /**
+     * Constructor - creates the index and bulk loads it with features from the iterator.
+     *
+     * The optional \a feedback object can be used to allow cancellation of bulk feature loading. Ownership
+     * of \a feedback is not transferred, and callers must take care that the lifetime of feedback exceeds
+     * that of the spatial index construction.
+     *
+     * The \a nodeSize argument sets the maximum number of entries per tree node.
+     *
+     * Features without geometry are ignored and not included in the index.
+     */
+    explicit QgsPackedSpatialIndex( QgsFeatureIterator &fi, QgsFeedback *feedback = nullptr, int nodeSize = DEFAULT_NODE_SIZE );
+
+    /**
+     * Constructor - creates the index and bulk loads it with features from the source.
+     *
+     * The optional \a feedback object can be used to allow cancellation of bulk feature loading. Ownership
+     * of \a feedback is not transferred, and callers must take care that the lifetime of feedback exceeds
+     * that of the spatial index construction.
+     *
+     * The \a nodeSize argument sets the maximum number of entries per tree node.
+     *
+     * Features without geometry are ignored and not included in the index.
+     */
+    explicit QgsPackedSpatialIndex( const QgsFeatureSource &source, QgsFeedback *feedback = nullptr, int nodeSize = DEFAULT_NODE_SIZE );
+
+    //! Copy constructor
+    QgsPackedSpatialIndex( const QgsPackedSpatialIndex &other );
+
+    //! Assignment operator
+    QgsPackedSpatialIndex &operator=( const QgsPackedSpatialIndex &other );
+
+    ~QgsPackedSpatialIndex();
+
+    /**
+     * Returns a list of features with a bounding box which intersects the specified \a rectangle.
+     *
+     * \note The intersection test is performed based on the feature bounding boxes only, so for non-point
+     * geometry features it is necessary to manually test the returned features for exact geometry intersection
+     * when required.
+     */
+    QList<QgsFeatureId> intersects( const QgsRectangle &rectangle ) const;
+
+    /**
+     * Calls a \a visitor function for all features with a bounding box which intersects the specified \a rectangle.
+     *
+     * The search is stopped as soon as the \a visitor returns FALSE.
+     *
+     * \note Not available in Python bindings
+     */
+    void intersects( const QgsRectangle &rectangle, const std::function< bool( QgsFeatureId ) > &visitor ) const SIP_SKIP;
+
+    /**
+     * Returns, for each of the specified \a rectangles, the list of features with a bounding box
+     * which intersects it. The rectangles are processed in parallel.
+     *
+     * \note Not available in Python bindings
+     */
+    QVector< QList<QgsFeatureId> > intersects( const QVector< QgsRectangle > &rectangles ) const SIP_SKIP;
+
+    /**
+     * Returns nearest neighbors to a \a point. The number of neighbors returned is specified
+     * by the \a neighbors argument.
+     *
+     * If the \a maxDistance argument is greater than 0, then only features within the specified
+     * distance of \a point will be considered.
+     *
+     * If multiple features are equidistant from the search \a point then the number of returned
+     * feature IDs may exceed \a neighbors.
+     *
+     * \warning The nearest neighbor test is performed based on the feature bounding boxes ONLY, so for non-point
+     * geometry features this method is not guaranteed to return the actual closest neighbors.
+     */
+    QList<QgsFeatureId> nearestNeighbor( const QgsPointXY &point, int neighbors = 1, double maxDistance = 0 ) const;
+
+    /**
+     * Returns the number of features contained within the index.
+     */
+    qgssize size() const;
+
+    /**
+     * Returns the maximum number of entries per tree node.
+     */
+    int nodeSize() const;
+
+    /**
+     * Returns the extent of all features contained within the index.
+     */
+    QgsRectangle extent() const;
+
+    /**
+     * Writes the index to the file at \a path.
+     *
+     * Returns FALSE if the file could not be written, in which case \a errorMessage will be set.
+     *
+     * \see fromFile()
+     */
+    bool writeToFile( const QString &path, QString *errorMessage SIP_OUT = nullptr ) const;
+
+    /**
+     * Reads an index previously written with writeToFile() from the file at \a path.
+     *
+     * If the file cannot be read, an empty index is returned and \a errorMessage is set.
+     *
+     * \see writeToFile()
+     */
+    static QgsPackedSpatialIndex fromFile( const QString &path, QString *errorMessage SIP_OUT = nullptr );
+
+  private:
+
+    //! Implicitly shared data pointer
+    QgsPackedSpatialIndexPrivate *d = nullptr;
+
+    friend class TestQgsPackedSpatialIndex;
+};
+
+#endif // QGSPACKEDSPATIALINDEX_H
@@ -0,0 +1,92 @@
+/***************************************************************************
+                             qgspackedspatialindex_p.h
+                             -------------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPACKEDSPATIALINDEX_PRIVATE_H
+#define QGSPACKEDSPATIALINDEX_PRIVATE_H
+
+#define SIP_NO_FILE
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include "qgsfeatureid.h"
+#include "qgsrectangle.h"
+#include <QAtomicInt>
+#include <functional>
+#include <vector>
+
+class QgsFeatureIterator;
+class QgsFeedback;
+
+/**
+ * Packed Hilbert R-tree, stored in flat arrays.
+ *
+ * Nodes are stored level by level, starting with the leaves. Each node has a bounding box
+ * (4 consecutive values in mBoxes) and an index: for leaves it is the feature id, for
+ * upper levels the position of the node's first child.
+ */
+class QgsPackedSpatialIndexPrivate
+{
+  public:
+
+    explicit QgsPackedSpatialIndexPrivate( int nodeSize = 16 );
+
+    /**
+     * Bulk loads the index from an iterator.
+     */
+    void load( QgsFeatureIterator &fi, QgsFeedback *feedback = nullptr, qgssize expectedCount = 0 );
+
+    /**
+     * Builds the tree from the item bounding boxes (4 values per item) and their ids.
+     */
+    void build( std::vector< double > &&itemBoxes, std::vector< QgsFeatureId > &&itemIds );
+
+    void search( double minX, double minY, double maxX, double maxY, const std::function< bool( QgsFeatureId ) > &visitor ) const;
+
+    QList< QgsFeatureId > neighbors( double x, double y, int maxResults, double maxDistance ) const;
+
+    bool write( const QString &path, QString &error ) const;
+    bool read( const QString &path, QString &error );
+
+    QAtomicInt ref = 1;
+
+    int mNodeSize = 16;
+    qgssize mNumItems = 0;
+    QgsRectangle mExtent;
+
+    //! End position of each level, leaves first
+    std::vector< qgssize > mLevelBounds;
+    std::vector< double > mBoxes;
+    std::vector< qint64 > mIndices;
+
+  private:
+
+    //! Returns the end position of the level containing the node at \a position
+    qgssize upperBound( qgssize position ) const;
+};
+
+/// @endcond
+
+#endif // QGSPACKEDSPATIALINDEX_PRIVATE_H
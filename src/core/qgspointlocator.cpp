@@ -29,8 +29,8 @@
 #include "qgspointlocatorinittask.h"
 #include <spatialindex/SpatialIndex.h>
 
-#include <QLinkedListIterator>
 #include <QtConcurrent>
+#include <algorithm>
 
 using namespace SpatialIndex;
 
@@ -63,27 +63,99 @@ static const double POINT_LOC_EPSILON = 1e-12;
 /**
  * \ingroup core
  * Helper class for bulk loading of R-trees.
+ *
+ * Streams the bounding boxes of the indexed features, creating the R-tree entries on demand
+ * instead of allocating them all upfront.
  * \note not available in Python bindings
 */
 class QgsPointLocator_Stream : public IDataStream
 {
   public:
-    explicit QgsPointLocator_Stream( const QLinkedList<RTree::Data *> &dataList )
-      : mDataList( dataList )
-      , mIt( mDataList )
+    explicit QgsPointLocator_Stream( const QVector< QPair< QgsFeatureId, QgsRectangle > > &entries )
+      : mEntries( entries )
     { }
 
-    IData *getNext() override { return mIt.next(); }
-    bool hasNext() override { return mIt.hasNext(); }
+    IData *getNext() override
+    {
+      const QPair< QgsFeatureId, QgsRectangle > &entry = mEntries.at( mIndex++ );
+      SpatialIndex::Region r( rect2region( entry.second ) );
+      return new RTree::Data( 0, nullptr, r, entry.first );
+    }
+
+    bool hasNext() override { return mIndex < mEntries.size(); }
 
-    uint32_t size() override { Q_ASSERT( false && "not available" ); return 0; }
-    void rewind() override { Q_ASSERT( false && "not available" ); }
+    uint32_t size() override { return static_cast< uint32_t >( mEntries.size() ); }
+    void rewind() override { mIndex = 0; }
 
   private:
-    QLinkedList<RTree::Data *> mDataList;
-    QLinkedListIterator<RTree::Data *> mIt;
+    const QVector< QPair< QgsFeatureId, QgsRectangle > > &mEntries;
+    int mIndex = 0;
+};
+
+
+////////////////////////////////////////////////////////////////////////////
+
+// number of features read before their geometries are prepared for indexing
+static const int INDEX_BATCH_SIZE = 8192;
+
+// below this number of geometries, preparing them is not worth spreading over multiple threads
+static const int PARALLEL_PREPARE_THRESHOLD = 256;
+
+/**
+ * \ingroup core
+ * A feature geometry, prepared to be added to the index.
+ * \note not available in Python bindings
+*/
+struct QgsPointLocator_IndexedGeometry
+{
+  QgsPointLocator_IndexedGeometry() = default;
+
+  QgsPointLocator_IndexedGeometry( QgsFeatureId fid, const QgsGeometry &geometry )
+    : fid( fid )
+    , geometry( geometry )
+  {}
+
+  QgsFeatureId fid = FID_NULL;
+  QgsGeometry geometry;
+  QgsRectangle boundingBox;
+  //! FALSE if the geometry cannot be indexed (failed transform or non finite bounding box)
+  bool isValid = false;
 };
 
+/**
+ * Transforms the \a geometries to the locator CRS using \a transform (if valid), and computes their
+ * bounding boxes. Large batches are processed over multiple threads.
+ */
+static void prepareGeometries( const QgsCoordinateTransform &transform, QVector< QgsPointLocator_IndexedGeometry > &geometries )
+{
+  auto prepare = [&transform]( QgsPointLocator_IndexedGeometry & entry )
+  {
+    if ( transform.isValid() )
+    {
+      try
+      {
+        entry.geometry.transform( transform );
+      }
+      catch ( const QgsException &e )
+      {
+        Q_UNUSED( e )
+        // See https://github.com/qgis/QGIS/issues/20749
+        QgsDebugMsg( QStringLiteral( "could not transform geometry to map, skipping the snap for it (%1)" ).arg( e.what() ) );
+        entry.isValid = false;
+        return;
+      }
+    }
+
+    entry.boundingBox = entry.geometry.boundingBox();
+    entry.isValid = entry.boundingBox.isFinite();
+  };
+
+  if ( geometries.size() < PARALLEL_PREPARE_THRESHOLD )
+    std::for_each( geometries.begin(), geometries.end(), prepare );
+  else
+    QtConcurrent::blockingMap( geometries, prepare );
+}
+
 
 ////////////////////////////////////////////////////////////////////////////
 
@@ -109,7 +181,7 @@ class QgsPointLocator_VisitorNearestVertex : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
+      QgsGeometry *geom = mLocator->cachedGeometry( id );
       int vertexIndex, beforeVertex, afterVertex;
       double sqrDist;
 
@@ -164,7 +236,7 @@ class QgsPointLocator_VisitorNearestCentroid : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
+      QgsGeometry *geom = mLocator->cachedGeometry( id );
 
       QgsPointXY pt = geom->centroid().asPoint();
 
@@ -216,7 +288,7 @@ class QgsPointLocator_VisitorNearestMiddleOfSegment: public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
+      QgsGeometry *geom = mLocator->cachedGeometry( id );
       QgsPointXY pt;
       int afterVertex;
       double sqrDist = geom->closestSegmentWithContext( mSrcPoint, pt, afterVertex, nullptr, POINT_LOC_EPSILON );
@@ -269,7 +341,7 @@ class QgsPointLocator_VisitorNearestEdge : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
+      QgsGeometry *geom = mLocator->cachedGeometry( id );
       QgsPointXY pt;
       int afterVertex;
       double sqrDist = geom->closestSegmentWithContext( mSrcPoint, pt, afterVertex, nullptr, POINT_LOC_EPSILON );
@@ -319,7 +391,7 @@ class QgsPointLocator_VisitorArea : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *g = mLocator->mGeoms.value( id );
+      QgsGeometry *g = mLocator->cachedGeometry( id );
       if ( g->intersects( mGeomPt ) )
         mList << QgsPointLocator::Match( QgsPointLocator::Area, mLocator->mLayer, id, 0, mGeomPt.asPoint() );
     }
@@ -515,7 +587,7 @@ class QgsPointLocator_VisitorEdgesInRect : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
+      QgsGeometry *geom = mLocator->cachedGeometry( id );
 
       const auto segmentsInRect {_geometrySegmentsInRect( geom, mSrcRect, mLocator->mLayer, id )};
       for ( const QgsPointLocator::Match &m : segmentsInRect )
@@ -560,7 +632,7 @@ class QgsPointLocator_VisitorVerticesInRect : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      const QgsGeometry *geom = mLocator->mGeoms.value( id );
+      const QgsGeometry *geom = mLocator->cachedGeometry( id );
 
       for ( QgsAbstractGeometry::vertex_iterator it = geom->vertices_begin(); it != geom->vertices_end(); ++it )
       {
@@ -607,7 +679,7 @@ class QgsPointLocator_VisitorCentroidsInRect : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      const QgsGeometry *geom = mLocator->mGeoms.value( id );
+      const QgsGeometry *geom = mLocator->cachedGeometry( id );
       const QgsPointXY centroid = geom->centroid().asPoint();
       if ( mSrcRect.contains( centroid ) )
       {
@@ -649,7 +721,7 @@ class QgsPointLocator_VisitorMiddlesInRect : public IVisitor
     void visitData( const IData &d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      const QgsGeometry *geom = mLocator->mGeoms.value( id );
+      const QgsGeometry *geom = mLocator->cachedGeometry( id );
 
       for ( QgsAbstractGeometry::const_part_iterator itPart = geom->const_parts_begin() ; itPart != geom->const_parts_end() ; ++itPart )
       {
@@ -813,15 +885,16 @@ void QgsPointLocator::onInitTaskFinished()
   mRenderer.reset();
   mSource.reset();
 
-  // treat added and deleted feature while indexing
-  for ( QgsFeatureId fid : mAddedFeatures )
-    onFeatureAdded( fid );
-  mAddedFeatures.clear();
-
+  // treat added and deleted feature while indexing. Deletions go first, as a feature whose geometry
+  // changed while indexing is both in the deleted and the added features
   for ( QgsFeatureId fid : mDeletedFeatures )
     onFeatureDeleted( fid );
   mDeletedFeatures.clear();
 
+  for ( QgsFeatureId fid : mAddedFeatures )
+    onFeatureAdded( fid );
+  mAddedFeatures.clear();
+
   emit initFinished( mInitTask->isBuildOK() );
 }
 
@@ -894,6 +967,8 @@ bool QgsPointLocator::prepare( bool relaxed )
       return false;
   }
 
+  indexPendingFeatures();
+
   return true;
 }
 
@@ -906,7 +981,6 @@ bool QgsPointLocator::rebuildIndex( int maxFeaturesToIndex )
 
   destroyIndex();
 
-  QLinkedList<RTree::Data *> dataList;
   QgsFeature f;
 
   QgsFeatureRequest request;
@@ -948,6 +1022,31 @@ bool QgsPointLocator::rebuildIndex( int maxFeaturesToIndex )
   QgsFeatureIterator fi = mSource->getFeatures( request );
   int indexedCount = 0;
 
+  // Features are read (and filtered by the renderer) serially, in batches. Transforming the geometries
+  // of a batch and computing their bounding boxes is then spread over multiple threads.
+  QVector< QgsPointLocator_IndexedGeometry > batch;
+  batch.reserve( INDEX_BATCH_SIZE );
+  QVector< QPair< QgsFeatureId, QgsRectangle > > entries;
+
+  auto indexBatch = [&]() -> bool
+  {
+    prepareGeometries( mTransform, batch );
+    for ( const QgsPointLocator_IndexedGeometry &entry : qgis::as_const( batch ) )
+    {
+      if ( !entry.isValid )
+        continue;
+
+      entries << qMakePair( entry.fid, entry.boundingBox );
+      cacheGeometry( entry.fid, entry.geometry );
+      ++indexedCount;
+
+      if ( maxFeaturesToIndex != -1 && indexedCount > maxFeaturesToIndex )
+        return false;
+    }
+    batch.clear();
+    return true;
+  };
+
   while ( fi.nextFeature( f ) )
   {
     if ( !f.hasGeometry() )
@@ -962,42 +1061,18 @@ bool QgsPointLocator::rebuildIndex( int maxFeaturesToIndex )
       }
     }
 
-    if ( mTransform.isValid() )
-    {
-      try
-      {
-        QgsGeometry transformedGeometry = f.geometry();
-        transformedGeometry.transform( mTransform );
-        f.setGeometry( transformedGeometry );
-      }
-      catch ( const QgsException &e )
-      {
-        Q_UNUSED( e )
-        // See https://github.com/qgis/QGIS/issues/20749
-        QgsDebugMsg( QStringLiteral( "could not transform geometry to map, skipping the snap for it (%1)" ).arg( e.what() ) );
-        continue;
-      }
-    }
-
-    const QgsRectangle bbox = f.geometry().boundingBox();
-    if ( bbox.isFinite() )
-    {
-      SpatialIndex::Region r( rect2region( bbox ) );
-      dataList << new RTree::Data( 0, nullptr, r, f.id() );
-
-      if ( mGeoms.contains( f.id() ) )
-        delete mGeoms.take( f.id() );
-      mGeoms[f.id()] = new QgsGeometry( f.geometry() );
-      ++indexedCount;
-    }
-
-    if ( maxFeaturesToIndex != -1 && indexedCount > maxFeaturesToIndex )
+    batch << QgsPointLocator_IndexedGeometry( f.id(), f.geometry() );
+    if ( batch.size() >= INDEX_BATCH_SIZE && !indexBatch() )
     {
-      qDeleteAll( dataList );
       destroyIndex();
       return false;
     }
   }
+  if ( !indexBatch() )
+  {
+    destroyIndex();
+    return false;
+  }
 
   // R-Tree parameters
   double fillFactor = 0.7;
@@ -1007,13 +1082,13 @@ bool QgsPointLocator::rebuildIndex( int maxFeaturesToIndex )
   RTree::RTreeVariant variant = RTree::RV_RSTAR;
   SpatialIndex::id_type indexId;
 
-  if ( dataList.isEmpty() )
+  if ( entries.isEmpty() )
   {
     mIsEmptyLayer = true;
     return true; // no features
   }
 
-  QgsPointLocator_Stream stream( dataList );
+  QgsPointLocator_Stream stream( entries );
   mRTree.reset( RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, stream, *mStorage, fillFactor, indexCapacity,
                 leafCapacity, dimension, variant, indexId ) );
 
@@ -1034,9 +1109,50 @@ void QgsPointLocator::destroyIndex()
 
   mIsEmptyLayer = false;
 
-  qDeleteAll( mGeoms );
+  mGeometries.clear();
+  mGeometryIndex.clear();
+  mFreeGeometrySlots.clear();
+  mPendingFeatures.clear();
+}
 
-  mGeoms.clear();
+QgsGeometry *QgsPointLocator::cachedGeometry( QgsFeatureId fid )
+{
+  const auto it = mGeometryIndex.constFind( fid );
+  return it != mGeometryIndex.constEnd() ? &mGeometries[ *it ] : nullptr;
+}
+
+void QgsPointLocator::cacheGeometry( QgsFeatureId fid, const QgsGeometry &geometry )
+{
+  const auto it = mGeometryIndex.constFind( fid );
+  if ( it != mGeometryIndex.constEnd() )
+  {
+    mGeometries[ *it ] = geometry;
+    return;
+  }
+
+  if ( !mFreeGeometrySlots.empty() )
+  {
+    const int slot = mFreeGeometrySlots.back();
+    mFreeGeometrySlots.pop_back();
+    mGeometries[ slot ] = geometry;
+    mGeometryIndex.insert( fid, slot );
+  }
+  else
+  {
+    mGeometryIndex.insert( fid, static_cast< int >( mGeometries.size() ) );
+    mGeometries.emplace_back( geometry );
+  }
+}
+
+void QgsPointLocator::removeCachedGeometry( QgsFeatureId fid )
+{
+  const auto it = mGeometryIndex.find( fid );
+  if ( it == mGeometryIndex.end() )
+    return;
+
+  mGeometries[ *it ] = QgsGeometry();
+  mFreeGeometrySlots.push_back( *it );
+  mGeometryIndex.erase( it );
 }
 
 void QgsPointLocator::onFeatureAdded( QgsFeatureId fid )
@@ -1059,63 +1175,64 @@ void QgsPointLocator::onFeatureAdded( QgsFeatureId fid )
     return; // nothing to do if we are not initialized yet
   }
 
+  // added and changed features are indexed together right before the next query, so that
+  // a batch of edits only needs a single feature request and renderer setup
+  mPendingFeatures << fid;
+}
+
+void QgsPointLocator::indexPendingFeatures()
+{
+  if ( mPendingFeatures.isEmpty() || !mRTree )
+    return;
+
+  QgsFeatureRequest request( mPendingFeatures );
+  mPendingFeatures.clear();
+
+  std::unique_ptr< QgsFeatureRenderer > renderer;
+  QgsRenderContext *ctx = nullptr;
+  if ( mContext )
+  {
+    renderer.reset( mLayer->renderer() ? mLayer->renderer()->clone() : nullptr );
+    mContext->expressionContext() << QgsExpressionContextUtils::layerScope( mLayer );
+    ctx = mContext.get();
+    if ( renderer )
+      renderer->startRender( *ctx, mLayer->fields() );
+  }
+
+  QVector< QgsPointLocator_IndexedGeometry > geometries;
+  QgsFeatureIterator fi = mLayer->getFeatures( request );
   QgsFeature f;
-  if ( mLayer->getFeatures( QgsFeatureRequest( fid ) ).nextFeature( f ) )
+  while ( fi.nextFeature( f ) )
   {
     if ( !f.hasGeometry() )
-      return;
+      continue;
 
-    if ( mContext )
+    if ( renderer && ctx )
     {
-      std::unique_ptr< QgsFeatureRenderer > renderer( mLayer->renderer() ? mLayer->renderer()->clone() : nullptr );
-      QgsRenderContext *ctx = nullptr;
-
-      mContext->expressionContext() << QgsExpressionContextUtils::layerScope( mLayer );
-      ctx = mContext.get();
-      if ( renderer && ctx )
-      {
-        bool pass = false;
-        renderer->startRender( *ctx, mLayer->fields() );
+      ctx->expressionContext().setFeature( f );
+      if ( !renderer->willRenderFeature( f, *ctx ) )
+        continue;
+    }
 
-        ctx->expressionContext().setFeature( f );
-        if ( !renderer->willRenderFeature( f, *ctx ) )
-        {
-          pass = true;
-        }
+    geometries << QgsPointLocator_IndexedGeometry( f.id(), f.geometry() );
+  }
 
-        renderer->stopRender( *ctx );
-        if ( pass )
-          return;
-      }
-    }
+  if ( renderer && ctx )
+    renderer->stopRender( *ctx );
 
-    if ( mTransform.isValid() )
-    {
-      try
-      {
-        QgsGeometry transformedGeom = f.geometry();
-        transformedGeom.transform( mTransform );
-        f.setGeometry( transformedGeom );
-      }
-      catch ( const QgsException &e )
-      {
-        Q_UNUSED( e )
-        // See https://github.com/qgis/QGIS/issues/20749
-        QgsDebugMsg( QStringLiteral( "could not transform geometry to map, skipping the snap for it (%1)" ).arg( e.what() ) );
-        return;
-      }
-    }
+  prepareGeometries( mTransform, geometries );
+  for ( const QgsPointLocator_IndexedGeometry &entry : qgis::as_const( geometries ) )
+  {
+    if ( !entry.isValid )
+      continue;
 
-    const QgsRectangle bbox = f.geometry().boundingBox();
-    if ( bbox.isFinite() )
-    {
-      SpatialIndex::Region r( rect2region( bbox ) );
-      mRTree->insertData( 0, nullptr, r, f.id() );
+    // a feature may have been added twice before being indexed
+    if ( const QgsGeometry *previous = cachedGeometry( entry.fid ) )
+      mRTree->deleteData( rect2region( previous->boundingBox() ), entry.fid );
 
-      if ( mGeoms.contains( f.id() ) )
-        delete mGeoms.take( f.id() );
-      mGeoms[fid] = new QgsGeometry( f.geometry() );
-    }
+    SpatialIndex::Region r( rect2region( entry.boundingBox ) );
+    mRTree->insertData( 0, nullptr, r, entry.fid );
+    cacheGeometry( entry.fid, entry.geometry );
   }
 }
 
@@ -1138,10 +1255,12 @@ void QgsPointLocator::onFeatureDeleted( QgsFeatureId fid )
   if ( !mRTree )
     return; // nothing to do if we are not initialized yet
 
-  if ( mGeoms.contains( fid ) )
+  mPendingFeatures.remove( fid );
+
+  if ( const QgsGeometry *geometry = cachedGeometry( fid ) )
   {
-    mRTree->deleteData( rect2region( mGeoms[fid]->boundingBox() ), fid );
-    delete mGeoms.take( fid );
+    mRTree->deleteData( rect2region( geometry->boundingBox() ), fid );
+    removeCachedGeometry( fid );
   }
 
 }
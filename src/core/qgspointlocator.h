@@ -33,6 +33,7 @@ class QgsVectorLayerFeatureSource;
 #include "qgslinestring.h"
 #include "qgspointlocatorinittask.h"
 #include <memory>
+#include <vector>
 
 /**
  * \ingroup core
@@ -393,7 +394,7 @@ class CORE_EXPORT QgsPointLocator : public QObject
      * Returns how many geometries are cached in the index
      * \since QGIS 2.14
      */
-    int cachedGeometryCount() const { return mGeoms.count(); }
+    int cachedGeometryCount() const { return mGeometryIndex.count(); }
 
     /**
      * Returns TRUE if the point locator is currently indexing the data.
@@ -438,10 +439,30 @@ class CORE_EXPORT QgsPointLocator : public QObject
      */
     bool prepare( bool relaxed );
 
+    //! Adds the features from mPendingFeatures to the index
+    void indexPendingFeatures();
+
+    //! Returns the cached geometry for the feature \a fid, or NULLPTR if the feature is not indexed
+    QgsGeometry *cachedGeometry( QgsFeatureId fid );
+
+    //! Stores the \a geometry of the feature \a fid
+    void cacheGeometry( QgsFeatureId fid, const QgsGeometry &geometry );
+
+    //! Removes the cached geometry of the feature \a fid
+    void removeCachedGeometry( QgsFeatureId fid );
+
     //! Storage manager
     std::unique_ptr< SpatialIndex::IStorageManager > mStorage;
 
-    QHash<QgsFeatureId, QgsGeometry *> mGeoms;
+    //! Geometries of the indexed features, stored contiguously
+    std::vector< QgsGeometry > mGeometries;
+    //! Position of each indexed feature geometry in mGeometries
+    QHash< QgsFeatureId, int > mGeometryIndex;
+    //! Positions in mGeometries left by removed features, reused by the next added ones
+    std::vector< int > mFreeGeometrySlots;
+    //! Features added or changed since the index was built, to be indexed before the next query
+    QgsFeatureIds mPendingFeatures;
+
     std::unique_ptr< SpatialIndex::ISpatialIndex > mRTree;
 
     //! flag whether the layer is currently empty (i.e. mRTree is NULLPTR but it is not necessary to rebuild it)
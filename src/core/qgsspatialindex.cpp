@@ -25,8 +25,13 @@
 #include "qgsspatialindexutils.h"
 
 #include <spatialindex/SpatialIndex.h>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QtEndian>
+#include <cstring>
 
 using namespace SpatialIndex;
 
@@ -88,6 +93,38 @@ class QgsSpatialIndexCopyVisitor : public SpatialIndex::IVisitor
     SpatialIndex::ISpatialIndex *mNewIndex = nullptr;
 };
 
+/**
+ * \ingroup core
+ * \class QgsSpatialIndexEntriesVisitor
+ * \brief Custom visitor that collects the identifier and bounding box of all visited entries.
+ * \note not available in Python bindings
+ */
+class QgsSpatialIndexEntriesVisitor : public SpatialIndex::IVisitor
+{
+  public:
+    explicit QgsSpatialIndexEntriesVisitor( QList< QPair< QgsFeatureId, QgsRectangle > > &list )
+      : mList( list ) {}
+
+    void visitNode( const INode &n ) override
+    { Q_UNUSED( n ) }
+
+    void visitData( const IData &d ) override
+    {
+      SpatialIndex::IShape *shape = nullptr;
+      d.getShape( &shape );
+      SpatialIndex::Region region;
+      shape->getMBR( region );
+      delete shape;
+      mList.append( qMakePair( d.getIdentifier(), QgsRectangle( region.m_pLow[0], region.m_pLow[1], region.m_pHigh[0], region.m_pHigh[1], false ) ) );
+    }
+
+    void visitData( std::vector<const IData *> &v ) override
+    { Q_UNUSED( v ) }
+
+  private:
+    QList< QPair< QgsFeatureId, QgsRectangle > > &mList;
+};
+
 ///@cond PRIVATE
 class QgsNearestNeighborComparator : public INearestNeighborComparator
 {
@@ -238,6 +275,117 @@ class QgsFeatureIteratorDataStream : public IDataStream
 };
 
 
+// spatial index file layout: a header followed by the entries, each one made of
+// the feature id, its bounding box and its WKB geometry (empty unless geometries are stored)
+static const char SPATIAL_INDEX_FILE_MAGIC[] = "QGSSIDX1";
+static const quint32 SPATIAL_INDEX_FILE_VERSION = 1;
+static const int SPATIAL_INDEX_FILE_HEADER_SIZE = 8 + 4 + 4 + 8 + 8 + 8;
+static const int SPATIAL_INDEX_FILE_ENTRY_SIZE = 8 + 4 * 8 + 4;
+
+/**
+ * \ingroup core
+ * \class QgsSpatialIndexFileDataStream
+ * \brief Utility class for bulk loading of R-trees from the entries of a memory mapped spatial index file.
+ * Not a part of public API.
+ * \note not available in Python bindings
+*/
+class QgsSpatialIndexFileDataStream : public IDataStream
+{
+  public:
+
+    /**
+     * Constructor for QgsSpatialIndexFileDataStream, reading \a count entries from \a data, which
+     * is \a size bytes long.
+     */
+    QgsSpatialIndexFileDataStream( const uchar *data, qint64 size, quint64 count, bool storeGeometries )
+      : mData( data )
+      , mSize( size )
+      , mCount( count )
+      , mStoreGeometries( storeGeometries )
+    {
+      readNextEntry();
+    }
+
+    ~QgsSpatialIndexFileDataStream() override
+    {
+      delete mNextData;
+    }
+
+    IData *getNext() override
+    {
+      RTree::Data *ret = mNextData;
+      mNextData = nullptr;
+      readNextEntry();
+      return ret;
+    }
+
+    bool hasNext() override { return nullptr != mNextData; }
+
+    uint32_t size() override { return static_cast< uint32_t >( mCount ); }
+
+    void rewind() override { Q_ASSERT( false && "not available" ); }
+
+    //! Returns TRUE if the entries were truncated or malformed
+    bool hasError() const { return mError; }
+
+    QHash< QgsFeatureId, QgsGeometry > geometries;
+
+  private:
+
+    static double readDouble( const uchar *data )
+    {
+      const quint64 bits = qFromLittleEndian< quint64 >( data );
+      double value;
+      std::memcpy( &value, &bits, sizeof( double ) );
+      return value;
+    }
+
+    void readNextEntry()
+    {
+      if ( mRead == mCount )
+        return;
+
+      if ( mPos + SPATIAL_INDEX_FILE_ENTRY_SIZE > mSize )
+      {
+        mError = true;
+        return;
+      }
+
+      const uchar *entry = mData + mPos;
+      const QgsFeatureId id = qFromLittleEndian< qint64 >( entry );
+      double low[] = { readDouble( entry + 8 ), readDouble( entry + 16 ) };
+      double high[] = { readDouble( entry + 24 ), readDouble( entry + 32 ) };
+      const quint32 wkbSize = qFromLittleEndian< quint32 >( entry + 40 );
+      mPos += SPATIAL_INDEX_FILE_ENTRY_SIZE;
+      if ( mPos + wkbSize > mSize )
+      {
+        mError = true;
+        return;
+      }
+
+      if ( mStoreGeometries && wkbSize > 0 )
+      {
+        QgsGeometry geometry;
+        geometry.fromWkb( QByteArray( reinterpret_cast< const char * >( mData + mPos ), static_cast< int >( wkbSize ) ) );
+        geometries.insert( id, geometry );
+      }
+      mPos += wkbSize;
+      mRead++;
+
+      SpatialIndex::Region r( low, high, 2 );
+      mNextData = new RTree::Data( 0, nullptr, r, FID_TO_NUMBER( id ) );
+    }
+
+    const uchar *mData = nullptr;
+    qint64 mSize = 0;
+    qint64 mPos = 0;
+    quint64 mCount = 0;
+    quint64 mRead = 0;
+    bool mStoreGeometries = false;
+    bool mError = false;
+    RTree::Data *mNextData = nullptr;
+};
+
 /**
  * \ingroup core
  * \class QgsSpatialIndexData
@@ -275,6 +423,17 @@ class QgsSpatialIndexData : public QSharedData
         mGeometries = fids.geometries;
     }
 
+    /**
+     * Constructor for QgsSpatialIndexData which bulk loads the entries of a spatial index file.
+     */
+    QgsSpatialIndexData( QgsSpatialIndexFileDataStream &stream, QgsSpatialIndex::Flags flags )
+      : mFlags( flags )
+    {
+      initTree( &stream );
+      if ( flags & QgsSpatialIndex::FlagStoreFeatureGeometries )
+        mGeometries = stream.geometries;
+    }
+
     QgsSpatialIndexData( const QgsSpatialIndexData &other )
       : QSharedData( other )
       , mFlags( other.mFlags )
@@ -555,6 +714,106 @@ QgsGeometry QgsSpatialIndex::geometry( QgsFeatureId id ) const
   return d->mGeometries.value( id );
 }
 
+bool QgsSpatialIndex::writeToFile( const QString &path, long sourceFeatureCount, const QDateTime &sourceLastModified, QString *errorMessage ) const
+{
+  QList< QPair< QgsFeatureId, QgsRectangle > > entries;
+  QHash< QgsFeatureId, QgsGeometry > geometries;
+  {
+    QgsSpatialIndexEntriesVisitor visitor( entries );
+    double low[]  = { std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest() };
+    double high[] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+    SpatialIndex::Region query( low, high, 2 );
+
+    QMutexLocker locker( &d->mMutex );
+    d->mRTree->intersectsWithQuery( query, visitor );
+    geometries = d->mGeometries;
+  }
+
+  // the file is replaced atomically, as other threads or processes may be reading it
+  QSaveFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+  {
+    if ( errorMessage )
+      *errorMessage = QObject::tr( "Could not open %1 for writing: %2" ).arg( path, file.errorString() );
+    return false;
+  }
+
+  QDataStream stream( &file );
+  stream.setByteOrder( QDataStream::LittleEndian );
+  stream.setFloatingPointPrecision( QDataStream::DoublePrecision );
+  stream.writeRawData( SPATIAL_INDEX_FILE_MAGIC, 8 );
+  stream << SPATIAL_INDEX_FILE_VERSION
+         << static_cast< quint32 >( d->mFlags )
+         << static_cast< qint64 >( sourceFeatureCount )
+         << static_cast< qint64 >( sourceLastModified.isValid() ? sourceLastModified.toMSecsSinceEpoch() : -1 )
+         << static_cast< quint64 >( entries.size() );
+
+  const bool storeGeometries = d->mFlags & QgsSpatialIndex::FlagStoreFeatureGeometries;
+  for ( const QPair< QgsFeatureId, QgsRectangle > &entry : qgis::as_const( entries ) )
+  {
+    const QByteArray wkb = storeGeometries ? geometries.value( entry.first ).asWkb() : QByteArray();
+    stream << static_cast< qint64 >( entry.first )
+           << entry.second.xMinimum() << entry.second.yMinimum() << entry.second.xMaximum() << entry.second.yMaximum()
+           << static_cast< quint32 >( wkb.size() );
+    stream.writeRawData( wkb.constData(), wkb.size() );
+  }
+
+  if ( stream.status() != QDataStream::Ok || !file.commit() )
+  {
+    if ( errorMessage )
+      *errorMessage = QObject::tr( "Could not write spatial index to %1: %2" ).arg( path, file.errorString() );
+    return false;
+  }
+
+  if ( errorMessage )
+    errorMessage->clear();
+  return true;
+}
+
+bool QgsSpatialIndex::readFromFile( const QString &path, long expectedFeatureCount, const QDateTime &expectedLastModified, QString *errorMessage )
+{
+  auto setError = [errorMessage]( const QString & error ) -> bool
+  {
+    if ( errorMessage )
+      *errorMessage = error;
+    return false;
+  };
+
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return setError( QObject::tr( "Could not open %1 for reading: %2" ).arg( path, file.errorString() ) );
+
+  const qint64 size = file.size();
+  const uchar *data = size >= SPATIAL_INDEX_FILE_HEADER_SIZE ? file.map( 0, size ) : nullptr;
+  if ( !data || std::memcmp( data, SPATIAL_INDEX_FILE_MAGIC, 8 ) != 0 )
+    return setError( QObject::tr( "%1 is not a spatial index file" ).arg( path ) );
+
+  const quint32 version = qFromLittleEndian< quint32 >( data + 8 );
+  const quint32 flags = qFromLittleEndian< quint32 >( data + 12 );
+  const qint64 featureCount = qFromLittleEndian< qint64 >( data + 16 );
+  const qint64 lastModified = qFromLittleEndian< qint64 >( data + 24 );
+  const quint64 entryCount = qFromLittleEndian< quint64 >( data + 32 );
+
+  if ( version != SPATIAL_INDEX_FILE_VERSION )
+    return setError( QObject::tr( "Unsupported spatial index file version %1" ).arg( version ) );
+  if ( flags != static_cast< quint32 >( d->mFlags ) )
+    return setError( QObject::tr( "Spatial index file %1 was created with different index flags" ).arg( path ) );
+  if ( featureCount != expectedFeatureCount
+       || lastModified != ( expectedLastModified.isValid() ? expectedLastModified.toMSecsSinceEpoch() : -1 ) )
+    return setError( QObject::tr( "Spatial index file %1 is out of date" ).arg( path ) );
+
+  QgsSpatialIndexFileDataStream entries( data + SPATIAL_INDEX_FILE_HEADER_SIZE, size - SPATIAL_INDEX_FILE_HEADER_SIZE, entryCount,
+                                         d->mFlags & QgsSpatialIndex::FlagStoreFeatureGeometries );
+  std::unique_ptr< QgsSpatialIndexData > newData = qgis::make_unique< QgsSpatialIndexData >( entries, d->mFlags );
+  if ( entries.hasError() )
+    return setError( QObject::tr( "Spatial index file %1 is corrupted" ).arg( path ) );
+
+  d = newData.release();
+  if ( errorMessage )
+    errorMessage->clear();
+  return true;
+}
+
 QAtomicInt QgsSpatialIndex::refs() const
 {
   return d->ref;
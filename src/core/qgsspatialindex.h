@@ -40,6 +40,7 @@ class QgsPointXY;
 
 #include "qgis_core.h"
 #include "qgsfeaturesink.h"
+#include <QDateTime>
 #include <QList>
 #include <QSharedDataPointer>
 
@@ -265,6 +266,41 @@ class CORE_EXPORT QgsSpatialIndex : public QgsFeatureSink
     % End
 #endif
 
+    /* persistence */
+
+    /**
+     * Writes the index to the file at \a path, so that it can later be loaded back with readFromFile()
+     * instead of being rebuilt from the features.
+     *
+     * The \a sourceFeatureCount and \a sourceLastModified arguments describe the state of the source the
+     * index was built from. They are stored in the file and checked when it is read back.
+     *
+     * If the index was created with the FlagStoreFeatureGeometries flag, the stored feature geometries
+     * are written too.
+     *
+     * Returns FALSE if the file could not be written, in which case \a errorMessage will be set.
+     *
+     * \see readFromFile()
+     * \since QGIS 3.18
+     */
+    bool writeToFile( const QString &path, long sourceFeatureCount, const QDateTime &sourceLastModified, QString *errorMessage SIP_OUT = nullptr ) const;
+
+    /**
+     * Replaces the content of the index with the index previously saved to the file at \a path with writeToFile().
+     *
+     * The file is memory mapped and its entries are bulk loaded, which is much faster than building the
+     * index from the original features.
+     *
+     * The file is rejected if it was written for a source with a different feature count than \a expectedFeatureCount,
+     * or a different last modification time than \a expectedLastModified, or with different index flags than
+     * this index. In this case, or if the file cannot be read, the index is left unchanged, FALSE is returned and
+     * \a errorMessage is set.
+     *
+     * \see writeToFile()
+     * \since QGIS 3.18
+     */
+    bool readFromFile( const QString &path, long expectedFeatureCount, const QDateTime &expectedLastModified, QString *errorMessage SIP_OUT = nullptr );
+
     /* debugging */
 
     //! Gets reference count - just for debugging!
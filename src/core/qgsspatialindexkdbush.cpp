@@ -21,6 +21,218 @@
 #include "qgsfeaturesource.h"
 #include "qgsspatialindexkdbush_p.h"
 
+#include <QThread>
+#include <QtConcurrentRun>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+///@cond PRIVATE
+
+// below this number of points, sorting a range is not worth spreading over multiple threads
+static const std::size_t PARALLEL_SORT_THRESHOLD = 65536;
+
+int PointXYKDBush::parallelSortDepth()
+{
+  // enough levels to give every thread at least one range to sort
+  int depth = 0;
+  const int threads = QThread::idealThreadCount();
+  while ( ( 1 << depth ) < threads )
+    depth++;
+  return depth;
+}
+
+void PointXYKDBush::parallelSortKD( std::size_t left, std::size_t right, std::uint8_t axis, int depth )
+{
+  if ( depth <= 0 || right - left < PARALLEL_SORT_THRESHOLD )
+  {
+    sortKD( left, right, axis );
+    return;
+  }
+
+  const std::size_t m = ( left + right ) >> 1;
+  if ( axis == 0 )
+    select<0>( m, left, right );
+  else
+    select<1>( m, left, right );
+
+  // the two halves do not overlap, so they can safely be sorted concurrently
+  const std::uint8_t nextAxis = ( axis + 1 ) % 2;
+  QFuture< void > leftSort = QtConcurrent::run( [ = ] { parallelSortKD( left, m - 1, nextAxis, depth - 1 ); } );
+  parallelSortKD( m + 1, right, nextAxis, depth - 1 );
+  leftSort.waitForFinished();
+}
+
+bool PointXYKDBush::visitRange( double minX, double minY, double maxX, double maxY, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor ) const
+{
+  if ( points.empty() )
+    return true;
+  return visitRange( minX, minY, maxX, maxY, visitor, 0, points.size() - 1, 0 );
+}
+
+bool PointXYKDBush::visitRange( double minX, double minY, double maxX, double maxY, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor,
+                                std::size_t left, std::size_t right, std::uint8_t axis ) const
+{
+  if ( right - left <= nodeSize )
+  {
+    for ( std::size_t i = left; i <= right; i++ )
+    {
+      const double x = points[i].coords.first;
+      const double y = points[i].coords.second;
+      if ( x >= minX && x <= maxX && y >= minY && y <= maxY && !visitor( points[i] ) )
+        return false;
+    }
+    return true;
+  }
+
+  const std::size_t m = ( left + right ) >> 1;
+  const double x = points[m].coords.first;
+  const double y = points[m].coords.second;
+
+  if ( x >= minX && x <= maxX && y >= minY && y <= maxY && !visitor( points[m] ) )
+    return false;
+
+  if ( ( axis == 0 ? minX <= x : minY <= y ) && !visitRange( minX, minY, maxX, maxY, visitor, left, m - 1, ( axis + 1 ) % 2 ) )
+    return false;
+
+  if ( axis == 0 ? maxX >= x : maxY >= y )
+    return visitRange( minX, minY, maxX, maxY, visitor, m + 1, right, ( axis + 1 ) % 2 );
+
+  return true;
+}
+
+bool PointXYKDBush::visitWithin( double qx, double qy, double radius, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor ) const
+{
+  if ( points.empty() )
+    return true;
+  return visitWithin( qx, qy, radius, visitor, 0, points.size() - 1, 0 );
+}
+
+bool PointXYKDBush::visitWithin( double qx, double qy, double r, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor,
+                                 std::size_t left, std::size_t right, std::uint8_t axis ) const
+{
+  const double r2 = r * r;
+
+  if ( right - left <= nodeSize )
+  {
+    for ( std::size_t i = left; i <= right; i++ )
+    {
+      if ( sqDist( points[i].coords.first, points[i].coords.second, qx, qy ) <= r2 && !visitor( points[i] ) )
+        return false;
+    }
+    return true;
+  }
+
+  const std::size_t m = ( left + right ) >> 1;
+  const double x = points[m].coords.first;
+  const double y = points[m].coords.second;
+
+  if ( sqDist( x, y, qx, qy ) <= r2 && !visitor( points[m] ) )
+    return false;
+
+  if ( ( axis == 0 ? qx - r <= x : qy - r <= y ) && !visitWithin( qx, qy, r, visitor, left, m - 1, ( axis + 1 ) % 2 ) )
+    return false;
+
+  if ( axis == 0 ? qx + r >= x : qy + r >= y )
+    return visitWithin( qx, qy, r, visitor, m + 1, right, ( axis + 1 ) % 2 );
+
+  return true;
+}
+
+void PointXYKDBush::nearest( double qx, double qy, int maxResults, double maxDistance, const std::function<void( const QgsSpatialIndexKDBushData &, double )> &visitor ) const
+{
+  if ( points.empty() || maxResults <= 0 )
+    return;
+
+  // best first search: candidates are either single points or ranges of the tree, together
+  // with the bounds of the area they cover, ordered by their (squared) distance to the query point
+  struct Candidate
+  {
+    double distance;
+    std::size_t left;
+    std::size_t right;
+    std::uint8_t axis;
+    bool isPoint;
+    double minX;
+    double minY;
+    double maxX;
+    double maxY;
+    bool operator<( const Candidate &other ) const { return distance > other.distance; }
+  };
+
+  auto axisDistance = []( double k, double min, double max ) -> double
+  {
+    return k < min ? min - k : ( k <= max ? 0 : k - max );
+  };
+
+  const double maxDistanceSquared = maxDistance > 0 ? maxDistance * maxDistance : std::numeric_limits< double >::max();
+  const double inf = std::numeric_limits< double >::infinity();
+  std::priority_queue< Candidate > queue;
+  queue.push( Candidate { 0, 0, points.size() - 1, 0, false, -inf, -inf, inf, inf } );
+
+  int found = 0;
+  double lastDistance = 0;
+  while ( !queue.empty() )
+  {
+    const Candidate candidate = queue.top();
+    queue.pop();
+
+    if ( candidate.isPoint )
+    {
+      // once enough points are found, only continue while there are ties
+      if ( found >= maxResults && candidate.distance > lastDistance )
+        return;
+
+      visitor( points[candidate.left], std::sqrt( candidate.distance ) );
+      found++;
+      lastDistance = candidate.distance;
+      continue;
+    }
+
+    auto pushPoint = [&]( std::size_t i )
+    {
+      const double distance = sqDist( points[i].coords.first, points[i].coords.second, qx, qy );
+      if ( distance <= maxDistanceSquared )
+        queue.push( Candidate { distance, i, i, 0, true, 0, 0, 0, 0 } );
+    };
+
+    if ( candidate.right - candidate.left <= nodeSize )
+    {
+      for ( std::size_t i = candidate.left; i <= candidate.right; i++ )
+        pushPoint( i );
+      continue;
+    }
+
+    const std::size_t m = ( candidate.left + candidate.right ) >> 1;
+    pushPoint( m );
+
+    const double x = points[m].coords.first;
+    const double y = points[m].coords.second;
+    const std::uint8_t nextAxis = ( candidate.axis + 1 ) % 2;
+    auto pushRange = [&]( std::size_t left, std::size_t right, double minX, double minY, double maxX, double maxY )
+    {
+      const double dx = axisDistance( qx, minX, maxX );
+      const double dy = axisDistance( qy, minY, maxY );
+      const double distance = dx * dx + dy * dy;
+      if ( distance <= maxDistanceSquared )
+        queue.push( Candidate { distance, left, right, nextAxis, false, minX, minY, maxX, maxY } );
+    };
+
+    if ( candidate.axis == 0 )
+    {
+      pushRange( candidate.left, m - 1, candidate.minX, candidate.minY, x, candidate.maxY );
+      pushRange( m + 1, candidate.right, x, candidate.minY, candidate.maxX, candidate.maxY );
+    }
+    else
+    {
+      pushRange( candidate.left, m - 1, candidate.minX, candidate.minY, candidate.maxX, y );
+      pushRange( m + 1, candidate.right, candidate.minX, y, candidate.maxX, candidate.maxY );
+    }
+  }
+}
+
+///@endcond
+
 QgsSpatialIndexKDBush::QgsSpatialIndexKDBush( QgsFeatureIterator &fi, QgsFeedback *feedback )
   : d( new QgsSpatialIndexKDBushPrivate( fi, feedback ) )
 {
@@ -32,6 +244,11 @@ QgsSpatialIndexKDBush::QgsSpatialIndexKDBush( const QgsFeatureSource &source, Qg
 {
 }
 
+QgsSpatialIndexKDBush::QgsSpatialIndexKDBush( QgsFeatureIterator &fi, const std::function<bool ( const QgsFeature & )> &callback )
+  : d( new QgsSpatialIndexKDBushPrivate( fi, callback ) )
+{
+}
+
 QgsSpatialIndexKDBush::QgsSpatialIndexKDBush( const QgsSpatialIndexKDBush &other ): d( other.d )
 {
   d->ref.ref();
@@ -58,6 +275,23 @@ QgsSpatialIndexKDBush::~QgsSpatialIndexKDBush()
     delete d;
 }
 
+void QgsSpatialIndexKDBush::visitWithin( const QgsPointXY &point, double radius, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor ) const
+{
+  d->index->visitWithin( point.x(), point.y(), radius, visitor );
+}
+
+QList<QgsSpatialIndexKDBushData> QgsSpatialIndexKDBush::nearestNeighbors( const QgsPointXY &point, int neighbors, double maxDistance ) const
+{
+  QList<QgsSpatialIndexKDBushData> result;
+  d->index->nearest( point.x(), point.y(), neighbors, maxDistance, [&result]( const QgsSpatialIndexKDBushData & p, double ) { result << p; } );
+  return result;
+}
+
+void QgsSpatialIndexKDBush::nearestNeighbors( const QgsPointXY &point, int neighbors, double maxDistance, const std::function<void( const QgsSpatialIndexKDBushData &, double )> &visitor ) const
+{
+  d->index->nearest( point.x(), point.y(), neighbors, maxDistance, visitor );
+}
+
 QList<QgsSpatialIndexKDBushData> QgsSpatialIndexKDBush::within( const QgsPointXY &point, double radius ) const
 {
   QList<QgsSpatialIndexKDBushData> result;
@@ -92,3 +326,11 @@ void QgsSpatialIndexKDBush::intersects( const QgsRectangle &rectangle, const std
                    rectangle.xMaximum(),
                    rectangle.yMaximum(), visitor );
 }
+
+void QgsSpatialIndexKDBush::visitIntersects( const QgsRectangle &rectangle, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor ) const
+{
+  d->index->visitRange( rectangle.xMinimum(),
+                        rectangle.yMinimum(),
+                        rectangle.xMaximum(),
+                        rectangle.yMaximum(), visitor );
+}
@@ -23,6 +23,7 @@ class QgsFeedback;
 class QgsFeatureSource;
 class QgsSpatialIndexKDBushPrivate;
 class QgsRectangle;
+class QgsFeature;
 
 #include "qgis_core.h"
 #include "qgsspatialindexkdbushdata.h"
@@ -44,6 +45,9 @@ class QgsRectangle;
  * - is much faster!
  * - allows direct retrieval of the original feature's points, without requiring additional feature requests
  * - supports true "distance based" searches, i.e. return all points within a radius from a search point
+ * - supports exact k-nearest neighbor searches
+ *
+ * Large point sources are sorted into the index across multiple threads.
  *
  * QgsSpatialIndexKDBush objects are implicitly shared and can be inexpensively copied.
  *
@@ -76,6 +80,24 @@ class CORE_EXPORT QgsSpatialIndexKDBush
      */
     explicit QgsSpatialIndexKDBush( const QgsFeatureSource &source, QgsFeedback *feedback = nullptr );
 
+#ifndef SIP_RUN
+
+    /**
+     * Constructor - creates KDBush index and bulk loads it with features from the iterator.
+     *
+     * This variant allows for a \a callback function to be specified, which is called for each
+     * feature in turn. It allows for the index to be loaded along with other feature based operations
+     * on a single iteration through a feature source. If \a callback returns FALSE, the load and
+     * iteration is canceled.
+     *
+     * Any non-single point features encountered during iteration will be ignored and not included in the index.
+     *
+     * \note Not available in Python bindings
+     * \since QGIS 3.18
+     */
+    QgsSpatialIndexKDBush( QgsFeatureIterator &fi, const std::function< bool( const QgsFeature & ) > &callback );
+#endif
+
     //! Copy constructor
     QgsSpatialIndexKDBush( const QgsSpatialIndexKDBush &other );
 
@@ -110,6 +132,57 @@ class CORE_EXPORT QgsSpatialIndexKDBush
      */
     void within( const QgsPointXY &point, double radius, const std::function<void( QgsSpatialIndexKDBushData )> &visitor ) SIP_SKIP;
 
+    /**
+     * Calls a \a visitor function for all features which fall within the specified \a rectangle.
+     *
+     * Unlike intersects(), the features are passed to the visitor by reference without being copied,
+     * and the search is stopped as soon as the \a visitor returns FALSE.
+     *
+     * \note Not available in Python bindings
+     * \since QGIS 3.18
+     */
+    void visitIntersects( const QgsRectangle &rectangle, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor ) const SIP_SKIP;
+
+    /**
+     * Calls a \a visitor function for all features which are within the given search \a radius
+     * of \a point.
+     *
+     * Unlike within(), the features are passed to the visitor by reference without being copied,
+     * and the search is stopped as soon as the \a visitor returns FALSE.
+     *
+     * \note Not available in Python bindings
+     * \since QGIS 3.18
+     */
+    void visitWithin( const QgsPointXY &point, double radius, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor ) const SIP_SKIP;
+
+    /**
+     * Returns the nearest neighbors to a \a point, sorted by increasing distance. The number of
+     * neighbors returned is specified by the \a neighbors argument.
+     *
+     * If the \a maxDistance argument is greater than 0, then only features within the specified
+     * distance of \a point will be considered.
+     *
+     * If multiple features are equidistant from the search \a point then the number of returned
+     * features may exceed \a neighbors.
+     *
+     * \since QGIS 3.18
+     */
+    QList<QgsSpatialIndexKDBushData> nearestNeighbors( const QgsPointXY &point, int neighbors = 1, double maxDistance = 0 ) const;
+
+    /**
+     * Calls a \a visitor function for the nearest neighbors to a \a point, in order of increasing distance.
+     * The visitor is passed each feature and its distance to \a point.
+     *
+     * The number of neighbors visited is specified by the \a neighbors argument. If multiple
+     * features are equidistant from the search \a point then the number of visited features may
+     * exceed \a neighbors. If the \a maxDistance argument is greater than 0, then only features
+     * within the specified distance of \a point will be considered.
+     *
+     * \note Not available in Python bindings
+     * \since QGIS 3.18
+     */
+    void nearestNeighbors( const QgsPointXY &point, int neighbors, double maxDistance, const std::function<void( const QgsSpatialIndexKDBushData &, double )> &visitor ) const SIP_SKIP;
+
     /**
      * Returns the size of the index, i.e. the number of points contained within the index.
      */
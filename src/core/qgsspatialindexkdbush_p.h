@@ -38,6 +38,7 @@
 #include "qgsfeaturesource.h"
 #include <memory>
 #include <QList>
+#include <functional>
 #include "kdbush.hpp"
 
 
@@ -57,7 +58,12 @@ class PointXYKDBush : public kdbush::KDBush< std::pair<double, double>, QgsSpati
       fillFromIterator( it, feedback );
     }
 
-    void fillFromIterator( QgsFeatureIterator &fi, QgsFeedback *feedback = nullptr )
+    PointXYKDBush( QgsFeatureIterator &fi, const std::function< bool( const QgsFeature & ) > &callback )
+    {
+      fillFromIterator( fi, nullptr, callback );
+    }
+
+    void fillFromIterator( QgsFeatureIterator &fi, QgsFeedback *feedback = nullptr, const std::function< bool( const QgsFeature & ) > &callback = nullptr )
     {
       std::size_t size = 0;
 
@@ -67,6 +73,9 @@ class PointXYKDBush : public kdbush::KDBush< std::pair<double, double>, QgsSpati
         if ( feedback && feedback->isCanceled() )
           return;
 
+        if ( callback && !callback( f ) )
+          return;
+
         if ( !f.hasGeometry() )
           continue;
 
@@ -87,7 +96,7 @@ class PointXYKDBush : public kdbush::KDBush< std::pair<double, double>, QgsSpati
       if ( size == 0 )
         return;
 
-      sortKD( 0, size - 1, 0 );
+      parallelSortKD( 0, size - 1, 0, parallelSortDepth() );
     }
 
     std::size_t size() const
@@ -95,6 +104,40 @@ class PointXYKDBush : public kdbush::KDBush< std::pair<double, double>, QgsSpati
       return points.size();
     }
 
+    /**
+     * Calls \a visitor for all points within a rectangle, stopping as soon as it returns FALSE.
+     * Returns FALSE if the search was stopped.
+     */
+    bool visitRange( double minX, double minY, double maxX, double maxY, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor ) const;
+
+    /**
+     * Calls \a visitor for all points within \a radius of (\a qx, \a qy), stopping as soon as it returns FALSE.
+     * Returns FALSE if the search was stopped.
+     */
+    bool visitWithin( double qx, double qy, double radius, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor ) const;
+
+    /**
+     * Calls \a visitor for the \a maxResults nearest points to (\a qx, \a qy) (plus any ties), by increasing distance.
+     */
+    void nearest( double qx, double qy, int maxResults, double maxDistance, const std::function<void( const QgsSpatialIndexKDBushData &, double )> &visitor ) const;
+
+  private:
+
+    //! Returns the recursion depth down to which sorting is spread over multiple threads
+    static int parallelSortDepth();
+
+    /**
+     * Same as sortKD(), but the two halves of each range are sorted concurrently
+     * until \a depth levels down the tree.
+     */
+    void parallelSortKD( std::size_t left, std::size_t right, std::uint8_t axis, int depth );
+
+    bool visitRange( double minX, double minY, double maxX, double maxY, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor,
+                     std::size_t left, std::size_t right, std::uint8_t axis ) const;
+
+    bool visitWithin( double qx, double qy, double r, const std::function<bool( const QgsSpatialIndexKDBushData & )> &visitor,
+                      std::size_t left, std::size_t right, std::uint8_t axis ) const;
+
 };
 
 class QgsSpatialIndexKDBushPrivate
@@ -109,6 +152,10 @@ class QgsSpatialIndexKDBushPrivate
       : index( qgis::make_unique < PointXYKDBush >( source, feedback ) )
     {}
 
+    QgsSpatialIndexKDBushPrivate( QgsFeatureIterator &fi, const std::function< bool( const QgsFeature & ) > &callback )
+      : index( qgis::make_unique < PointXYKDBush >( fi, callback ) )
+    {}
+
     QAtomicInt ref = 1;
     std::unique_ptr< PointXYKDBush > index;
 };
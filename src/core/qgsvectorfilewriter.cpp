@@ -45,6 +45,8 @@
 #include <QSet>
 #include <QMetaType>
 #include <QMutex>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include <cassert>
 #include <cstdlib> // size_t
@@ -162,11 +164,14 @@ QgsVectorFileWriter *QgsVectorFileWriter::create(
 )
 {
   Q_NOWARN_DEPRECATED_PUSH
-  return new QgsVectorFileWriter( fileName, options.fileEncoding, fields, geometryType, srs,
-                                  options.driverName, options.datasourceOptions, options.layerOptions,
-                                  newFilename, options.symbologyExport, options.fieldValueConverter, options.layerName,
-                                  options.actionOnExistingFile, newLayer, transformContext, sinkFlags, options.fieldNameSource );
+  QgsVectorFileWriter *writer = new QgsVectorFileWriter( fileName, options.fileEncoding, fields, geometryType, srs,
+      options.driverName, options.datasourceOptions, options.layerOptions,
+      newFilename, options.symbologyExport, options.fieldValueConverter, options.layerName,
+      options.actionOnExistingFile, newLayer, transformContext, sinkFlags, options.fieldNameSource );
   Q_NOWARN_DEPRECATED_POP
+  writer->setTransactionSize( options.transactionSize );
+  writer->setParallelGeometryConversionEnabled( options.parallelGeometryConversion );
+  return writer;
 }
 
 bool QgsVectorFileWriter::supportsFeatureStyles( const QString &driverName )
@@ -2306,13 +2311,7 @@ bool QgsVectorFileWriter::addFeature( QgsFeature &feature, QgsFeatureSink::Flags
 
 bool QgsVectorFileWriter::addFeatures( QgsFeatureList &features, QgsFeatureSink::Flags )
 {
-  QgsFeatureList::iterator fIt = features.begin();
-  bool result = true;
-  for ( ; fIt != features.end(); ++fIt )
-  {
-    result = result && addFeatureWithStyle( *fIt, nullptr, QgsUnitTypes::DistanceMeters );
-  }
-  return result;
+  return writeFeatureBatch( features, true ) == 0;
 }
 
 QString QgsVectorFileWriter::lastError() const
@@ -2387,17 +2386,30 @@ bool QgsVectorFileWriter::addFeatureWithStyle( QgsFeature &feature, QgsFeatureRe
 }
 
 gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeature &feature )
+{
+  gdal::ogr_feature_unique_ptr poFeature( OGR_F_Create( OGR_L_GetLayerDefn( mLayer ) ) );
+  if ( !setFeatureAttributes( poFeature.get(), feature ) )
+    return nullptr;
+
+  if ( mWkbType != QgsWkbTypes::NoGeometry && !setFeatureGeometry( poFeature.get(), convertGeometry( feature, mCoordinateTransform.get() ) ) )
+    return nullptr;
+
+  return poFeature;
+}
+
+bool QgsVectorFileWriter::setFeatureAttributes( OGRFeatureH ogrFeature, const QgsFeature &feature )
 {
   QgsLocaleNumC l; // Make sure the decimal delimiter is a dot
   Q_UNUSED( l )
 
-  gdal::ogr_feature_unique_ptr poFeature( OGR_F_Create( OGR_L_GetLayerDefn( mLayer ) ) );
+  // the OGR feature may be reused, so clear the id set by a previous OGR_L_CreateFeature call
+  OGR_F_SetFID( ogrFeature, OGRNullFID );
 
   qint64 fid = FID_TO_NUMBER( feature.id() );
   if ( fid > std::numeric_limits<int>::max() )
   {
     QgsDebugMsg( QStringLiteral( "feature id %1 too large." ).arg( fid ) );
-    OGRErr err = OGR_F_SetFID( poFeature.get(), static_cast<long>( fid ) );
+    OGRErr err = OGR_F_SetFID( ogrFeature, static_cast<long>( fid ) );
     if ( err != OGRERR_NONE )
     {
       QgsDebugMsg( QStringLiteral( "Failed to set feature id to %1: %2 (OGR error: %3)" )
@@ -2426,7 +2438,9 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
 // field to not be present at all in the output, and thus on reading to
 // have disappeared. #16812
 #ifdef OGRNullMarker
-      OGR_F_SetFieldNull( poFeature.get(), ogrField );
+      OGR_F_SetFieldNull( ogrFeature, ogrField );
+#else
+      OGR_F_UnsetField( ogrFeature, ogrField );
 #endif
       continue;
     }
@@ -2446,28 +2460,28 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
                             mFields.at( fldIdx ).name(), errorMessage );
       QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
       mError = ErrFeatureWriteFailed;
-      return nullptr;
+      return false;
     }
 
     switch ( field.type() )
     {
       case QVariant::Int:
-        OGR_F_SetFieldInteger( poFeature.get(), ogrField, attrValue.toInt() );
+        OGR_F_SetFieldInteger( ogrFeature, ogrField, attrValue.toInt() );
         break;
       case QVariant::LongLong:
-        OGR_F_SetFieldInteger64( poFeature.get(), ogrField, attrValue.toLongLong() );
+        OGR_F_SetFieldInteger64( ogrFeature, ogrField, attrValue.toLongLong() );
         break;
       case QVariant::Bool:
-        OGR_F_SetFieldInteger( poFeature.get(), ogrField, attrValue.toInt() );
+        OGR_F_SetFieldInteger( ogrFeature, ogrField, attrValue.toInt() );
         break;
       case QVariant::String:
-        OGR_F_SetFieldString( poFeature.get(), ogrField, mCodec->fromUnicode( attrValue.toString() ).constData() );
+        OGR_F_SetFieldString( ogrFeature, ogrField, mCodec->fromUnicode( attrValue.toString() ).constData() );
         break;
       case QVariant::Double:
-        OGR_F_SetFieldDouble( poFeature.get(), ogrField, attrValue.toDouble() );
+        OGR_F_SetFieldDouble( ogrFeature, ogrField, attrValue.toDouble() );
         break;
       case QVariant::Date:
-        OGR_F_SetFieldDateTime( poFeature.get(), ogrField,
+        OGR_F_SetFieldDateTime( ogrFeature, ogrField,
                                 attrValue.toDate().year(),
                                 attrValue.toDate().month(),
                                 attrValue.toDate().day(),
@@ -2476,11 +2490,11 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
       case QVariant::DateTime:
         if ( mOgrDriverName == QLatin1String( "ESRI Shapefile" ) )
         {
-          OGR_F_SetFieldString( poFeature.get(), ogrField, mCodec->fromUnicode( attrValue.toDateTime().toString( QStringLiteral( "yyyy/MM/dd hh:mm:ss.zzz" ) ) ).constData() );
+          OGR_F_SetFieldString( ogrFeature, ogrField, mCodec->fromUnicode( attrValue.toDateTime().toString( QStringLiteral( "yyyy/MM/dd hh:mm:ss.zzz" ) ) ).constData() );
         }
         else
         {
-          OGR_F_SetFieldDateTime( poFeature.get(), ogrField,
+          OGR_F_SetFieldDateTime( ogrFeature, ogrField,
                                   attrValue.toDateTime().date().year(),
                                   attrValue.toDateTime().date().month(),
                                   attrValue.toDateTime().date().day(),
@@ -2493,11 +2507,11 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
       case QVariant::Time:
         if ( mOgrDriverName == QLatin1String( "ESRI Shapefile" ) )
         {
-          OGR_F_SetFieldString( poFeature.get(), ogrField, mCodec->fromUnicode( attrValue.toString() ).constData() );
+          OGR_F_SetFieldString( ogrFeature, ogrField, mCodec->fromUnicode( attrValue.toString() ).constData() );
         }
         else
         {
-          OGR_F_SetFieldDateTime( poFeature.get(), ogrField,
+          OGR_F_SetFieldDateTime( ogrFeature, ogrField,
                                   0, 0, 0,
                                   attrValue.toTime().hour(),
                                   attrValue.toTime().minute(),
@@ -2509,7 +2523,7 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
       case QVariant::ByteArray:
       {
         const QByteArray ba = attrValue.toByteArray();
-        OGR_F_SetFieldBinary( poFeature.get(), ogrField, ba.size(), const_cast< GByte * >( reinterpret_cast< const GByte * >( ba.data() ) ) );
+        OGR_F_SetFieldBinary( ogrFeature, ogrField, ba.size(), const_cast< GByte * >( reinterpret_cast< const GByte * >( ba.data() ) ) );
         break;
       }
 
@@ -2536,11 +2550,11 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
               }
             }
             lst[count] = nullptr;
-            OGR_F_SetFieldStringList( poFeature.get(), ogrField, lst );
+            OGR_F_SetFieldStringList( ogrFeature, ogrField, lst );
           }
           else
           {
-            OGR_F_SetFieldString( poFeature.get(), ogrField, mCodec->fromUnicode( list.join( ',' ) ).constData() );
+            OGR_F_SetFieldString( ogrFeature, ogrField, mCodec->fromUnicode( list.join( ',' ) ).constData() );
           }
           break;
         }
@@ -2556,130 +2570,195 @@ gdal::ogr_feature_unique_ptr QgsVectorFileWriter::createFeature( const QgsFeatur
                               attrValue.toString() );
         QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
         mError = ErrFeatureWriteFailed;
-        return nullptr;
+        return false;
     }
   }
 
-  if ( mWkbType != QgsWkbTypes::NoGeometry )
+  return true;
+}
+
+QgsVectorFileWriter::OutputGeometry QgsVectorFileWriter::convertGeometry( const QgsFeature &feature, const QgsCoordinateTransform *transform ) const
+{
+  OutputGeometry output;
+  output.ogrType = mWkbType;
+  if ( !feature.hasGeometry() )
+    return output;
+
+  // build geometry from WKB
+  QgsGeometry geom = feature.geometry();
+  if ( transform )
   {
-    if ( feature.hasGeometry() )
+    // output dataset requires coordinate transform
+    try
     {
-      // build geometry from WKB
-      QgsGeometry geom = feature.geometry();
-      if ( mCoordinateTransform )
-      {
-        // output dataset requires coordinate transform
-        try
-        {
-          geom.transform( *mCoordinateTransform );
-        }
-        catch ( QgsCsException & )
-        {
-          QgsLogger::warning( QObject::tr( "Feature geometry failed to transform" ) );
-          return nullptr;
-        }
-      }
+      geom.transform( *transform );
+    }
+    catch ( QgsCsException & )
+    {
+      output.transformFailed = true;
+      return output;
+    }
+  }
 
-      // turn single geometry to multi geometry if needed
-      if ( QgsWkbTypes::flatType( geom.wkbType() ) != QgsWkbTypes::flatType( mWkbType ) &&
-           QgsWkbTypes::flatType( geom.wkbType() ) == QgsWkbTypes::flatType( QgsWkbTypes::singleType( mWkbType ) ) )
+  // turn single geometry to multi geometry if needed
+  if ( QgsWkbTypes::flatType( geom.wkbType() ) != QgsWkbTypes::flatType( mWkbType ) &&
+       QgsWkbTypes::flatType( geom.wkbType() ) == QgsWkbTypes::flatType( QgsWkbTypes::singleType( mWkbType ) ) )
+  {
+    geom.convertToMultiType();
+  }
+
+  if ( geom.wkbType() != mWkbType )
+  {
+    output.ogrType = QgsWkbTypes::Unknown;
+
+    // If requested WKB type is 25D and geometry WKB type is 3D,
+    // we must force the use of 25D.
+    if ( mWkbType >= QgsWkbTypes::Point25D && mWkbType <= QgsWkbTypes::MultiPolygon25D )
+    {
+      //ND: I suspect there's a bug here, in that this is NOT converting the geometry's WKB type,
+      //so the exported WKB has a different type to what the OGRGeometry is expecting.
+      //possibly this is handled already in OGR, but it should be fixed regardless by actually converting
+      //geom to the correct WKB type
+      QgsWkbTypes::Type wkbType = geom.wkbType();
+      if ( wkbType >= QgsWkbTypes::PointZ && wkbType <= QgsWkbTypes::MultiPolygonZ )
       {
-        geom.convertToMultiType();
+        output.ogrType = static_cast<QgsWkbTypes::Type>( geom.wkbType() - QgsWkbTypes::PointZ + QgsWkbTypes::Point25D );
       }
+    }
 
-      if ( geom.wkbType() != mWkbType )
-      {
-        OGRGeometryH mGeom2 = nullptr;
+    // drop m/z value if not present in output wkb type
+    if ( !QgsWkbTypes::hasZ( mWkbType ) && QgsWkbTypes::hasZ( geom.wkbType() ) )
+      geom.get()->dropZValue();
+    if ( !QgsWkbTypes::hasM( mWkbType ) && QgsWkbTypes::hasM( geom.wkbType() ) )
+      geom.get()->dropMValue();
 
-        // If requested WKB type is 25D and geometry WKB type is 3D,
-        // we must force the use of 25D.
-        if ( mWkbType >= QgsWkbTypes::Point25D && mWkbType <= QgsWkbTypes::MultiPolygon25D )
-        {
-          //ND: I suspect there's a bug here, in that this is NOT converting the geometry's WKB type,
-          //so the exported WKB has a different type to what the OGRGeometry is expecting.
-          //possibly this is handled already in OGR, but it should be fixed regardless by actually converting
-          //geom to the correct WKB type
-          QgsWkbTypes::Type wkbType = geom.wkbType();
-          if ( wkbType >= QgsWkbTypes::PointZ && wkbType <= QgsWkbTypes::MultiPolygonZ )
-          {
-            QgsWkbTypes::Type wkbType25d = static_cast<QgsWkbTypes::Type>( geom.wkbType() - QgsWkbTypes::PointZ + QgsWkbTypes::Point25D );
-            mGeom2 = createEmptyGeometry( wkbType25d );
-          }
-        }
+    // add m/z values if not present in the input wkb type -- this is needed for formats which determine
+    // geometry type based on features, e.g. geojson
+    if ( QgsWkbTypes::hasZ( mWkbType ) && !QgsWkbTypes::hasZ( geom.wkbType() ) )
+      geom.get()->addZValue( 0 );
+    if ( QgsWkbTypes::hasM( mWkbType ) && !QgsWkbTypes::hasM( geom.wkbType() ) )
+      geom.get()->addMValue( 0 );
 
-        // drop m/z value if not present in output wkb type
-        if ( !QgsWkbTypes::hasZ( mWkbType ) && QgsWkbTypes::hasZ( geom.wkbType() ) )
-          geom.get()->dropZValue();
-        if ( !QgsWkbTypes::hasM( mWkbType ) && QgsWkbTypes::hasM( geom.wkbType() ) )
-          geom.get()->dropMValue();
+    if ( output.ogrType == QgsWkbTypes::Unknown )
+    {
+      // there's a problem when layer type is set as wkbtype Polygon
+      // although there are also features of type MultiPolygon
+      // (at least in OGR provider)
+      // If the feature's wkbtype is different from the layer's wkbtype,
+      // try to export it too.
+      //
+      // Btw. OGRGeometry must be exactly of the type of the geometry which it will receive
+      // i.e. Polygons can't be imported to OGRMultiPolygon
+      output.ogrType = geom.wkbType();
+    }
 
-        // add m/z values if not present in the input wkb type -- this is needed for formats which determine
-        // geometry type based on features, e.g. geojson
-        if ( QgsWkbTypes::hasZ( mWkbType ) && !QgsWkbTypes::hasZ( geom.wkbType() ) )
-          geom.get()->addZValue( 0 );
-        if ( QgsWkbTypes::hasM( mWkbType ) && !QgsWkbTypes::hasM( geom.wkbType() ) )
-          geom.get()->addMValue( 0 );
+    output.wkb = geom.asWkb();
+  }
+  else // wkb type matches
+  {
+    output.wkb = geom.asWkb( QgsAbstractGeometry::FlagExportTrianglesAsPolygons );
+  }
+  return output;
+}
 
-        if ( !mGeom2 )
-        {
-          // there's a problem when layer type is set as wkbtype Polygon
-          // although there are also features of type MultiPolygon
-          // (at least in OGR provider)
-          // If the feature's wkbtype is different from the layer's wkbtype,
-          // try to export it too.
-          //
-          // Btw. OGRGeometry must be exactly of the type of the geometry which it will receive
-          // i.e. Polygons can't be imported to OGRMultiPolygon
-          mGeom2 = createEmptyGeometry( geom.wkbType() );
-        }
+bool QgsVectorFileWriter::setFeatureGeometry( OGRFeatureH ogrFeature, const QgsVectorFileWriter::OutputGeometry &geometry )
+{
+  if ( geometry.transformFailed )
+  {
+    QgsLogger::warning( QObject::tr( "Feature geometry failed to transform" ) );
+    return false;
+  }
 
-        if ( !mGeom2 )
-        {
-          mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
-                          .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-          mError = ErrFeatureWriteFailed;
-          QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
-          return nullptr;
-        }
+  OGRGeometryH ogrGeom = createEmptyGeometry( geometry.ogrType );
+  if ( !ogrGeom )
+  {
+    mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
+                    .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
+    mError = ErrFeatureWriteFailed;
+    QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+    return false;
+  }
 
-        QByteArray wkb( geom.asWkb() );
-        OGRErr err = OGR_G_ImportFromWkb( mGeom2, reinterpret_cast<unsigned char *>( const_cast<char *>( wkb.constData() ) ), wkb.length() );
-        if ( err != OGRERR_NONE )
-        {
-          mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
-                          .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-          mError = ErrFeatureWriteFailed;
-          QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
-          return nullptr;
-        }
+  if ( !geometry.wkb.isEmpty() )
+  {
+    OGRErr err = OGR_G_ImportFromWkb( ogrGeom, reinterpret_cast<unsigned char *>( const_cast<char *>( geometry.wkb.constData() ) ), geometry.wkb.length() );
+    if ( err != OGRERR_NONE )
+    {
+      OGR_G_DestroyGeometry( ogrGeom );
+      mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
+                      .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
+      mError = ErrFeatureWriteFailed;
+      QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+      return false;
+    }
+  }
 
-        // pass ownership to geometry
-        OGR_F_SetGeometryDirectly( poFeature.get(), mGeom2 );
-      }
-      else // wkb type matches
+  // set geometry (ownership is passed to OGR)
+  OGR_F_SetGeometryDirectly( ogrFeature, ogrGeom );
+  return true;
+}
+
+int QgsVectorFileWriter::writeFeatureBatch( QgsFeatureList &features, bool stopOnError, QStringList *errors )
+{
+  if ( features.isEmpty() )
+    return 0;
+
+  // geometry conversion (reprojection, type fixes, WKB export) does not touch OGR, so it can run on worker threads
+  std::vector< OutputGeometry > geometries( features.size() );
+  if ( mWkbType != QgsWkbTypes::NoGeometry )
+  {
+    if ( mParallelGeometryConversion && features.size() >= PARALLEL_CONVERSION_THRESHOLD )
+    {
+      struct Range
       {
-        QByteArray wkb( geom.asWkb( QgsAbstractGeometry::FlagExportTrianglesAsPolygons ) );
-        OGRGeometryH ogrGeom = createEmptyGeometry( mWkbType );
-        OGRErr err = OGR_G_ImportFromWkb( ogrGeom, reinterpret_cast<unsigned char *>( const_cast<char *>( wkb.constData() ) ), wkb.length() );
-        if ( err != OGRERR_NONE )
-        {
-          mErrorMessage = QObject::tr( "Feature geometry not imported (OGR error: %1)" )
-                          .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
-          mError = ErrFeatureWriteFailed;
-          QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
-          return nullptr;
-        }
+        int begin;
+        int end;
+      };
 
-        // set geometry (ownership is passed to OGR)
-        OGR_F_SetGeometryDirectly( poFeature.get(), ogrGeom );
-      }
+      const int threads = std::max( 1, QThread::idealThreadCount() );
+      const int chunkSize = std::max( 1, ( features.size() + threads - 1 ) / threads );
+      QVector< Range > ranges;
+      for ( int begin = 0; begin < features.size(); begin += chunkSize )
+        ranges.append( Range { begin, std::min( begin + chunkSize, features.size() ) } );
+
+      const QgsCoordinateTransform *transform = mCoordinateTransform.get();
+      QtConcurrent::blockingMap( ranges, [this, &features, &geometries, transform]( const Range & range )
+      {
+        // coordinate transforms keep error state and are not safe to share between threads, each range works with its own copy
+        std::unique_ptr< QgsCoordinateTransform > ct( transform ? new QgsCoordinateTransform( *transform ) : nullptr );
+        for ( int i = range.begin; i < range.end; ++i )
+          geometries[i] = convertGeometry( features.at( i ), ct.get() );
+      } );
     }
     else
     {
-      OGR_F_SetGeometryDirectly( poFeature.get(), createEmptyGeometry( mWkbType ) );
+      for ( int i = 0; i < features.size(); ++i )
+        geometries[i] = convertGeometry( features.at( i ), mCoordinateTransform.get() );
     }
   }
-  return poFeature;
+
+  if ( !mBatchFeature )
+    mBatchFeature.reset( OGR_F_Create( OGR_L_GetLayerDefn( mLayer ) ) );
+
+  int failures = 0;
+  for ( int i = 0; i < features.size(); ++i )
+  {
+    OGRFeatureH ogrFeature = mBatchFeature.get();
+    const bool ok = setFeatureAttributes( ogrFeature, features.at( i ) )
+                    && ( mWkbType == QgsWkbTypes::NoGeometry || setFeatureGeometry( ogrFeature, geometries[i] ) )
+                    && writeFeature( mLayer, ogrFeature );
+    if ( !ok )
+    {
+      ++failures;
+      if ( errors )
+        errors->append( mErrorMessage );
+      if ( stopOnError )
+        break;
+    }
+    // release the converted geometry as soon as possible
+    geometries[i] = OutputGeometry();
+  }
+  return failures;
 }
 
 void QgsVectorFileWriter::resetMap( const QgsAttributeList &attributes )
@@ -2695,6 +2774,9 @@ void QgsVectorFileWriter::resetMap( const QgsAttributeList &attributes )
 
 bool QgsVectorFileWriter::writeFeature( OGRLayerH layer, OGRFeatureH feature )
 {
+  if ( !mWriteTimer.isValid() )
+    mWriteTimer.start();
+
   if ( OGR_L_CreateFeature( layer, feature ) != OGRERR_NONE )
   {
     mErrorMessage = QObject::tr( "Feature creation error (OGR error: %1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
@@ -2702,9 +2784,58 @@ bool QgsVectorFileWriter::writeFeature( OGRLayerH layer, OGRFeatureH feature )
     QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
     return false;
   }
+  ++mWrittenFeatureCount;
+
+  if ( mUsingTransaction && mTransactionSize > 0 && ++mFeaturesInTransaction >= mTransactionSize )
+  {
+    mFeaturesInTransaction = 0;
+    if ( OGRERR_NONE != OGR_L_CommitTransaction( mLayer ) )
+    {
+      mErrorMessage = QObject::tr( "Error while committing transaction (OGR error: %1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
+      mError = ErrFeatureWriteFailed;
+      QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+      mUsingTransaction = false;
+      return false;
+    }
+    mUsingTransaction = OGRERR_NONE == OGR_L_StartTransaction( mLayer );
+  }
   return true;
 }
 
+void QgsVectorFileWriter::setTransactionSize( int size )
+{
+  mTransactionSize = std::max( 0, size );
+}
+
+int QgsVectorFileWriter::transactionSize() const
+{
+  return mTransactionSize;
+}
+
+void QgsVectorFileWriter::setParallelGeometryConversionEnabled( bool enabled )
+{
+  mParallelGeometryConversion = enabled;
+}
+
+bool QgsVectorFileWriter::parallelGeometryConversionEnabled() const
+{
+  return mParallelGeometryConversion;
+}
+
+long long QgsVectorFileWriter::writtenFeatureCount() const
+{
+  return mWrittenFeatureCount;
+}
+
+double QgsVectorFileWriter::writeThroughput() const
+{
+  if ( !mWriteTimer.isValid() )
+    return 0;
+
+  const qint64 elapsed = mWriteTimer.elapsed();
+  return elapsed > 0 ? mWrittenFeatureCount * 1000.0 / elapsed : 0;
+}
+
 QgsVectorFileWriter::~QgsVectorFileWriter()
 {
   if ( mUsingTransaction )
@@ -3094,6 +3225,40 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormatV2( Pre
   // Reset mFields to layer fields, and not just exported fields
   writer->mFields = details.sourceFields;
 
+  // without symbology, features are written in batches through a reused OGR feature
+  const bool writeInBatches = writer->symbologyExport() == NoSymbology;
+  QgsFeatureList batch;
+  bool tooManyErrors = false;
+  auto flushBatch = [&]()
+  {
+    if ( batch.isEmpty() )
+      return;
+
+    QStringList batchErrors;
+    const int failures = writer->writeFeatureBatch( batch, false, &batchErrors );
+    if ( failures > 0 && errorMessage )
+    {
+      if ( errorMessage->isEmpty() )
+      {
+        *errorMessage = QObject::tr( "Feature write errors:" );
+      }
+      for ( const QString &error : qgis::as_const( batchErrors ) )
+        *errorMessage += '\n' + error;
+    }
+    errors += failures;
+    n += batch.size();
+    batch.clear();
+
+    if ( errors > 1000 )
+    {
+      if ( errorMessage )
+      {
+        *errorMessage += QObject::tr( "Stopping after %1 errors" ).arg( errors );
+      }
+      tooManyErrors = true;
+    }
+  };
+
   // write all features
   long saved = 0;
   int initialProgress = lastProgressReport;
@@ -3147,6 +3312,21 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormatV2( Pre
       fet.initAttributes( 0 );
     }
 
+    if ( writeInBatches )
+    {
+      batch << fet;
+      if ( batch.size() >= WRITE_BATCH_SIZE )
+      {
+        flushBatch();
+        if ( tooManyErrors )
+        {
+          n = -1;
+          break;
+        }
+      }
+      continue;
+    }
+
     if ( !writer->addFeatureWithStyle( fet, writer->mRenderer.get(), mapUnits ) )
     {
       WriterError err = writer->hasError();
@@ -3174,6 +3354,15 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormatV2( Pre
     n++;
   }
 
+  if ( !tooManyErrors )
+  {
+    flushBatch();
+    if ( tooManyErrors )
+      n = -1;
+  }
+
+  QgsDebugMsgLevel( QStringLiteral( "Wrote %1 features (%2 features/s)" ).arg( writer->writtenFeatureCount() ).arg( writer->writeThroughput(), 0, 'f', 0 ), 2 );
+
   writer->stopRender();
 
   if ( errors > 0 && errorMessage && n > 0 )
@@ -30,6 +30,7 @@
 #include "qgsgeometryengine.h"
 #include "qgsfeaturesink.h"
 #include <ogr_api.h>
+#include <QElapsedTimer>
 
 class QgsSymbolLayer;
 class QTextCodec;
@@ -531,6 +532,22 @@ class CORE_EXPORT QgsVectorFileWriter : public QgsFeatureSink
          * \since QGIS 3.18
          */
         FieldNameSource fieldNameSource = Original;
+
+        /**
+         * Number of features written per transaction, for formats which support transactions.
+         * If 0, all features are written in a single transaction.
+         *
+         * \since QGIS 3.18
+         */
+        int transactionSize = 0;
+
+        /**
+         * Sets to TRUE to reproject and convert feature geometries on worker threads when
+         * features are written in batches.
+         *
+         * \since QGIS 3.18
+         */
+        bool parallelGeometryConversion = true;
     };
 
 #ifndef SIP_RUN
@@ -826,6 +843,62 @@ class CORE_EXPORT QgsVectorFileWriter : public QgsFeatureSink
      */
     void setSymbologyScale( double scale );
 
+    /**
+     * Sets the number of features written per transaction, for formats which support transactions.
+     * If \a size is 0 (the default), all features are written in a single transaction which is
+     * committed when the writer is destroyed.
+     *
+     * Smaller transactions limit the size of the journal kept by database based formats like GeoPackage.
+     *
+     * \see transactionSize()
+     * \since QGIS 3.18
+     */
+    void setTransactionSize( int size );
+
+    /**
+     * Returns the number of features written per transaction, or 0 if all features are
+     * written in a single transaction.
+     *
+     * \see setTransactionSize()
+     * \since QGIS 3.18
+     */
+    int transactionSize() const;
+
+    /**
+     * Sets whether feature geometries are reprojected and converted on worker threads when
+     * features are written in batches with addFeatures().
+     *
+     * \see parallelGeometryConversionEnabled()
+     * \since QGIS 3.18
+     */
+    void setParallelGeometryConversionEnabled( bool enabled );
+
+    /**
+     * Returns TRUE if feature geometries are reprojected and converted on worker threads when
+     * features are written in batches with addFeatures().
+     *
+     * \see setParallelGeometryConversionEnabled()
+     * \since QGIS 3.18
+     */
+    bool parallelGeometryConversionEnabled() const;
+
+    /**
+     * Returns the number of features successfully written so far.
+     *
+     * \see writeThroughput()
+     * \since QGIS 3.18
+     */
+    long long writtenFeatureCount() const;
+
+    /**
+     * Returns the average number of features written per second, measured since the
+     * first feature was written.
+     *
+     * \see writtenFeatureCount()
+     * \since QGIS 3.18
+     */
+    double writeThroughput() const;
+
     static bool driverMetadata( const QString &driverName, MetaData &driverMetadata );
 
     /**
@@ -1000,10 +1073,50 @@ class CORE_EXPORT QgsVectorFileWriter : public QgsFeatureSink
     bool mUsingTransaction = false;
     bool supportsStringList = false;
 
+    int mTransactionSize = 0;
+    int mFeaturesInTransaction = 0;
+    bool mParallelGeometryConversion = true;
+    long long mWrittenFeatureCount = 0;
+    QElapsedTimer mWriteTimer;
+
+    //! OGR feature reused for all features written by writeFeatureBatch()
+    gdal::ogr_feature_unique_ptr mBatchFeature;
+
+    //! Minimum number of features in a batch for converting their geometries on worker threads
+    static const int PARALLEL_CONVERSION_THRESHOLD = 64;
+
+    //! Number of features written together when exporting a layer without symbology
+    static const int WRITE_BATCH_SIZE = 1000;
+
+    //! Feature geometry converted to the output type, ready to be imported by OGR
+    struct OutputGeometry
+    {
+      //! WKB of the geometry, empty for features without geometry
+      QByteArray wkb;
+      //! Type of the OGR geometry to import the WKB into
+      QgsWkbTypes::Type ogrType = QgsWkbTypes::Unknown;
+      bool transformFailed = false;
+    };
+
     void createSymbolLayerTable( QgsVectorLayer *vl, const QgsCoordinateTransform &ct, OGRDataSourceH ds );
     gdal::ogr_feature_unique_ptr createFeature( const QgsFeature &feature );
+    bool setFeatureAttributes( OGRFeatureH ogrFeature, const QgsFeature &feature );
+
+    /**
+     * Converts the geometry of \a feature to the output type, reprojecting it with \a transform if set.
+     * This is safe to call from worker threads as long as each thread uses its own \a transform.
+     */
+    OutputGeometry convertGeometry( const QgsFeature &feature, const QgsCoordinateTransform *transform ) const;
+    bool setFeatureGeometry( OGRFeatureH ogrFeature, const OutputGeometry &geometry );
     bool writeFeature( OGRLayerH layer, OGRFeatureH feature );
 
+    /**
+     * Writes \a features through a single reused OGR feature, after converting their geometries (in parallel if enabled).
+     * Stops at the first failure if \a stopOnError is TRUE. Returns the number of features which could not be written,
+     * their error messages are appended to \a errors.
+     */
+    int writeFeatureBatch( QgsFeatureList &features, bool stopOnError, QStringList *errors = nullptr );
+
     //! Writes features considering symbol level order
     QgsVectorFileWriter::WriterError exportFeaturesSymbolLevels( const PreparedWriterDetails &details, QgsFeatureIterator &fit, const QgsCoordinateTransform &ct, QString *errorMessage = nullptr );
     double mmScaleFactor( double scale, QgsUnitTypes::RenderUnit symbolUnits, QgsUnitTypes::DistanceUnit mapUnits );
@@ -0,0 +1,334 @@
+/***************************************************************************
+                             qgsgeneralizationpyramid.cpp
+                             ----------------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsgeneralizationpyramid.h"
+#include "qgsfeature.h"
+#include "qgsfeatureiterator.h"
+#include "qgsfeedback.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+#include <QSaveFile>
+#include <QSharedData>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+///@cond PRIVATE
+
+static const char PYRAMID_MAGIC[] = "QGSGPYRD";
+static const quint32 PYRAMID_VERSION = 2;
+
+class QgsGeneralizationPyramidPrivate : public QSharedData
+{
+  public:
+
+    QgsGeneralizationPyramidPrivate() = default;
+    QgsGeneralizationPyramidPrivate( const QgsGeneralizationPyramidPrivate &other ) = default;
+
+    QList< double > mTolerances;
+    QgsMapToPixelSimplifier::SimplifyAlgorithm mAlgorithm = QgsMapToPixelSimplifier::Distance;
+    long mSourceFeatureCount = 0;
+    QDateTime mSourceLastModified;
+
+    //! Reduced geometries for each level, keyed by feature id
+    QVector< QHash< QgsFeatureId, QgsGeometry > > mLevels;
+};
+
+///@endcond
+
+QgsGeneralizationPyramid::QgsGeneralizationPyramid()
+  : d( new QgsGeneralizationPyramidPrivate() )
+{
+}
+
+QgsGeneralizationPyramid::QgsGeneralizationPyramid( const QgsGeneralizationPyramid &other ) = default;
+
+QgsGeneralizationPyramid &QgsGeneralizationPyramid::operator=( const QgsGeneralizationPyramid &other ) = default;
+
+QgsGeneralizationPyramid::~QgsGeneralizationPyramid() = default;
+
+QgsGeneralizationPyramid QgsGeneralizationPyramid::build( QgsFeatureIterator &iterator, const QList<double> &tolerances, QgsMapToPixelSimplifier::SimplifyAlgorithm algorithm, QgsFeedback *feedback )
+{
+  QList< double > sortedTolerances;
+  for ( double tolerance : tolerances )
+  {
+    if ( tolerance > 0 && std::isfinite( tolerance ) && !sortedTolerances.contains( tolerance ) )
+      sortedTolerances << tolerance;
+  }
+  std::sort( sortedTolerances.begin(), sortedTolerances.end() );
+
+  if ( sortedTolerances.isEmpty() )
+    return QgsGeneralizationPyramid();
+
+  std::vector< QgsMapToPixelSimplifier > simplifiers;
+  simplifiers.reserve( sortedTolerances.size() );
+  for ( double tolerance : qgis::as_const( sortedTolerances ) )
+    simplifiers.emplace_back( QgsMapToPixelSimplifier::SimplifyGeometry, tolerance, algorithm );
+
+  QVector< QHash< QgsFeatureId, QgsGeometry > > levels( sortedTolerances.size() );
+  long featureCount = 0;
+
+  QgsFeature feature;
+  while ( iterator.nextFeature( feature ) )
+  {
+    if ( feedback && feedback->isCanceled() )
+      return QgsGeneralizationPyramid();
+
+    featureCount++;
+    if ( !feature.hasGeometry() )
+      continue;
+
+    const QgsGeometry geometry = feature.geometry();
+    const int vertexCount = geometry.constGet()->nCoordinates();
+    for ( int level = 0; level < levels.size(); ++level )
+    {
+      const QgsGeometry simplified = simplifiers[ level ].simplify( geometry );
+      // only keep geometries which are actually reduced, the original geometry is used for all the others
+      if ( simplified.isNull() || simplified.constGet()->nCoordinates() >= vertexCount )
+        continue;
+
+      levels[ level ].insert( feature.id(), simplified );
+    }
+  }
+
+  QgsGeneralizationPyramid pyramid;
+  pyramid.d->mTolerances = sortedTolerances;
+  pyramid.d->mAlgorithm = algorithm;
+  pyramid.d->mSourceFeatureCount = featureCount;
+  pyramid.d->mLevels = levels;
+  return pyramid;
+}
+
+QList<double> QgsGeneralizationPyramid::defaultTolerances( const QgsRectangle &extent, int levels )
+{
+  QList< double > tolerances;
+  if ( extent.isNull() || extent.isEmpty() || !extent.isFinite() || levels < 1 )
+    return tolerances;
+
+  const double coarsest = std::max( extent.width(), extent.height() ) / 1024.0;
+  for ( int level = levels - 1; level >= 0; --level )
+    tolerances << coarsest / std::pow( 4.0, level );
+  return tolerances;
+}
+
+bool QgsGeneralizationPyramid::isValid() const
+{
+  return !d->mTolerances.isEmpty();
+}
+
+int QgsGeneralizationPyramid::levelCount() const
+{
+  return d->mTolerances.size();
+}
+
+QList<double> QgsGeneralizationPyramid::tolerances() const
+{
+  return d->mTolerances;
+}
+
+QgsMapToPixelSimplifier::SimplifyAlgorithm QgsGeneralizationPyramid::algorithm() const
+{
+  return d->mAlgorithm;
+}
+
+long QgsGeneralizationPyramid::sourceFeatureCount() const
+{
+  return d->mSourceFeatureCount;
+}
+
+QDateTime QgsGeneralizationPyramid::sourceLastModified() const
+{
+  return d->mSourceLastModified;
+}
+
+void QgsGeneralizationPyramid::setSourceLastModified( const QDateTime &lastModified )
+{
+  d->mSourceLastModified = lastModified;
+}
+
+int QgsGeneralizationPyramid::levelForTolerance( double tolerance ) const
+{
+  int result = -1;
+  for ( int level = 0; level < d->mTolerances.size(); ++level )
+  {
+    if ( d->mTolerances.at( level ) > tolerance )
+      break;
+    result = level;
+  }
+  return result;
+}
+
+QgsGeometry QgsGeneralizationPyramid::geometry( int level, QgsFeatureId id ) const
+{
+  if ( level < 0 || level >= d->mLevels.size() )
+    return QgsGeometry();
+
+  return d->mLevels.at( level ).value( id );
+}
+
+bool QgsGeneralizationPyramid::applyToFeature( int level, QgsFeature &feature ) const
+{
+  if ( level < 0 || level >= d->mLevels.size() )
+    return false;
+
+  const QHash< QgsFeatureId, QgsGeometry > &geometries = d->mLevels.at( level );
+  const auto it = geometries.constFind( feature.id() );
+  if ( it == geometries.constEnd() )
+    return false;
+
+  feature.setGeometry( it.value() );
+  return true;
+}
+
+bool QgsGeneralizationPyramid::writeToFile( const QString &path, QString *errorMessage ) const
+{
+  // the sidecar is written to a temporary file and only replaces an existing one once complete,
+  // so that an interrupted write never leaves a truncated pyramid behind
+  QSaveFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+  {
+    if ( errorMessage )
+      *errorMessage = QObject::tr( "Could not open %1 for writing: %2" ).arg( path, file.errorString() );
+    return false;
+  }
+
+  QDataStream stream( &file );
+  stream.setByteOrder( QDataStream::LittleEndian );
+  stream.writeRawData( PYRAMID_MAGIC, 8 );
+  stream << PYRAMID_VERSION;
+  stream << static_cast< qint32 >( d->mAlgorithm );
+  stream << static_cast< qint64 >( d->mSourceFeatureCount );
+  stream << static_cast< qint64 >( d->mSourceLastModified.isValid() ? d->mSourceLastModified.toMSecsSinceEpoch() : -1 );
+  stream << static_cast< quint32 >( d->mTolerances.size() );
+  for ( double tolerance : qgis::as_const( d->mTolerances ) )
+    stream << tolerance;
+
+  for ( const QHash< QgsFeatureId, QgsGeometry > &geometries : qgis::as_const( d->mLevels ) )
+  {
+    stream << static_cast< quint64 >( geometries.size() );
+    for ( auto it = geometries.constBegin(); it != geometries.constEnd(); ++it )
+    {
+      stream << static_cast< qint64 >( it.key() );
+      stream << it.value().asWkb();
+    }
+  }
+
+  // the temporary file is discarded if not committed
+  if ( stream.status() != QDataStream::Ok || !file.commit() )
+  {
+    if ( errorMessage )
+      *errorMessage = QObject::tr( "Could not write generalization pyramid to %1: %2" ).arg( path, file.errorString() );
+    return false;
+  }
+  return true;
+}
+
+QgsGeneralizationPyramid QgsGeneralizationPyramid::fromFile( const QString &path, QString *errorMessage )
+{
+  auto setError = [errorMessage]( const QString & message )
+  {
+    if ( errorMessage )
+      *errorMessage = message;
+  };
+
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+  {
+    setError( QObject::tr( "Could not open %1 for reading: %2" ).arg( path, file.errorString() ) );
+    return QgsGeneralizationPyramid();
+  }
+
+  QDataStream stream( &file );
+  stream.setByteOrder( QDataStream::LittleEndian );
+
+  char magic[8];
+  if ( stream.readRawData( magic, 8 ) != 8 || memcmp( magic, PYRAMID_MAGIC, 8 ) != 0 )
+  {
+    setError( QObject::tr( "%1 is not a generalization pyramid file" ).arg( path ) );
+    return QgsGeneralizationPyramid();
+  }
+
+  quint32 version = 0;
+  stream >> version;
+  if ( version != PYRAMID_VERSION )
+  {
+    setError( QObject::tr( "Unsupported generalization pyramid file version %1" ).arg( version ) );
+    return QgsGeneralizationPyramid();
+  }
+
+  qint32 algorithm = 0;
+  qint64 sourceFeatureCount = 0;
+  qint64 sourceLastModified = -1;
+  quint32 levelCount = 0;
+  stream >> algorithm >> sourceFeatureCount >> sourceLastModified >> levelCount;
+  if ( stream.status() != QDataStream::Ok || algorithm < QgsMapToPixelSimplifier::Distance || algorithm > QgsMapToPixelSimplifier::SnappedToGridGlobal
+       || static_cast< qint64 >( levelCount ) * static_cast< qint64 >( sizeof( double ) ) > file.size() )
+  {
+    setError( QObject::tr( "Generalization pyramid file %1 is corrupted" ).arg( path ) );
+    return QgsGeneralizationPyramid();
+  }
+
+  QList< double > tolerances;
+  for ( quint32 i = 0; i < levelCount; ++i )
+  {
+    double tolerance = 0;
+    stream >> tolerance;
+    tolerances << tolerance;
+  }
+
+  QVector< QHash< QgsFeatureId, QgsGeometry > > levels( static_cast< int >( levelCount ) );
+  for ( QHash< QgsFeatureId, QgsGeometry > &geometries : levels )
+  {
+    quint64 count = 0;
+    stream >> count;
+    // each entry takes at least a feature id and a byte array size
+    if ( stream.status() != QDataStream::Ok || count > static_cast< quint64 >( file.size() - file.pos() ) / 12 )
+    {
+      setError( QObject::tr( "Generalization pyramid file %1 is corrupted" ).arg( path ) );
+      return QgsGeneralizationPyramid();
+    }
+
+    geometries.reserve( static_cast< int >( count ) );
+    for ( quint64 i = 0; i < count; ++i )
+    {
+      qint64 id = 0;
+      QByteArray wkb;
+      stream >> id >> wkb;
+      QgsGeometry geometry;
+      geometry.fromWkb( wkb );
+      if ( stream.status() != QDataStream::Ok || geometry.isNull() )
+      {
+        setError( QObject::tr( "Generalization pyramid file %1 is corrupted" ).arg( path ) );
+        return QgsGeneralizationPyramid();
+      }
+      geometries.insert( id, geometry );
+    }
+  }
+
+  QgsGeneralizationPyramid pyramid;
+  pyramid.d->mTolerances = tolerances;
+  pyramid.d->mAlgorithm = static_cast< QgsMapToPixelSimplifier::SimplifyAlgorithm >( algorithm );
+  pyramid.d->mSourceFeatureCount = static_cast< long >( sourceFeatureCount );
+  if ( sourceLastModified >= 0 )
+    pyramid.d->mSourceLastModified = QDateTime::fromMSecsSinceEpoch( sourceLastModified );
+  pyramid.d->mLevels = levels;
+  return pyramid;
+}
@@ -0,0 +1,185 @@
+/***************************************************************************
+                             qgsgeneralizationpyramid.h
+                             --------------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSGENERALIZATIONPYRAMID_H
+#define QGSGENERALIZATIONPYRAMID_H
+
+#include "qgis_core.h"
+#include "qgis_sip.h"
+#include "qgsfeatureid.h"
+#include "qgsgeometry.h"
+#include "qgsmaptopixelgeometrysimplifier.h"
+#include "qgsrectangle.h"
+
+#include <QDateTime>
+#include <QList>
+#include <QSharedDataPointer>
+
+class QgsFeature;
+class QgsFeatureIterator;
+class QgsFeedback;
+class QgsGeneralizationPyramidPrivate;
+
+/**
+ * \class QgsGeneralizationPyramid
+ * \ingroup core
+ *
+ * A set of precomputed, progressively coarser versions of the geometries of a feature source.
+ *
+ * Each level of the pyramid holds the feature geometries simplified with QgsMapToPixelSimplifier
+ * at a fixed tolerance, expressed in the source's map units. Levels are built once, and a renderer
+ * can then pick the coarsest level whose tolerance stays within its current map to pixel tolerance
+ * instead of simplifying the full resolution geometries on every draw.
+ *
+ * Only the geometries which are actually reduced by the simplification are stored, so features
+ * without an entry for a level should be rendered using their original geometry.
+ *
+ * Queries are read only, so a single QgsGeneralizationPyramid object can safely be used across multiple threads.
+ *
+ * QgsGeneralizationPyramid objects are implicitly shared and can be inexpensively copied.
+ *
+ * \see QgsVectorLayer::buildGeneralizationPyramid()
+ * \since QGIS 3.18
+*/
+class CORE_EXPORT QgsGeneralizationPyramid
+{
+  public:
+
+    /**
+     * Constructor for an empty QgsGeneralizationPyramid, without any level.
+     */
+    QgsGeneralizationPyramid();
+
+    //! Copy constructor
+    QgsGeneralizationPyramid( const QgsGeneralizationPyramid &other );
+
+    //! Assignment operator
+    QgsGeneralizationPyramid &operator=( const QgsGeneralizationPyramid &other );
+
+    ~QgsGeneralizationPyramid();
+
+    /**
+     * Builds a pyramid from all the features returned by an iterator.
+     *
+     * One level is created for each of the \a tolerances (in map units of the features), simplifying
+     * geometries with the specified \a algorithm. Each level is computed from the original geometries,
+     * so simplification errors do not accumulate from one level to the next.
+     *
+     * The optional \a feedback object can be used to allow cancellation, in which case an empty
+     * pyramid is returned.
+     */
+    static QgsGeneralizationPyramid build( QgsFeatureIterator &iterator, const QList< double > &tolerances,
+                                           QgsMapToPixelSimplifier::SimplifyAlgorithm algorithm = QgsMapToPixelSimplifier::Distance,
+                                           QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns a sensible set of tolerances for a source covering the specified \a extent.
+     *
+     * The coarsest tolerance roughly matches one pixel when the whole extent is shown on a
+     * 1024 pixel wide map, and every other level is four times finer than the previous one.
+     * The returned list contains \a levels values, sorted from the finest to the coarsest.
+     */
+    static QList< double > defaultTolerances( const QgsRectangle &extent, int levels = 4 );
+
+    /**
+     * Returns TRUE if the pyramid contains at least one level.
+     */
+    bool isValid() const;
+
+    /**
+     * Returns the number of levels in the pyramid.
+     */
+    int levelCount() const;
+
+    /**
+     * Returns the simplification tolerances of the levels, sorted from the finest to the coarsest.
+     */
+    QList< double > tolerances() const;
+
+    /**
+     * Returns the simplification algorithm used to build the levels.
+     */
+    QgsMapToPixelSimplifier::SimplifyAlgorithm algorithm() const;
+
+    /**
+     * Returns the number of features which were read when the pyramid was built.
+     */
+    long sourceFeatureCount() const;
+
+    /**
+     * Returns the last modification time of the source the pyramid was built from, or an invalid
+     * date time if it is not known.
+     *
+     * \see setSourceLastModified()
+     */
+    QDateTime sourceLastModified() const;
+
+    /**
+     * Sets the last modification time of the source the pyramid was built from, which is saved
+     * to the file by writeToFile() so that outdated files can be detected.
+     *
+     * \see sourceLastModified()
+     */
+    void setSourceLastModified( const QDateTime &lastModified );
+
+    /**
+     * Returns the coarsest level whose tolerance does not exceed \a tolerance, or -1
+     * if even the finest level is too coarse.
+     */
+    int levelForTolerance( double tolerance ) const;
+
+    /**
+     * Returns the simplified geometry of the feature with matching \a id at the given \a level.
+     *
+     * A null geometry is returned if the level does not hold a reduced version of the feature's geometry,
+     * in which case the original geometry should be used.
+     */
+    QgsGeometry geometry( int level, QgsFeatureId id ) const;
+
+    /**
+     * Replaces the geometry of a \a feature with its simplified version at the given \a level.
+     *
+     * Returns TRUE if the geometry was replaced, or FALSE if the level does not hold a reduced
+     * version of the feature's geometry, in which case the feature is left untouched.
+     */
+    bool applyToFeature( int level, QgsFeature &feature ) const;
+
+    /**
+     * Writes the pyramid to the file at \a path, e.g. a sidecar file next to the layer's data source.
+     *
+     * Returns FALSE if the file could not be written, in which case \a errorMessage will be set.
+     *
+     * \see fromFile()
+     */
+    bool writeToFile( const QString &path, QString *errorMessage SIP_OUT = nullptr ) const;
+
+    /**
+     * Reads a pyramid previously written with writeToFile() from the file at \a path.
+     *
+     * If the file cannot be read, an empty pyramid is returned and \a errorMessage is set.
+     *
+     * \see writeToFile()
+     */
+    static QgsGeneralizationPyramid fromFile( const QString &path, QString *errorMessage SIP_OUT = nullptr );
+
+  private:
+
+    QSharedDataPointer< QgsGeneralizationPyramidPrivate > d;
+
+};
+
+#endif // QGSGENERALIZATIONPYRAMID_H
@@ -0,0 +1,120 @@
+/***************************************************************************
+                             qgsgeneralizationpyramidtask.cpp
+                             --------------------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsgeneralizationpyramidtask.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectordataprovider.h"
+#include "qgsproviderregistry.h"
+#include "qgsfeedback.h"
+#include "qgsmessagelog.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+
+///@cond PRIVATE
+
+//! Returns the last modification time of a file based layer's data, or an invalid date time for other layers
+static QDateTime _sourceLastModified( const QgsVectorLayer *layer )
+{
+  const QVariantMap parts = QgsProviderRegistry::instance()->decodeUri( layer->providerType(), layer->source() );
+  const QFileInfo fileInfo( parts.value( QStringLiteral( "path" ) ).toString() );
+  if ( !fileInfo.isFile() )
+    return QDateTime();
+
+  // changes to SQLite based formats may only have reached the write-ahead log yet
+  QDateTime lastModified = fileInfo.lastModified();
+  const QFileInfo walFileInfo( fileInfo.filePath() + QStringLiteral( "-wal" ) );
+  if ( walFileInfo.exists() && walFileInfo.lastModified() > lastModified )
+    lastModified = walFileInfo.lastModified();
+  return lastModified;
+}
+
+///@endcond
+
+QgsGeneralizationPyramidTask::QgsGeneralizationPyramidTask( QgsVectorLayer *layer, const QList<double> &tolerances, const QString &sidecarPath )
+  : QgsTask( tr( "Generalizing %1" ).arg( layer->name() ), QgsTask::CanCancel )
+  , mSource( layer->dataProvider()->featureSource() )
+  , mFeedback( new QgsFeedback() )
+  , mTolerances( tolerances.isEmpty() ? QgsGeneralizationPyramid::defaultTolerances( layer->extent() ) : tolerances )
+  , mAlgorithm( static_cast< QgsMapToPixelSimplifier::SimplifyAlgorithm >( layer->simplifyMethod().simplifyAlgorithm() ) )
+  , mSidecarPath( sidecarPath )
+  , mExpectedFeatureCount( layer->dataProvider()->featureCount() )
+  , mSourceLastModified( _sourceLastModified( layer ) )
+{
+  std::sort( mTolerances.begin(), mTolerances.end() );
+}
+
+QgsGeneralizationPyramidTask::~QgsGeneralizationPyramidTask() = default;
+
+void QgsGeneralizationPyramidTask::cancel()
+{
+  mFeedback->cancel();
+  QgsTask::cancel();
+}
+
+QgsGeneralizationPyramid QgsGeneralizationPyramidTask::pyramid() const
+{
+  return mPyramid;
+}
+
+bool QgsGeneralizationPyramidTask::run()
+{
+  // without a modification time, nothing tells whether the sidecar file still matches the source
+  const bool useSidecar = !mSidecarPath.isEmpty() && mSourceLastModified.isValid();
+  if ( useSidecar && QFileInfo::exists( mSidecarPath ) )
+  {
+    QString error;
+    QgsGeneralizationPyramid saved = QgsGeneralizationPyramid::fromFile( mSidecarPath, &error );
+    if ( !saved.isValid() )
+    {
+      QgsMessageLog::logMessage( error, tr( "Rendering" ) );
+    }
+    else
+    {
+      const QList< double > savedTolerances = saved.tolerances();
+      bool matches = saved.algorithm() == mAlgorithm
+                     && savedTolerances.size() == mTolerances.size()
+                     && saved.sourceLastModified() == mSourceLastModified
+                     && ( mExpectedFeatureCount < 0 || saved.sourceFeatureCount() == mExpectedFeatureCount );
+      for ( int i = 0; matches && i < savedTolerances.size(); ++i )
+        matches = qgsDoubleNear( savedTolerances.at( i ), mTolerances.at( i ), mTolerances.at( i ) * 1e-9 );
+
+      if ( matches )
+      {
+        mPyramid = saved;
+        return true;
+      }
+    }
+  }
+
+  QgsFeatureRequest request;
+  request.setNoAttributes();
+  QgsFeatureIterator it = mSource->getFeatures( request );
+  mPyramid = QgsGeneralizationPyramid::build( it, mTolerances, mAlgorithm, mFeedback.get() );
+  if ( mFeedback->isCanceled() || !mPyramid.isValid() )
+    return false;
+
+  mPyramid.setSourceLastModified( mSourceLastModified );
+  if ( useSidecar )
+  {
+    QString error;
+    if ( !mPyramid.writeToFile( mSidecarPath, &error ) )
+      QgsMessageLog::logMessage( error, tr( "Rendering" ) );
+  }
+  return true;
+}
@@ -0,0 +1,88 @@
+/***************************************************************************
+                             qgsgeneralizationpyramidtask.h
+                             ------------------------------
+    begin                : October 2020
+    copyright            : (C) 2020 by agent
+    email                : agent at local
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSGENERALIZATIONPYRAMIDTASK_H
+#define QGSGENERALIZATIONPYRAMIDTASK_H
+
+#include "qgis_core.h"
+#include "qgsgeneralizationpyramid.h"
+#include "qgstaskmanager.h"
+
+#include <memory>
+
+class QgsAbstractFeatureSource;
+class QgsFeedback;
+class QgsVectorLayer;
+
+/**
+ * \class QgsGeneralizationPyramidTask
+ * \ingroup core
+ *
+ * QgsTask task which builds a QgsGeneralizationPyramid for a vector layer in the background.
+ *
+ * The pyramid is built from the features of the layer's data provider, so uncommitted edits
+ * are ignored.
+ *
+ * If a sidecar file path is set for a file based layer, a pyramid previously saved to that file
+ * is reused when it matches the requested tolerances, the provider's feature count and the last
+ * modification time of the layer's file. Otherwise the pyramid is built from the provider's features
+ * and written to the sidecar file. The sidecar file is not used for other layers.
+ *
+ * You should most likely not use this directly and instead call QgsVectorLayer::buildGeneralizationPyramid().
+ *
+ * \since QGIS 3.18
+ */
+class CORE_EXPORT QgsGeneralizationPyramidTask : public QgsTask
+{
+    Q_OBJECT
+
+  public:
+
+    /**
+     * Constructor for QgsGeneralizationPyramidTask, for the specified \a layer.
+     *
+     * If \a tolerances is empty, QgsGeneralizationPyramid::defaultTolerances() for the layer's extent are used.
+     * The optional \a sidecarPath is the file the pyramid is loaded from and saved to.
+     */
+    QgsGeneralizationPyramidTask( QgsVectorLayer *layer, const QList< double > &tolerances = QList< double >(), const QString &sidecarPath = QString() );
+
+    ~QgsGeneralizationPyramidTask() override;
+
+    void cancel() override;
+
+    /**
+     * Returns the built pyramid. Only valid after the task has completed.
+     */
+    QgsGeneralizationPyramid pyramid() const;
+
+  protected:
+
+    bool run() override;
+
+  private:
+
+    std::unique_ptr< QgsAbstractFeatureSource > mSource;
+    std::unique_ptr< QgsFeedback > mFeedback;
+    QList< double > mTolerances;
+    QgsMapToPixelSimplifier::SimplifyAlgorithm mAlgorithm = QgsMapToPixelSimplifier::Distance;
+    QString mSidecarPath;
+    long mExpectedFeatureCount = -1;
+    QDateTime mSourceLastModified;
+    QgsGeneralizationPyramid mPyramid;
+};
+
+#endif // QGSGENERALIZATIONPYRAMIDTASK_H
@@ -80,6 +80,7 @@
 #include "qgsvectorlayerrenderer.h"
 #include "qgsvectorlayerundocommand.h"
 #include "qgsvectorlayerfeaturecounter.h"
+#include "qgsgeneralizationpyramidtask.h"
 #include "qgspoint.h"
 #include "qgsrenderer.h"
 #include "qgssymbollayer.h"
@@ -205,6 +206,11 @@ QgsVectorLayer::QgsVectorLayer( const QString &vectorLayerPath,
   connect( this, &QgsVectorLayer::dataSourceChanged, this, &QgsVectorLayer::supportsEditingChanged );
   connect( this, &QgsVectorLayer::readOnlyChanged, this, &QgsVectorLayer::supportsEditingChanged );
 
+  connect( this, &QgsVectorLayer::afterCommitChanges, this, &QgsVectorLayer::invalidateGeneralizationPyramid );
+  connect( this, &QgsVectorLayer::afterRollBack, this, &QgsVectorLayer::invalidateGeneralizationPyramid );
+  connect( this, &QgsVectorLayer::subsetStringChanged, this, &QgsVectorLayer::invalidateGeneralizationPyramid );
+  connect( this, &QgsVectorLayer::dataSourceChanged, this, &QgsVectorLayer::invalidateGeneralizationPyramid );
+
   // Default simplify drawing settings
   QgsSettings settings;
   mSimplifyMethod.setSimplifyHints( settings.flagValue( QStringLiteral( "qgis/simplifyDrawingHints" ), mSimplifyMethod.simplifyHints(), QgsSettings::NoSection ) );
@@ -989,6 +995,32 @@ bool QgsVectorLayer::simplifyDrawingCanbeApplied( const QgsRenderContext &render
   return false;
 }
 
+void QgsVectorLayer::setGeneralizationPyramid( const QgsGeneralizationPyramid &pyramid )
+{
+  mGeneralizationPyramid = pyramid;
+}
+
+QgsGeneralizationPyramid QgsVectorLayer::generalizationPyramid() const
+{
+  return mGeneralizationPyramid;
+}
+
+QgsGeneralizationPyramidTask *QgsVectorLayer::buildGeneralizationPyramid( const QList<double> &tolerances, const QString &sidecarPath )
+{
+  // the pyramid would be discarded when the edits are committed or rolled back
+  if ( !isValid() || !mDataProvider || !isSpatial() || mEditBuffer )
+    return nullptr;
+
+  if ( mGeneralizationPyramidTask )
+    mGeneralizationPyramidTask->cancel();
+
+  QgsGeneralizationPyramidTask *task = new QgsGeneralizationPyramidTask( this, tolerances, sidecarPath );
+  connect( task, &QgsTask::taskCompleted, this, &QgsVectorLayer::onGeneralizationPyramidBuilt );
+  mGeneralizationPyramidTask = task;
+  QgsApplication::taskManager()->addTask( task );
+  return task;
+}
+
 QgsConditionalLayerStyles *QgsVectorLayer::conditionalStyles() const
 {
   return mConditionalStyles;
@@ -1842,6 +1874,7 @@ bool QgsVectorLayer::setDataProvider( QString const &provider, const QgsDataProv
 
   connect( mDataProvider, &QgsVectorDataProvider::dataChanged, this, &QgsVectorLayer::emitDataChanged );
   connect( mDataProvider, &QgsVectorDataProvider::dataChanged, this, &QgsVectorLayer::removeSelection );
+  connect( mDataProvider, &QgsVectorDataProvider::dataChanged, this, &QgsVectorLayer::invalidateGeneralizationPyramid );
 
   return true;
 } // QgsVectorLayer:: setDataProvider
@@ -5413,6 +5446,27 @@ void QgsVectorLayer::onAfterCommitChangesDependency()
   reload();
 }
 
+void QgsVectorLayer::onGeneralizationPyramidBuilt()
+{
+  QgsGeneralizationPyramidTask *task = qobject_cast< QgsGeneralizationPyramidTask * >( sender() );
+  // ignore results from builds which were superseded or invalidated in the meantime
+  if ( !task || task != mGeneralizationPyramidTask )
+    return;
+
+  mGeneralizationPyramid = task->pyramid();
+  mGeneralizationPyramidTask = nullptr;
+}
+
+void QgsVectorLayer::invalidateGeneralizationPyramid()
+{
+  mGeneralizationPyramid = QgsGeneralizationPyramid();
+  if ( mGeneralizationPyramidTask )
+  {
+    mGeneralizationPyramidTask->cancel();
+    mGeneralizationPyramidTask = nullptr;
+  }
+}
+
 bool QgsVectorLayer::setDependencies( const QSet<QgsMapLayerDependency> &oDeps )
 {
   QSet<QgsMapLayerDependency> deps;
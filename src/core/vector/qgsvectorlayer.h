@@ -26,6 +26,7 @@
 #include <QStringList>
 #include <QFont>
 #include <QMutex>
+#include <QPointer>
 
 #include "qgis.h"
 #include "qgsmaplayer.h"
@@ -43,6 +44,7 @@
 #include "qgsexpressioncontextgenerator.h"
 #include "qgsexpressioncontextscopegenerator.h"
 #include "qgsexpressioncontext.h"
+#include "qgsgeneralizationpyramid.h"
 
 class QPainter;
 class QImage;
@@ -81,6 +83,7 @@ class QgsGeometryOptions;
 class QgsStyleEntityVisitorInterface;
 class QgsVectorLayerTemporalProperties;
 class QgsFeatureRendererGenerator;
+class QgsGeneralizationPyramidTask;
 
 typedef QList<int> QgsAttributeList;
 typedef QSet<int> QgsAttributeIds;
@@ -2292,6 +2295,49 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer, public QgsExpressionConte
      */
     bool simplifyDrawingCanbeApplied( const QgsRenderContext &renderContext, QgsVectorSimplifyMethod::SimplifyHint simplifyHint ) const;
 
+    /**
+     * Sets the generalization \a pyramid used when rendering the layer with geometry simplification.
+     *
+     * When the layer is rendered with simplification enabled, the coarsest pyramid level whose tolerance
+     * stays within the current map to pixel tolerance is drawn instead of the full resolution geometries.
+     * The pyramid is not used while the layer is in editing mode, and it is discarded when edits are
+     * committed or rolled back or the layer's subset string, data source or provider data changes.
+     *
+     * Set an empty QgsGeneralizationPyramid to disable the use of precomputed geometries.
+     *
+     * \see generalizationPyramid()
+     * \see buildGeneralizationPyramid()
+     * \since QGIS 3.18
+     */
+    void setGeneralizationPyramid( const QgsGeneralizationPyramid &pyramid );
+
+    /**
+     * Returns the generalization pyramid used when rendering the layer with geometry simplification.
+     *
+     * \see setGeneralizationPyramid()
+     * \see buildGeneralizationPyramid()
+     * \since QGIS 3.18
+     */
+    QgsGeneralizationPyramid generalizationPyramid() const;
+
+    /**
+     * Starts building a generalization pyramid for the layer in a background task, using the layer's
+     * simplification algorithm. Once the task completes, the pyramid is set on the layer.
+     *
+     * If \a tolerances (in layer map units) is empty, QgsGeneralizationPyramid::defaultTolerances() for the layer's
+     * extent are used. For file based layers, the optional \a sidecarPath is a file the pyramid is loaded from,
+     * if it matches the layer's file, and saved to otherwise.
+     *
+     * Any pyramid build already in progress for the layer is canceled.
+     *
+     * Returns the task, or NULLPTR if the layer is not a valid spatial layer or is in editing mode. The task
+     * is owned by the application task manager.
+     *
+     * \see setGeneralizationPyramid()
+     * \since QGIS 3.18
+     */
+    QgsGeneralizationPyramidTask *buildGeneralizationPyramid( const QList< double > &tolerances = QList< double >(), const QString &sidecarPath = QString() );
+
     /**
      * Returns the conditional styles that are set for this layer. Style information is
      * used to render conditional formatting in the attribute table.
@@ -2797,6 +2843,8 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer, public QgsExpressionConte
     void onDirtyTransaction( const QString &sql, const QString &name );
     void emitDataChanged();
     void onAfterCommitChangesDependency();
+    void onGeneralizationPyramidBuilt();
+    void invalidateGeneralizationPyramid();
 
   private:
     void updateDefaultValues( QgsFeatureId fid, QgsFeature feature = QgsFeature() );
@@ -2899,6 +2947,12 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer, public QgsExpressionConte
     //! Simplification object which holds the information about how to simplify the features for fast rendering
     QgsVectorSimplifyMethod mSimplifyMethod;
 
+    //! Precomputed simplified geometries used for rendering
+    QgsGeneralizationPyramid mGeneralizationPyramid;
+
+    //! Task currently building the generalization pyramid, if any
+    QPointer< QgsGeneralizationPyramidTask > mGeneralizationPyramidTask;
+
     //! Labeling configuration
     QgsAbstractVectorLayerLabeling *mLabeling = nullptr;
 
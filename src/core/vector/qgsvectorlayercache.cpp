@@ -21,6 +21,47 @@
 #include "qgsvectorlayerjoininfo.h"
 #include "qgsvectorlayerjoinbuffer.h"
 #include "qgsvectorlayer.h"
+#include "qgsgenericspatialindex.h"
+
+#include <algorithm>
+#include <limits>
+
+//! Maximum number of completed request extents remembered by the cache
+static const int MAX_COMPLETED_EXTENTS = 32;
+
+///@cond PRIVATE
+namespace
+{
+  //! Returns a rough estimate of the memory used by a cached copy of \a feature
+  qint64 estimatedFeatureSize( const QgsFeature &feature )
+  {
+    qint64 size = sizeof( QgsFeature ) + 64; // private data, ref counts and cache bookkeeping
+
+    const QgsAttributes attributes = feature.attributes();
+    size += static_cast< qint64 >( attributes.size() ) * sizeof( QVariant );
+    for ( const QVariant &value : attributes )
+    {
+      switch ( value.type() )
+      {
+        case QVariant::String:
+          size += value.toString().size() * sizeof( QChar );
+          break;
+        case QVariant::ByteArray:
+          size += value.toByteArray().size();
+          break;
+        default:
+          break;
+      }
+    }
+
+    // the in-memory coordinate storage is close to the WKB size
+    if ( feature.hasGeometry() )
+      size += feature.geometry().constGet()->wkbSize();
+
+    return size;
+  }
+}
+///@endcond
 
 QgsVectorLayerCache::QgsVectorLayerCache( QgsVectorLayer *layer, int cacheSize, QObject *parent )
   : QObject( parent )
@@ -48,18 +89,214 @@ QgsVectorLayerCache::~QgsVectorLayerCache()
 {
   qDeleteAll( mCacheIndices );
   mCacheIndices.clear();
+
+  // release the cached features while the spatial index still exists
+  mCache.clear();
 }
 
 void QgsVectorLayerCache::setCacheSize( int cacheSize )
 {
+  if ( mMaxBytes > 0 )
+  {
+    // back to one unit of cost per feature
+    mMaxBytes = 0;
+    mBytesPerCost = 1;
+    mCache.setMaxCost( std::numeric_limits< int >::max() );
+    updateCosts();
+  }
+  mEvictionInProgress = true;
   mCache.setMaxCost( cacheSize );
+  mEvictionInProgress = false;
 }
 
 int QgsVectorLayerCache::cacheSize()
 {
+  if ( mMaxBytes > 0 )
+    return mCache.size();
+
   return mCache.maxCost();
 }
 
+void QgsVectorLayerCache::setCacheSizeInBytes( qint64 bytes )
+{
+  if ( bytes <= 0 )
+  {
+    if ( mMaxBytes > 0 )
+      setCacheSize( mCache.size() );
+    return;
+  }
+
+  mMaxBytes = bytes;
+  mBytesPerCost = 1 + bytes / std::numeric_limits< int >::max();
+  mCache.setMaxCost( std::numeric_limits< int >::max() );
+  updateCosts();
+  mEvictionInProgress = true;
+  mCache.setMaxCost( static_cast< int >( bytes / mBytesPerCost ) );
+  mEvictionInProgress = false;
+}
+
+void QgsVectorLayerCache::setSpatialIndexEnabled( bool enabled )
+{
+  if ( enabled == static_cast< bool >( mSpatialIndex ) )
+    return;
+
+  mCompletedExtents.clear();
+  if ( !enabled )
+  {
+    mSpatialIndex.reset();
+    const QList< QgsFeatureId > ids = mCache.keys();
+    for ( QgsFeatureId id : ids )
+      mCache.object( id )->mIndexed = false;
+    return;
+  }
+
+  mSpatialIndex = qgis::make_unique< QgsGenericSpatialIndex< QgsCachedFeature > >();
+  const QList< QgsFeatureId > ids = mCache.keys();
+  for ( QgsFeatureId id : ids )
+    updateCachedFeature( mCache.object( id ) );
+}
+
+bool QgsVectorLayerCache::spatialIndexEnabled() const
+{
+  return static_cast< bool >( mSpatialIndex );
+}
+
+void QgsVectorLayerCache::resetStatistics()
+{
+  mHitCount = 0;
+  mMissCount = 0;
+  mEvictionCount = 0;
+}
+
+void QgsVectorLayerCache::cacheFeature( QgsFeature &feat )
+{
+  // replace any previous version first, so that it is not counted as an eviction
+  mCache.remove( feat.id() );
+
+  QgsCachedFeature *cachedFeature = new QgsCachedFeature( feat, this );
+  updateCachedFeature( cachedFeature );
+
+  mEvictionInProgress = true;
+  mCache.insert( feat.id(), cachedFeature, cost( cachedFeature ) );
+  mEvictionInProgress = false;
+}
+
+void QgsVectorLayerCache::updateCachedFeature( QgsCachedFeature *cachedFeature )
+{
+  mCachedBytes -= cachedFeature->mBytes;
+  cachedFeature->mBytes = estimatedFeatureSize( *cachedFeature->mFeature );
+  mCachedBytes += cachedFeature->mBytes;
+
+  if ( !mSpatialIndex )
+    return;
+
+  if ( cachedFeature->mIndexed )
+    mSpatialIndex->remove( cachedFeature, cachedFeature->mIndexedBounds );
+
+  cachedFeature->mIndexed = cachedFeature->mFeature->hasGeometry();
+  if ( cachedFeature->mIndexed )
+  {
+    cachedFeature->mIndexedBounds = cachedFeature->mFeature->geometry().boundingBox();
+    mSpatialIndex->insert( cachedFeature, cachedFeature->mIndexedBounds );
+  }
+}
+
+void QgsVectorLayerCache::cachedFeatureDeleted( QgsCachedFeature *cachedFeature )
+{
+  mCachedBytes -= cachedFeature->mBytes;
+  if ( mEvictionInProgress )
+  {
+    // the cache ran out of room
+    ++mEvictionCount;
+    mFullCache = false;
+  }
+
+  if ( mSpatialIndex && cachedFeature->mIndexed )
+  {
+    mSpatialIndex->remove( cachedFeature, cachedFeature->mIndexedBounds );
+
+    // features within these extents are no longer all cached
+    for ( int i = mCompletedExtents.size() - 1; i >= 0; --i )
+    {
+      if ( mCompletedExtents.at( i ).intersects( cachedFeature->mIndexedBounds ) )
+        mCompletedExtents.removeAt( i );
+    }
+  }
+}
+
+void QgsVectorLayerCache::cachedFeatureResized( QgsFeatureId fid, QgsCachedFeature *cachedFeature )
+{
+  updateCachedFeature( cachedFeature );
+  if ( mMaxBytes <= 0 )
+    return;
+
+  // insert the entry back so that the QCache knows its new cost, and evicts other features if needed
+  mCache.take( fid );
+  mEvictionInProgress = true;
+  mCache.insert( fid, cachedFeature, cost( cachedFeature ) );
+  mEvictionInProgress = false;
+}
+
+int QgsVectorLayerCache::cost( const QgsCachedFeature *cachedFeature ) const
+{
+  if ( mMaxBytes <= 0 )
+    return 1;
+
+  return static_cast< int >( std::max( static_cast< qint64 >( 1 ), ( cachedFeature->mBytes + mBytesPerCost - 1 ) / mBytesPerCost ) );
+}
+
+void QgsVectorLayerCache::updateCosts()
+{
+  const QList< QgsFeatureId > ids = mCache.keys();
+  for ( QgsFeatureId id : ids )
+  {
+    // taking an entry out of the cache does not delete it
+    QgsCachedFeature *cachedFeature = mCache.take( id );
+    if ( !cachedFeature )
+      continue;
+
+    mEvictionInProgress = true;
+    mCache.insert( id, cachedFeature, cost( cachedFeature ) );
+    mEvictionInProgress = false;
+  }
+}
+
+void QgsVectorLayerCache::addCompletedExtent( const QgsRectangle &extent )
+{
+  for ( const QgsRectangle &completedExtent : qgis::as_const( mCompletedExtents ) )
+  {
+    if ( completedExtent.contains( extent ) )
+      return;
+  }
+
+  // extents covered by the new one are redundant
+  for ( int i = mCompletedExtents.size() - 1; i >= 0; --i )
+  {
+    if ( extent.contains( mCompletedExtents.at( i ) ) )
+      mCompletedExtents.removeAt( i );
+  }
+
+  // forget the oldest extents, the cached features themselves are kept
+  while ( mCompletedExtents.size() >= MAX_COMPLETED_EXTENTS )
+    mCompletedExtents.removeFirst();
+
+  mCompletedExtents << extent;
+}
+
+QgsFeatureIds QgsVectorLayerCache::cachedFeatureIdsInRectangle( const QgsRectangle &rectangle ) const
+{
+  QgsFeatureIds ids;
+  if ( !mSpatialIndex )
+    return ids;
+
+  mSpatialIndex->intersects( rectangle, [&ids]( QgsCachedFeature * cachedFeature ) -> bool
+  {
+    ids.insert( cachedFeature->mFeature->id() );
+    return true;
+  } );
+  return ids;
+}
+
 void QgsVectorLayerCache::setCacheGeometry( bool cacheGeometry )
 {
   bool shouldCacheGeometry = cacheGeometry && mLayer->isSpatial();
@@ -91,7 +328,9 @@ void QgsVectorLayerCache::setFullCache( bool fullCache )
   if ( mFullCache )
   {
     // Add a little more than necessary...
-    setCacheSize( mLayer->featureCount() + 100 );
+    // A memory budget is kept as is: if the features do not fit, evicting them resets mFullCache
+    if ( mMaxBytes <= 0 )
+      setCacheSize( mLayer->featureCount() + 100 );
 
     // Initialize the cache...
     QgsFeatureIterator it( new QgsCachedFeatureWriterIterator( this, QgsFeatureRequest()
@@ -108,6 +347,10 @@ void QgsVectorLayerCache::setFullCache( bool fullCache )
     {
       ++i;
 
+      // the memory budget is exhausted, there is no point in reading further
+      if ( !mFullCache )
+        break;
+
       if ( t.elapsed() > 1000 )
       {
         bool cancel = false;
@@ -155,17 +398,22 @@ bool QgsVectorLayerCache::featureAtId( QgsFeatureId featureId, QgsFeature &featu
 
   if ( cachedFeature )
   {
+    ++mHitCount;
     feature = QgsFeature( *cachedFeature->feature() );
     featureFound = true;
   }
-  else if ( mLayer->getFeatures( QgsFeatureRequest()
-                                 .setFilterFid( featureId )
-                                 .setSubsetOfAttributes( mCachedAttributes )
-                                 .setFlags( !mCacheGeometry ? QgsFeatureRequest::NoGeometry : QgsFeatureRequest::Flags() ) )
-            .nextFeature( feature ) )
+  else
   {
-    cacheFeature( feature );
-    featureFound = true;
+    ++mMissCount;
+    if ( mLayer->getFeatures( QgsFeatureRequest()
+                              .setFilterFid( featureId )
+                              .setSubsetOfAttributes( mCachedAttributes )
+                              .setFlags( !mCacheGeometry ? QgsFeatureRequest::NoGeometry : QgsFeatureRequest::Flags() ) )
+         .nextFeature( feature ) )
+    {
+      cacheFeature( feature );
+      featureFound = true;
+    }
   }
 
   return featureFound;
@@ -206,6 +454,25 @@ void QgsVectorLayerCache::requestCompleted( const QgsFeatureRequest &featureRequ
   // If a request is too large for the cache don't notify to prevent from indexing incomplete requests
   if ( fids.count() <= mCache.size() )
   {
+    if ( mSpatialIndex && mCacheGeometry && !featureRequest.filterRect().isNull()
+         && featureRequest.filterType() == QgsFeatureRequest::FilterNone
+         && !( featureRequest.flags() & QgsFeatureRequest::ExactIntersect )
+         && featureRequest.limit() < 0 )
+    {
+      // remember the extent if all of its features are still in the cache
+      bool allCached = true;
+      for ( QgsFeatureId fid : fids )
+      {
+        if ( !mCache.contains( fid ) )
+        {
+          allCached = false;
+          break;
+        }
+      }
+      if ( allCached )
+        addCompletedExtent( featureRequest.filterRect() );
+    }
+
     for ( const auto &idx : qgis::as_const( mCacheIndices ) )
     {
       idx->requestCompleted( featureRequest, fids );
@@ -234,6 +501,7 @@ void QgsVectorLayerCache::onAttributeValueChanged( QgsFeatureId fid, int field,
   if ( cachedFeat )
   {
     cachedFeat->mFeature->setAttribute( field, value );
+    cachedFeatureResized( fid, cachedFeat );
   }
 
   emit attributeValueChanged( fid, field, value );
@@ -269,9 +537,13 @@ void QgsVectorLayerCache::featureDeleted( QgsFeatureId fid )
 
 void QgsVectorLayerCache::onFeatureAdded( QgsFeatureId fid )
 {
+  // the new feature may lie within a completed extent
+  mCompletedExtents.clear();
+
   if ( mFullCache )
   {
-    if ( cacheSize() <= mLayer->featureCount() )
+    // with a memory budget, the number of cached features is not a limit
+    if ( mMaxBytes <= 0 && cacheSize() <= mLayer->featureCount() )
     {
       setCacheSize( mLayer->featureCount() + 100 );
     }
@@ -311,6 +583,12 @@ void QgsVectorLayerCache::geometryChanged( QgsFeatureId fid, const QgsGeometry &
   if ( cachedFeat )
   {
     cachedFeat->mFeature->setGeometry( geom );
+    cachedFeatureResized( fid, cachedFeat );
+  }
+  else
+  {
+    // the feature may have moved into a completed extent
+    mCompletedExtents.clear();
   }
 }
 
@@ -323,6 +601,7 @@ void QgsVectorLayerCache::layerDeleted()
 void QgsVectorLayerCache::invalidate()
 {
   mCache.clear();
+  mCompletedExtents.clear();
   mFullCache = false;
   emit invalidated();
 }
@@ -368,6 +647,20 @@ bool QgsVectorLayerCache::canUseCacheForRequest( const QgsFeatureRequest &featur
         it = QgsFeatureIterator( new QgsCachedFeatureIterator( this, featureRequest ) );
         return true;
       }
+
+      // a rectangle within the extent of a completed request
+      if ( !featureRequest.filterRect().isNull() && !mCompletedExtents.isEmpty()
+           && ( !featureRequest.destinationCrs().isValid() || featureRequest.destinationCrs() == sourceCrs() ) )
+      {
+        for ( const QgsRectangle &extent : qgis::as_const( mCompletedExtents ) )
+        {
+          if ( extent.contains( featureRequest.filterRect() ) )
+          {
+            it = QgsFeatureIterator( new QgsCachedFeatureIterator( this, featureRequest ) );
+            return true;
+          }
+        }
+      }
       break;
     }
 
@@ -379,6 +672,7 @@ QgsFeatureIterator QgsVectorLayerCache::getFeatures( const QgsFeatureRequest &fe
 {
   QgsFeatureIterator it;
   bool requiresWriterIt = true; // If a not yet cached, but cacheable request is made, this stays true.
+  bool servedFromCache = false;
 
   if ( checkInformationCovered( featureRequest ) )
   {
@@ -393,6 +687,7 @@ QgsFeatureIterator QgsVectorLayerCache::getFeatures( const QgsFeatureRequest &fe
       // may still be able to satisfy request using cache
       requiresWriterIt = !canUseCacheForRequest( featureRequest, it );
     }
+    servedFromCache = !requiresWriterIt;
   }
   else
   {
@@ -418,6 +713,11 @@ QgsFeatureIterator QgsVectorLayerCache::getFeatures( const QgsFeatureRequest &fe
     it = QgsFeatureIterator( new QgsCachedFeatureWriterIterator( this, myRequest ) );
   }
 
+  if ( servedFromCache )
+    ++mHitCount;
+  else
+    ++mMissCount;
+
   return it;
 }
 
@@ -26,11 +26,15 @@
 #include "qgsfeatureiterator.h"
 
 #include <QCache>
+#include <memory>
 
 class QgsVectorLayer;
 class QgsFeature;
 class QgsCachedFeatureIterator;
 class QgsAbstractCacheIndex;
+#ifndef SIP_RUN
+template <typename T> class QgsGenericSpatialIndex;
+#endif
 
 /**
  * \ingroup core
@@ -40,6 +44,9 @@ class QgsAbstractCacheIndex;
  * The cached features can be indexed by QgsAbstractCacheIndex.
  *
  * Proper indexing for a given use-case may speed up performance substantially.
+ *
+ * The size of the cache is limited either by a number of features (see setCacheSize()) or,
+ * since QGIS 3.18, by an estimated amount of memory (see setCacheSizeInBytes()).
  */
 
 class CORE_EXPORT QgsVectorLayerCache : public QObject
@@ -73,6 +80,7 @@ class CORE_EXPORT QgsVectorLayerCache : public QObject
         {
           // That's the reason we need this wrapper:
           // Inform the cache that this feature has been removed
+          mCache->cachedFeatureDeleted( this );
           mCache->featureRemoved( mFeature->id() );
           delete mFeature;
         }
@@ -83,6 +91,13 @@ class CORE_EXPORT QgsVectorLayerCache : public QObject
         QgsFeature *mFeature = nullptr;
         QgsVectorLayerCache *mCache = nullptr;
 
+        //! Estimated memory used by the feature
+        qint64 mBytes = 0;
+
+        //! TRUE if the feature is stored in the spatial index, under mIndexedBounds
+        bool mIndexed = false;
+        QgsRectangle mIndexedBounds;
+
         friend class QgsVectorLayerCache;
         Q_DISABLE_COPY( QgsCachedFeature )
     };
@@ -95,6 +110,8 @@ class CORE_EXPORT QgsVectorLayerCache : public QObject
      * Sets the maximum number of features to keep in the cache. Some features will be removed from
      * the cache if the number is smaller than the previous size of the cache.
      *
+     * Calling this method replaces any memory budget set with setCacheSizeInBytes().
+     *
      * \param cacheSize indicates the maximum number of features to keep in the cache
      */
     void setCacheSize( int cacheSize );
@@ -104,10 +121,106 @@ class CORE_EXPORT QgsVectorLayerCache : public QObject
      * Returns the maximum number of features this cache will hold.
      * In case full caching is enabled, this number can change, as new features get added.
      *
+     * If the cache is limited by a memory budget (see setCacheSizeInBytes()), the number
+     * of features currently held is returned.
+     *
      * \returns int
      */
     int cacheSize();
 
+    /**
+     * Limits the cache by an estimated amount of memory instead of a number of features.
+     *
+     * The memory used by each feature is estimated from its attributes and geometry, so that
+     * complex geometries take a bigger share of the cache than simple ones. Least recently
+     * used features are removed from the cache when the budget is exceeded. Features cached
+     * without geometry (see setCacheGeometry()) are much cheaper, allowing a lot more of them
+     * to fit in the same budget.
+     *
+     * Setting a budget of 0 restores a limit of cacheSize() features.
+     *
+     * \note The memory budget is kept when full caching is enabled with setFullCache(). If all the features
+     * do not fit in the budget, hasFullCache() becomes FALSE.
+     *
+     * \see cacheSizeInBytes()
+     * \see cachedBytes()
+     * \since QGIS 3.18
+     */
+    void setCacheSizeInBytes( qint64 bytes );
+
+    /**
+     * Returns the memory budget of the cache, in bytes, or 0 if the cache is limited by a number
+     * of features.
+     *
+     * \see setCacheSizeInBytes()
+     * \since QGIS 3.18
+     */
+    qint64 cacheSizeInBytes() const { return mMaxBytes; }
+
+    /**
+     * Returns the estimated memory used by the cached features, in bytes.
+     *
+     * \see setCacheSizeInBytes()
+     * \since QGIS 3.18
+     */
+    qint64 cachedBytes() const { return mCachedBytes; }
+
+    /**
+     * Sets whether the bounding boxes of cached features are kept in a spatial index.
+     *
+     * When enabled, rectangle requests answered from the cache only visit the features
+     * whose bounding box intersects the rectangle, instead of scanning the whole cache. The cache
+     * also remembers the extents of completed rectangle requests, so that later requests
+     * within one of these extents are answered from the cache even without a full cache.
+     *
+     * Only useful when geometries are cached. Disabled by default.
+     *
+     * \see spatialIndexEnabled()
+     * \since QGIS 3.18
+     */
+    void setSpatialIndexEnabled( bool enabled );
+
+    /**
+     * Returns TRUE if the bounding boxes of cached features are kept in a spatial index.
+     *
+     * \see setSpatialIndexEnabled()
+     * \since QGIS 3.18
+     */
+    bool spatialIndexEnabled() const;
+
+    /**
+     * Returns the number of requests (feature requests and featureAtId() calls) answered
+     * from the cache since the cache creation or the last call to resetStatistics().
+     *
+     * \see missCount()
+     * \since QGIS 3.18
+     */
+    qint64 hitCount() const { return mHitCount; }
+
+    /**
+     * Returns the number of requests (feature requests and featureAtId() calls) which had
+     * to be forwarded to the layer since the cache creation or the last call to resetStatistics().
+     *
+     * \see hitCount()
+     * \since QGIS 3.18
+     */
+    qint64 missCount() const { return mMissCount; }
+
+    /**
+     * Returns the number of features removed from the cache to make room for other features
+     * since the cache creation or the last call to resetStatistics().
+     *
+     * \since QGIS 3.18
+     */
+    qint64 evictionCount() const { return mEvictionCount; }
+
+    /**
+     * Resets the hit, miss and eviction counters.
+     *
+     * \since QGIS 3.18
+     */
+    void resetStatistics();
+
     /**
      * Enable or disable the caching of geometries
      *
@@ -389,15 +502,50 @@ class CORE_EXPORT QgsVectorLayerCache : public QObject
 
     void connectJoinedLayers() const;
 
-    inline void cacheFeature( QgsFeature &feat )
-    {
-      QgsCachedFeature *cachedFeature = new QgsCachedFeature( feat, this );
-      mCache.insert( feat.id(), cachedFeature );
-    }
+    void cacheFeature( QgsFeature &feat );
+
+    //! Updates the memory accounting and the spatial index after a cached feature has been modified
+    void updateCachedFeature( QgsCachedFeature *cachedFeature );
+
+    //! Removes a cached feature from the memory accounting and the spatial index
+    void cachedFeatureDeleted( QgsCachedFeature *cachedFeature );
+
+    //! Updates the memory accounting of a cached feature after its size changed, and its cost in the QCache
+    void cachedFeatureResized( QgsFeatureId fid, QgsCachedFeature *cachedFeature );
+
+    //! Returns the cost of a cached feature in the QCache
+    int cost( const QgsCachedFeature *cachedFeature ) const;
+
+    //! Inserts back all cached features, after a change of the cost model
+    void updateCosts();
+
+    //! Remembers that all features within \a extent are cached, keeping a bounded number of extents
+    void addCompletedExtent( const QgsRectangle &extent );
+
+    //! Returns the ids of cached features whose bounding box intersects \a rectangle
+    QgsFeatureIds cachedFeatureIdsInRectangle( const QgsRectangle &rectangle ) const;
 
     QgsVectorLayer *mLayer = nullptr;
     QCache< QgsFeatureId, QgsCachedFeature > mCache;
 
+    //! Maximum memory budget in bytes, or 0 if the cache is limited by a feature count
+    qint64 mMaxBytes = 0;
+
+    //! Number of bytes represented by one unit of cost, so that the budget fits in the int costs of QCache
+    qint64 mBytesPerCost = 1;
+    qint64 mCachedBytes = 0;
+
+    std::unique_ptr< QgsGenericSpatialIndex< QgsCachedFeature > > mSpatialIndex;
+
+    //! Extents (in layer CRS) of completed rectangle requests, for which all features are cached
+    QList< QgsRectangle > mCompletedExtents;
+
+    //! TRUE while the QCache may drop entries to respect its maximum cost
+    bool mEvictionInProgress = false;
+    qint64 mHitCount = 0;
+    qint64 mMissCount = 0;
+    qint64 mEvictionCount = 0;
+
     bool mCacheGeometry = true;
     bool mFullCache = false;
     QList<QgsAbstractCacheIndex *> mCacheIndices;
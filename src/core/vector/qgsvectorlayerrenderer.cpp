@@ -115,6 +115,10 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer *layer, QgsRender
     mSimplifyGeometry = layer->simplifyDrawingCanbeApplied( *renderContext(), QgsVectorSimplifyMethod::GeometrySimplification );
   }
 
+  // precomputed geometries are only valid for the provider's features, not for uncommitted edits
+  if ( mSimplifyGeometry && !layer->editBuffer() )
+    mGeneralizationPyramid = layer->generalizationPyramid();
+
   QgsSettings settings;
   mVertexMarkerOnlyForSelection = settings.value( QStringLiteral( "qgis/digitizing/marker_only_for_selected" ), true ).toBool();
 
@@ -292,6 +296,8 @@ bool QgsVectorLayerRenderer::renderInternal( QgsFeatureRenderer *renderer )
     featureRequest.combineFilterExpression( mTemporalFilter );
   }
 
+  mGeneralizationLevel = -1;
+
   // enable the simplification of the geometries (Using the current map2pixel context) before send it to renderer engine.
   if ( mSimplifyGeometry )
   {
@@ -352,6 +358,10 @@ bool QgsVectorLayerRenderer::renderInternal( QgsFeatureRenderer *renderer )
       QgsVectorSimplifyMethod vectorMethod = mSimplifyMethod;
       vectorMethod.setTolerance( map2pixelTol );
       context.setVectorSimplifyMethod( vectorMethod );
+
+      // draw the coarsest precomputed level which stays within the tolerance, the remaining
+      // simplification then only has to deal with the already reduced geometries
+      mGeneralizationLevel = mGeneralizationPyramid.levelForTolerance( map2pixelTol );
     }
     else
     {
@@ -434,8 +444,17 @@ void QgsVectorLayerRenderer::drawRenderer( QgsFeatureRenderer *renderer, QgsFeat
       bool sel = isMainRenderer && context.showSelection() && mSelectedFeatureIds.contains( fet.id() );
       bool drawMarker = isMainRenderer && ( mDrawVertexMarkers && context.drawEditingInformation() && ( !mVertexMarkerOnlyForSelection || sel ) );
 
-      // render feature
-      bool rendered = renderer->renderFeature( fet, context, -1, sel, drawMarker );
+      // render feature, using its precomputed simplified geometry if available. The original
+      // feature is kept for labeling and diagrams.
+      QgsFeature generalizedFeature;
+      const QgsFeature *renderedFeature = &fet;
+      if ( mGeneralizationLevel >= 0 )
+      {
+        generalizedFeature = fet;
+        if ( mGeneralizationPyramid.applyToFeature( mGeneralizationLevel, generalizedFeature ) )
+          renderedFeature = &generalizedFeature;
+      }
+      bool rendered = renderer->renderFeature( *renderedFeature, context, -1, sel, drawMarker );
 
       // labeling - register feature
       if ( rendered )
@@ -545,7 +564,12 @@ void QgsVectorLayerRenderer::drawRendererLevels( QgsFeatureRenderer *renderer, Q
     {
       features.insert( sym, QList<QgsFeature>() );
     }
-    features[sym].append( fet );
+    // store the precomputed simplified geometry for drawing, if available. The original
+    // feature is kept for labeling and diagrams.
+    QgsFeature renderedFeature( fet );
+    if ( mGeneralizationLevel >= 0 )
+      mGeneralizationPyramid.applyToFeature( mGeneralizationLevel, renderedFeature );
+    features[sym].append( renderedFeature );
 
     // new labeling engine
     if ( isMainRenderer && context.labelingEngine() && ( mLabelProvider || mDiagramProvider ) )
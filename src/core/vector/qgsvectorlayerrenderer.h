@@ -39,6 +39,7 @@ typedef QList<int> QgsAttributeList;
 #include "qgsfields.h"  // QgsFields
 #include "qgsfeatureiterator.h"
 #include "qgsvectorsimplifymethod.h"
+#include "qgsgeneralizationpyramid.h"
 #include "qgsfeedback.h"
 #include "qgsfeatureid.h"
 
@@ -163,6 +164,11 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
     QgsVectorSimplifyMethod mSimplifyMethod;
     bool mSimplifyGeometry;
 
+    //! Precomputed simplified geometries of the layer, if any
+    QgsGeneralizationPyramid mGeneralizationPyramid;
+    //! Pyramid level drawn by the current renderer, or -1 if the original geometries are drawn
+    int mGeneralizationLevel = -1;
+
     QList< QgsMapClippingRegion > mClippingRegions;
     QgsGeometry mClipFilterGeom;
     bool mApplyClipFilter = false;
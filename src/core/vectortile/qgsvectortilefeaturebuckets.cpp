@@ -0,0 +1,132 @@
+/***************************************************************************
+  qgsvectortilefeaturebuckets.cpp
+  --------------------------------------
+  Date                 : October 2020
+  Copyright            : (C) 2020 by agent
+  Email                : agent at local
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsvectortilefeaturebuckets_p.h"
+
+#include "qgsabstractgeometry.h"
+#include "qgsgeometry.h"
+
+#include <QDataStream>
+#include <QDir>
+
+///@cond PRIVATE
+
+//! Rough estimate of the memory used by a feature besides its geometry
+static const int FEATURE_OVERHEAD = 64;
+//! Rough estimate of the memory used by a single attribute
+static const int ATTRIBUTE_SIZE = 16;
+
+QgsVectorTileFeatureBuckets::QgsVectorTileFeatureBuckets( int bucketCount, qint64 memoryLimit )
+  : mBuckets( bucketCount )
+  , mMemoryLimit( memoryLimit )
+{
+}
+
+bool QgsVectorTileFeatureBuckets::addFeature( int bucket, const QgsFeature &feature )
+{
+  mBuckets[ bucket ].features << feature;
+
+  mMemoryUsage += FEATURE_OVERHEAD + ATTRIBUTE_SIZE * feature.attributes().size();
+  if ( feature.hasGeometry() )
+    mMemoryUsage += feature.geometry().constGet()->wkbSize();
+
+  if ( mMemoryUsage > mMemoryLimit )
+    return spill();
+  return true;
+}
+
+QgsFeatureList QgsVectorTileFeatureBuckets::features( int bucket ) const
+{
+  const Bucket &b = mBuckets.at( bucket );
+  if ( b.segments.isEmpty() )
+    return b.features;
+
+  QVector< QByteArray > data;
+  data.reserve( b.segments.size() );
+  {
+    QMutexLocker locker( &mFileMutex );
+    for ( const Segment &segment : b.segments )
+    {
+      if ( !mFile->seek( segment.offset ) )
+        break;
+      data << mFile->read( segment.size );
+    }
+  }
+
+  QgsFeatureList features;
+  for ( const QByteArray &segmentData : qgis::as_const( data ) )
+  {
+    QDataStream stream( segmentData );
+    while ( !stream.atEnd() && stream.status() == QDataStream::Ok )
+    {
+      QgsFeature feature;
+      stream >> feature;
+      features << feature;
+    }
+  }
+  features << b.features;
+  return features;
+}
+
+bool QgsVectorTileFeatureBuckets::spill()
+{
+  if ( !mFile )
+  {
+    mFile = qgis::make_unique< QTemporaryFile >( QDir::temp().filePath( QStringLiteral( "qgis_vectortile_buckets_XXXXXX" ) ) );
+    if ( !mFile->open() )
+    {
+      mErrorMessage = QObject::tr( "Could not create temporary file: %1" ).arg( mFile->errorString() );
+      return false;
+    }
+  }
+
+  if ( !mFile->seek( mFile->size() ) )
+  {
+    mErrorMessage = QObject::tr( "Could not write temporary file %1: %2" ).arg( mFile->fileName(), mFile->errorString() );
+    return false;
+  }
+
+  for ( Bucket &bucket : mBuckets )
+  {
+    if ( bucket.features.isEmpty() )
+      continue;
+
+    QByteArray data;
+    QDataStream stream( &data, QIODevice::WriteOnly );
+    for ( const QgsFeature &feature : qgis::as_const( bucket.features ) )
+      stream << feature;
+
+    Segment segment;
+    segment.offset = mFile->pos();
+    segment.size = data.size();
+    if ( mFile->write( data ) != data.size() )
+    {
+      mErrorMessage = QObject::tr( "Could not write temporary file %1: %2" ).arg( mFile->fileName(), mFile->errorString() );
+      return false;
+    }
+    bucket.segments << segment;
+    bucket.features.clear();
+  }
+
+  mMemoryUsage = 0;
+  if ( !mFile->flush() )
+  {
+    mErrorMessage = QObject::tr( "Could not write temporary file %1: %2" ).arg( mFile->fileName(), mFile->errorString() );
+    return false;
+  }
+  return true;
+}
+
+///@endcond
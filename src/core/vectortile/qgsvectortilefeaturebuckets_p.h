@@ -0,0 +1,114 @@
+/***************************************************************************
+  qgsvectortilefeaturebuckets_p.h
+  --------------------------------------
+  Date                 : October 2020
+  Copyright            : (C) 2020 by agent
+  Email                : agent at local
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSVECTORTILEFEATUREBUCKETS_P_H
+#define QGSVECTORTILEFEATUREBUCKETS_P_H
+
+#define SIP_NO_FILE
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include "qgis_core.h"
+#include "qgsfeature.h"
+
+#include <QMutex>
+#include <QTemporaryFile>
+#include <QVector>
+
+#include <memory>
+
+/**
+ * Buckets of features, filled once and then read by several threads.
+ *
+ * Used by QgsVectorTileWriter to assign the clipped features of the input layers
+ * to tiles in a single pass over each layer. Features are kept in memory until
+ * the estimated size of all the buckets exceeds the memory limit, in which case
+ * the content of the buckets is moved to a temporary file.
+ *
+ * Features must be added from a single thread, and can then be read from any
+ * number of threads concurrently.
+ */
+class CORE_EXPORT QgsVectorTileFeatureBuckets
+{
+  public:
+
+    //! Default memory limit, in bytes
+    static const qint64 DEFAULT_MEMORY_LIMIT = 256 * 1024 * 1024;
+
+    //! Creates \a bucketCount empty buckets
+    explicit QgsVectorTileFeatureBuckets( int bucketCount, qint64 memoryLimit = DEFAULT_MEMORY_LIMIT );
+
+    //! Returns the number of buckets
+    int bucketCount() const { return mBuckets.size(); }
+
+    /**
+     * Adds a feature to a bucket. Returns FALSE if the buckets had to be moved to the
+     * temporary file and this failed, see errorMessage().
+     */
+    bool addFeature( int bucket, const QgsFeature &feature );
+
+    //! Returns all the features of a bucket, in the order they were added
+    QgsFeatureList features( int bucket ) const;
+
+    //! Returns the estimated size of the features kept in memory, in bytes
+    qint64 memoryUsage() const { return mMemoryUsage; }
+
+    //! Returns TRUE if features have been moved to the temporary file
+    bool hasSpilled() const { return static_cast< bool >( mFile ); }
+
+    //! Returns the last error
+    QString errorMessage() const { return mErrorMessage; }
+
+  private:
+
+    //! Features of a bucket written to the temporary file
+    struct Segment
+    {
+      qint64 offset;
+      qint64 size;
+    };
+
+    struct Bucket
+    {
+      QgsFeatureList features;
+      QVector< Segment > segments;
+    };
+
+    //! Moves the features of all buckets to the temporary file
+    bool spill();
+
+    QVector< Bucket > mBuckets;
+    qint64 mMemoryLimit;
+    qint64 mMemoryUsage = 0;
+
+    std::unique_ptr< QTemporaryFile > mFile;
+    //! Serializes reads of the temporary file
+    mutable QMutex mFileMutex;
+
+    QString mErrorMessage;
+};
+
+/// @endcond
+
+#endif // QGSVECTORTILEFEATUREBUCKETS_P_H
@@ -174,8 +174,7 @@ void QgsVectorTileMVTEncoder::addLayer( QgsVectorLayer *layer, QgsFeedback *feed
 
   // add buffer to both filter extent in layer CRS (for feature request) and tile extent in target CRS (for clipping)
   double bufferRatio = static_cast<double>( mBuffer ) / mResolution;
-  QgsRectangle tileExtent = mTileExtent;
-  tileExtent.grow( bufferRatio * mTileExtent.width() );
+  const QgsRectangle tileExtent = tileExtentWithBuffer();
   layerTileExtent.grow( bufferRatio * std::max( layerTileExtent.width(), layerTileExtent.height() ) );
 
   QgsFeatureRequest request;
@@ -190,16 +189,7 @@ void QgsVectorTileMVTEncoder::addLayer( QgsVectorLayer *layer, QgsFeedback *feed
     return;  // nothing to write - do not add the layer at all
   }
 
-  vector_tile::Tile_Layer *tileLayer = tile.add_layers();
-  tileLayer->set_name( layerName.toUtf8() );
-  tileLayer->set_version( 2 );  // 2 means MVT spec version 2.1
-  tileLayer->set_extent( static_cast<::google::protobuf::uint32>( mResolution ) );
-
-  const QgsFields fields = layer->fields();
-  for ( int i = 0; i < fields.count(); ++i )
-  {
-    tileLayer->add_keys( fields[i].name().toUtf8() );
-  }
+  vector_tile::Tile_Layer *tileLayer = addTileLayer( layerName, layer->fields() );
 
   do
   {
@@ -231,6 +221,44 @@ void QgsVectorTileMVTEncoder::addLayer( QgsVectorLayer *layer, QgsFeedback *feed
   mKnownValues.clear();
 }
 
+void QgsVectorTileMVTEncoder::addLayer( const QString &layerName, const QgsFields &fields, const QgsFeatureList &features, QgsFeedback *feedback )
+{
+  if ( features.isEmpty() || ( feedback && feedback->isCanceled() ) )
+    return;
+
+  vector_tile::Tile_Layer *tileLayer = addTileLayer( layerName, fields );
+  for ( const QgsFeature &f : features )
+  {
+    if ( feedback && feedback->isCanceled() )
+      break;
+
+    addFeature( tileLayer, f );
+  }
+
+  mKnownValues.clear();
+}
+
+QgsRectangle QgsVectorTileMVTEncoder::tileExtentWithBuffer() const
+{
+  QgsRectangle extent = mTileExtent;
+  extent.grow( static_cast<double>( mBuffer ) / mResolution * mTileExtent.width() );
+  return extent;
+}
+
+vector_tile::Tile_Layer *QgsVectorTileMVTEncoder::addTileLayer( const QString &layerName, const QgsFields &fields )
+{
+  vector_tile::Tile_Layer *tileLayer = tile.add_layers();
+  tileLayer->set_name( layerName.toUtf8() );
+  tileLayer->set_version( 2 );  // 2 means MVT spec version 2.1
+  tileLayer->set_extent( static_cast<::google::protobuf::uint32>( mResolution ) );
+
+  for ( int i = 0; i < fields.count(); ++i )
+  {
+    tileLayer->add_keys( fields[i].name().toUtf8() );
+  }
+  return tileLayer;
+}
+
 void QgsVectorTileMVTEncoder::addFeature( vector_tile::Tile_Layer *tileLayer, const QgsFeature &f )
 {
   QgsGeometry g = f.geometry();
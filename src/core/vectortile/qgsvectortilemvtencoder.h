@@ -63,10 +63,32 @@ class CORE_EXPORT QgsVectorTileMVTEncoder
      */
     void addLayer( QgsVectorLayer *layer, QgsFeedback *feedback = nullptr, QString filterExpression = QString(), QString layerName = QString() );
 
+    /**
+     * Adds a layer with the given \a features, which must already be reprojected to EPSG:3857
+     * and clipped to tileExtentWithBuffer(). The layer is not added if there are no features.
+     *
+     * This allows features to be fetched, reprojected and clipped once and then shared between
+     * several tiles, e.g. reusing the features of a tile for its child tiles.
+     *
+     * Optional feedback object may be provided to support cancellation.
+     *
+     * \since QGIS 3.18
+     */
+    void addLayer( const QString &layerName, const QgsFields &fields, const QgsFeatureList &features, QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns the extent of the tile grown by the tile buffer, in EPSG:3857. Features
+     * added to the tile are clipped to this extent.
+     *
+     * \since QGIS 3.18
+     */
+    QgsRectangle tileExtentWithBuffer() const;
+
     //! Encodes MVT using data stored previously with addLayer() calls
     QByteArray encode() const;
 
   private:
+    vector_tile::Tile_Layer *addTileLayer( const QString &layerName, const QgsFields &fields );
     void addFeature( vector_tile::Tile_Layer *tileLayer, const QgsFeature &f );
 
   private:
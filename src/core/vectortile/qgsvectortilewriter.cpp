@@ -15,6 +15,7 @@
 
 #include "qgsvectortilewriter.h"
 
+#include "qgsapplication.h"
 #include "qgsdatasourceuri.h"
 #include "qgsfeedback.h"
 #include "qgsjsonutils.h"
@@ -22,6 +23,7 @@
 #include "qgsmbtiles.h"
 #include "qgstiles.h"
 #include "qgsvectorlayer.h"
+#include "qgsvectortilefeaturebuckets_p.h"
 #include "qgsvectortilemvtencoder.h"
 #include "qgsvectortileutils.h"
 
@@ -30,7 +32,383 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
 #include <QUrl>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <cmath>
+
+
+///@cond PRIVATE
+
+//! Input layer settings, prepared in the calling thread so that workers never touch the QgsVectorLayer
+struct QgsVectorTileWriterLayerInfo
+{
+  QString name;
+  QgsFields fields;
+  QString filterExpression;
+  int minZoom = -1;
+  int maxZoom = -1;
+  QgsCoordinateTransform transform;  //!< From layer CRS to EPSG:3857
+  QgsRectangle extent;  //!< In layer CRS
+
+  //! Returns whether the layer gets written to tiles of the given zoom level
+  bool isActive( int zoomLevel ) const
+  {
+    return ( minZoom < 0 || zoomLevel >= minZoom ) && ( maxZoom < 0 || zoomLevel <= maxZoom );
+  }
+};
+
+//! Encoded tile waiting to be written
+struct QgsVectorTileWriterTile
+{
+  QgsTileXYZ tileID;
+  QByteArray data;
+};
+
+//! Tile handed to a worker, optionally with all its descendants up to the max. zoom level
+struct QgsVectorTileWriterWorkItem
+{
+  QgsTileXYZ tileID;
+  bool withChildren;
+};
+
+//! Clips the feature's geometry to the extent, returns FALSE if nothing is left
+static bool clipFeature( QgsFeature &f, const QgsRectangle &extent )
+{
+  const QgsGeometry g = f.geometry();
+  const QgsRectangle bbox = g.boundingBox();
+  if ( extent.contains( bbox ) )
+    return true;
+  if ( !extent.intersects( bbox ) )
+    return false;
+
+  const QgsGeometry clipped = g.clipped( extent );
+  if ( clipped.isEmpty() )
+    return false;
+
+  f.setGeometry( clipped );
+  return true;
+}
+
+/**
+ * State shared between the worker threads encoding tiles and the calling thread,
+ * which is the only one reading the input layers and writing tiles to the destination.
+ *
+ * Tiles up to the split zoom level are distributed among the workers as work items,
+ * each tile of the split zoom level being processed together with all its descendants.
+ * Before encoding starts, each input layer is read once: features are reprojected and
+ * their clipped fragments are assigned to buckets, one per work item and layer.
+ */
+class QgsVectorTileWriterJob
+{
+  public:
+
+    //! Maximum number of encoded tiles waiting to be written, per worker thread
+    static const int MAX_QUEUED_TILES_PER_WORKER = 64;
+
+    QgsVectorTileWriterJob( int minZoomLevel, int maxZoomLevel, const QgsRectangle &outputExtent )
+      : minZoom( minZoomLevel )
+      , maxZoom( maxZoomLevel )
+      , splitZoom( maxZoomLevel )
+    {
+      for ( int zoomLevel = minZoom; zoomLevel <= maxZoom; ++zoomLevel )
+      {
+        tileMatrices.emplace_back( QgsTileMatrix::fromWebMercator( zoomLevel ) );
+        tileRanges << tileMatrices.back().tileRangeFromExtent( outputExtent );
+        const QgsTileXYZ tileID( 0, 0, zoomLevel );
+        tileBuffers << ( QgsVectorTileMVTEncoder( tileID ).tileExtentWithBuffer().width() - tileMatrices.back().tileExtent( tileID ).width() ) / 2;
+      }
+    }
+
+    QVector< QgsVectorTileWriterLayerInfo > layers;
+    const int minZoom;
+    const int maxZoom;
+    int splitZoom;
+    //! Tile matrices, range of tiles to create and tile buffer size for each zoom level (indexed by zoom level - minZoom)
+    std::vector< QgsTileMatrix > tileMatrices;
+    QVector< QgsTileRange > tileRanges;
+    QVector< double > tileBuffers;
+
+    QVector< QgsVectorTileWriterWorkItem > workItems;
+    //! Index of the first work item of each zoom level up to the split zoom level
+    QVector< int > workItemOffsets;
+    std::unique_ptr< QgsVectorTileFeatureBuckets > buckets;
+
+    QAtomicInt nextWorkItem = 0;
+    QAtomicInt canceled = 0;
+
+    QMutex mutex;
+    QWaitCondition tilesAvailable;
+    QWaitCondition spaceAvailable;
+    QQueue< QgsVectorTileWriterTile > queue;
+    int maxQueueSize = MAX_QUEUED_TILES_PER_WORKER;
+    int runningWorkers = 0;
+
+    //! Returns whether the tile is within the output extent
+    bool containsTile( const QgsTileXYZ &tileID ) const
+    {
+      if ( tileID.zoomLevel() < minZoom || tileID.zoomLevel() > maxZoom )
+        return false;
+      const QgsTileRange &range = tileRanges.at( tileID.zoomLevel() - minZoom );
+      return tileID.column() >= range.startColumn() && tileID.column() <= range.endColumn() &&
+             tileID.row() >= range.startRow() && tileID.row() <= range.endRow();
+    }
+
+    //! Returns the extent of the tile grown by the tile buffer, as used by QgsVectorTileMVTEncoder
+    QgsRectangle bufferedTileExtent( const QgsTileXYZ &tileID ) const
+    {
+      QgsRectangle extent = tileMatrices.at( tileID.zoomLevel() - minZoom ).tileExtent( tileID );
+      extent.grow( tileBuffers.at( tileID.zoomLevel() - minZoom ) );
+      return extent;
+    }
+
+    //! Returns whether work items of the zoom level need features of the layer
+    bool workItemNeedsLayer( int zoomLevel, int layerIndex ) const
+    {
+      const QgsVectorTileWriterLayerInfo &layer = layers.at( layerIndex );
+      if ( zoomLevel < splitZoom )
+        return layer.isActive( zoomLevel );
+
+      // work items of the split zoom level also encode all their descendants
+      return ( layer.minZoom < 0 || layer.minZoom <= maxZoom ) && ( layer.maxZoom < 0 || layer.maxZoom >= zoomLevel );
+    }
+
+    //! Returns the bucket of features of a layer for a tile of a work item
+    int bucketIndex( const QgsTileXYZ &tileID, int layerIndex ) const
+    {
+      const QgsTileRange &range = tileRanges.at( tileID.zoomLevel() - minZoom );
+      const int workItemIndex = workItemOffsets.at( tileID.zoomLevel() - minZoom )
+                                + ( tileID.row() - range.startRow() ) * ( range.endColumn() - range.startColumn() + 1 )
+                                + tileID.column() - range.startColumn();
+      return workItemIndex * layers.size() + layerIndex;
+    }
+
+    /**
+     * Reads all the input layers once, assigning clipped features to the buckets of work items.
+     * Progress is reported from 0 to \a progressRange.
+     */
+    bool fillBuckets( const QList< QgsVectorLayer * > &vectorLayers, QgsFeedback *feedback, double progressRange, QString &errorMessage )
+    {
+      buckets = qgis::make_unique< QgsVectorTileFeatureBuckets >( workItems.size() * layers.size() );
+
+      for ( int i = 0; i < layers.size(); ++i )
+      {
+        const QgsVectorTileWriterLayerInfo &layer = layers.at( i );
+        QList< int > zoomLevels;
+        for ( int zoomLevel = minZoom; zoomLevel <= splitZoom; ++zoomLevel )
+        {
+          if ( workItemNeedsLayer( zoomLevel, i ) )
+            zoomLevels << zoomLevel;
+        }
+        if ( zoomLevels.isEmpty() )
+          continue;
+
+        // buffered tiles of the coarsest zoom level cover the tiles of all the others
+        const int coarsestZoom = zoomLevels.first();
+        const QgsTileRange &range = tileRanges.at( coarsestZoom - minZoom );
+        QgsRectangle extent = bufferedTileExtent( QgsTileXYZ( range.startColumn(), range.startRow(), coarsestZoom ) );
+        extent.combineExtentWith( bufferedTileExtent( QgsTileXYZ( range.endColumn(), range.endRow(), coarsestZoom ) ) );
+
+        QgsRectangle layerExtent;
+        try
+        {
+          layerExtent = layer.transform.transformBoundingBox( extent, QgsCoordinateTransform::ReverseTransform );
+        }
+        catch ( const QgsCsException & )
+        {
+          QgsDebugMsg( "Failed to reproject output extent to the layer" );
+          continue;
+        }
+        if ( !layerExtent.intersects( layer.extent ) )
+          continue;  // output is completely outside of the layer's extent
+
+        QgsVectorLayer *vl = vectorLayers.at( i );
+        QgsFeatureRequest request;
+        request.setFilterRect( layerExtent );
+        if ( !layer.filterExpression.isEmpty() )
+          request.setFilterExpression( layer.filterExpression );
+        const long featureCount = vl->featureCount();
+        QgsFeatureIterator fit = vl->getFeatures( request );
+
+        long featuresRead = 0;
+        QgsFeature f;
+        while ( fit.nextFeature( f ) )
+        {
+          if ( feedback && feedback->isCanceled() )
+          {
+            errorMessage = QgsVectorTileWriter::tr( "Operation has been canceled" );
+            return false;
+          }
+          if ( feedback && featureCount > 0 )
+            feedback->setProgress( progressRange * ( i + std::min( 1.0, static_cast< double >( ++featuresRead ) / featureCount ) ) / layers.size() );
+
+          QgsGeometry g = f.geometry();
+          try
+          {
+            g.transform( layer.transform );
+          }
+          catch ( const QgsCsException & )
+          {
+            QgsDebugMsg( "Failed to reproject geometry " + QString::number( f.id() ) );
+            continue;
+          }
+          f.setGeometry( g );
+
+          const QgsRectangle bbox = g.boundingBox();
+          for ( int zoomLevel : qgis::as_const( zoomLevels ) )
+          {
+            const QgsTileMatrix &tileMatrix = tileMatrices.at( zoomLevel - minZoom );
+            const QgsTileRange &tileRange = tileRanges.at( zoomLevel - minZoom );
+            const double buffer = tileBuffers.at( zoomLevel - minZoom );
+            const QPointF topLeft = tileMatrix.mapToTileCoordinates( QgsPointXY( bbox.xMinimum() - buffer, bbox.yMaximum() + buffer ) );
+            const QPointF bottomRight = tileMatrix.mapToTileCoordinates( QgsPointXY( bbox.xMaximum() + buffer, bbox.yMinimum() - buffer ) );
+            const int startColumn = std::max( tileRange.startColumn(), static_cast< int >( std::floor( topLeft.x() ) ) );
+            const int endColumn = std::min( tileRange.endColumn(), static_cast< int >( std::floor( bottomRight.x() ) ) );
+            const int startRow = std::max( tileRange.startRow(), static_cast< int >( std::floor( topLeft.y() ) ) );
+            const int endRow = std::min( tileRange.endRow(), static_cast< int >( std::floor( bottomRight.y() ) ) );
+
+            for ( int row = startRow; row <= endRow; ++row )
+            {
+              for ( int col = startColumn; col <= endColumn; ++col )
+              {
+                const QgsTileXYZ tileID( col, row, zoomLevel );
+                QgsFeature fragment( f );
+                if ( !clipFeature( fragment, bufferedTileExtent( tileID ) ) )
+                  continue;
+
+                if ( !buckets->addFeature( bucketIndex( tileID, i ), fragment ) )
+                {
+                  errorMessage = buckets->errorMessage();
+                  return false;
+                }
+              }
+            }
+          }
+        }
+      }
+      return true;
+    }
+
+    //! Queues an encoded tile for writing, waiting for the writer if the queue is full
+    void pushTile( const QgsTileXYZ &tileID, const QByteArray &data )
+    {
+      QMutexLocker locker( &mutex );
+      while ( queue.size() >= maxQueueSize && !canceled.loadAcquire() )
+        spaceAvailable.wait( &mutex );
+
+      if ( canceled.loadAcquire() )
+        return;
+
+      queue.enqueue( { tileID, data } );
+      tilesAvailable.wakeOne();
+    }
+
+    //! Asks the workers to stop as soon as possible
+    void cancel()
+    {
+      canceled.storeRelease( 1 );
+      QMutexLocker locker( &mutex );
+      spaceAvailable.wakeAll();
+    }
+};
+
+/**
+ * Worker thread encoding tiles from the buckets of features prepared by QgsVectorTileWriterJob::fillBuckets().
+ *
+ * The features of a work item are clipped to each tile, the clipped features of a tile
+ * being reused for its child tiles.
+ */
+class QgsVectorTileWriterWorker : public QThread
+{
+  public:
+    explicit QgsVectorTileWriterWorker( QgsVectorTileWriterJob *job )
+      : mJob( job )
+    {
+    }
+
+    ~QgsVectorTileWriterWorker() override
+    {
+      wait();
+    }
+
+  protected:
+
+    void run() override
+    {
+      while ( !mJob->canceled.loadAcquire() )
+      {
+        const int index = mJob->nextWorkItem.fetchAndAddOrdered( 1 );
+        if ( index >= mJob->workItems.size() )
+          break;
+
+        const QgsVectorTileWriterWorkItem &item = mJob->workItems.at( index );
+        QVector< QgsFeatureList > features( mJob->layers.size() );
+        for ( int i = 0; i < mJob->layers.size(); ++i )
+          features[i] = mJob->buckets->features( index * mJob->layers.size() + i );
+
+        processTile( item.tileID, features, item.withChildren );
+      }
+
+      QMutexLocker locker( &mJob->mutex );
+      mJob->runningWorkers--;
+      mJob->tilesAvailable.wakeOne();
+    }
+
+  private:
+
+    //! Encodes a tile from features of its parent (or of the work item), then recurses into its children if requested
+    void processTile( const QgsTileXYZ &tileID, const QVector< QgsFeatureList > &parentFeatures, bool withChildren )
+    {
+      if ( mJob->canceled.loadAcquire() )
+        return;
+
+      const int zoomLevel = tileID.zoomLevel();
+      QgsVectorTileMVTEncoder encoder( tileID );
+      const QgsRectangle tileExtent = encoder.tileExtentWithBuffer();
+
+      QVector< QgsFeatureList > features( parentFeatures.size() );
+      for ( int i = 0; i < parentFeatures.size(); ++i )
+      {
+        const QgsVectorTileWriterLayerInfo &layer = mJob->layers.at( i );
+        if ( layer.maxZoom >= 0 && zoomLevel > layer.maxZoom )
+          continue;  // not needed by this tile nor its children anymore
+
+        QgsFeatureList &layerFeatures = features[i];
+        for ( QgsFeature f : parentFeatures.at( i ) )
+        {
+          if ( clipFeature( f, tileExtent ) )
+            layerFeatures << f;
+        }
+
+        if ( layer.isActive( zoomLevel ) )
+          encoder.addLayer( layer.name, layer.fields, layerFeatures );
+      }
+
+      // empty tiles are queued too, so that the writer can keep track of progress
+      mJob->pushTile( tileID, encoder.encode() );
+
+      if ( !withChildren || zoomLevel >= mJob->maxZoom )
+        return;
+
+      for ( int row = 2 * tileID.row(); row <= 2 * tileID.row() + 1; ++row )
+      {
+        for ( int col = 2 * tileID.column(); col <= 2 * tileID.column() + 1; ++col )
+        {
+          const QgsTileXYZ childID( col, row, zoomLevel + 1 );
+          if ( mJob->containsTile( childID ) )
+            processTile( childID, features, true );
+        }
+      }
+    }
+
+    QgsVectorTileWriterJob *mJob = nullptr;
+};
+
+///@endcond
 
 
 QgsVectorTileWriter::QgsVectorTileWriter()
@@ -151,66 +529,168 @@ bool QgsVectorTileWriter::writeTiles( QgsFeedback *feedback )
     }
   }
 
-  int tilesCreated = 0;
+  QgsVectorTileWriterJob job( mMinZoom, mMaxZoom, outputExtent );
+  QList< QgsVectorLayer * > vectorLayers;
+  for ( const Layer &layer : qgis::as_const( mLayers ) )
+  {
+    QgsVectorLayer *vl = layer.layer();
+    vectorLayers << vl;
+
+    QgsVectorTileWriterLayerInfo info;
+    info.name = layer.layerName().isEmpty() ? vl->name() : layer.layerName();
+    info.fields = vl->fields();
+    info.filterExpression = layer.filterExpression();
+    info.minZoom = layer.minZoom();
+    info.maxZoom = layer.maxZoom();
+    info.transform = QgsCoordinateTransform( vl->crs(), QgsCoordinateReferenceSystem( "EPSG:3857" ), mTransformContext );
+    info.extent = vl->extent();
+    job.layers << info;
+  }
+
+  int threadCount = QThread::idealThreadCount();
+  if ( QgsApplication::maxThreads() > 0 )
+    threadCount = std::min( threadCount, QgsApplication::maxThreads() );
+  threadCount = std::max( threadCount, 1 );
+
+  // Tiles up to the split zoom level are distributed among the workers, and each tile
+  // of the split zoom level is processed together with all its descendants, so that
+  // its features are clipped progressively for the whole subtree. The split zoom level
+  // is the first one with enough tiles to keep all workers busy.
   for ( int zoomLevel = mMinZoom; zoomLevel <= mMaxZoom; ++zoomLevel )
   {
-    QgsTileMatrix tileMatrix = QgsTileMatrix::fromWebMercator( zoomLevel );
+    const QgsTileRange &tileRange = job.tileRanges.at( zoomLevel - mMinZoom );
+    const int tileCount = ( tileRange.endRow() - tileRange.startRow() + 1 ) *
+                          ( tileRange.endColumn() - tileRange.startColumn() + 1 );
+    if ( tileCount >= 4 * threadCount )
+    {
+      job.splitZoom = zoomLevel;
+      break;
+    }
+  }
 
-    QgsTileRange tileRange = tileMatrix.tileRangeFromExtent( outputExtent );
+  for ( int zoomLevel = mMinZoom; zoomLevel <= job.splitZoom; ++zoomLevel )
+  {
+    const QgsTileRange &tileRange = job.tileRanges.at( zoomLevel - mMinZoom );
+    job.workItemOffsets << job.workItems.size();
     for ( int row = tileRange.startRow(); row <= tileRange.endRow(); ++row )
     {
       for ( int col = tileRange.startColumn(); col <= tileRange.endColumn(); ++col )
       {
-        QgsTileXYZ tileID( col, row, zoomLevel );
-        QgsVectorTileMVTEncoder encoder( tileID );
-        encoder.setTransformContext( mTransformContext );
+        QgsVectorTileWriterWorkItem item;
+        item.tileID = QgsTileXYZ( col, row, zoomLevel );
+        item.withChildren = zoomLevel == job.splitZoom;
+        job.workItems << item;
+      }
+    }
+  }
 
-        for ( const Layer &layer : qgis::as_const( mLayers ) )
-        {
-          if ( ( layer.minZoom() >= 0 && zoomLevel < layer.minZoom() ) ||
-               ( layer.maxZoom() >= 0 && zoomLevel > layer.maxZoom() ) )
-            continue;
+  // features spanning many tiles are read, reprojected and clipped only once
+  // here, instead of being requested again for each tile
+  const double bucketsProgress = 50;
+  if ( !job.fillBuckets( vectorLayers, feedback, bucketsProgress, mErrorMessage ) )
+    return false;
 
-          encoder.addLayer( layer.layer(), feedback, layer.filterExpression(), layer.layerName() );
-        }
+  // this thread is the only one writing to the destination, MBTiles are
+  // written in transactions of several tiles as committing each tile separately is slow
+  const int tilesPerTransaction = 1000;
+  int tilesInTransaction = 0;
+  if ( mbtiles && !mbtiles->beginTransaction() )
+  {
+    mErrorMessage = tr( "Failed to write tiles to MBTiles file: " ) + sourcePath;
+    return false;
+  }
 
-        if ( feedback && feedback->isCanceled() )
-        {
-          mErrorMessage = tr( "Operation has been canceled" );
-          return false;
-        }
+  threadCount = std::min( threadCount, job.workItems.size() );
+  job.maxQueueSize = QgsVectorTileWriterJob::MAX_QUEUED_TILES_PER_WORKER * threadCount;
+  job.runningWorkers = threadCount;
 
-        QByteArray tileData = encoder.encode();
+  std::vector< std::unique_ptr< QgsVectorTileWriterWorker > > workers;
+  for ( int i = 0; i < threadCount; ++i )
+    workers.emplace_back( qgis::make_unique< QgsVectorTileWriterWorker >( &job ) );
+  for ( const std::unique_ptr< QgsVectorTileWriterWorker > &worker : workers )
+    worker->start();
 
-        ++tilesCreated;
-        if ( feedback )
-        {
-          feedback->setProgress( static_cast<double>( tilesCreated ) / tilesToCreate * 100 );
-        }
+  bool result = true;
+  int tilesCreated = 0;
+  while ( result )
+  {
+    if ( feedback && feedback->isCanceled() )
+    {
+      mErrorMessage = tr( "Operation has been canceled" );
+      result = false;
+      break;
+    }
 
-        if ( tileData.isEmpty() )
-        {
-          // skipping empty tile - no need to write it
-          continue;
-        }
+    QQueue< QgsVectorTileWriterTile > tiles;
+    {
+      QMutexLocker locker( &job.mutex );
+      if ( job.queue.isEmpty() && job.runningWorkers > 0 )
+        job.tilesAvailable.wait( &job.mutex, 100 );  // wake up regularly to check for cancellation
 
-        if ( sourceType == QLatin1String( "xyz" ) )
+      if ( job.queue.isEmpty() )
+      {
+        if ( job.runningWorkers == 0 )
+          break;
+        continue;
+      }
+
+      tiles.swap( job.queue );
+      job.spaceAvailable.wakeAll();
+    }
+
+    for ( const QgsVectorTileWriterTile &tile : qgis::as_const( tiles ) )
+    {
+      ++tilesCreated;
+      if ( feedback )
+      {
+        feedback->setProgress( bucketsProgress + static_cast<double>( tilesCreated ) / tilesToCreate * ( 100 - bucketsProgress ) );
+      }
+
+      if ( tile.data.isEmpty() )
+      {
+        // skipping empty tile - no need to write it
+        continue;
+      }
+
+      if ( sourceType == QLatin1String( "xyz" ) )
+      {
+        if ( !writeTileFileXYZ( sourcePath, tile.tileID, QgsTileMatrix::fromWebMercator( tile.tileID.zoomLevel() ), tile.data ) )
         {
-          if ( !writeTileFileXYZ( sourcePath, tileID, tileMatrix, tileData ) )
-            return false;  // error message already set
+          result = false;  // error message already set
+          break;
         }
-        else  // mbtiles
+      }
+      else  // mbtiles
+      {
+        QByteArray gzipTileData;
+        QgsMbTiles::encodeGzip( tile.data, gzipTileData );
+        int rowTMS = pow( 2, tile.tileID.zoomLevel() ) - tile.tileID.row() - 1;
+        mbtiles->setTileData( tile.tileID.zoomLevel(), tile.tileID.column(), rowTMS, gzipTileData );
+
+        if ( ++tilesInTransaction >= tilesPerTransaction )
         {
-          QByteArray gzipTileData;
-          QgsMbTiles::encodeGzip( tileData, gzipTileData );
-          int rowTMS = pow( 2, tileID.zoomLevel() ) - tileID.row() - 1;
-          mbtiles->setTileData( tileID.zoomLevel(), tileID.column(), rowTMS, gzipTileData );
+          if ( !mbtiles->commitTransaction() || !mbtiles->beginTransaction() )
+          {
+            mErrorMessage = tr( "Failed to write tiles to MBTiles file: " ) + sourcePath;
+            result = false;
+            break;
+          }
+          tilesInTransaction = 0;
         }
       }
     }
   }
 
-  return true;
+  job.cancel();
+  workers.clear();  // waits for the threads to finish
+
+  if ( mbtiles && !mbtiles->commitTransaction() && result )
+  {
+    mErrorMessage = tr( "Failed to write tiles to MBTiles file: " ) + sourcePath;
+    result = false;
+  }
+
+  return result;
 }
 
 QgsRectangle QgsVectorTileWriter::fullExtent() const
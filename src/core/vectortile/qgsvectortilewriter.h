@@ -66,6 +66,13 @@ class QgsVectorLayer;
  * in metadata by the client, tile writer also writes "name", "bounds", "minzoom"
  * and "maxzoom".
  *
+ * Since QGIS 3.18, each input layer is read only once: features are reprojected and
+ * their clipped fragments are assigned to buckets of tiles (kept in a temporary file
+ * when they get large), from which tiles are then encoded in parallel by several worker
+ * threads (up to QgsApplication::maxThreads(), if set). Fragments are clipped progressively
+ * from one zoom level to the next, and the thread calling writeTiles() is the only one
+ * writing tiles to the destination.
+ *
  *
  * \since QGIS 3.14
  */
@@ -1197,7 +1197,7 @@ bool QgsDb2Provider::addFeatures( QgsFeatureList &flist, Flags flags )
 
 QgsVectorDataProvider::Capabilities QgsDb2Provider::capabilities() const
 {
-  QgsVectorDataProvider::Capabilities cap = AddFeatures;
+  QgsVectorDataProvider::Capabilities cap = AddFeatures | OrderByCompilation;
   bool hasGeom = false;
   if ( !mGeometryColName.isEmpty() )
   {
@@ -1491,6 +1491,9 @@ bool QgsPostgresProvider::hasSufficientPermsAndCapabilities()
   // supports layer metadata
   mEnabledCapabilities |= QgsVectorDataProvider::ReadLayerMetadata;
 
+  // order by clauses are compiled to SQL
+  mEnabledCapabilities |= QgsVectorDataProvider::OrderByCompilation;
+
   if ( ( mEnabledCapabilities & QgsVectorDataProvider::ChangeGeometries ) &&
        ( mEnabledCapabilities & QgsVectorDataProvider::ChangeAttributeValues ) &&
        mSpatialColType != SctTopoGeometry )
@@ -555,6 +555,8 @@ QgsSpatiaLiteProvider::QgsSpatiaLiteProvider( QString const &uri, const Provider
     mEnabledCapabilities |= QgsVectorDataProvider::CreateAttributeIndex;
     mEnabledCapabilities |= QgsVectorDataProvider::TransactionSupport;
   }
+  // order by clauses are compiled to SQL
+  mEnabledCapabilities |= QgsVectorDataProvider::OrderByCompilation;
 
   if ( lyr )
   {
@@ -14,6 +14,7 @@ email                : hugo dot mercier at oslandia dot com
  *                                                                         *
  ***************************************************************************/
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <cstdint>
@@ -159,6 +160,9 @@ struct VTable
 
     QgsFields fields() const { return mFields; }
 
+    // whether the source is able to sort features on its side
+    bool canCompileOrderBy() const { return mCanCompileOrderBy; }
+
   private:
 
     VTable( const VTable &other ) = delete;
@@ -190,6 +194,8 @@ struct VTable
 
     QgsFields mFields;
 
+    bool mCanCompileOrderBy = false;
+
     void init_()
     {
       mFields = mLayer ? mLayer->fields() : mProvider->fields();
@@ -244,6 +250,9 @@ struct VTable
       mCreationStr = "CREATE TABLE vtable (" + sqlFields.join( QLatin1Char( ',' ) ) + ")";
 
       mCrs = provider->crs().postgisSrid();
+
+      // only consume ORDER BY clauses when the provider sorts on the backend side, SQLite sorts as fast otherwise
+      mCanCompileOrderBy = provider->capabilities() & QgsVectorDataProvider::OrderByCompilation;
     }
 };
 
@@ -282,6 +291,13 @@ struct VTableCursor
     next();
   }
 
+  // no record matches the constraints
+  void clear()
+  {
+    mIterator = QgsFeatureIterator();
+    mEof = true;
+  }
+
   void next()
   {
     if ( !mEof )
@@ -474,100 +490,303 @@ int vtableRename( sqlite3_vtab *vtab, const char *newName )
   return SQLITE_OK;
 }
 
-int vtableBestIndex( sqlite3_vtab *pvtab, sqlite3_index_info *indexInfo )
+/**
+ * Filtering plan chosen by vtableBestIndex and executed by vtableFilter.
+ *
+ * The plan is serialized in the idxStr member of sqlite3_index_info so that
+ * it survives between the planning and the execution of a statement.
+ */
+struct VTableIndexPlan
 {
-  VTable *vtab = reinterpret_cast< VTable * >( pvtab );
-  for ( int i = 0; i < indexInfo->nConstraint; i++ )
+  enum ConstraintType
   {
-    // request for primary key filter with '='
-    if ( ( indexInfo->aConstraint[i].usable ) &&
-         ( vtab->pkColumn() == indexInfo->aConstraint[i].iColumn ) &&
-         ( indexInfo->aConstraint[i].op == SQLITE_INDEX_CONSTRAINT_EQ ) )
+    Fid, // feature id equality, through the primary key
+    FidIn, // list of feature ids, through the primary key
+    Rect, // _search_frame_ equality, used by the RTree filter
+    Equal,
+    GreaterThan,
+    LesserOrEqual,
+    LesserThan,
+    GreaterOrEqual,
+    Like,
+    NotEqual,
+    IsNull,
+    IsNotNull,
+    In,
+  };
+
+  struct Constraint
+  {
+    ConstraintType type;
+    // attribute index, -1 for Fid, FidIn and Rect constraints
+    int column;
+  };
+
+  // constraints to AND together, in the order of their arguments in argv
+  QList<Constraint> constraints;
+
+  // attributes to fetch, all of them when empty and allAttributes is true
+  bool allAttributes = true;
+  QgsAttributeList attributes;
+
+  bool fetchGeometry = true;
+
+  // attribute index and descending flag of each ORDER BY term consumed
+  QList< QPair< int, bool > > orderBy;
+
+  static bool hasArgument( ConstraintType type )
+  {
+    return type != IsNull && type != IsNotNull;
+  }
+
+  QString toString() const
+  {
+    QStringList parts;
+    for ( const Constraint &c : constraints )
+      parts << QStringLiteral( "w%1,%2" ).arg( c.type ).arg( c.column );
+    if ( !allAttributes )
     {
-      indexInfo->aConstraintUsage[i].argvIndex = 1;
-      indexInfo->aConstraintUsage[i].omit = 1;
-      indexInfo->idxNum = 1; // PK filter
-      indexInfo->estimatedCost = 1.0;
-      indexInfo->idxStr = nullptr;
-      indexInfo->needToFreeIdxStr = 0;
-      return SQLITE_OK;
+      QStringList attrs;
+      for ( int attr : attributes )
+        attrs << QString::number( attr );
+      parts << QStringLiteral( "a" ) + attrs.join( QLatin1Char( ',' ) );
     }
+    if ( !fetchGeometry )
+      parts << QStringLiteral( "n" );
+    for ( const QPair< int, bool > &clause : orderBy )
+      parts << QStringLiteral( "o%1,%2" ).arg( clause.first ).arg( clause.second ? 1 : 0 );
+    return parts.join( QLatin1Char( ';' ) );
+  }
 
-    // request for filter with a comparison operator
-    if ( ( indexInfo->aConstraint[i].usable ) &&
-         ( indexInfo->aConstraint[i].iColumn >= 0 ) &&
-         ( indexInfo->aConstraint[i].iColumn < vtab->fields().count() ) &&
-         ( ( indexInfo->aConstraint[i].op == SQLITE_INDEX_CONSTRAINT_EQ ) || // if no PK
-           ( indexInfo->aConstraint[i].op == SQLITE_INDEX_CONSTRAINT_GT ) ||
-           ( indexInfo->aConstraint[i].op == SQLITE_INDEX_CONSTRAINT_LE ) ||
-           ( indexInfo->aConstraint[i].op == SQLITE_INDEX_CONSTRAINT_LT ) ||
-           ( indexInfo->aConstraint[i].op == SQLITE_INDEX_CONSTRAINT_GE )
-#ifdef SQLITE_INDEX_CONSTRAINT_LIKE
-           || ( indexInfo->aConstraint[i].op == SQLITE_INDEX_CONSTRAINT_LIKE )
-#endif
-         ) )
+  static VTableIndexPlan fromString( const QString &str )
+  {
+    VTableIndexPlan plan;
+    const QStringList parts = str.split( QLatin1Char( ';' ) );
+    for ( const QString &part : parts )
     {
-      indexInfo->aConstraintUsage[i].argvIndex = 1;
-      indexInfo->aConstraintUsage[i].omit = 1;
-      indexInfo->idxNum = 3; // expression filter
-      indexInfo->estimatedCost = 2.0; // probably better than no index
+      if ( part.isEmpty() )
+        continue;
 
-      QString expr = QgsExpression::quotedColumnRef( vtab->fields().at( indexInfo->aConstraint[i].iColumn ).name() );
-      switch ( indexInfo->aConstraint[i].op )
+      const QString valuesStr = part.mid( 1 );
+      const QStringList values = valuesStr.isEmpty() ? QStringList() : valuesStr.split( QLatin1Char( ',' ) );
+      switch ( part.at( 0 ).toLatin1() )
       {
-        case SQLITE_INDEX_CONSTRAINT_EQ:
-          expr += QLatin1String( " = " );
-          break;
-        case SQLITE_INDEX_CONSTRAINT_GT:
-          expr += QLatin1String( " > " );
+        case 'w':
+          plan.constraints << Constraint { static_cast< ConstraintType >( values.value( 0 ).toInt() ), values.value( 1 ).toInt() };
           break;
-        case SQLITE_INDEX_CONSTRAINT_LE:
-          expr += QLatin1String( " <= " );
+        case 'a':
+          plan.allAttributes = false;
+          for ( const QString &value : values )
+            plan.attributes << value.toInt();
           break;
-        case SQLITE_INDEX_CONSTRAINT_LT:
-          expr += QLatin1String( " < " );
+        case 'n':
+          plan.fetchGeometry = false;
           break;
-        case SQLITE_INDEX_CONSTRAINT_GE:
-          expr += QLatin1String( " >= " );
+        case 'o':
+          plan.orderBy << qMakePair( values.value( 0 ).toInt(), values.value( 1 ).toInt() != 0 );
           break;
-#ifdef SQLITE_INDEX_CONSTRAINT_LIKE
-        case SQLITE_INDEX_CONSTRAINT_LIKE:
-          expr += QLatin1String( " LIKE " );
-          break;
-#endif
         default:
           break;
       }
+    }
+    return plan;
+  }
+};
 
-      QByteArray ba = expr.toUtf8();
-      char *cp = ( char * )sqlite3_malloc( ba.size() + 1 );
-      memcpy( cp, ba.constData(), ba.size() + 1 );
+/**
+ * Returns the plan constraint type corresponding to a SQLite constraint operator, or
+ * FALSE if the operator cannot be translated into a QGIS expression.
+ */
+bool constraintTypeFromOperator( unsigned char op, VTableIndexPlan::ConstraintType &type )
+{
+  switch ( op )
+  {
+    case SQLITE_INDEX_CONSTRAINT_EQ:
+      type = VTableIndexPlan::Equal;
+      return true;
+    case SQLITE_INDEX_CONSTRAINT_GT:
+      type = VTableIndexPlan::GreaterThan;
+      return true;
+    case SQLITE_INDEX_CONSTRAINT_LE:
+      type = VTableIndexPlan::LesserOrEqual;
+      return true;
+    case SQLITE_INDEX_CONSTRAINT_LT:
+      type = VTableIndexPlan::LesserThan;
+      return true;
+    case SQLITE_INDEX_CONSTRAINT_GE:
+      type = VTableIndexPlan::GreaterOrEqual;
+      return true;
+#ifdef SQLITE_INDEX_CONSTRAINT_LIKE
+    case SQLITE_INDEX_CONSTRAINT_LIKE:
+      type = VTableIndexPlan::Like;
+      return true;
+#endif
+#ifdef SQLITE_INDEX_CONSTRAINT_NE
+    case SQLITE_INDEX_CONSTRAINT_NE:
+      type = VTableIndexPlan::NotEqual;
+      return true;
+#endif
+#ifdef SQLITE_INDEX_CONSTRAINT_ISNULL
+    case SQLITE_INDEX_CONSTRAINT_ISNULL:
+      type = VTableIndexPlan::IsNull;
+      return true;
+#endif
+#ifdef SQLITE_INDEX_CONSTRAINT_ISNOTNULL
+    case SQLITE_INDEX_CONSTRAINT_ISNOTNULL:
+      type = VTableIndexPlan::IsNotNull;
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
 
-      indexInfo->idxStr = cp;
-      indexInfo->needToFreeIdxStr = 1;
-      return SQLITE_OK;
-    }
+/**
+ * Returns TRUE if the constraint \a i is an IN operator that can be processed
+ * in a single xFilter call, and tells SQLite to do so.
+ */
+bool constraintIsInList( sqlite3_index_info *indexInfo, int i )
+{
+#if SQLITE_VERSION_NUMBER >= 3038000
+  if ( sqlite3_vtab_in( indexInfo, i, -1 ) )
+  {
+    sqlite3_vtab_in( indexInfo, i, 1 );
+    return true;
+  }
+#else
+  Q_UNUSED( indexInfo )
+  Q_UNUSED( i )
+#endif
+  return false;
+}
 
-    // request for rtree filtering
+int vtableBestIndex( sqlite3_vtab *pvtab, sqlite3_index_info *indexInfo )
+{
+  VTable *vtab = reinterpret_cast< VTable * >( pvtab );
+  const QgsFields fields = vtab->fields();
+  const int fieldCount = fields.count();
+
+  VTableIndexPlan plan;
+  int argvIndex = 0;
+  double cost = 10.0;
+
+  // request for primary key filter with '='
+  // this is the most selective one: use it alone and let SQLite check the other constraints
+  for ( int i = 0; i < indexInfo->nConstraint; i++ )
+  {
     if ( ( indexInfo->aConstraint[i].usable ) &&
-         // request on _search_frame_ column
-         ( vtab->fields().count() + 1 == indexInfo->aConstraint[i].iColumn ) &&
+         ( vtab->pkColumn() == indexInfo->aConstraint[i].iColumn ) &&
          ( indexInfo->aConstraint[i].op == SQLITE_INDEX_CONSTRAINT_EQ ) )
     {
-      indexInfo->aConstraintUsage[i].argvIndex = 1;
-      // do not test for equality, since it is used for filtering, not to return an actual value
+      const bool isInList = constraintIsInList( indexInfo, i );
+      plan.constraints << VTableIndexPlan::Constraint { isInList ? VTableIndexPlan::FidIn : VTableIndexPlan::Fid, -1 };
+      indexInfo->aConstraintUsage[i].argvIndex = ++argvIndex;
       indexInfo->aConstraintUsage[i].omit = 1;
-      indexInfo->idxNum = 2; // RTree filter
-      indexInfo->estimatedCost = 1.0;
-      indexInfo->idxStr = nullptr;
-      indexInfo->needToFreeIdxStr = 0;
-      return SQLITE_OK;
+      cost = 1.0;
+      break;
+    }
+  }
+
+  if ( plan.constraints.isEmpty() )
+  {
+    bool hasRect = false;
+    for ( int i = 0; i < indexInfo->nConstraint; i++ )
+    {
+      if ( !indexInfo->aConstraint[i].usable )
+        continue;
+
+      const int column = indexInfo->aConstraint[i].iColumn;
+      if ( !hasRect &&
+           // request on _search_frame_ column
+           ( fieldCount + 1 == column ) &&
+           ( indexInfo->aConstraint[i].op == SQLITE_INDEX_CONSTRAINT_EQ ) )
+      {
+        // request for rtree filtering
+        plan.constraints << VTableIndexPlan::Constraint { VTableIndexPlan::Rect, -1 };
+        indexInfo->aConstraintUsage[i].argvIndex = ++argvIndex;
+        // do not test for equality, since it is used for filtering, not to return an actual value
+        indexInfo->aConstraintUsage[i].omit = 1;
+        hasRect = true;
+        cost = std::min( cost, 1.0 );
+        continue;
+      }
+
+      // request for filter with a comparison operator
+      // all of them are ANDed in a single expression, and we rely on the expression compiler if available
+      VTableIndexPlan::ConstraintType type;
+      if ( column < 0 || column >= fieldCount || !constraintTypeFromOperator( indexInfo->aConstraint[i].op, type ) )
+        continue;
+
+      if ( type == VTableIndexPlan::Equal && constraintIsInList( indexInfo, i ) )
+        type = VTableIndexPlan::In;
+
+      plan.constraints << VTableIndexPlan::Constraint { type, column };
+      if ( VTableIndexPlan::hasArgument( type ) )
+        indexInfo->aConstraintUsage[i].argvIndex = ++argvIndex;
+      indexInfo->aConstraintUsage[i].omit = 1;
+      // each additional constraint is probably better than no index
+      cost *= 0.2;
+    }
+  }
+
+#if SQLITE_VERSION_NUMBER >= 3010000
+  // only fetch the columns the statement actually uses
+  // bit 63 of colUsed stands for every column beyond the 63rd one
+  const sqlite3_uint64 colUsed = indexInfo->colUsed;
+  auto columnUsed = [colUsed]( int column ) -> bool
+  {
+    return colUsed & ( static_cast< sqlite3_uint64 >( 1 ) << std::min( column, 63 ) );
+  };
+  for ( int column = 0; column < fieldCount; ++column )
+  {
+    if ( columnUsed( column ) )
+      plan.attributes << column;
+  }
+  plan.allAttributes = plan.attributes.count() == fieldCount;
+  if ( plan.allAttributes )
+    plan.attributes.clear();
+  plan.fetchGeometry = columnUsed( fieldCount );
+#endif
+
+  // consume the ORDER BY clause when the source is able to sort on its side
+  // text columns are left to SQLite, since the source collation may differ from the binary one used by SQLite
+  if ( indexInfo->nOrderBy > 0 && vtab->canCompileOrderBy() )
+  {
+    QList< QPair< int, bool > > orderBy;
+    for ( int i = 0; i < indexInfo->nOrderBy; i++ )
+    {
+      const int column = indexInfo->aOrderBy[i].iColumn;
+      if ( column < 0 || column >= fieldCount || !fields.at( column ).isNumeric() )
+      {
+        orderBy.clear();
+        break;
+      }
+      orderBy << qMakePair( column, indexInfo->aOrderBy[i].desc != 0 );
+    }
+    if ( !orderBy.isEmpty() )
+    {
+      plan.orderBy = orderBy;
+      indexInfo->orderByConsumed = 1;
     }
   }
-  indexInfo->idxNum = 0;
-  indexInfo->estimatedCost = 10.0;
-  indexInfo->idxStr = nullptr;
-  indexInfo->needToFreeIdxStr = 0;
+
+  indexInfo->idxNum = plan.constraints.isEmpty() ? 0 : 1;
+  indexInfo->estimatedCost = cost;
+
+  const QString planStr = plan.toString();
+  if ( planStr.isEmpty() )
+  {
+    indexInfo->idxStr = nullptr;
+    indexInfo->needToFreeIdxStr = 0;
+  }
+  else
+  {
+    const QByteArray ba = planStr.toUtf8();
+    char *cp = reinterpret_cast< char * >( sqlite3_malloc( ba.size() + 1 ) );
+    memcpy( cp, ba.constData(), ba.size() + 1 );
+    indexInfo->idxStr = cp;
+    indexInfo->needToFreeIdxStr = 1;
+  }
   return SQLITE_OK;
 }
 
@@ -587,57 +806,209 @@ int vtableClose( sqlite3_vtab_cursor *cursor )
   return SQLITE_OK;
 }
 
+/**
+ * Converts a SQLite value to a QGIS expression literal.
+ * Returns FALSE if the value is NULL or cannot be compared (blobs), in which case no row matches.
+ */
+bool sqliteValueToExpressionLiteral( sqlite3_value *value, QString &literal )
+{
+  switch ( sqlite3_value_type( value ) )
+  {
+    case SQLITE_INTEGER:
+      literal = QString::number( sqlite3_value_int64( value ) );
+      return true;
+    case SQLITE_FLOAT:
+      literal = QString::number( sqlite3_value_double( value ), 'g', 17 );
+      return true;
+    case SQLITE_TEXT:
+    {
+      int n = sqlite3_value_bytes( value );
+      const char *t = reinterpret_cast<const char *>( sqlite3_value_text( value ) );
+      literal = QgsExpression::quotedString( QString::fromUtf8( t, n ) );
+      return true;
+    }
+    case SQLITE_NULL:
+    case SQLITE_BLOB: // comparison to blob ignored
+    default:
+      return false;
+  }
+}
+
+/**
+ * Returns the list of values of an IN constraint argument.
+ */
+QList< sqlite3_value * > sqliteInListValues( sqlite3_value *list )
+{
+  QList< sqlite3_value * > values;
+#if SQLITE_VERSION_NUMBER >= 3038000
+  sqlite3_value *value = nullptr;
+  for ( int r = sqlite3_vtab_in_first( list, &value ); r == SQLITE_OK && value; r = sqlite3_vtab_in_next( list, &value ) )
+    values << value;
+#else
+  Q_UNUSED( list )
+#endif
+  return values;
+}
+
 int vtableFilter( sqlite3_vtab_cursor *cursor, int idxNum, const char *idxStr, int argc, sqlite3_value **argv )
 {
-  Q_UNUSED( argc )
+  Q_UNUSED( idxNum )
+
+  VTableCursor *c = reinterpret_cast<VTableCursor *>( cursor );
+  const QgsFields fields = c->mVtab->fields();
+  const VTableIndexPlan plan = VTableIndexPlan::fromString( QString::fromUtf8( idxStr ) );
 
   QgsFeatureRequest request;
-  if ( idxNum == 1 )
-  {
-    // id filter
-    request.setFilterFid( sqlite3_value_int( argv[0] ) );
-  }
-  else if ( idxNum == 2 )
+  QStringList expressions;
+  bool hasRect = false;
+  int argIndex = 0;
+  for ( const VTableIndexPlan::Constraint &constraint : plan.constraints )
   {
-    // rtree filter
-    const char *blob = reinterpret_cast< const char * >( sqlite3_value_blob( argv[0] ) );
-    if ( blob )
+    sqlite3_value *arg = nullptr;
+    if ( VTableIndexPlan::hasArgument( constraint.type ) )
     {
-      int bytes = sqlite3_value_bytes( argv[0] );
-      QgsRectangle r( spatialiteBlobBbox( blob, bytes ) );
-      request.setFilterRect( r );
+      if ( argIndex >= argc )
+        return SQLITE_ERROR;
+      arg = argv[argIndex++];
     }
-  }
-  else if ( idxNum == 3 )
-  {
-    // comparison operator filter
-    // build an expression filter and rely on expression compiler if available
-    QString expr = idxStr;
-    switch ( sqlite3_value_type( argv[0] ) )
+
+    switch ( constraint.type )
     {
-      case SQLITE_INTEGER:
-        expr += QString::number( sqlite3_value_int64( argv[0] ) );
+      case VTableIndexPlan::Fid:
+        // id filter
+        request.setFilterFid( sqlite3_value_int64( arg ) );
         break;
-      case SQLITE_FLOAT:
-        expr += QString::number( sqlite3_value_double( argv[0] ) );
+
+      case VTableIndexPlan::FidIn:
+      {
+        QgsFeatureIds fids;
+        const QList< sqlite3_value * > values = sqliteInListValues( arg );
+        for ( sqlite3_value *value : values )
+          fids.insert( sqlite3_value_int64( value ) );
+        if ( fids.isEmpty() )
+        {
+          c->clear();
+          return SQLITE_OK;
+        }
+        request.setFilterFids( fids );
         break;
-      case SQLITE_TEXT:
+      }
+
+      case VTableIndexPlan::Rect:
       {
-        int n = sqlite3_value_bytes( argv[0] );
-        const char *t = reinterpret_cast<const char *>( sqlite3_value_text( argv[0] ) );
-        QString str = QString::fromUtf8( t, n );
-        expr += QgsExpression::quotedString( str );
+        // rtree filter
+        const char *blob = reinterpret_cast< const char * >( sqlite3_value_blob( arg ) );
+        if ( blob )
+        {
+          int bytes = sqlite3_value_bytes( arg );
+          QgsRectangle r( spatialiteBlobBbox( blob, bytes ) );
+          request.setFilterRect( r );
+          hasRect = true;
+        }
         break;
       }
-      case SQLITE_NULL:
-      case SQLITE_BLOB: // comparison to blob ignored
-      default:
-        expr += QLatin1String( " is null" );
+
+      case VTableIndexPlan::IsNull:
+      case VTableIndexPlan::IsNotNull:
+        expressions << QgsExpression::quotedColumnRef( fields.at( constraint.column ).name() )
+                    + ( constraint.type == VTableIndexPlan::IsNull ? QStringLiteral( " IS NULL" ) : QStringLiteral( " IS NOT NULL" ) );
+        break;
+
+      case VTableIndexPlan::In:
+      {
+        QStringList literals;
+        const QList< sqlite3_value * > values = sqliteInListValues( arg );
+        for ( sqlite3_value *value : values )
+        {
+          QString literal;
+          if ( sqliteValueToExpressionLiteral( value, literal ) )
+            literals << literal;
+        }
+        if ( literals.isEmpty() )
+        {
+          c->clear();
+          return SQLITE_OK;
+        }
+        expressions << QStringLiteral( "%1 IN (%2)" ).arg( QgsExpression::quotedColumnRef( fields.at( constraint.column ).name() ),
+                    literals.join( QLatin1String( ", " ) ) );
+        break;
+      }
+
+      case VTableIndexPlan::Equal:
+      case VTableIndexPlan::GreaterThan:
+      case VTableIndexPlan::LesserOrEqual:
+      case VTableIndexPlan::LesserThan:
+      case VTableIndexPlan::GreaterOrEqual:
+      case VTableIndexPlan::Like:
+      case VTableIndexPlan::NotEqual:
+      {
+        // comparison operator filter
+        QString literal;
+        if ( !sqliteValueToExpressionLiteral( arg, literal ) )
+        {
+          // a comparison with NULL is never true
+          c->clear();
+          return SQLITE_OK;
+        }
+
+        QString op;
+        switch ( constraint.type )
+        {
+          case VTableIndexPlan::Equal:
+            op = QStringLiteral( "=" );
+            break;
+          case VTableIndexPlan::GreaterThan:
+            op = QStringLiteral( ">" );
+            break;
+          case VTableIndexPlan::LesserOrEqual:
+            op = QStringLiteral( "<=" );
+            break;
+          case VTableIndexPlan::LesserThan:
+            op = QStringLiteral( "<" );
+            break;
+          case VTableIndexPlan::GreaterOrEqual:
+            op = QStringLiteral( ">=" );
+            break;
+          case VTableIndexPlan::Like:
+            op = QStringLiteral( "LIKE" );
+            break;
+          case VTableIndexPlan::NotEqual:
+            op = QStringLiteral( "<>" );
+            break;
+          default:
+            break;
+        }
+        expressions << QStringLiteral( "%1 %2 %3" ).arg( QgsExpression::quotedColumnRef( fields.at( constraint.column ).name() ), op, literal );
         break;
+      }
     }
-    request.setFilterExpression( expr );
   }
-  VTableCursor *c = reinterpret_cast<VTableCursor *>( cursor );
+
+  if ( !expressions.isEmpty() )
+  {
+    // build an expression filter and rely on expression compiler if available
+    request.setFilterExpression( expressions.join( QLatin1String( " AND " ) ) );
+  }
+
+  if ( !plan.allAttributes )
+    request.setSubsetOfAttributes( plan.attributes );
+
+  // keep the geometry for rectangle filters, some sources need it to test the candidates
+  if ( !plan.fetchGeometry && !hasRect )
+    request.setFlags( request.flags() | QgsFeatureRequest::NoGeometry );
+
+  if ( !plan.orderBy.isEmpty() )
+  {
+    QgsFeatureRequest::OrderBy orderBy;
+    for ( const QPair< int, bool > &clause : plan.orderBy )
+    {
+      // SQLite sorts NULL values first in ascending order
+      const bool ascending = !clause.second;
+      orderBy << QgsFeatureRequest::OrderByClause( QgsExpression::quotedColumnRef( fields.at( clause.first ).name() ), ascending, ascending );
+    }
+    request.setOrderBy( orderBy );
+  }
+
   c->filter( request );
   return SQLITE_OK;
 }
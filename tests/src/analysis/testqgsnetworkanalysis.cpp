@@ -25,6 +25,12 @@ Email                : nyall dot dawson at gmail dot com
 #include "qgsgraphbuilder.h"
 #include "qgsgraph.h"
 #include "qgsgraphanalyzer.h"
+#include "qgscompactgraph.h"
+#include "qgscontractionhierarchy.h"
+
+#include <QTemporaryDir>
+#include <QThread>
+#include <cmath>
 
 class TestQgsNetworkAnalysis : public QObject
 {
@@ -40,9 +46,20 @@ class TestQgsNetworkAnalysis : public QObject
     void testGraph();
     void testBuild();
     void testBuildTolerance();
+    void testBuildLargeNetwork();
+    void testBuildNonThreadSafeStrategy();
     void dijkkjkjkskkjsktra();
     void testRouteFail();
     void testRouteFail2();
+    void testCompactGraph();
+    void testCompactShortestPath();
+    void benchmarkDijkstra();
+    void benchmarkCompactDijkstra();
+    void benchmarkShortestPath_data();
+    void benchmarkShortestPath();
+    void testContractionHierarchy();
+    void testContractionHierarchyFile();
+    void benchmarkContractionHierarchy();
 
   private:
     std::unique_ptr< QgsVectorLayer > buildNetwork();
@@ -50,6 +67,38 @@ class TestQgsNetworkAnalysis : public QObject
 
 };
 
+// synthetic grid network, with edges in both directions between neighboring vertices
+static std::unique_ptr< QgsGraph > buildGridGraph( int size )
+{
+  std::unique_ptr< QgsGraph > graph = qgis::make_unique< QgsGraph >();
+  for ( int row = 0; row < size; ++row )
+  {
+    for ( int col = 0; col < size; ++col )
+      graph->addVertex( QgsPointXY( col, row ) );
+  }
+
+  for ( int row = 0; row < size; ++row )
+  {
+    for ( int col = 0; col < size; ++col )
+    {
+      const int vertex = row * size + col;
+      // costs are never lower than the length of the edges, like travel times at a maximum speed
+      const double cost = 1 + ( ( row * 7 + col * 13 ) % 5 ) / 4.0;
+      if ( col + 1 < size )
+      {
+        graph->addEdge( vertex, vertex + 1, QVector< QVariant >() << cost );
+        graph->addEdge( vertex + 1, vertex, QVector< QVariant >() << cost + 0.5 );
+      }
+      if ( row + 1 < size )
+      {
+        graph->addEdge( vertex, vertex + size, QVector< QVariant >() << cost + 0.25 );
+        graph->addEdge( vertex + size, vertex, QVector< QVariant >() << cost );
+      }
+    }
+  }
+  return graph;
+}
+
 class TestNetworkStrategy : public QgsNetworkStrategy
 {
     QSet< int > requiredAttributes() const override
@@ -62,6 +111,30 @@ class TestNetworkStrategy : public QgsNetworkStrategy
     }
 };
 
+// a strategy which is not thread safe, like strategies implemented in Python
+class ThreadCheckingNetworkStrategy : public QgsNetworkStrategy
+{
+  public:
+    QSet< int > requiredAttributes() const override
+    {
+      return QSet< int >();
+    }
+    QVariant cost( double distance, const QgsFeature & ) const override
+    {
+      if ( QThread::currentThread() != mThread )
+        mOtherThreadCalls++;
+      // deliberately unsynchronized, concurrent calls would lose counts
+      const int count = mCalls;
+      QThread::yieldCurrentThread();
+      mCalls = count + 1;
+      return distance;
+    }
+
+    QThread *mThread = QThread::currentThread();
+    mutable int mCalls = 0;
+    mutable int mOtherThreadCalls = 0;
+};
+
 void  TestQgsNetworkAnalysis::initTestCase()
 {
   //
@@ -281,6 +354,103 @@ void TestQgsNetworkAnalysis::testBuildTolerance()
   QCOMPARE( graph->edge( 4 ).toVertex(), 3 );
 }
 
+void TestQgsNetworkAnalysis::testBuildLargeNetwork()
+{
+  // a 70 x 70 grid, with one feature per grid edge: more features than a single processing batch
+  const int size = 70;
+  std::unique_ptr< QgsVectorLayer > network = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "LineString?crs=epsg:4326&field=cost:int" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+  QgsFeatureList flist;
+  for ( int row = 0; row <= size; ++row )
+  {
+    for ( int col = 0; col <= size; ++col )
+    {
+      QgsFeature ff;
+      ff.setAttributes( QgsAttributes() << 1 );
+      if ( col < size )
+      {
+        ff.setGeometry( QgsGeometry::fromPolylineXY( QgsPolylineXY() << QgsPointXY( col, row ) << QgsPointXY( col + 1, row ) ) );
+        flist << ff;
+      }
+      if ( row < size )
+      {
+        // vertical lines start slightly off the grid vertices
+        ff.setGeometry( QgsGeometry::fromPolylineXY( QgsPolylineXY() << QgsPointXY( col + 0.01, row - 0.01 ) << QgsPointXY( col, row + 1 ) ) );
+        flist << ff;
+      }
+    }
+  }
+  network->dataProvider()->addFeatures( flist );
+
+  std::unique_ptr< QgsVectorLayerDirector > director = qgis::make_unique< QgsVectorLayerDirector > ( network.get(),
+      -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionBoth );
+  director->addStrategy( new QgsNetworkDistanceStrategy() );
+
+  // without tolerance, the start of each vertical line is a separate vertex
+  std::unique_ptr< QgsGraphBuilder > builder = qgis::make_unique< QgsGraphBuilder > ( network->sourceCrs(), true, 0 );
+  QVector<QgsPointXY > snapped;
+  director->makeGraph( builder.get(), QVector<QgsPointXY>(), snapped );
+  std::unique_ptr< QgsGraph > graph( builder->graph() );
+  QCOMPARE( graph->vertexCount(), ( size + 1 ) * ( size + 1 ) + size * ( size + 1 ) );
+  QCOMPARE( graph->edgeCount(), 4 * size * ( size + 1 ) );
+
+  // with tolerance, they are merged with the grid vertices
+  builder = qgis::make_unique< QgsGraphBuilder > ( network->sourceCrs(), true, 0.05 );
+  director->makeGraph( builder.get(), QVector<QgsPointXY>() << QgsPointXY( 12.25, 40.875 ) << QgsPointXY( 5.5, 5.375 ) << QgsPointXY( 3, -7 ) << QgsPointXY( 30, 20.02 ), snapped );
+  QCOMPARE( snapped, QVector<QgsPointXY>() << QgsPointXY( 12.25, 41 ) << QgsPointXY( 5.5, 5 ) << QgsPointXY( 3, 0 ) << QgsPointXY( 30, 20 ) );
+  graph.reset( builder->graph() );
+  // the first two points split an edge, the others are tied to existing vertices
+  QCOMPARE( graph->vertexCount(), ( size + 1 ) * ( size + 1 ) + 2 );
+  QCOMPARE( graph->edgeCount(), 4 * size * ( size + 1 ) + 2 * 2 );
+
+  // edges are added in the order of the features
+  QCOMPARE( graph->vertex( graph->edge( 0 ).fromVertex() ).point(), QgsPointXY( 0, 0 ) );
+  QCOMPARE( graph->vertex( graph->edge( 0 ).toVertex() ).point(), QgsPointXY( 1, 0 ) );
+  QCOMPARE( graph->vertex( graph->edge( 2 ).fromVertex() ).point(), QgsPointXY( 0, 0 ) );
+  QCOMPARE( graph->vertex( graph->edge( 2 ).toVertex() ).point(), QgsPointXY( 0, 1 ) );
+  const int tiedVertex = graph->findVertex( QgsPointXY( 12.25, 41 ) );
+  QVERIFY( tiedVertex >= 0 );
+  QCOMPARE( graph->vertex( tiedVertex ).outgoingEdges().size(), 2 );
+  QCOMPARE( graph->vertex( tiedVertex ).incomingEdges().size(), 2 );
+}
+
+void TestQgsNetworkAnalysis::testBuildNonThreadSafeStrategy()
+{
+  // more features than a single processing batch
+  const int size = 70;
+  std::unique_ptr< QgsVectorLayer > network = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "LineString?crs=epsg:4326" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+  QgsFeatureList flist;
+  for ( int row = 0; row <= size; ++row )
+  {
+    for ( int col = 0; col < size; ++col )
+    {
+      QgsFeature ff;
+      ff.setGeometry( QgsGeometry::fromPolylineXY( QgsPolylineXY() << QgsPointXY( col, row ) << QgsPointXY( col + 1, row ) ) );
+      flist << ff;
+    }
+  }
+  network->dataProvider()->addFeatures( flist );
+
+  std::unique_ptr< QgsVectorLayerDirector > director = qgis::make_unique< QgsVectorLayerDirector > ( network.get(),
+      -1, QString(), QString(), QString(), QgsVectorLayerDirector::DirectionBoth );
+  ThreadCheckingNetworkStrategy *strategy = new ThreadCheckingNetworkStrategy();
+  director->addStrategy( strategy );
+  // built-in strategies are evaluated by the worker threads, next to the other ones
+  director->addStrategy( new QgsNetworkDistanceStrategy() );
+
+  std::unique_ptr< QgsGraphBuilder > builder = qgis::make_unique< QgsGraphBuilder > ( network->sourceCrs(), true, 0 );
+  QVector<QgsPointXY > snapped;
+  director->makeGraph( builder.get(), QVector<QgsPointXY>(), snapped );
+  std::unique_ptr< QgsGraph > graph( builder->graph() );
+
+  // the strategy is only called from the thread building the graph, once for both directions of each arc
+  QCOMPARE( strategy->mOtherThreadCalls, 0 );
+  QCOMPARE( strategy->mCalls, size * ( size + 1 ) );
+  QCOMPARE( graph->edgeCount(), 2 * size * ( size + 1 ) );
+  QCOMPARE( graph->edge( 0 ).cost( 0 ).toDouble(), graph->edge( 1 ).cost( 0 ).toDouble() );
+  for ( int i = 0; i < graph->edgeCount(); ++i )
+    QCOMPARE( graph->edge( i ).cost( 1 ).toDouble(), graph->edge( i ).cost( 0 ).toDouble() );
+}
+
 void TestQgsNetworkAnalysis::dijkkjkjkskkjsktra()
 {
   std::unique_ptr<QgsVectorLayer> network = buildNetwork();
@@ -576,6 +746,321 @@ void TestQgsNetworkAnalysis::testRouteFail2()
 }
 
 
+void TestQgsNetworkAnalysis::testCompactGraph()
+{
+  QgsGraph graph;
+  graph.addVertex( QgsPointXY( 0, 0 ) );
+  graph.addVertex( QgsPointXY( 3, 4 ) );
+  graph.addVertex( QgsPointXY( 3, 0 ) );
+  graph.addEdge( 0, 1, QVector< QVariant >() << 10 << 1 );
+  graph.addEdge( 1, 2, QVector< QVariant >() << 8 << QString( "x" ) );
+  graph.addEdge( 2, 0, QVector< QVariant >() << 3 );
+
+  const QgsCompactGraph compact( graph );
+  QCOMPARE( compact.vertexCount(), 3 );
+  QCOMPARE( compact.edgeCount(), 3 );
+  QCOMPARE( compact.strategyCount(), 2 );
+  QCOMPARE( compact.vertexPoint( 1 ), QgsPointXY( 3, 4 ) );
+  QCOMPARE( compact.edgeFromVertex( 1 ), 1 );
+  QCOMPARE( compact.edgeToVertex( 1 ), 2 );
+  QCOMPARE( compact.edgeCost( 0, 0 ), 10.0 );
+  QCOMPARE( compact.edgeCost( 0, 1 ), 1.0 );
+  // missing or non numeric costs are 0
+  QCOMPARE( compact.edgeCost( 1, 1 ), 0.0 );
+  QCOMPARE( compact.edgeCost( 2, 1 ), 0.0 );
+  // lowest cost per distance unit is 3 / 3 for the first strategy
+  QGSCOMPARENEAR( compact.minimumCostPerDistance( 0 ), 1, 1e-6 );
+  QCOMPARE( compact.minimumCostPerDistance( 1 ), 0.0 );
+  QCOMPARE( compact.minimumCostPerDistance( 2 ), 0.0 );
+
+  QCOMPARE( QgsCompactGraph().vertexCount(), 0 );
+  QCOMPARE( QgsCompactGraph().strategyCount(), 0 );
+
+  // same results as with the QgsGraph
+  std::unique_ptr< QgsGraph > grid = buildGridGraph( 30 );
+  const QgsCompactGraph compactGrid( *grid );
+  QCOMPARE( compactGrid.vertexCount(), grid->vertexCount() );
+  QCOMPARE( compactGrid.edgeCount(), grid->edgeCount() );
+
+  QVector<int> resultTree;
+  QVector<double> resultCost;
+  QgsGraphAnalyzer::dijkstra( grid.get(), 17, 0, &resultTree, &resultCost );
+  QVector<int> compactTree;
+  QVector<double> compactCost;
+  QgsGraphAnalyzer::dijkstra( &compactGrid, 17, 0, &compactTree, &compactCost );
+  QCOMPARE( compactCost, resultCost );
+  QCOMPARE( compactTree.size(), resultTree.size() );
+  QCOMPARE( compactTree.at( 17 ), -1 );
+  for ( int vertex = 0; vertex < compactGrid.vertexCount(); ++vertex )
+  {
+    if ( vertex == 17 )
+      continue;
+    // paths with equal costs may be picked in a different order
+    const int edge = compactTree.at( vertex );
+    QCOMPARE( compactGrid.edgeToVertex( edge ), vertex );
+    QCOMPARE( compactCost.at( compactGrid.edgeFromVertex( edge ) ) + compactGrid.edgeCost( edge, 0 ), compactCost.at( vertex ) );
+  }
+
+  // built from the graph builder
+  QgsGraphBuilder builder( QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:3857" ) ), false );
+  builder.addVertex( 0, QgsPointXY( 0, 0 ) );
+  builder.addVertex( 1, QgsPointXY( 10, 0 ) );
+  builder.addEdge( 0, QgsPointXY( 0, 0 ), 1, QgsPointXY( 10, 0 ), QVector< QVariant >() << 10 );
+  std::unique_ptr< QgsCompactGraph > builtGraph( builder.compactGraph() );
+  QVERIFY( builtGraph );
+  QCOMPARE( builtGraph->vertexCount(), 2 );
+  QCOMPARE( builtGraph->edgeCount(), 1 );
+  std::unique_ptr< QgsGraph > builtQgsGraph( builder.graph() );
+  QVERIFY( !builder.compactGraph() );
+}
+
+void TestQgsNetworkAnalysis::testCompactShortestPath()
+{
+  std::unique_ptr< QgsGraph > grid = buildGridGraph( 30 );
+  grid->addVertex( QgsPointXY( -10, -10 ) );  // unreachable
+  const QgsCompactGraph compact( *grid );
+  QVERIFY( compact.minimumCostPerDistance( 0 ) > 0.99 );
+
+  const QList< QgsGraphAnalyzer::ShortestPathAlgorithm > algorithms = QList< QgsGraphAnalyzer::ShortestPathAlgorithm >()
+      << QgsGraphAnalyzer::Dijkstra << QgsGraphAnalyzer::BidirectionalDijkstra << QgsGraphAnalyzer::AStar;
+
+  const QList< QPair< int, int > > pairs = QList< QPair< int, int > >()
+      << qMakePair( 0, 899 ) << qMakePair( 899, 0 ) << qMakePair( 45, 46 ) << qMakePair( 452, 77 ) << qMakePair( 29, 870 );
+  for ( const QPair< int, int > &pair : pairs )
+  {
+    QVector<double> resultCost;
+    QgsGraphAnalyzer::dijkstra( &compact, pair.first, 0, nullptr, &resultCost );
+
+    for ( QgsGraphAnalyzer::ShortestPathAlgorithm algorithm : algorithms )
+    {
+      double cost = 0;
+      const QVector< int > path = QgsGraphAnalyzer::shortestPath( &compact, pair.first, pair.second, 0, algorithm, &cost );
+      QCOMPARE( cost, resultCost.at( pair.second ) );
+
+      // the path must be made of consecutive edges, from the start to the end vertex
+      QVERIFY( !path.isEmpty() );
+      int vertex = pair.first;
+      double pathCost = 0;
+      for ( int edge : path )
+      {
+        QCOMPARE( compact.edgeFromVertex( edge ), vertex );
+        vertex = compact.edgeToVertex( edge );
+        pathCost += compact.edgeCost( edge, 0 );
+      }
+      QCOMPARE( vertex, pair.second );
+      QCOMPARE( pathCost, cost );
+    }
+  }
+
+  for ( QgsGraphAnalyzer::ShortestPathAlgorithm algorithm : algorithms )
+  {
+    double cost = 0;
+    QVERIFY( QgsGraphAnalyzer::shortestPath( &compact, 0, 900, 0, algorithm, &cost ).isEmpty() );
+    QVERIFY( std::isinf( cost ) );
+    QVERIFY( QgsGraphAnalyzer::shortestPath( &compact, 900, 0, 0, algorithm, &cost ).isEmpty() );
+    QVERIFY( std::isinf( cost ) );
+    QVERIFY( QgsGraphAnalyzer::shortestPath( &compact, 12, 12, 0, algorithm, &cost ).isEmpty() );
+    QCOMPARE( cost, 0.0 );
+    QVERIFY( QgsGraphAnalyzer::shortestPath( &compact, 12, 901, 0, algorithm, &cost ).isEmpty() );
+    QVERIFY( std::isinf( cost ) );
+    QVERIFY( QgsGraphAnalyzer::shortestPath( &compact, 12, 13, 1, algorithm, &cost ).isEmpty() );
+    QVERIFY( std::isinf( cost ) );
+  }
+}
+
+void TestQgsNetworkAnalysis::benchmarkDijkstra()
+{
+  std::unique_ptr< QgsGraph > grid = buildGridGraph( 200 );
+  QVector<int> resultTree;
+  QVector<double> resultCost;
+  QBENCHMARK
+  {
+    QgsGraphAnalyzer::dijkstra( grid.get(), 0, 0, &resultTree, &resultCost );
+  }
+}
+
+void TestQgsNetworkAnalysis::benchmarkCompactDijkstra()
+{
+  std::unique_ptr< QgsGraph > grid = buildGridGraph( 200 );
+  const QgsCompactGraph compact( *grid );
+  QVector<int> resultTree;
+  QVector<double> resultCost;
+  QBENCHMARK
+  {
+    QgsGraphAnalyzer::dijkstra( &compact, 0, 0, &resultTree, &resultCost );
+  }
+}
+
+void TestQgsNetworkAnalysis::benchmarkShortestPath_data()
+{
+  QTest::addColumn< int >( "algorithm" );
+  QTest::newRow( "dijkstra" ) << static_cast< int >( QgsGraphAnalyzer::Dijkstra );
+  QTest::newRow( "bidirectional" ) << static_cast< int >( QgsGraphAnalyzer::BidirectionalDijkstra );
+  QTest::newRow( "astar" ) << static_cast< int >( QgsGraphAnalyzer::AStar );
+}
+
+void TestQgsNetworkAnalysis::benchmarkShortestPath()
+{
+  QFETCH( int, algorithm );
+
+  std::unique_ptr< QgsGraph > grid = buildGridGraph( 200 );
+  const QgsCompactGraph compact( *grid );
+  QBENCHMARK
+  {
+    // from the center to a corner of the grid
+    QgsGraphAnalyzer::shortestPath( &compact, 100 * 200 + 100, 200 * 200 - 1, 0, static_cast< QgsGraphAnalyzer::ShortestPathAlgorithm >( algorithm ) );
+  }
+}
+
+void TestQgsNetworkAnalysis::testContractionHierarchy()
+{
+  std::unique_ptr< QgsGraph > grid = buildGridGraph( 30 );
+  grid->addVertex( QgsPointXY( -10, -10 ) );  // unreachable
+  // parallel edge and self loop
+  grid->addEdge( 0, 1, QVector< QVariant >() << 0.25 );
+  grid->addEdge( 5, 5, QVector< QVariant >() << 0.0 );
+  const QgsCompactGraph compact( *grid );
+
+  QVERIFY( !QgsContractionHierarchy().isValid() );
+  QVERIFY( !QgsContractionHierarchy::build( compact, 1 ).isValid() );
+
+  const QgsContractionHierarchy hierarchy = QgsContractionHierarchy::build( compact, 0 );
+  QVERIFY( hierarchy.isValid() );
+  QCOMPARE( hierarchy.vertexCount(), 901 );
+  QCOMPARE( hierarchy.strategyIndex(), 0 );
+  QVERIFY( hierarchy.shortcutCount() > 0 );
+  QCOMPARE( hierarchy.fingerprint(), QgsContractionHierarchy::graphFingerprint( compact, 0 ) );
+
+  const QVector< int > vertices = QVector< int >() << 0 << 899 << 45 << 46 << 452 << 77 << 29 << 870 << 900;
+  const QVector< QVector< double > > matrix = hierarchy.costMatrix( vertices, vertices );
+  QCOMPARE( matrix.size(), vertices.size() );
+
+  for ( int row = 0; row < vertices.size(); ++row )
+  {
+    const int start = vertices.at( row );
+    QVector<double> resultCost;
+    QgsGraphAnalyzer::dijkstra( &compact, start, 0, nullptr, &resultCost );
+    QCOMPARE( matrix.at( row ).size(), vertices.size() );
+
+    for ( int column = 0; column < vertices.size(); ++column )
+    {
+      const int end = vertices.at( column );
+      const double expected = resultCost.at( end );
+
+      double cost = 0;
+      const QVector< int > path = hierarchy.shortestPath( start, end, &cost );
+      if ( std::isinf( expected ) )
+      {
+        QVERIFY( std::isinf( cost ) );
+        QVERIFY( std::isinf( hierarchy.shortestPathCost( start, end ) ) );
+        QVERIFY( std::isinf( matrix.at( row ).at( column ) ) );
+        QVERIFY( path.isEmpty() );
+        continue;
+      }
+
+      QGSCOMPARENEAR( cost, expected, 1e-9 );
+      QGSCOMPARENEAR( hierarchy.shortestPathCost( start, end ), expected, 1e-9 );
+      QGSCOMPARENEAR( matrix.at( row ).at( column ), expected, 1e-9 );
+
+      // shortcuts are expanded to consecutive edges of the original graph
+      QCOMPARE( path.isEmpty(), start == end );
+      int vertex = start;
+      double pathCost = 0;
+      for ( int edge : path )
+      {
+        QCOMPARE( compact.edgeFromVertex( edge ), vertex );
+        vertex = compact.edgeToVertex( edge );
+        pathCost += compact.edgeCost( edge, 0 );
+      }
+      QCOMPARE( vertex, end );
+      QGSCOMPARENEAR( pathCost, expected, 1e-9 );
+    }
+  }
+
+  // the parallel edge is cheaper than the grid edge
+  double cost = 0;
+  QCOMPARE( hierarchy.shortestPath( 0, 1, &cost ), QVector< int >() << compact.edgeCount() - 2 );
+  QCOMPARE( cost, 0.25 );
+
+  // invalid vertices
+  QVERIFY( hierarchy.shortestPath( 12, 901, &cost ).isEmpty() );
+  QVERIFY( std::isinf( cost ) );
+  QVERIFY( std::isinf( hierarchy.shortestPathCost( -1, 12 ) ) );
+  const QVector< QVector< double > > invalidMatrix = hierarchy.costMatrix( QVector< int >() << -1 << 12, QVector< int >() << 12 << 1000 );
+  QVERIFY( std::isinf( invalidMatrix.at( 0 ).at( 0 ) ) );
+  QCOMPARE( invalidMatrix.at( 1 ).at( 0 ), 0.0 );
+  QVERIFY( std::isinf( invalidMatrix.at( 1 ).at( 1 ) ) );
+  QVERIFY( std::isinf( QgsContractionHierarchy().costMatrix( QVector< int >() << 0, QVector< int >() << 1 ).at( 0 ).at( 0 ) ) );
+
+  // a different graph has a different fingerprint
+  grid->addVertex( QgsPointXY( -20, -20 ) );
+  QVERIFY( QgsContractionHierarchy::graphFingerprint( QgsCompactGraph( *grid ), 0 ) != hierarchy.fingerprint() );
+}
+
+void TestQgsNetworkAnalysis::testContractionHierarchyFile()
+{
+  std::unique_ptr< QgsGraph > grid = buildGridGraph( 20 );
+  const QgsCompactGraph compact( *grid );
+  const QgsContractionHierarchy hierarchy = QgsContractionHierarchy::build( compact, 0 );
+
+  QTemporaryDir dir;
+  const QString path = dir.filePath( QStringLiteral( "grid.qgsch" ) );
+  QString error;
+  QVERIFY( !QgsContractionHierarchy().writeToFile( path, &error ) );
+  QVERIFY( !error.isEmpty() );
+  error.clear();
+  QVERIFY( hierarchy.writeToFile( path, &error ) );
+  QVERIFY( error.isEmpty() );
+
+  const QgsContractionHierarchy read = QgsContractionHierarchy::fromFile( path, &error );
+  QVERIFY( read.isValid() );
+  QCOMPARE( read.fingerprint(), hierarchy.fingerprint() );
+  QCOMPARE( read.vertexCount(), hierarchy.vertexCount() );
+  QCOMPARE( read.strategyIndex(), 0 );
+  QCOMPARE( read.shortcutCount(), hierarchy.shortcutCount() );
+  for ( int end : QVector< int >() << 1 << 57 << 210 << 399 )
+  {
+    double expectedCost = 0;
+    double cost = 0;
+    QCOMPARE( read.shortestPath( 0, end, &cost ), hierarchy.shortestPath( 0, end, &expectedCost ) );
+    QCOMPARE( cost, expectedCost );
+  }
+
+  // not a hierarchy file
+  const QString badPath = dir.filePath( QStringLiteral( "bad.qgsch" ) );
+  QFile badFile( badPath );
+  QVERIFY( badFile.open( QIODevice::WriteOnly ) );
+  badFile.write( "not a hierarchy" );
+  badFile.close();
+  QVERIFY( !QgsContractionHierarchy::fromFile( badPath, &error ).isValid() );
+  QVERIFY( !error.isEmpty() );
+
+  // truncated file
+  QFile file( path );
+  QVERIFY( file.open( QIODevice::ReadWrite ) );
+  QVERIFY( file.resize( file.size() - 10 ) );
+  file.close();
+  error.clear();
+  QVERIFY( !QgsContractionHierarchy::fromFile( path, &error ).isValid() );
+  QVERIFY( !error.isEmpty() );
+
+  error.clear();
+  QVERIFY( !QgsContractionHierarchy::fromFile( dir.filePath( QStringLiteral( "missing.qgsch" ) ), &error ).isValid() );
+  QVERIFY( !error.isEmpty() );
+}
+
+void TestQgsNetworkAnalysis::benchmarkContractionHierarchy()
+{
+  std::unique_ptr< QgsGraph > grid = buildGridGraph( 200 );
+  const QgsCompactGraph compact( *grid );
+  const QgsContractionHierarchy hierarchy = QgsContractionHierarchy::build( compact, 0 );
+  QBENCHMARK
+  {
+    // from the center to a corner of the grid, as in benchmarkShortestPath
+    hierarchy.shortestPath( 100 * 200 + 100, 200 * 200 - 1 );
+  }
+}
+
 
 QGSTEST_MAIN( TestQgsNetworkAnalysis )
 #include "testqgsnetworkanalysis.moc"
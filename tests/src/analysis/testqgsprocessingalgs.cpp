@@ -17,6 +17,7 @@
 #include "limits"
 
 #include "qgstest.h"
+#include <QThreadPool>
 #include "qgsprocessingregistry.h"
 #include "qgsprocessingprovider.h"
 #include "qgsprocessingutils.h"
@@ -56,6 +57,9 @@
 #include "qgsrenderchecker.h"
 #include "qgsrelationmanager.h"
 #include "qgsmeshlayer.h"
+#include "qgsgraph.h"
+#include "qgscompactgraph.h"
+#include "qgscontractionhierarchy.h"
 
 class TestQgsProcessingAlgs: public QObject
 {
@@ -127,6 +131,9 @@ class TestQgsProcessingAlgs: public QObject
 
     void repairShapefile();
     void renameField();
+    void overlayParallel();
+    void dissolveCascaded();
+    void odMatrixFromLayers();
 
     void compareDatasets();
     void shapefileEncoding();
@@ -3849,6 +3856,281 @@ void TestQgsProcessingAlgs::renameField()
 
 }
 
+void TestQgsProcessingAlgs::overlayParallel()
+{
+  // overlay results must not depend on the number of threads used
+  QgsProject p;
+  QgsVectorLayer *layerA = new QgsVectorLayer( QStringLiteral( "Polygon?crs=epsg:3857&field=a:int" ), QStringLiteral( "a" ), QStringLiteral( "memory" ) );
+  QVERIFY( layerA->isValid() );
+  QgsVectorLayer *layerB = new QgsVectorLayer( QStringLiteral( "Polygon?crs=epsg:3857&field=b:int" ), QStringLiteral( "b" ), QStringLiteral( "memory" ) );
+  QVERIFY( layerB->isValid() );
+  p.addMapLayers( QList< QgsMapLayer * >() << layerA << layerB );
+
+  QgsFeatureList featuresA;
+  QgsFeatureList featuresB;
+  for ( int i = 0; i < 80; ++i )
+  {
+    for ( int j = 0; j < 80; ++j )
+    {
+      QgsFeature fA;
+      fA.setAttributes( QgsAttributes() << i * 80 + j );
+      fA.setGeometry( QgsGeometry::fromRect( QgsRectangle( i, j, i + 1, j + 1 ) ) );
+      featuresA << fA;
+
+      QgsFeature fB;
+      fB.setAttributes( QgsAttributes() << i * 80 + j );
+      fB.setGeometry( QgsGeometry::fromRect( QgsRectangle( i + 0.5, j + 0.5, i + 1.5, j + 1.5 ) ) );
+      featuresB << fB;
+    }
+  }
+  QVERIFY( layerA->dataProvider()->addFeatures( featuresA ) );
+  QVERIFY( layerB->dataProvider()->addFeatures( featuresB ) );
+
+  auto runOverlay = [&]( const QString & algorithmId ) -> QStringList
+  {
+    std::unique_ptr< QgsProcessingAlgorithm > alg( QgsApplication::processingRegistry()->createAlgorithmById( algorithmId ) );
+    QVariantMap parameters;
+    parameters.insert( QStringLiteral( "INPUT" ), QVariant::fromValue( layerA ) );
+    parameters.insert( QStringLiteral( "OVERLAY" ), QVariant::fromValue( layerB ) );
+    parameters.insert( QStringLiteral( "OUTPUT" ), QgsProcessing::TEMPORARY_OUTPUT );
+
+    bool ok = false;
+    QgsProcessingFeedback feedback;
+    std::unique_ptr< QgsProcessingContext > context = qgis::make_unique< QgsProcessingContext >();
+    const QVariantMap results = alg->run( parameters, *context, &feedback, &ok );
+    if ( !ok )
+      return QStringList();
+
+    QgsVectorLayer *output = qobject_cast< QgsVectorLayer * >( context->getMapLayer( results.value( QStringLiteral( "OUTPUT" ) ).toString() ) );
+    QStringList res;
+    QgsFeature f;
+    QgsFeatureIterator it = output->getFeatures();
+    while ( it.nextFeature( f ) )
+    {
+      QStringList attrs;
+      for ( const QVariant &v : f.attributes() )
+        attrs << v.toString();
+      res << QStringLiteral( "%1 %2" ).arg( attrs.join( ',' ), f.geometry().asWkt( 2 ) );
+    }
+    return res;
+  };
+
+  const int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+  const QStringList intersectionSingle = runOverlay( QStringLiteral( "native:intersection" ) );
+  const QStringList differenceSingle = runOverlay( QStringLiteral( "native:difference" ) );
+  QThreadPool::globalInstance()->setMaxThreadCount( std::max( 4, maxThreads ) );
+  const QStringList intersectionMulti = runOverlay( QStringLiteral( "native:intersection" ) );
+  const QStringList differenceMulti = runOverlay( QStringLiteral( "native:difference" ) );
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreads );
+
+  // every square of A overlaps up to four squares of B
+  QCOMPARE( intersectionSingle.count(), 80 * 80 + 2 * 79 * 80 + 79 * 79 );
+  QVERIFY( intersectionSingle.at( 0 ).startsWith( QStringLiteral( "0,0 MultiPolygon" ) ) );
+  QCOMPARE( intersectionMulti, intersectionSingle );
+
+  // squares of A are fully covered by B, except for the ones on the left or bottom edges
+  QCOMPARE( differenceSingle.count(), 80 + 79 );
+  QCOMPARE( differenceMulti, differenceSingle );
+}
+
+void TestQgsProcessingAlgs::dissolveCascaded()
+{
+  // enough features to dissolve them in several chunks
+  QgsProject p;
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "Polygon?crs=epsg:3857&field=half:int&field=id:int" ), QStringLiteral( "grid" ), QStringLiteral( "memory" ) );
+  QVERIFY( layer->isValid() );
+  p.addMapLayer( layer );
+
+  QgsFeatureList features;
+  for ( int i = 0; i < 150; ++i )
+  {
+    for ( int j = 0; j < 150; ++j )
+    {
+      QgsFeature f;
+      f.setAttributes( QgsAttributes() << ( i < 75 ? 1 : 0 ) << i * 150 + j );
+      f.setGeometry( QgsGeometry::fromRect( QgsRectangle( i, j, i + 1, j + 1 ) ) );
+      features << f;
+    }
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  std::unique_ptr< QgsProcessingAlgorithm > alg( QgsApplication::processingRegistry()->createAlgorithmById( QStringLiteral( "native:dissolve" ) ) );
+  QVERIFY( alg != nullptr );
+
+  QVariantMap parameters;
+  parameters.insert( QStringLiteral( "INPUT" ), QVariant::fromValue( layer ) );
+  parameters.insert( QStringLiteral( "OUTPUT" ), QgsProcessing::TEMPORARY_OUTPUT );
+
+  // single thread, so that the feature queue is dissolved in blocks
+  const int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+  bool ok = false;
+  QgsProcessingFeedback feedback;
+  std::unique_ptr< QgsProcessingContext > context = qgis::make_unique< QgsProcessingContext >();
+  QVariantMap results = alg->run( parameters, *context, &feedback, &ok );
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreads );
+  QVERIFY( ok );
+
+  QgsVectorLayer *output = qobject_cast< QgsVectorLayer * >( context->getMapLayer( results.value( QStringLiteral( "OUTPUT" ) ).toString() ) );
+  QCOMPARE( output->featureCount(), 1L );
+  QgsFeature f;
+  QVERIFY( output->getFeatures().nextFeature( f ) );
+  QGSCOMPARENEAR( f.geometry().area(), 150.0 * 150.0, 0.001 );
+  QCOMPARE( f.geometry().constGet()->partCount(), 1 );
+  QCOMPARE( f.attribute( 1 ).toInt(), 0 );
+
+  // groups are dissolved in parallel, and written in the order they first appear in the source
+  parameters.insert( QStringLiteral( "FIELD" ), QStringList() << QStringLiteral( "half" ) );
+  ok = false;
+  results = alg->run( parameters, *context, &feedback, &ok );
+  QVERIFY( ok );
+
+  output = qobject_cast< QgsVectorLayer * >( context->getMapLayer( results.value( QStringLiteral( "OUTPUT" ) ).toString() ) );
+  QCOMPARE( output->featureCount(), 2L );
+  QgsFeatureIterator it = output->getFeatures();
+  QVERIFY( it.nextFeature( f ) );
+  QCOMPARE( f.attributes(), QgsAttributes() << 1 << 0 );
+  QCOMPARE( f.geometry().boundingBox(), QgsRectangle( 0, 0, 75, 150 ) );
+  QGSCOMPARENEAR( f.geometry().area(), 75.0 * 150.0, 0.001 );
+  QVERIFY( it.nextFeature( f ) );
+  QCOMPARE( f.attributes(), QgsAttributes() << 0 << 75 * 150 );
+  QCOMPARE( f.geometry().boundingBox(), QgsRectangle( 75, 0, 150, 150 ) );
+  QGSCOMPARENEAR( f.geometry().area(), 75.0 * 150.0, 0.001 );
+}
+
+void TestQgsProcessingAlgs::odMatrixFromLayers()
+{
+  QgsProject p;
+  p.setCrs( QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:3857" ) ) );
+  QgsVectorLayer *network = new QgsVectorLayer( QStringLiteral( "LineString?crs=epsg:3857" ), QStringLiteral( "network" ), QStringLiteral( "memory" ) );
+  QVERIFY( network->isValid() );
+  p.addMapLayer( network );
+  QgsFeatureList features;
+  for ( const QString &wkt : QStringList() << QStringLiteral( "LineString (0 0, 10 0)" ) << QStringLiteral( "LineString (10 0, 10 10)" ) << QStringLiteral( "LineString (100 100, 110 100)" ) )
+  {
+    QgsFeature f;
+    f.setGeometry( QgsGeometry::fromWkt( wkt ) );
+    features << f;
+  }
+  QVERIFY( network->dataProvider()->addFeatures( features ) );
+
+  QgsVectorLayer *origins = new QgsVectorLayer( QStringLiteral( "Point?crs=epsg:3857&field=name:string" ), QStringLiteral( "origins" ), QStringLiteral( "memory" ) );
+  QVERIFY( origins->isValid() );
+  p.addMapLayer( origins );
+  features.clear();
+  QgsFeature origin;
+  origin.setAttributes( QgsAttributes() << QStringLiteral( "a" ) );
+  origin.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 0, 0 ) ) );
+  features << origin;
+  origin.setAttributes( QgsAttributes() << QStringLiteral( "b" ) );
+  origin.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 10, 10 ) ) );
+  features << origin;
+  // features without geometry are skipped
+  origin.setAttributes( QgsAttributes() << QStringLiteral( "c" ) );
+  origin.clearGeometry();
+  features << origin;
+  QVERIFY( origins->dataProvider()->addFeatures( features ) );
+
+  QgsVectorLayer *destinations = new QgsVectorLayer( QStringLiteral( "Point?crs=epsg:3857" ), QStringLiteral( "destinations" ), QStringLiteral( "memory" ) );
+  QVERIFY( destinations->isValid() );
+  p.addMapLayer( destinations );
+  features.clear();
+  QgsFeature destination;
+  destination.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 10, 0 ) ) );
+  features << destination;
+  // snapped to a line which is not connected to the origins
+  destination.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( 105, 101 ) ) );
+  features << destination;
+  QVERIFY( destinations->dataProvider()->addFeatures( features ) );
+
+  std::unique_ptr< QgsProcessingAlgorithm > alg( QgsApplication::processingRegistry()->createAlgorithmById( QStringLiteral( "native:odmatrixfromlayers" ) ) );
+  QVERIFY( alg != nullptr );
+
+  QVariantMap parameters;
+  parameters.insert( QStringLiteral( "INPUT" ), QVariant::fromValue( network ) );
+  parameters.insert( QStringLiteral( "ORIGINS" ), QVariant::fromValue( origins ) );
+  parameters.insert( QStringLiteral( "ORIGINS_ID_FIELD" ), QStringLiteral( "name" ) );
+  parameters.insert( QStringLiteral( "DESTINATIONS" ), QVariant::fromValue( destinations ) );
+  parameters.insert( QStringLiteral( "OUTPUT" ), QgsProcessing::TEMPORARY_OUTPUT );
+
+  for ( bool useHierarchy : { false, true } )
+  {
+    parameters.insert( QStringLiteral( "CONTRACTION_HIERARCHY" ), useHierarchy );
+
+    bool ok = false;
+    QgsProcessingFeedback feedback;
+    std::unique_ptr< QgsProcessingContext > context = qgis::make_unique< QgsProcessingContext >();
+    context->setProject( &p );
+    QVariantMap results = alg->run( parameters, *context, &feedback, &ok );
+    QVERIFY( ok );
+
+    QgsVectorLayer *output = qobject_cast< QgsVectorLayer * >( context->getMapLayer( results.value( QStringLiteral( "OUTPUT" ) ).toString() ) );
+    QVERIFY( output );
+    QCOMPARE( output->wkbType(), QgsWkbTypes::NoGeometry );
+    QCOMPARE( output->fields().names(), QStringList() << QStringLiteral( "origin_id" ) << QStringLiteral( "destination_id" ) << QStringLiteral( "cost" ) );
+    QCOMPARE( output->featureCount(), 4L );
+
+    // one row per origin and destination pair, in the order of the origins
+    QgsFeatureIterator it = output->getFeatures();
+    QgsFeature f;
+    QVERIFY( it.nextFeature( f ) );
+    QCOMPARE( f.attribute( 0 ).toString(), QStringLiteral( "a" ) );
+    QCOMPARE( f.attribute( 1 ).toLongLong(), 1LL );
+    QGSCOMPARENEAR( f.attribute( 2 ).toDouble(), 10, 0.01 );
+    QVERIFY( it.nextFeature( f ) );
+    QCOMPARE( f.attribute( 0 ).toString(), QStringLiteral( "a" ) );
+    QCOMPARE( f.attribute( 1 ).toLongLong(), 2LL );
+    QVERIFY( f.attribute( 2 ).isNull() );
+    QVERIFY( it.nextFeature( f ) );
+    QCOMPARE( f.attribute( 0 ).toString(), QStringLiteral( "b" ) );
+    QCOMPARE( f.attribute( 1 ).toLongLong(), 1LL );
+    QGSCOMPARENEAR( f.attribute( 2 ).toDouble(), 10, 0.1 );
+    QVERIFY( it.nextFeature( f ) );
+    QCOMPARE( f.attribute( 0 ).toString(), QStringLiteral( "b" ) );
+    QCOMPARE( f.attribute( 1 ).toLongLong(), 2LL );
+    QVERIFY( f.attribute( 2 ).isNull() );
+    QVERIFY( !it.nextFeature( f ) );
+  }
+
+  // cached hierarchies are only reused if they were built from the same graph
+  QTemporaryDir cacheDir;
+  parameters.insert( QStringLiteral( "CONTRACTION_HIERARCHY" ), true );
+  parameters.insert( QStringLiteral( "CONTRACTION_HIERARCHY_CACHE" ), cacheDir.path() );
+  auto firstCost = [&]() -> double
+  {
+    bool ok = false;
+    QgsProcessingFeedback feedback;
+    std::unique_ptr< QgsProcessingContext > context = qgis::make_unique< QgsProcessingContext >();
+    context->setProject( &p );
+    QVariantMap results = alg->run( parameters, *context, &feedback, &ok );
+    QgsVectorLayer *output = ok ? qobject_cast< QgsVectorLayer * >( context->getMapLayer( results.value( QStringLiteral( "OUTPUT" ) ).toString() ) ) : nullptr;
+    QgsFeature f;
+    if ( !output || !output->getFeatures().nextFeature( f ) )
+      return -1;
+    return f.attribute( 2 ).toDouble();
+  };
+  QGSCOMPARENEAR( firstCost(), 10, 0.01 );
+  const QStringList cachedFiles = QDir( cacheDir.path() ).entryList( QStringList() << QStringLiteral( "*.qgsch" ), QDir::Files );
+  QCOMPARE( cachedFiles.size(), 1 );
+  const QString cachedPath = QDir( cacheDir.path() ).filePath( cachedFiles.at( 0 ) );
+  const QgsContractionHierarchy cachedHierarchy = QgsContractionHierarchy::fromFile( cachedPath );
+  const QByteArray fingerprint = cachedHierarchy.fingerprint();
+  QVERIFY( !fingerprint.isEmpty() );
+
+  // a hierarchy of another graph with the same number of vertices, stored under the same name, is rebuilt
+  QgsGraph otherGraph;
+  for ( int i = 0; i < cachedHierarchy.vertexCount(); ++i )
+  {
+    otherGraph.addVertex( QgsPointXY( i, 0 ) );
+    if ( i > 0 )
+      otherGraph.addEdge( i - 1, i, QVector< QVariant >() << 1000.0 );
+  }
+  QVERIFY( QgsContractionHierarchy::build( QgsCompactGraph( otherGraph ), 0 ).writeToFile( cachedPath ) );
+  QGSCOMPARENEAR( firstCost(), 10, 0.01 );
+  QCOMPARE( QgsContractionHierarchy::fromFile( cachedPath ).fingerprint(), fingerprint );
+}
+
 void TestQgsProcessingAlgs::compareDatasets()
 {
   QgsProject p;
@@ -0,0 +1,290 @@
+/***************************************************************************
+     testqgsgeneralizationpyramid.cpp
+     --------------------------------
+    Date                 : October 2020
+    Copyright            : (C) 2020 by agent
+    Email                : agent at local
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include <QObject>
+#include <QSignalSpy>
+#include <QString>
+#include <QTemporaryDir>
+#include <cmath>
+
+#include <qgsapplication.h>
+#include "qgsfeatureiterator.h"
+#include "qgsgeneralizationpyramid.h"
+#include "qgsgeneralizationpyramidtask.h"
+#include "qgsgeometry.h"
+#include "qgslinestring.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorfilewriter.h"
+#include "qgsvectorlayer.h"
+
+static QgsFeature _waveFeature( QgsFeatureId id, int vertexCount )
+{
+  // a dense wave along the x axis, from 0 to 100
+  QVector< double > x;
+  QVector< double > y;
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    x << 100.0 * i / ( vertexCount - 1 );
+    y << 5 * std::sin( x.last() / 3.0 );
+  }
+  QgsFeature f( id );
+  f.setGeometry( QgsGeometry( new QgsLineString( x, y ) ) );
+  return f;
+}
+
+static std::unique_ptr< QgsVectorLayer > _waveLayer()
+{
+  std::unique_ptr< QgsVectorLayer > vl = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "LineString" ), QString(), QStringLiteral( "memory" ) );
+  QgsFeature shortLine( 2 );
+  shortLine.setGeometry( QgsGeometry::fromWkt( QStringLiteral( "LineString (0 0, 10 10)" ) ) );
+  QgsFeatureList features;
+  features << _waveFeature( 1, 20000 ) << shortLine << QgsFeature( 3 );
+  vl->dataProvider()->addFeatures( features );
+  return vl;
+}
+
+class TestQgsGeneralizationPyramid : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+
+    void initTestCase()
+    {
+      QgsApplication::init();
+      QgsApplication::initQgis();
+    }
+    void cleanupTestCase()
+    {
+      QgsApplication::exitQgis();
+    }
+
+    void testBuild()
+    {
+      std::unique_ptr< QgsVectorLayer > vl = _waveLayer();
+      QgsFeatureIterator it = vl->getFeatures();
+      const QgsGeneralizationPyramid pyramid = QgsGeneralizationPyramid::build( it, QList< double >() << 1 << 0.01 << 0.1 << -1 );
+      QVERIFY( pyramid.isValid() );
+      QCOMPARE( pyramid.levelCount(), 3 );
+      QCOMPARE( pyramid.tolerances(), QList< double >() << 0.01 << 0.1 << 1 );
+      QCOMPARE( pyramid.algorithm(), QgsMapToPixelSimplifier::Distance );
+      QCOMPARE( pyramid.sourceFeatureCount(), 3L );
+
+      QCOMPARE( pyramid.levelForTolerance( 0.005 ), -1 );
+      QCOMPARE( pyramid.levelForTolerance( 0.01 ), 0 );
+      QCOMPARE( pyramid.levelForTolerance( 0.5 ), 1 );
+      QCOMPARE( pyramid.levelForTolerance( 50 ), 2 );
+
+      const QgsGeometry original = vl->getFeature( 1 ).geometry();
+      int previousVertexCount = original.constGet()->nCoordinates();
+      for ( int level = 0; level < pyramid.levelCount(); ++level )
+      {
+        const QgsGeometry simplified = pyramid.geometry( level, 1 );
+        QVERIFY( !simplified.isNull() );
+        const int vertexCount = simplified.constGet()->nCoordinates();
+        QVERIFY( vertexCount < previousVertexCount );
+        previousVertexCount = vertexCount;
+        // every level is derived from the original geometry
+        QVERIFY( simplified.hausdorffDistance( original ) < 2 * pyramid.tolerances().at( level ) );
+      }
+
+      // geometries which cannot be reduced are not stored
+      QVERIFY( pyramid.geometry( 2, 2 ).isNull() );
+      QVERIFY( pyramid.geometry( 2, 3 ).isNull() );
+      QVERIFY( pyramid.geometry( 2, 4 ).isNull() );
+      QVERIFY( pyramid.geometry( 3, 1 ).isNull() );
+      QVERIFY( pyramid.geometry( -1, 1 ).isNull() );
+
+      QgsFeature f = vl->getFeature( 1 );
+      QVERIFY( pyramid.applyToFeature( 2, f ) );
+      QCOMPARE( f.geometry().asWkt(), pyramid.geometry( 2, 1 ).asWkt() );
+      f = vl->getFeature( 2 );
+      QVERIFY( !pyramid.applyToFeature( 2, f ) );
+      QCOMPARE( f.geometry().asWkt(), QStringLiteral( "LineString (0 0, 10 10)" ) );
+
+      // no usable tolerance
+      it = vl->getFeatures();
+      QVERIFY( !QgsGeneralizationPyramid::build( it, QList< double >() << 0 ).isValid() );
+      QVERIFY( !QgsGeneralizationPyramid().isValid() );
+      QCOMPARE( QgsGeneralizationPyramid().levelForTolerance( 100 ), -1 );
+    }
+
+    void testDefaultTolerances()
+    {
+      QVERIFY( QgsGeneralizationPyramid::defaultTolerances( QgsRectangle() ).isEmpty() );
+      const QList< double > tolerances = QgsGeneralizationPyramid::defaultTolerances( QgsRectangle( 0, 0, 2048, 1024 ), 3 );
+      QCOMPARE( tolerances.size(), 3 );
+      QGSCOMPARENEAR( tolerances.at( 0 ), 0.125, 1e-12 );
+      QGSCOMPARENEAR( tolerances.at( 1 ), 0.5, 1e-12 );
+      QGSCOMPARENEAR( tolerances.at( 2 ), 2, 1e-12 );
+    }
+
+    void testFile()
+    {
+      std::unique_ptr< QgsVectorLayer > vl = _waveLayer();
+      QgsFeatureIterator it = vl->getFeatures();
+      const QgsGeneralizationPyramid pyramid = QgsGeneralizationPyramid::build( it, QList< double >() << 0.01 << 0.1 << 1, QgsMapToPixelSimplifier::Visvalingam );
+
+      QTemporaryDir dir;
+      const QString path = dir.filePath( QStringLiteral( "wave.qgpyr" ) );
+      QString error;
+      QVERIFY( pyramid.writeToFile( path, &error ) );
+      QVERIFY( error.isEmpty() );
+
+      const QgsGeneralizationPyramid read = QgsGeneralizationPyramid::fromFile( path, &error );
+      QVERIFY( read.isValid() );
+      QCOMPARE( read.tolerances(), pyramid.tolerances() );
+      QCOMPARE( read.algorithm(), QgsMapToPixelSimplifier::Visvalingam );
+      QCOMPARE( read.sourceFeatureCount(), 3L );
+      for ( int level = 0; level < read.levelCount(); ++level )
+      {
+        QCOMPARE( read.geometry( level, 1 ).asWkt(), pyramid.geometry( level, 1 ).asWkt() );
+        QVERIFY( read.geometry( level, 2 ).isNull() );
+      }
+
+      // not a pyramid file
+      const QString badPath = dir.filePath( QStringLiteral( "bad.qgpyr" ) );
+      QFile badFile( badPath );
+      QVERIFY( badFile.open( QIODevice::WriteOnly ) );
+      badFile.write( "not a pyramid" );
+      badFile.close();
+      QVERIFY( !QgsGeneralizationPyramid::fromFile( badPath, &error ).isValid() );
+      QVERIFY( !error.isEmpty() );
+
+      // truncated file
+      QFile file( path );
+      QVERIFY( file.open( QIODevice::ReadWrite ) );
+      QVERIFY( file.resize( file.size() - 10 ) );
+      file.close();
+      error.clear();
+      QVERIFY( !QgsGeneralizationPyramid::fromFile( path, &error ).isValid() );
+      QVERIFY( !error.isEmpty() );
+
+      error.clear();
+      QVERIFY( !QgsGeneralizationPyramid::fromFile( dir.filePath( QStringLiteral( "missing.qgpyr" ) ), &error ).isValid() );
+      QVERIFY( !error.isEmpty() );
+    }
+
+    void testLayer()
+    {
+      std::unique_ptr< QgsVectorLayer > vl = _waveLayer();
+      QVERIFY( !vl->generalizationPyramid().isValid() );
+
+      // memory layers have no file telling whether a sidecar file is outdated, so none is written
+      QTemporaryDir dir;
+      const QString memoryPath = dir.filePath( QStringLiteral( "memory.qgpyr" ) );
+      QgsGeneralizationPyramidTask *task = vl->buildGeneralizationPyramid( QList< double >() << 0.1 << 1, memoryPath );
+      QVERIFY( task );
+      QSignalSpy spy( task, &QgsTask::taskCompleted );
+      QVERIFY( spy.wait() );
+      QVERIFY( vl->generalizationPyramid().isValid() );
+      QCOMPARE( vl->generalizationPyramid().tolerances(), QList< double >() << 0.1 << 1 );
+      QVERIFY( !vl->generalizationPyramid().sourceLastModified().isValid() );
+      QVERIFY( !QFile::exists( memoryPath ) );
+
+      // committing edits discards the pyramid, as geometries may have changed
+      QVERIFY( vl->startEditing() );
+      QVERIFY( vl->changeGeometry( 1, QgsGeometry::fromWkt( QStringLiteral( "LineString (0 0, 1 1)" ) ) ) );
+      QVERIFY( vl->commitChanges() );
+      QVERIFY( !vl->generalizationPyramid().isValid() );
+
+      // layers with uncommitted edits are not generalized, and rolling back discards the pyramid
+      QgsFeatureIterator it = vl->getFeatures();
+      vl->setGeneralizationPyramid( QgsGeneralizationPyramid::build( it, QList< double >() << 1 ) );
+      QVERIFY( vl->generalizationPyramid().isValid() );
+      QVERIFY( vl->startEditing() );
+      QVERIFY( !vl->buildGeneralizationPyramid() );
+      QVERIFY( vl->rollBack() );
+      QVERIFY( !vl->generalizationPyramid().isValid() );
+
+      it = vl->getFeatures();
+      vl->setGeneralizationPyramid( QgsGeneralizationPyramid::build( it, QList< double >() << 1 ) );
+      vl->setSubsetString( QStringLiteral( "1=1" ) );
+      QVERIFY( !vl->generalizationPyramid().isValid() );
+
+      // non spatial layers
+      QgsVectorLayer table( QStringLiteral( "None" ), QString(), QStringLiteral( "memory" ) );
+      QVERIFY( !table.buildGeneralizationPyramid() );
+    }
+
+    void testSidecar()
+    {
+      QTemporaryDir dir;
+      const QString gpkgPath = dir.filePath( QStringLiteral( "wave.gpkg" ) );
+      std::unique_ptr< QgsVectorLayer > memoryLayer = _waveLayer();
+      QgsVectorFileWriter::SaveVectorOptions options;
+      options.driverName = QStringLiteral( "GPKG" );
+      QString error;
+      QCOMPARE( QgsVectorFileWriter::writeAsVectorFormatV2( memoryLayer.get(), gpkgPath, QgsCoordinateTransformContext(), options, nullptr, nullptr, &error ), QgsVectorFileWriter::NoError );
+
+      QgsVectorLayer vl( gpkgPath, QStringLiteral( "wave" ), QStringLiteral( "ogr" ) );
+      QVERIFY( vl.isValid() );
+      QgsFeature first;
+      QVERIFY( vl.getFeatures().nextFeature( first ) );
+      const QgsFeatureId waveId = first.id();
+
+      const QString path = dir.filePath( QStringLiteral( "wave.qgpyr" ) );
+      QgsGeneralizationPyramidTask *task = vl.buildGeneralizationPyramid( QList< double >() << 0.1 << 1, path );
+      QVERIFY( task );
+      QSignalSpy spy( task, &QgsTask::taskCompleted );
+      QVERIFY( spy.wait() );
+      QVERIFY( QFile::exists( path ) );
+      const QgsGeneralizationPyramid built = vl.generalizationPyramid();
+      QVERIFY( built.sourceLastModified().isValid() );
+      QVERIFY( !built.geometry( 1, waveId ).isNull() );
+
+      // replace the sidecar file by a pyramid of shifted geometries with the same fingerprint,
+      // to tell whether it is reused or rebuilt
+      QgsGeometry shifted = _waveFeature( waveId, 20000 ).geometry();
+      shifted.translate( 1000, 0 );
+      QgsFeature shiftedFeature( waveId );
+      shiftedFeature.setGeometry( shifted );
+      std::unique_ptr< QgsVectorLayer > shiftedLayer = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "LineString" ), QString(), QStringLiteral( "memory" ) );
+      shiftedLayer->dataProvider()->addFeatures( QgsFeatureList() << shiftedFeature << QgsFeature( waveId + 1 ) << QgsFeature( waveId + 2 ) );
+      QgsFeatureIterator it = shiftedLayer->getFeatures();
+      QgsGeneralizationPyramid shiftedPyramid = QgsGeneralizationPyramid::build( it, built.tolerances(), built.algorithm() );
+      shiftedPyramid.setSourceLastModified( built.sourceLastModified() );
+      QVERIFY( shiftedPyramid.writeToFile( path ) );
+      const QString shiftedWkt = shiftedPyramid.geometry( 1, waveId ).asWkt();
+
+      // the sidecar file is reused when it matches the layer's file
+      vl.setGeneralizationPyramid( QgsGeneralizationPyramid() );
+      task = vl.buildGeneralizationPyramid( QList< double >() << 1 << 0.1, path );
+      QSignalSpy spy2( task, &QgsTask::taskCompleted );
+      QVERIFY( spy2.wait() );
+      QCOMPARE( vl.generalizationPyramid().geometry( 1, waveId ).asWkt(), shiftedWkt );
+
+      // once the file is modified, the sidecar file is outdated even with the same feature count
+      QVERIFY( shiftedPyramid.writeToFile( path ) );
+      // make sure the modification time changes on file systems with a coarse resolution
+      QTest::qSleep( 1100 );
+      QgsGeometryMap geometries;
+      geometries.insert( waveId, _waveFeature( waveId, 10000 ).geometry() );
+      QVERIFY( vl.dataProvider()->changeGeometryValues( geometries ) );
+      task = vl.buildGeneralizationPyramid( QList< double >() << 0.1 << 1, path );
+      QSignalSpy spy3( task, &QgsTask::taskCompleted );
+      QVERIFY( spy3.wait() );
+      QCOMPARE( vl.generalizationPyramid().sourceFeatureCount(), 3L );
+      QVERIFY( vl.generalizationPyramid().sourceLastModified() > built.sourceLastModified() );
+      QVERIFY( vl.generalizationPyramid().geometry( 1, waveId ).asWkt() != shiftedWkt );
+      QVERIFY( !vl.generalizationPyramid().geometry( 1, waveId ).isNull() );
+    }
+
+};
+
+QGSTEST_MAIN( TestQgsGeneralizationPyramid )
+
+#include "testqgsgeneralizationpyramid.moc"
@@ -89,6 +89,7 @@ class TestQgsGeometry : public QObject
     void partIterator();
 
     void geos();
+    void geosCaching();
 
     // geometry types
     void point(); //test QgsPointV2
@@ -145,6 +146,11 @@ class TestQgsGeometry : public QObject
     void exportToGeoJSON();
 
     void wkbInOut();
+    void wkbBulkVertices();
+    void wkbDecodeBenchmark_data();
+    void wkbDecodeBenchmark();
+    void wkbEncodeBenchmark_data();
+    void wkbEncodeBenchmark();
 
     void directionNeutralSegmentation();
     void poleOfInaccessibility();
@@ -614,6 +620,55 @@ void TestQgsGeometry::geos()
   QCOMPARE( res.asWkt(), QStringLiteral( "MultiPolygon (((0 0, 0 1, 1 1, 0 0)),((10 0, 10 1, 11 1, 10 0)))" ) );
 }
 
+void TestQgsGeometry::geosCaching()
+{
+  QgsGeometry poly = QgsGeometry::fromWkt( QStringLiteral( "Polygon ((0 0, 10 0, 10 10, 0 10, 0 0))" ) );
+  const QgsGeometry inside = QgsGeometry::fromWkt( QStringLiteral( "Point (5 5)" ) );
+  const QgsGeometry outside = QgsGeometry::fromWkt( QStringLiteral( "Point (15 5)" ) );
+  QVERIFY( !poly.geosCachingEnabled() );
+
+  // without caching, both geometries are converted on every call
+  QgsGeos::resetConversionCounts();
+  QVERIFY( poly.intersects( inside ) );
+  QVERIFY( !poly.intersects( outside ) );
+  QCOMPARE( QgsGeos::toGeosConversionCount(), 4ULL );
+
+  // with caching, only the other geometry is converted after the first call
+  poly.setGeosCachingEnabled( true );
+  QVERIFY( poly.geosCachingEnabled() );
+  QgsGeos::resetConversionCounts();
+  QVERIFY( poly.intersects( inside ) );
+  QVERIFY( !poly.intersects( outside ) );
+  QVERIFY( poly.contains( inside ) );
+  QGSCOMPARENEAR( poly.distance( outside ), 5.0, 0.0000001 );
+  QCOMPARE( QgsGeos::toGeosConversionCount(), 5ULL );
+
+  // implicitly shared copies share the cache
+  const QgsGeometry copy = poly;
+  QVERIFY( copy.geosCachingEnabled() );
+  QgsGeos::resetConversionCounts();
+  QVERIFY( copy.intersects( inside ) );
+  QCOMPARE( QgsGeos::toGeosConversionCount(), 1ULL );
+
+  // modifying the geometry must invalidate the cache
+  poly.translate( 10, 0 );
+  QVERIFY( poly.geosCachingEnabled() );
+  QgsGeos::resetConversionCounts();
+  QVERIFY( !poly.intersects( inside ) );
+  QVERIFY( poly.intersects( outside ) );
+  QCOMPARE( QgsGeos::toGeosConversionCount(), 3ULL );
+  // the original copy is unaffected
+  QVERIFY( copy.intersects( inside ) );
+  QVERIFY( !copy.intersects( outside ) );
+
+  // disabling caching drops the cached engine
+  poly.setGeosCachingEnabled( false );
+  QgsGeos::resetConversionCounts();
+  QVERIFY( poly.intersects( outside ) );
+  QVERIFY( poly.intersects( outside ) );
+  QCOMPARE( QgsGeos::toGeosConversionCount(), 4ULL );
+}
+
 void TestQgsGeometry::point()
 {
   //test QgsPointV2
@@ -17444,6 +17499,130 @@ void TestQgsGeometry::wkbInOut()
   QCOMPARE( badHeader.wkbType(), QgsWkbTypes::Unknown );
 }
 
+void TestQgsGeometry::wkbBulkVertices()
+{
+  // round trip of line strings and polygons through the bulk vertex import/export
+  const QStringList wkts = QStringList() << QStringLiteral( "LineString (1 2, 3 4, 5 6)" )
+                           << QStringLiteral( "LineStringZ (1 2 3, 4 5 6, 7 8 9)" )
+                           << QStringLiteral( "LineStringM (1 2 3, 4 5 6)" )
+                           << QStringLiteral( "LineStringZM (1 2 3 4, 5 6 7 8)" )
+                           << QStringLiteral( "LineString EMPTY" )
+                           << QStringLiteral( "PolygonZ ((0 0 1, 10 0 2, 10 10 3, 0 0 1),(1 1 1, 2 1 1, 2 2 1, 1 1 1))" )
+                           << QStringLiteral( "MultiLineStringM ((0 0 1, 1 1 2),(2 2 3, 3 3 4))" );
+  for ( const QString &wkt : wkts )
+  {
+    const QgsGeometry geom = QgsGeometry::fromWkt( wkt );
+    const QByteArray wkb = geom.asWkb();
+    QgsGeometry fromWkb;
+    fromWkb.fromWkb( wkb );
+    QCOMPARE( fromWkb.asWkt(), geom.asWkt() );
+    QCOMPARE( fromWkb.asWkb(), wkb );
+  }
+
+  // big endian WKB goes through the byte swapping path
+  QByteArray bigEndian;
+  QDataStream stream( &bigEndian, QIODevice::WriteOnly );
+  stream.setByteOrder( QDataStream::BigEndian );
+  stream.setFloatingPointPrecision( QDataStream::DoublePrecision );
+  stream << static_cast< quint8 >( 0 ) << static_cast< quint32 >( QgsWkbTypes::LineStringZ ) << static_cast< quint32 >( 3 );
+  stream << 1.0 << 2.0 << 3.0 << 4.0 << 5.0 << 6.0 << 7.0 << 8.0 << 9.0;
+  QgsLineString bigEndianLine;
+  QgsConstWkbPtr bigEndianPtr( bigEndian );
+  QVERIFY( bigEndianLine.fromWkb( bigEndianPtr ) );
+  QCOMPARE( bigEndianLine.asWkt(), QStringLiteral( "LineStringZ (1 2 3, 4 5 6, 7 8 9)" ) );
+  QCOMPARE( bigEndianPtr.remaining(), 0 );
+
+  // vertex count exceeding the WKB size must not be trusted
+  QByteArray truncated = QgsGeometry::fromWkt( QStringLiteral( "LineString (1 2, 3 4)" ) ).asWkb();
+  truncated[5] = static_cast< char >( 0xff );
+  truncated[6] = static_cast< char >( 0xff );
+  truncated[7] = static_cast< char >( 0xff );
+  QgsGeometry truncatedGeom;
+  truncatedGeom.fromWkb( truncated );
+  QVERIFY( truncatedGeom.isNull() );
+}
+
+namespace
+{
+  QgsLineString *benchmarkLine( int vertices, bool hasZ, bool hasM, double offset = 0 )
+  {
+    QVector< double > x, y, z, m;
+    for ( int i = 0; i < vertices; ++i )
+    {
+      const double angle = 2 * M_PI * i / vertices;
+      x << offset + std::cos( angle ) * 100;
+      y << offset + std::sin( angle ) * 100;
+      if ( hasZ )
+        z << i;
+      if ( hasM )
+        m << i * 0.5;
+    }
+    // closed, so that it can be used as a ring
+    x << x.at( 0 );
+    y << y.at( 0 );
+    if ( hasZ )
+      z << z.at( 0 );
+    if ( hasM )
+      m << m.at( 0 );
+    return new QgsLineString( x, y, z, m );
+  }
+
+  void addWkbBenchmarkRows()
+  {
+    QTest::addColumn<QByteArray>( "wkb" );
+
+    QTest::newRow( "point" ) << QgsGeometry( new QgsPoint( 1, 2 ) ).asWkb();
+    QTest::newRow( "linestring" ) << QgsGeometry( benchmarkLine( 10000, false, false ) ).asWkb();
+    QTest::newRow( "linestringz" ) << QgsGeometry( benchmarkLine( 10000, true, false ) ).asWkb();
+    QTest::newRow( "linestringzm" ) << QgsGeometry( benchmarkLine( 10000, true, true ) ).asWkb();
+
+    QgsPolygon *polygon = new QgsPolygon( benchmarkLine( 10000, false, false ) );
+    polygon->addInteriorRing( benchmarkLine( 1000, false, false ) );
+    QTest::newRow( "polygon" ) << QgsGeometry( polygon ).asWkb();
+
+    QgsMultiPolygon *multiPolygon = new QgsMultiPolygon();
+    for ( int i = 0; i < 100; ++i )
+      multiPolygon->addGeometry( new QgsPolygon( benchmarkLine( 100, false, false, i * 1000 ) ) );
+    QTest::newRow( "multipolygon" ) << QgsGeometry( multiPolygon ).asWkb();
+  }
+}
+
+void TestQgsGeometry::wkbDecodeBenchmark_data()
+{
+  addWkbBenchmarkRows();
+}
+
+void TestQgsGeometry::wkbDecodeBenchmark()
+{
+  QFETCH( QByteArray, wkb );
+
+  QBENCHMARK
+  {
+    QgsConstWkbPtr ptr( wkb );
+    std::unique_ptr< QgsAbstractGeometry > geom = QgsGeometryFactory::geomFromWkb( ptr );
+    QVERIFY( geom );
+  }
+}
+
+void TestQgsGeometry::wkbEncodeBenchmark_data()
+{
+  addWkbBenchmarkRows();
+}
+
+void TestQgsGeometry::wkbEncodeBenchmark()
+{
+  QFETCH( QByteArray, wkb );
+  QgsConstWkbPtr ptr( wkb );
+  std::unique_ptr< QgsAbstractGeometry > geom = QgsGeometryFactory::geomFromWkb( ptr );
+  QVERIFY( geom );
+
+  QBENCHMARK
+  {
+    const QByteArray encoded = geom->asWkb();
+    QCOMPARE( encoded.size(), wkb.size() );
+  }
+}
+
 void TestQgsGeometry::directionNeutralSegmentation()
 {
   //Tests, if segmentation of a circularstring is the same in both directions
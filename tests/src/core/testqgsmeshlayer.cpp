@@ -18,6 +18,8 @@
 #include "qgstest.h"
 #include <QObject>
 #include <QString>
+#include <QTemporaryDir>
+#include <QTextStream>
 
 //qgis includes...
 #include "qgsmaplayer.h"
@@ -82,6 +84,9 @@ class TestQgsMeshLayer : public QObject
     void test_reload_extra_dataset();
 
     void test_mesh_simplification();
+    void test_triangular_mesh_cache();
+    void test_dataset_cache();
+    void test_dataset_cache_blocks();
 
     void test_snap_on_mesh();
     void test_dataset_value_from_layer();
@@ -1166,6 +1171,245 @@ void TestQgsMeshLayer::test_mesh_simplification()
     delete m;
 }
 
+void TestQgsMeshLayer::test_triangular_mesh_cache()
+{
+  QgsMeshLayer layer( mDataDir + "/trap_steady_05_3D.nc", "Cache", "mdal" );
+  QVERIFY( layer.isValid() );
+  layer.setCrs( QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:27700" ) ) );
+
+  layer.updateTriangularMesh();
+  QgsTriangularMesh *nativeCrsMesh = layer.triangularMesh();
+  QVERIFY( nativeCrsMesh );
+  const QgsRectangle nativeExtent = nativeCrsMesh->extent();
+
+  const QgsCoordinateTransform transform( layer.crs(), QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:4326" ) ), QgsProject::instance() );
+  layer.updateTriangularMesh( transform );
+  QVERIFY( layer.triangularMesh() != nativeCrsMesh );
+  QVERIFY( layer.triangularMesh()->extent() != nativeExtent );
+  QCOMPARE( layer.triangularMesh()->triangles().count(), 640 );
+
+  // the mesh of the previous transform is reused
+  layer.updateTriangularMesh();
+  QCOMPARE( layer.triangularMesh(), nativeCrsMesh );
+  QCOMPARE( layer.triangularMesh()->extent(), nativeExtent );
+
+  // without cache, meshes are computed again
+  QCOMPARE( layer.triangularMeshCacheMaximumSize(), 256LL * 1024 * 1024 );
+  layer.setTriangularMeshCacheMaximumSize( 0 );
+  layer.updateTriangularMesh( transform );
+  layer.updateTriangularMesh();
+  QCOMPARE( layer.triangularMesh()->extent(), nativeExtent );
+  QCOMPARE( layer.triangularMesh()->triangles().count(), 640 );
+
+  // simplified meshes are computed in the background once simplification is enabled
+  QCOMPARE( layer.triangularMeshLevelOfDetailCount(), 1 );
+  const QVector<QgsTriangularMesh *> expectedMeshes = layer.triangularMesh()->simplifyMesh( 2 );
+  QVERIFY( !expectedMeshes.isEmpty() );
+  QgsMeshSimplificationSettings settings;
+  settings.setEnabled( true );
+  settings.setReductionFactor( 2 );
+  layer.setMeshSimplificationSettings( settings );
+  QTRY_COMPARE( layer.triangularMeshLevelOfDetailCount(), expectedMeshes.count() + 1 );
+  for ( int i = 0; i < expectedMeshes.count(); ++i )
+    QCOMPARE( layer.triangularMeshByLodIndex( i + 1 )->triangles().count(), expectedMeshes.at( i )->triangles().count() );
+  qDeleteAll( expectedMeshes );
+
+  // simplified meshes are kept with their base mesh in the cache
+  layer.setTriangularMeshCacheMaximumSize( 256 * 1024 * 1024 );
+  layer.updateTriangularMesh( transform );
+  QVERIFY( layer.triangularMeshLevelOfDetailCount() > 1 );
+  layer.updateTriangularMesh();
+  QCOMPARE( layer.triangularMeshLevelOfDetailCount(), expectedMeshes.count() + 1 );
+
+  // no background simplification is started when it cannot give any simplified mesh
+  QgsMeshLayer layer1D( mMdal1DLayer->source(), "Lines", "mdal" );
+  QVERIFY( layer1D.isValid() );
+  layer1D.updateTriangularMesh();
+  layer1D.setMeshSimplificationSettings( settings );
+  QVERIFY( !layer1D.mSimplificationPending );
+  QCOMPARE( layer1D.triangularMeshLevelOfDetailCount(), 1 );
+
+  QgsMeshLayer layerNoReduction( layer.source(), "No reduction", "mdal" );
+  QVERIFY( layerNoReduction.isValid() );
+  layerNoReduction.updateTriangularMesh();
+  settings.setReductionFactor( 1 );
+  layerNoReduction.setMeshSimplificationSettings( settings );
+  QVERIFY( !layerNoReduction.mSimplificationPending );
+  QCOMPARE( layerNoReduction.triangularMeshLevelOfDetailCount(), 1 );
+
+  // a base mesh is only simplified once, even when this gives no simplified mesh
+  settings.setReductionFactor( 2 );
+  layerNoReduction.mSimplificationAttemptedGeneration = layerNoReduction.mTriangularMeshesGeneration;
+  layerNoReduction.mSimplificationSettings = settings;
+  layerNoReduction.startSimplifiedMeshesComputation();
+  QVERIFY( !layerNoReduction.mSimplificationPending );
+  QCOMPARE( layerNoReduction.triangularMeshLevelOfDetailCount(), 1 );
+}
+
+void TestQgsMeshLayer::test_dataset_cache()
+{
+  QgsMeshLayer layer( mDataDir + "/quad_and_triangle.2dm", "Triangle and Quad MDAL", "mdal" );
+  layer.dataProvider()->addDataset( mDataDir + "/quad_and_triangle_vertex_scalar_with_inactive_face.dat" );
+  QgsMeshDataProvider *dp = layer.dataProvider();
+  QCOMPARE( layer.datasetGroupCount(), 2 );
+  QCOMPARE( layer.datasetCacheMaximumSize(), 128LL * 1024 * 1024 );
+
+  // values are the same when read from the provider and then from the cache
+  const QgsMeshDatasetIndex index( 1, 1 );
+  for ( int i = 0; i < 2; ++i )
+  {
+    const QgsMeshDataBlock values = layer.datasetValues( index, 1, 3 );
+    QVERIFY( values.isValid() );
+    QCOMPARE( values.count(), 3 );
+    QCOMPARE( values.values(), dp->datasetValues( index, 1, 3 ).values() );
+
+    const QgsMeshDataBlock active = layer.areFacesActive( index, 0, 2 );
+    QVERIFY( active.isValid() );
+    QVERIFY( !active.active( 0 ) );
+    QVERIFY( active.active( 1 ) );
+  }
+
+  // values which are not required are not read
+  QVector<bool> requiredVertices( 5, false );
+  QgsMeshDataBlock values = layer.datasetValues( index, requiredVertices );
+  QVERIFY( values.isValid() );
+  QCOMPARE( values.count(), 5 );
+  for ( double value : values.values() )
+    QVERIFY( std::isnan( value ) );
+  const QgsMeshDataBlock active = layer.areFacesActive( index, QVector<bool>( 2, false ) );
+  QVERIFY( active.isValid() );
+  QVERIFY( !active.active( 1 ) );
+
+  // values are read by blocks, so the whole small mesh is read
+  requiredVertices[2] = true;
+  values = layer.datasetValues( index, requiredVertices );
+  QCOMPARE( values.value( 2 ), QgsMeshDatasetValue( 4.0 ) );
+  QCOMPARE( values.value( 0 ), QgsMeshDatasetValue( 2.0 ) );
+
+  // read ahead of another time step
+  layer.setDatasetCacheMaximumSize( 1024 * 1024 );
+  QCOMPARE( layer.datasetCacheMaximumSize(), 1024LL * 1024 );
+  layer.prefetchDataset( QgsMeshDatasetIndex( 1, 0 ), QVector<bool>( 5, true ), QVector<bool>( 2, true ) );
+  values = layer.datasetValues( QgsMeshDatasetIndex( 1, 0 ), QVector<bool>( 5, true ) );
+  QCOMPARE( values.value( 0 ), QgsMeshDatasetValue( 1.0 ) );
+  QCOMPARE( values.value( 2 ), QgsMeshDatasetValue( 3.0 ) );
+
+  // the cache is cleared when reloading
+  layer.reload();
+  QCOMPARE( layer.datasetValues( index, 0, 5 ).value( 4 ), QgsMeshDatasetValue( 2.0 ) );
+}
+
+void TestQgsMeshLayer::test_dataset_cache_blocks()
+{
+  // a grid mesh with more vertices and faces than a block of the dataset cache
+  const int size = 130;
+  const int vertexCount = size * size;
+  const int faceCount = ( size - 1 ) * ( size - 1 );
+  QTemporaryDir dir;
+  const QString meshPath = dir.filePath( QStringLiteral( "grid.2dm" ) );
+  const QString datasetPath = dir.filePath( QStringLiteral( "grid_vertex_scalar.dat" ) );
+  {
+    QFile file( meshPath );
+    QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Text ) );
+    QTextStream stream( &file );
+    stream << "MESH2D\n";
+    for ( int i = 0; i < vertexCount; ++i )
+      stream << "ND " << i + 1 << " " << i % size << " " << i / size << " 0\n";
+    for ( int i = 0; i < faceCount; ++i )
+    {
+      const int vertex = ( i / ( size - 1 ) ) * size + i % ( size - 1 ) + 1;
+      stream << "E4Q " << i + 1 << " " << vertex << " " << vertex + 1 << " " << vertex + size + 1 << " " << vertex + size << " 1\n";
+    }
+  }
+  {
+    // face 16500 is inactive at both time steps, face 100 only at the second one
+    QFile file( datasetPath );
+    QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Text ) );
+    QTextStream stream( &file );
+    stream << "DATASET\nOBJTYPE \"mesh2d\"\nBEGSCL\nND " << vertexCount << "\nNC " << faceCount << "\nNAME \"Grid\"\nTIMEUNITS se\n";
+    for ( int timeStep = 0; timeStep < 2; ++timeStep )
+    {
+      stream << "TS 1 " << timeStep * 3600 << "\n";
+      for ( int i = 0; i < faceCount; ++i )
+        stream << ( i == 16500 || ( timeStep == 1 && i == 100 ) ? "0\n" : "1\n" );
+      for ( int i = 0; i < vertexCount; ++i )
+        stream << i + timeStep * 0.5 << "\n";
+    }
+    stream << "ENDDS\n";
+  }
+
+  QgsMeshLayer layer( meshPath, QStringLiteral( "Grid" ), QStringLiteral( "mdal" ) );
+  QVERIFY( layer.isValid() );
+  QVERIFY( layer.dataProvider()->addDataset( datasetPath ) );
+  QCOMPARE( layer.datasetGroupCount(), 2 );
+  QCOMPARE( layer.dataProvider()->vertexCount(), vertexCount );
+  QCOMPARE( layer.dataProvider()->faceCount(), faceCount );
+  const QgsMeshDatasetIndex index( 1, 0 );
+  const QgsMeshDatasetIndex nextIndex( 1, 1 );
+
+  // a range at the end of the first block and the start of the second one
+  QgsMeshDataBlock values = layer.datasetValues( index, 16380, 10 );
+  QCOMPARE( values.count(), 10 );
+  for ( int i = 0; i < 10; ++i )
+    QCOMPARE( values.value( i ).scalar(), 16380.0 + i );
+  QgsMeshDataBlock active = layer.areFacesActive( index, 16380, 200 );
+  QCOMPARE( active.count(), 200 );
+  for ( int i = 0; i < 200; ++i )
+    QCOMPARE( active.active( i ), 16380 + i != 16500 );
+  QCOMPARE( layer.datasetCacheHitCount(), 0LL );
+  QCOMPARE( layer.datasetCacheMissCount(), 4LL );
+
+  // the first block is skipped when none of its values is required: its values are NaN and its faces inactive
+  QVector<bool> requiredVertices( vertexCount, false );
+  requiredVertices[16400] = true;
+  values = layer.datasetValues( index, requiredVertices );
+  QCOMPARE( values.count(), vertexCount );
+  QVERIFY( std::isnan( values.value( 0 ).scalar() ) );
+  QVERIFY( std::isnan( values.value( 16383 ).scalar() ) );
+  QCOMPARE( values.value( 16384 ).scalar(), 16384.0 );
+  QCOMPARE( values.value( vertexCount - 1 ).scalar(), vertexCount - 1.0 );
+  QVector<bool> requiredFaces( faceCount, false );
+  requiredFaces[100] = true;
+  active = layer.areFacesActive( index, requiredFaces );
+  QCOMPARE( active.count(), faceCount );
+  QVERIFY( active.active( 0 ) );
+  QVERIFY( active.active( 100 ) );
+  QVERIFY( !active.active( 16384 ) );
+  QVERIFY( !active.active( faceCount - 1 ) );
+  QCOMPARE( layer.datasetCacheHitCount(), 2LL );
+  QCOMPARE( layer.datasetCacheMissCount(), 4LL );
+
+  // reading ahead the next time step is done once the event loop runs, between the other provider calls
+  layer.prefetchDataset( nextIndex, QVector<bool>( vertexCount, true ), QVector<bool>( faceCount, true ) );
+  QCOMPARE( layer.datasetCacheMissCount(), 4LL );
+  QCOMPARE( layer.datasetGroupMetadata( index ).dataType(), QgsMeshDatasetGroupMetadata::DataOnVertices );
+  QVERIFY( layer.datasetMetadata( nextIndex ).isValid() );
+  QCOMPARE( layer.datasetValue( index, 16500 ).scalar(), 16500.0 );
+  QVERIFY( !layer.isFaceActive( index, 16500 ) );
+  QCOMPARE( layer.datasetValues( index, 0, 5 ).value( 4 ).scalar(), 4.0 );
+  QTRY_COMPARE( layer.datasetCacheMissCount(), 8LL );
+
+  // all the blocks of the next time step are then in the cache
+  const qint64 hits = layer.datasetCacheHitCount();
+  values = layer.datasetValues( nextIndex, 0, vertexCount );
+  QCOMPARE( values.value( 0 ).scalar(), 0.5 );
+  QCOMPARE( values.value( 16500 ).scalar(), 16500.5 );
+  active = layer.areFacesActive( nextIndex, 0, faceCount );
+  QVERIFY( !active.active( 100 ) );
+  QVERIFY( active.active( 101 ) );
+  QVERIFY( !active.active( 16500 ) );
+  QCOMPARE( layer.datasetCacheHitCount(), hits + 4 );
+  QCOMPARE( layer.datasetCacheMissCount(), 8LL );
+
+  // pending reads ahead are canceled when the provider reloads, the cache is emptied first so that they would read from the provider
+  layer.setDatasetCacheMaximumSize( 0 );
+  layer.setDatasetCacheMaximumSize( 1024 * 1024 );
+  layer.prefetchDataset( index, QVector<bool>( vertexCount, true ), QVector<bool>( faceCount, true ) );
+  layer.reload();
+  QCoreApplication::processEvents();
+  QCOMPARE( layer.datasetCacheMissCount(), 8LL );
+}
+
 void TestQgsMeshLayer::test_snap_on_mesh()
 {
   //1D mesh
@@ -16,6 +16,7 @@
 #include <QObject>
 #include <QString>
 #include <QApplication>
+#include <cmath>
 
 //qgis includes...
 #include <qgsrasterblock.h>
@@ -24,6 +25,9 @@
 #include <qgsapplication.h>
 #include <qgscoordinatereferencesystem.h>
 #include <qgsproject.h>
+#include <qgscoordinatetransform.h>
+#include <qgsmaptopixel.h>
+#include <qgstriangularmesh.h>
 
 /**
  * \ingroup UnitTests
@@ -39,6 +43,8 @@ class TestQgsMeshLayerInterpolator: public QObject
     void cleanup() {} // will be called after every testfunction.
 
     void testExportRasterBand();
+    void testRasterizeLargeMesh();
+    void benchmarkRasterizeLargeMesh();
   private:
     QString mTestDataDir;
 };
@@ -89,5 +95,120 @@ void TestQgsMeshLayerInterpolator::testExportRasterBand()
   QVERIFY( block->isNoData( 10, 10 ) );
 }
 
+//! Grid of quads from (0, 0) to (size, size), with vertex values following a linear function
+static void _gridMesh( int size, QgsTriangularMesh &triangularMesh, QgsMeshDataBlock &vertexValues )
+{
+  QgsMesh mesh;
+  QVector<double> values;
+  for ( int j = 0; j <= size; ++j )
+  {
+    for ( int i = 0; i <= size; ++i )
+    {
+      mesh.vertices.append( QgsMeshVertex( i, j ) );
+      values.append( i + 2.0 * j );
+    }
+  }
+  for ( int j = 0; j < size; ++j )
+  {
+    for ( int i = 0; i < size; ++i )
+    {
+      const int v = j * ( size + 1 ) + i;
+      mesh.faces.append( QgsMeshFace() << v << v + 1 << v + size + 2 << v + size + 1 );
+    }
+  }
+  triangularMesh.update( &mesh );
+
+  vertexValues = QgsMeshDataBlock( QgsMeshDataBlock::ScalarDouble, values.count() );
+  vertexValues.setValues( values );
+}
+
+void TestQgsMeshLayerInterpolator::testRasterizeLargeMesh()
+{
+  QgsTriangularMesh triangularMesh;
+  QgsMeshDataBlock vertexValues;
+  _gridMesh( 100, triangularMesh, vertexValues );
+  QgsMeshDataBlock activeFlags( QgsMeshDataBlock::ActiveFlagInteger, 100 * 100 );
+  activeFlags.setValid( true );
+
+  // enough rows to be rasterized in several bands
+  const QgsRectangle extent( -10, -10, 110, 110 );
+  const double mapUnitsPerPixel = 0.25;
+  std::unique_ptr< QgsRasterBlock > block( QgsMeshUtils::exportRasterBlock( triangularMesh, vertexValues, activeFlags,
+      QgsMeshDatasetGroupMetadata::DataOnVertices, QgsCoordinateTransform(), mapUnitsPerPixel, extent ) );
+  QCOMPARE( block->width(), 480 );
+  QCOMPARE( block->height(), 480 );
+
+  // values are linear in the mesh, so barycentric interpolation gives them exactly
+  const QgsMapToPixel mapToPixel( mapUnitsPerPixel, extent.center().x(), extent.center().y(), 480, 480, 0 );
+  int dataCount = 0;
+  for ( int row = 0; row < block->height(); ++row )
+  {
+    for ( int col = 0; col < block->width(); ++col )
+    {
+      const QgsPointXY point = mapToPixel.toMapCoordinates( col, row );
+      if ( point.x() > 0 && point.x() < 100 && point.y() > 0 && point.y() < 100 )
+      {
+        QVERIFY( !block->isNoData( row, col ) );
+        QGSCOMPARENEAR( block->value( row, col ), point.x() + 2 * point.y(), 1e-9 );
+        ++dataCount;
+      }
+      else if ( point.x() < -0.01 || point.x() > 100.01 || point.y() < -0.01 || point.y() > 100.01 )
+      {
+        QVERIFY( block->isNoData( row, col ) );
+      }
+    }
+  }
+  QCOMPARE( dataCount, 399 * 399 );
+
+  // values on faces, with the faces of the left half inactive
+  QVector<double> faceValues;
+  QVector<int> active;
+  for ( int j = 0; j < 100; ++j )
+  {
+    for ( int i = 0; i < 100; ++i )
+    {
+      faceValues.append( j * 100 + i );
+      active.append( i < 50 ? 0 : 1 );
+    }
+  }
+  QgsMeshDataBlock faceValuesBlock( QgsMeshDataBlock::ScalarDouble, faceValues.count() );
+  faceValuesBlock.setValues( faceValues );
+  activeFlags.setActive( active );
+  block.reset( QgsMeshUtils::exportRasterBlock( triangularMesh, faceValuesBlock, activeFlags,
+               QgsMeshDatasetGroupMetadata::DataOnFaces, QgsCoordinateTransform(), mapUnitsPerPixel, extent ) );
+  for ( int row = 0; row < block->height(); row += 7 )
+  {
+    for ( int col = 0; col < block->width(); col += 7 )
+    {
+      const QgsPointXY point = mapToPixel.toMapCoordinates( col, row );
+      if ( point.x() > 50.01 && point.x() < 100 && point.y() > 0 && point.y() < 100
+           && !qgsDoubleNear( point.x(), std::round( point.x() ), 0.01 ) && !qgsDoubleNear( point.y(), std::round( point.y() ), 0.01 ) )
+      {
+        QCOMPARE( block->value( row, col ), std::floor( point.y() ) * 100 + std::floor( point.x() ) );
+      }
+      else if ( point.x() < 49.99 )
+      {
+        QVERIFY( block->isNoData( row, col ) );
+      }
+    }
+  }
+}
+
+void TestQgsMeshLayerInterpolator::benchmarkRasterizeLargeMesh()
+{
+  QgsTriangularMesh triangularMesh;
+  QgsMeshDataBlock vertexValues;
+  _gridMesh( 700, triangularMesh, vertexValues );
+  QgsMeshDataBlock activeFlags( QgsMeshDataBlock::ActiveFlagInteger, 700 * 700 );
+  activeFlags.setValid( true );
+
+  QBENCHMARK
+  {
+    std::unique_ptr< QgsRasterBlock > block( QgsMeshUtils::exportRasterBlock( triangularMesh, vertexValues, activeFlags,
+        QgsMeshDatasetGroupMetadata::DataOnVertices, QgsCoordinateTransform(), 0.35, QgsRectangle( 0, 0, 700, 700 ) ) );
+    QVERIFY( block->isValid() );
+  }
+}
+
 QGSTEST_MAIN( TestQgsMeshLayerInterpolator )
 #include "testqgsmeshlayerinterpolator.moc"
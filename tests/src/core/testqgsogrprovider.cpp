@@ -24,8 +24,13 @@
 #include <qgsproviderregistry.h>
 #include <qgsvectorlayer.h>
 #include <qgsnetworkaccessmanager.h>
+#include <qgsvectorfilewriter.h>
+#include <qgsvectordataprovider.h>
+#include <qgsgeometry.h>
+#include <qgscoordinatetransformcontext.h>
 
 #include <QObject>
+#include <QTemporaryDir>
 
 #include <cpl_conv.h>
 
@@ -48,6 +53,7 @@ class TestQgsOgrProvider : public QObject
     void decodeUri();
     void encodeUri();
     void testThread();
+    void readAhead();
 
   private:
     QString mTestDataDir;
@@ -351,6 +357,74 @@ void TestQgsOgrProvider::testThread()
 
 }
 
+void TestQgsOgrProvider::readAhead()
+{
+  // write a layer spanning several read ahead batches
+  QgsVectorLayer source( QStringLiteral( "Point?crs=epsg:4326&field=id:integer&field=name:string" ), QStringLiteral( "source" ), QStringLiteral( "memory" ) );
+  QVERIFY( source.isValid() );
+  QgsFeatureList features;
+  for ( int i = 0; i < 1000; ++i )
+  {
+    QgsFeature f( source.fields() );
+    f.setAttributes( QgsAttributes() << i << QStringLiteral( "f%1" ).arg( i ) );
+    f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( i % 40, i / 40 ) ) );
+    features << f;
+  }
+  QVERIFY( source.dataProvider()->addFeatures( features ) );
+
+  QTemporaryDir dir;
+  const QString path = dir.path() + QStringLiteral( "/read_ahead.gpkg" );
+  QgsVectorFileWriter::SaveVectorOptions options;
+  options.driverName = QStringLiteral( "GPKG" );
+  QString error;
+  QCOMPARE( QgsVectorFileWriter::writeAsVectorFormatV2( &source, path, QgsCoordinateTransformContext(), options, nullptr, nullptr, &error ), QgsVectorFileWriter::NoError );
+
+  QgsSettings settings;
+  settings.setValue( QStringLiteral( "qgis/ogrReadAhead" ), false );
+  QgsVectorLayer direct( path, QStringLiteral( "direct" ), QStringLiteral( "ogr" ) );
+  settings.setValue( QStringLiteral( "qgis/ogrReadAhead" ), true );
+  QgsVectorLayer readAhead( path, QStringLiteral( "read_ahead" ), QStringLiteral( "ogr" ) );
+  settings.remove( QStringLiteral( "qgis/ogrReadAhead" ) );
+  QVERIFY( direct.isValid() );
+  QVERIFY( readAhead.isValid() );
+
+  auto collect = []( QgsFeatureIterator it ) -> QStringList
+  {
+    QStringList res;
+    QgsFeature f;
+    while ( it.nextFeature( f ) )
+    {
+      res << QStringLiteral( "%1:%2:%3:%4" ).arg( f.id() ).arg( f.isValid() ).arg( f.attribute( QStringLiteral( "name" ) ).toString(), f.geometry().asWkt( 3 ) );
+    }
+    return res;
+  };
+
+  const QList< QgsFeatureRequest > requests = QList< QgsFeatureRequest >()
+      << QgsFeatureRequest()
+      << QgsFeatureRequest().setFilterRect( QgsRectangle( 5.5, 5.5, 20.5, 15.5 ) )
+      << QgsFeatureRequest().setFilterExpression( QStringLiteral( "\"id\" % 3 = 0" ) )
+      << QgsFeatureRequest().setSubsetOfAttributes( QStringList() << QStringLiteral( "name" ), source.fields() ).setFlags( QgsFeatureRequest::NoGeometry )
+      << QgsFeatureRequest().setDestinationCrs( QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:3857" ) ), QgsCoordinateTransformContext() );
+  for ( const QgsFeatureRequest &request : requests )
+  {
+    const QStringList expected = collect( direct.getFeatures( request ) );
+    QVERIFY( !expected.isEmpty() );
+    QCOMPARE( collect( readAhead.getFeatures( request ) ), expected );
+  }
+  QCOMPARE( collect( readAhead.getFeatures() ).size(), 1000 );
+
+  // rewind and early close while the producer is still reading
+  QgsFeatureIterator it = readAhead.getFeatures();
+  QgsFeature f;
+  QVERIFY( it.nextFeature( f ) );
+  const QgsFeatureId firstId = f.id();
+  QVERIFY( it.nextFeature( f ) );
+  QVERIFY( it.rewind() );
+  QVERIFY( it.nextFeature( f ) );
+  QCOMPARE( f.id(), firstId );
+  QVERIFY( it.close() );
+  QVERIFY( !it.nextFeature( f ) );
+}
 
 QGSTEST_MAIN( TestQgsOgrProvider )
 #include "testqgsogrprovider.moc"
@@ -0,0 +1,276 @@
+/***************************************************************************
+     testqgspackedspatialindex.cpp
+     -----------------------------
+    Date                 : October 2020
+    Copyright            : (C) 2020 by agent
+    Email                : agent at local
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgstest.h"
+#include <QObject>
+#include <QString>
+#include <QTemporaryDir>
+
+#include <qgsapplication.h>
+#include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
+#include "qgspackedspatialindex.h"
+#include "qgspackedspatialindex_p.h"
+#include "qgsspatialindex.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+static QgsFeature _pointFeature( QgsFeatureId id, qreal x, qreal y )
+{
+  QgsFeature f( id );
+  QgsGeometry g = QgsGeometry::fromPointXY( QgsPointXY( x, y ) );
+  f.setGeometry( g );
+  return f;
+}
+
+static QList<QgsFeature> _pointFeatures()
+{
+  /*
+   *  2   |   1
+   *      |
+   * -----+-----
+   *      |
+   *  3   |   4
+   */
+
+  QList<QgsFeature> feats;
+  feats << _pointFeature( 1,  1,  1 )
+        << _pointFeature( 2, -1,  1 )
+        << _pointFeature( 3, -1, -1 )
+        << _pointFeature( 4,  1, -1 );
+  return feats;
+}
+
+static std::unique_ptr< QgsVectorLayer > _gridLayer( int size )
+{
+  // a grid of size x size small squares, with ids following the row/column
+  std::unique_ptr< QgsVectorLayer > vl = qgis::make_unique< QgsVectorLayer >( QStringLiteral( "Polygon" ), QString(), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  for ( int i = 0; i < size; ++i )
+  {
+    for ( int j = 0; j < size; ++j )
+    {
+      QgsFeature f( i * size + j );
+      f.setGeometry( QgsGeometry::fromRect( QgsRectangle( i, j, i + 0.5, j + 0.5 ) ) );
+      features << f;
+    }
+  }
+  vl->dataProvider()->addFeatures( features );
+  return vl;
+}
+
+class TestQgsPackedSpatialIndex : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+
+    void initTestCase()
+    {
+      QgsApplication::init();
+      QgsApplication::initQgis();
+    }
+    void cleanupTestCase()
+    {
+      QgsApplication::exitQgis();
+    }
+
+    void testQuery()
+    {
+      std::unique_ptr< QgsVectorLayer > vl = qgis::make_unique< QgsVectorLayer >( "Point", QString(), QStringLiteral( "memory" ) );
+      for ( QgsFeature f : _pointFeatures() )
+        vl->dataProvider()->addFeature( f );
+      QgsPackedSpatialIndex index( *vl->dataProvider() );
+      QCOMPARE( index.size(), 4ULL );
+      QCOMPARE( index.extent(), QgsRectangle( -1, -1, 1, 1 ) );
+
+      QList<QgsFeatureId> fids = index.intersects( QgsRectangle( 0, 0, 10, 10 ) );
+      QCOMPARE( fids, QList<QgsFeatureId>() << 1 );
+
+      QList<QgsFeatureId> fids2 = index.intersects( QgsRectangle( -10, -10, 0, 10 ) );
+      std::sort( fids2.begin(), fids2.end() );
+      QCOMPARE( fids2, QList<QgsFeatureId>() << 2 << 3 );
+
+      QVERIFY( index.intersects( QgsRectangle( 2, 2, 3, 3 ) ).isEmpty() );
+
+      // visitor, stopping after the first match
+      int count = 0;
+      index.intersects( QgsRectangle( -10, -10, 10, 10 ), [&count]( QgsFeatureId ) -> bool { count++; return false; } );
+      QCOMPARE( count, 1 );
+
+      QList<QgsFeatureId> nearest = index.nearestNeighbor( QgsPointXY( 0.9, -0.8 ), 1 );
+      QCOMPARE( nearest, QList<QgsFeatureId>() << 4 );
+      nearest = index.nearestNeighbor( QgsPointXY( 0.9, -0.8 ), 2 );
+      QCOMPARE( nearest, QList<QgsFeatureId>() << 4 << 1 );
+      // equidistant features
+      nearest = index.nearestNeighbor( QgsPointXY( 0, 0 ), 1 );
+      QCOMPARE( nearest.count(), 4 );
+      // max distance
+      QVERIFY( index.nearestNeighbor( QgsPointXY( 5, 5 ), 1, 1 ).isEmpty() );
+    }
+
+    void testEmpty()
+    {
+      QgsPackedSpatialIndex index;
+      QCOMPARE( index.size(), 0ULL );
+      QVERIFY( index.intersects( QgsRectangle( 0, 0, 10, 10 ) ).isEmpty() );
+      QVERIFY( index.nearestNeighbor( QgsPointXY( 0, 0 ), 3 ).isEmpty() );
+
+      std::unique_ptr< QgsVectorLayer > vl = qgis::make_unique< QgsVectorLayer >( "Point", QString(), QStringLiteral( "memory" ) );
+      QgsPackedSpatialIndex index2( *vl->dataProvider() );
+      QCOMPARE( index2.size(), 0ULL );
+      QVERIFY( index2.intersects( QgsRectangle( 0, 0, 10, 10 ) ).isEmpty() );
+    }
+
+    void testLargeIndex()
+    {
+      // compare results with QgsSpatialIndex, on a grid large enough to be built in parallel
+      std::unique_ptr< QgsVectorLayer > vl = _gridLayer( 300 );
+      QgsPackedSpatialIndex index( *vl->dataProvider() );
+      QCOMPARE( index.size(), 90000ULL );
+      QgsSpatialIndex reference( *vl->dataProvider() );
+
+      QVector< QgsRectangle > rectangles;
+      rectangles << QgsRectangle( 10.2, 10.2, 20.7, 12.7 )
+                 << QgsRectangle( -5, -5, 0.2, 0.2 )
+                 << QgsRectangle( 299.4, 299.4, 400, 400 )
+                 << QgsRectangle( 150.6, 0, 150.9, 300 );
+      for ( int i = 0; i < 500; ++i )
+        rectangles << QgsRectangle( i % 300, ( 7 * i ) % 300, i % 300 + 3.2, ( 7 * i ) % 300 + 1.2 );
+
+      const QVector< QList<QgsFeatureId> > results = index.intersects( rectangles );
+      QCOMPARE( results.size(), rectangles.size() );
+      for ( int i = 0; i < rectangles.size(); ++i )
+      {
+        QList<QgsFeatureId> expected = reference.intersects( rectangles.at( i ) );
+        std::sort( expected.begin(), expected.end() );
+        QList<QgsFeatureId> actual = results.at( i );
+        std::sort( actual.begin(), actual.end() );
+        QCOMPARE( actual, expected );
+
+        // same as individual queries
+        actual = index.intersects( rectangles.at( i ) );
+        std::sort( actual.begin(), actual.end() );
+        QCOMPARE( actual, expected );
+      }
+      QCOMPARE( results.at( 1 ), QList<QgsFeatureId>() << 0 );
+      QCOMPARE( results.at( 2 ), QList<QgsFeatureId>() << 89999 );
+      QVERIFY( results.at( 3 ).isEmpty() );
+
+      QCOMPARE( index.nearestNeighbor( QgsPointXY( 120.25, 37.25 ), 1 ), QList<QgsFeatureId>() << 120 * 300 + 37 );
+      QList<QgsFeatureId> nearest = index.nearestNeighbor( QgsPointXY( 120.75, 37.25 ), 2 );
+      std::sort( nearest.begin(), nearest.end() );
+      QCOMPARE( nearest, QList<QgsFeatureId>() << 120 * 300 + 37 << 121 * 300 + 37 );
+    }
+
+    void testFile()
+    {
+      std::unique_ptr< QgsVectorLayer > vl = _gridLayer( 50 );
+      QgsPackedSpatialIndex index( *vl->dataProvider(), nullptr, 8 );
+
+      QTemporaryDir dir;
+      const QString path = dir.filePath( QStringLiteral( "index.qpsi" ) );
+      QString error;
+      QVERIFY( index.writeToFile( path, &error ) );
+      QVERIFY( error.isEmpty() );
+
+      QgsPackedSpatialIndex index2 = QgsPackedSpatialIndex::fromFile( path, &error );
+      QVERIFY( error.isEmpty() );
+      QCOMPARE( index2.size(), index.size() );
+      QCOMPARE( index2.nodeSize(), 8 );
+      QCOMPARE( index2.extent(), index.extent() );
+      QCOMPARE( index2.d->mBoxes, index.d->mBoxes );
+      QCOMPARE( index2.d->mIndices, index.d->mIndices );
+
+      QList<QgsFeatureId> fids = index2.intersects( QgsRectangle( 10.2, 10.2, 11.7, 10.7 ) );
+      std::sort( fids.begin(), fids.end() );
+      QCOMPARE( fids, QList<QgsFeatureId>() << 10 * 50 + 10 << 11 * 50 + 10 );
+
+      // invalid files
+      QgsPackedSpatialIndex index3 = QgsPackedSpatialIndex::fromFile( dir.filePath( QStringLiteral( "missing.qpsi" ) ), &error );
+      QVERIFY( !error.isEmpty() );
+      QCOMPARE( index3.size(), 0ULL );
+
+      QFile file( path );
+      QVERIFY( file.resize( file.size() - 8 ) );
+      error.clear();
+      index3 = QgsPackedSpatialIndex::fromFile( path, &error );
+      QVERIFY( !error.isEmpty() );
+      QCOMPARE( index3.size(), 0ULL );
+
+      // corrupted header counts must be rejected before allocating anything
+      QVERIFY( index.writeToFile( path, &error ) );
+      const auto corruptHeader = [&path]( qint64 offset, const QByteArray & bytes )
+      {
+        QFile f( path );
+        if ( !f.open( QIODevice::ReadWrite ) || !f.seek( offset ) )
+          return false;
+        return f.write( bytes ) == bytes.size();
+      };
+      // item count, after magic, version, byte order and node size
+      QVERIFY( corruptHeader( 17, QByteArray( 8, '\xff' ) ) );
+      error.clear();
+      index3 = QgsPackedSpatialIndex::fromFile( path, &error );
+      QVERIFY( !error.isEmpty() );
+      QCOMPARE( index3.size(), 0ULL );
+
+      // level count, after the item count and extent
+      QVERIFY( index.writeToFile( path, &error ) );
+      QVERIFY( corruptHeader( 57, QByteArray( 4, '\xff' ) ) );
+      error.clear();
+      index3 = QgsPackedSpatialIndex::fromFile( path, &error );
+      QVERIFY( !error.isEmpty() );
+      QCOMPARE( index3.size(), 0ULL );
+    }
+
+    void testCopy()
+    {
+      std::unique_ptr< QgsVectorLayer > vl = qgis::make_unique< QgsVectorLayer >( "Point", QString(), QStringLiteral( "memory" ) );
+      for ( QgsFeature f : _pointFeatures() )
+        vl->dataProvider()->addFeature( f );
+
+      std::unique_ptr< QgsPackedSpatialIndex > index( new QgsPackedSpatialIndex( *vl->dataProvider() ) );
+
+      // create copy of the index
+      std::unique_ptr< QgsPackedSpatialIndex > indexCopy( new QgsPackedSpatialIndex( *index ) );
+
+      QVERIFY( index->d == indexCopy->d );
+      QVERIFY( index->d->ref == 2 );
+
+      index.reset();
+
+      // test that copied index still works
+      QList<QgsFeatureId> fids = indexCopy->intersects( QgsRectangle( 0, 0, 10, 10 ) );
+      QCOMPARE( fids, QList<QgsFeatureId>() << 1 );
+      QVERIFY( indexCopy->d->ref == 1 );
+
+      // assignment operator
+      QgsPackedSpatialIndex index3;
+      QVERIFY( index3.intersects( QgsRectangle( 0, 0, 10, 10 ) ).isEmpty() );
+      index3 = *indexCopy;
+      QVERIFY( index3.d == indexCopy->d );
+      QVERIFY( index3.d->ref == 2 );
+      fids = index3.intersects( QgsRectangle( 0, 0, 10, 10 ) );
+      QCOMPARE( fids, QList<QgsFeatureId>() << 1 );
+
+      indexCopy.reset();
+      QVERIFY( index3.d->ref == 1 );
+    }
+
+};
+
+QGSTEST_MAIN( TestQgsPackedSpatialIndex )
+
+#include "testqgspackedspatialindex.moc"
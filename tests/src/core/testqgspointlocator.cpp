@@ -289,6 +289,56 @@ class TestQgsPointLocator : public QObject
       mVL->rollBack();
     }
 
+    void testLayerUpdatesBatched()
+    {
+      QgsPointLocator loc( mVL );
+      QVERIFY( loc.nearestVertex( QgsPointXY( 12, 12 ), 999 ).isValid() );
+      QCOMPARE( loc.cachedGeometryCount(), 1 );
+
+      mVL->startEditing();
+
+      auto triangle = []( double x, double y ) -> QgsFeature
+      {
+        QgsPolylineXY polyline;
+        polyline << QgsPointXY( x, y + 1 ) << QgsPointXY( x + 1, y ) << QgsPointXY( x + 1, y + 1 ) << QgsPointXY( x, y + 1 );
+        QgsFeature ff( 0 );
+        ff.setGeometry( QgsGeometry::fromPolygonXY( QgsPolygonXY() << polyline ) );
+        return ff;
+      };
+
+      // add several features, they are indexed on the next query
+      QList< QgsFeatureId > added;
+      for ( int i = 0; i < 3; ++i )
+      {
+        QgsFeature ff = triangle( 10 + i, 10 + i );
+        QVERIFY( mVL->addFeature( ff ) );
+        added << ff.id();
+      }
+      QCOMPARE( loc.cachedGeometryCount(), 1 );
+
+      // a pending feature deleted before being indexed is never indexed
+      QVERIFY( mVL->deleteFeature( added.at( 0 ) ) );
+
+      QgsPointLocator::Match m = loc.nearestVertex( QgsPointXY( 13.5, 13.5 ), 999 );
+      QVERIFY( m.isValid() );
+      QCOMPARE( m.point(), QgsPointXY( 13, 13 ) );
+      QCOMPARE( m.featureId(), added.at( 2 ) );
+      QCOMPARE( loc.cachedGeometryCount(), 3 );
+
+      // deleting an indexed feature frees its geometry slot, which is reused by the next one
+      QVERIFY( mVL->deleteFeature( added.at( 2 ) ) );
+      QCOMPARE( loc.cachedGeometryCount(), 2 );
+      QgsFeature ff = triangle( 20, 20 );
+      QVERIFY( mVL->addFeature( ff ) );
+      m = loc.nearestVertex( QgsPointXY( 21.5, 21.5 ), 999 );
+      QVERIFY( m.isValid() );
+      QCOMPARE( m.point(), QgsPointXY( 21, 21 ) );
+      QCOMPARE( loc.cachedGeometryCount(), 3 );
+      QCOMPARE( static_cast< int >( loc.mGeometries.size() ), 3 );
+
+      mVL->rollBack();
+    }
+
     void testExtent()
     {
       QgsRectangle bbox1( 10, 10, 11, 11 ); // out of layer's bounds
@@ -16,6 +16,7 @@
 #include "qgstest.h"
 #include <QObject>
 #include <QString>
+#include <QTemporaryDir>
 
 #include <qgsapplication.h>
 #include "qgsfeatureiterator.h"
@@ -352,6 +353,67 @@ class TestQgsSpatialIndex : public QObject
       QVERIFY( i6.geometry( 50 ).isNull() );
     }
 
+    void testPersistence()
+    {
+      QgsVectorLayer *vl = new QgsVectorLayer( QStringLiteral( "LineString" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      int fid = 0;
+      QgsFeatureList flist;
+      for ( int x = 0; x < 10; ++x )
+      {
+        for ( int y = 100; y < 110; ++y )
+        {
+          QgsFeature f( fid++ );
+          f.setGeometry( qgis::make_unique< QgsLineString >( QgsPoint( x, y ), QgsPoint( x + 0.5, y - 0.5 ) ) );
+          flist << f;
+        }
+      }
+      vl->dataProvider()->addFeatures( flist );
+
+      QTemporaryDir dir;
+      const QString path = dir.filePath( QStringLiteral( "index.qsidx" ) );
+      const QDateTime modified( QDate( 2020, 10, 5 ), QTime( 10, 11, 12 ) );
+
+      QgsSpatialIndex i1( vl->getFeatures() );
+      QString error;
+      QVERIFY( i1.writeToFile( path, 100, modified, &error ) );
+      QVERIFY( error.isEmpty() );
+
+      QgsSpatialIndex i2;
+      QVERIFY( i2.readFromFile( path, 100, modified, &error ) );
+      QVERIFY( error.isEmpty() );
+      QList<QgsFeatureId> expected = i1.intersects( QgsRectangle( 2.2, 102.2, 5.3, 104.1 ) );
+      QList<QgsFeatureId> res = i2.intersects( QgsRectangle( 2.2, 102.2, 5.3, 104.1 ) );
+      std::sort( expected.begin(), expected.end() );
+      std::sort( res.begin(), res.end() );
+      QVERIFY( !res.isEmpty() );
+      QCOMPARE( res, expected );
+      QCOMPARE( i2.nearestNeighbor( QgsPointXY( 4.1, 103 ), 1 ), i1.nearestNeighbor( QgsPointXY( 4.1, 103 ), 1 ) );
+      QVERIFY( i2.geometry( 1 ).isNull() );
+
+      // stale source
+      QgsSpatialIndex i3;
+      QVERIFY( !i3.readFromFile( path, 101, modified, &error ) );
+      QVERIFY( !error.isEmpty() );
+      QVERIFY( i3.intersects( QgsRectangle( 2.2, 102.2, 5.3, 104.1 ) ).isEmpty() );
+      QVERIFY( !i3.readFromFile( path, 100, modified.addSecs( 1 ), &error ) );
+      QVERIFY( !i3.readFromFile( dir.filePath( QStringLiteral( "missing.qsidx" ) ), 100, modified, &error ) );
+
+      // flags must match
+      QgsSpatialIndex i4( QgsSpatialIndex::FlagStoreFeatureGeometries );
+      QVERIFY( !i4.readFromFile( path, 100, modified, &error ) );
+
+      // stored geometries
+      QgsSpatialIndex i5( vl->getFeatures(), nullptr, QgsSpatialIndex::FlagStoreFeatureGeometries );
+      QVERIFY( i5.writeToFile( path, 100, QDateTime(), &error ) );
+      QgsSpatialIndex i6( QgsSpatialIndex::FlagStoreFeatureGeometries );
+      QVERIFY( i6.readFromFile( path, 100, QDateTime(), &error ) );
+      QCOMPARE( i6.geometry( 1 ).asWkt( 1 ), QStringLiteral( "LineString (0 100, 0.5 99.5)" ) );
+      QCOMPARE( i6.geometry( 50 ).asWkt( 1 ), QStringLiteral( "LineString (4 109, 4.5 108.5)" ) );
+      QCOMPARE( i6.intersects( QgsRectangle( 4.1, 108.6, 4.2, 108.7 ) ), QList< QgsFeatureId >() << 50 );
+
+      delete vl;
+    }
+
     void testNearestNeighbour()
     {
       QgsSpatialIndex i;
@@ -163,6 +163,111 @@ class TestQgsSpatialIndexKdBush : public QObject
       QVERIFY( index3.d->ref == 1 );
     }
 
+    void testNearestNeighbors()
+    {
+      std::unique_ptr< QgsVectorLayer > vl = qgis::make_unique< QgsVectorLayer >( "Point", QString(), QStringLiteral( "memory" ) );
+      for ( QgsFeature f : _pointFeatures() )
+        vl->dataProvider()->addFeature( f );
+      QgsSpatialIndexKDBush index( *vl->dataProvider() );
+
+      QList<QgsSpatialIndexKDBushData> res = index.nearestNeighbors( QgsPointXY( 0.9, 0.8 ) );
+      QCOMPARE( res.count(), 1 );
+      QVERIFY( testContains( res, 1, QgsPointXY( 1, 1 ) ) );
+
+      res = index.nearestNeighbors( QgsPointXY( 0.9, 0.8 ), 2 );
+      QCOMPARE( res.count(), 2 );
+      QCOMPARE( res.at( 0 ).id, 1LL );
+      QCOMPARE( res.at( 1 ).id, 4LL );
+
+      // ties are all returned
+      res = index.nearestNeighbors( QgsPointXY( 0, 0 ), 1 );
+      QCOMPARE( res.count(), 4 );
+
+      // max distance
+      res = index.nearestNeighbors( QgsPointXY( 0.9, 0.8 ), 3, 1 );
+      QCOMPARE( res.count(), 1 );
+      QCOMPARE( res.at( 0 ).id, 1LL );
+      QVERIFY( index.nearestNeighbors( QgsPointXY( 5, 5 ), 1, 2 ).isEmpty() );
+
+      QList< double > distances;
+      index.nearestNeighbors( QgsPointXY( -1, 0 ), 4, 0, [&distances]( const QgsSpatialIndexKDBushData &, double distance )
+      {
+        distances << distance;
+      } );
+      QCOMPARE( distances.count(), 4 );
+      QGSCOMPARENEAR( distances.at( 0 ), 1, 0.000001 );
+      QGSCOMPARENEAR( distances.at( 1 ), 1, 0.000001 );
+      QGSCOMPARENEAR( distances.at( 2 ), std::sqrt( 5 ), 0.000001 );
+      QGSCOMPARENEAR( distances.at( 3 ), std::sqrt( 5 ), 0.000001 );
+    }
+
+    void testNearestNeighborsLarge()
+    {
+      // enough points to exercise the tree levels and compare against a brute force search
+      std::unique_ptr< QgsVectorLayer > vl = qgis::make_unique< QgsVectorLayer >( "Point", QString(), QStringLiteral( "memory" ) );
+      QgsFeatureList features;
+      for ( int i = 0; i < 5000; ++i )
+      {
+        QgsFeature f;
+        f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( std::fmod( i * 7.31, 100.0 ), std::fmod( i * 3.17, 97.0 ) ) ) );
+        features << f;
+      }
+      vl->dataProvider()->addFeatures( features );
+      QgsSpatialIndexKDBush index( *vl->dataProvider() );
+      QCOMPARE( index.size(), static_cast< qgssize >( 5000 ) );
+
+      const QgsPointXY search( 41.3, 57.9 );
+      QList< double > expected;
+      for ( const QgsFeature &f : qgis::as_const( features ) )
+        expected << f.geometry().asPoint().distance( search );
+      std::sort( expected.begin(), expected.end() );
+
+      QList< double > distances;
+      index.nearestNeighbors( search, 10, 0, [&distances]( const QgsSpatialIndexKDBushData &, double distance )
+      {
+        distances << distance;
+      } );
+      QVERIFY( distances.count() >= 10 );
+      for ( int i = 0; i < 10; ++i )
+        QGSCOMPARENEAR( distances.at( i ), expected.at( i ), 0.000001 );
+    }
+
+    void testVisitors()
+    {
+      std::unique_ptr< QgsVectorLayer > vl = qgis::make_unique< QgsVectorLayer >( "Point", QString(), QStringLiteral( "memory" ) );
+      for ( QgsFeature f : _pointFeatures() )
+        vl->dataProvider()->addFeature( f );
+      QgsSpatialIndexKDBush index( *vl->dataProvider() );
+
+      int count = 0;
+      index.visitIntersects( QgsRectangle( -10, -10, 0, 10 ), [&count]( const QgsSpatialIndexKDBushData & ) -> bool
+      {
+        count++;
+        return true;
+      } );
+      QCOMPARE( count, 2 );
+
+      // stop after the first result
+      count = 0;
+      index.visitWithin( QgsPointXY( 0, 0 ), 2, [&count]( const QgsSpatialIndexKDBushData & ) -> bool
+      {
+        count++;
+        return false;
+      } );
+      QCOMPARE( count, 1 );
+
+      // callback based loading
+      QgsFeatureIterator it = vl->getFeatures();
+      count = 0;
+      QgsSpatialIndexKDBush index2( it, [&count]( const QgsFeature & ) -> bool
+      {
+        count++;
+        return true;
+      } );
+      QCOMPARE( count, 4 );
+      QCOMPARE( index2.size(), static_cast< qgssize >( 4 ) );
+    }
+
 };
 
 QGSTEST_MAIN( TestQgsSpatialIndexKdBush )
@@ -91,6 +91,8 @@ class TestQgsVectorFileWriter: public QObject
     void prepareWriteAsVectorFormat();
     //! Test regression #21714 (Exported GeoPackages have wrong field definitions)
     void testTextFieldLength();
+    //! Test writing features in batches, with small transactions
+    void testBatchWrite();
     //! Test https://github.com/qgis/QGIS/issues/29819
     void testExportToGpxPoint();
     //! Test https://github.com/qgis/QGIS/issues/29819
@@ -534,6 +536,75 @@ void TestQgsVectorFileWriter::testTextFieldLength()
 
 }
 
+void TestQgsVectorFileWriter::testBatchWrite()
+{
+  QTemporaryFile tmpFile( QDir::tempPath() +  "/test_qgsvectorfilewriter_batch_XXXXXX.gpkg" );
+  tmpFile.open();
+  const QString fileName( tmpFile.fileName( ) );
+
+  QgsFields fields;
+  fields.append( QgsField( QStringLiteral( "name" ), QVariant::String ) );
+  fields.append( QgsField( QStringLiteral( "value" ), QVariant::Int ) );
+
+  QgsVectorFileWriter::SaveVectorOptions options;
+  options.driverName = QStringLiteral( "GPKG" );
+  options.layerName = QStringLiteral( "test" );
+  options.transactionSize = 300;
+  std::unique_ptr< QgsVectorFileWriter > writer( QgsVectorFileWriter::create( fileName, fields, QgsWkbTypes::MultiPoint, QgsCoordinateReferenceSystem( QStringLiteral( "EPSG:4326" ) ), QgsCoordinateTransformContext(), options ) );
+  QCOMPARE( writer->hasError(), QgsVectorFileWriter::NoError );
+  QCOMPARE( writer->transactionSize(), 300 );
+  QVERIFY( writer->parallelGeometryConversionEnabled() );
+
+  QgsFeatureList features;
+  for ( int i = 0; i < 1000; ++i )
+  {
+    QgsFeature f( fields );
+    // null values must not be filled with the values of the previous feature when the OGR feature is reused
+    if ( i % 2 == 0 )
+      f.setAttributes( QgsAttributes() << QStringLiteral( "f%1" ).arg( i ) << i );
+    else
+      f.setAttributes( QgsAttributes() << QVariant() << QVariant() );
+    // single points are converted to the multipoint layer type, every third feature has no geometry
+    if ( i % 3 != 0 )
+      f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( i, -i ) ) );
+    features << f;
+  }
+  QVERIFY( writer->addFeatures( features ) );
+  QCOMPARE( writer->writtenFeatureCount(), 1000LL );
+  QVERIFY( writer->writeThroughput() >= 0 );
+  writer.reset();
+
+  QgsVectorLayer vl( QStringLiteral( "%1|layername=test" ).arg( fileName ), QStringLiteral( "test" ), QStringLiteral( "ogr" ) );
+  QVERIFY( vl.isValid() );
+  QCOMPARE( vl.featureCount(), 1000L );
+
+  QgsFeatureRequest request;
+  request.addOrderBy( QStringLiteral( "fid" ) );
+  QgsFeatureIterator it = vl.getFeatures( request );
+  QgsFeature f;
+  int i = 0;
+  while ( it.nextFeature( f ) )
+  {
+    if ( i % 2 == 0 )
+    {
+      QCOMPARE( f.attribute( QStringLiteral( "name" ) ).toString(), QStringLiteral( "f%1" ).arg( i ) );
+      QCOMPARE( f.attribute( QStringLiteral( "value" ) ).toInt(), i );
+    }
+    else
+    {
+      QVERIFY( f.attribute( QStringLiteral( "name" ) ).isNull() );
+      QVERIFY( f.attribute( QStringLiteral( "value" ) ).isNull() );
+    }
+
+    if ( i % 3 != 0 )
+      QCOMPARE( f.geometry().asWkt(), QStringLiteral( "MultiPoint ((%1 %2))" ).arg( i ).arg( -i ) );
+    else
+      QVERIFY( f.geometry().isEmpty() );
+    ++i;
+  }
+  QCOMPARE( i, 1000 );
+}
+
 void TestQgsVectorFileWriter::_testExportToGpx( const QString &geomTypeName,
     const QString &wkt,
     const QString &expectedLayerName,
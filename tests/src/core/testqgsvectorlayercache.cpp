@@ -26,6 +26,7 @@
 #include "qgsvectorlayereditbuffer.h"
 #include "qgscacheindexfeatureid.h"
 #include "qgsvectorlayer.h"
+#include "qgslinestring.h"
 
 #include <QDebug>
 
@@ -56,6 +57,10 @@ class TestVectorLayerCache : public QObject
     void testCanUseCacheForRequest();
     void testCacheGeom();
     void testFullCacheWithRect(); // Test that if rect is set then no full cache can exist, see #19468
+    void testCacheSizeInBytes();
+    void testFullCacheWithBudget();
+    void testSpatialIndex();
+    void testStatistics();
 
     void onCommittedFeaturesAdded( const QString &, const QgsFeatureList & );
 
@@ -420,6 +425,212 @@ void TestVectorLayerCache::testFullCacheWithRect()
 
 }
 
+void TestVectorLayerCache::testCacheSizeInBytes()
+{
+  QgsVectorLayer layer( QStringLiteral( "LineString?crs=epsg:3857&field=id:integer" ), QStringLiteral( "lines" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  for ( int i = 0; i < 100; ++i )
+  {
+    // half of the features are much more complex than the others
+    const int vertexCount = i % 2 ? 1000 : 2;
+    QVector< double > x, y;
+    for ( int j = 0; j < vertexCount; ++j )
+    {
+      x << i + j * 0.001;
+      y << j * 0.001;
+    }
+    QgsFeature f( layer.fields() );
+    f.setAttributes( QgsAttributes() << i );
+    f.setGeometry( QgsGeometry( new QgsLineString( x, y ) ) );
+    features << f;
+  }
+  QVERIFY( layer.dataProvider()->addFeatures( features ) );
+
+  QgsVectorLayerCache cache( &layer, 1000 );
+  cache.setCacheSizeInBytes( 200000 );
+  QCOMPARE( cache.cacheSizeInBytes(), 200000LL );
+
+  QgsFeature f;
+  QgsFeatureIterator it = cache.getFeatures();
+  int count = 0;
+  while ( it.nextFeature( f ) )
+    count++;
+  QCOMPARE( count, 100 );
+
+  // the budget is respected, at the expense of some features
+  QVERIFY( cache.cachedBytes() > 0 );
+  QVERIFY( cache.cachedBytes() <= 200000 );
+  QVERIFY( cache.evictionCount() > 0 );
+  QVERIFY( cache.cachedFeatureIds().size() < 100 );
+  QCOMPARE( cache.cacheSize(), cache.cachedFeatureIds().size() );
+
+  // back to a feature count
+  cache.setCacheSize( 1000 );
+  QCOMPARE( cache.cacheSizeInBytes(), 0LL );
+  QCOMPARE( cache.cacheSize(), 1000 );
+  it = cache.getFeatures();
+  while ( it.nextFeature( f ) ) { }
+  QCOMPARE( cache.cachedFeatureIds().size(), 100 );
+  const qint64 allBytes = cache.cachedBytes();
+  QVERIFY( allBytes > 200000 );
+
+  // lowering the budget evicts features
+  cache.setCacheSizeInBytes( allBytes / 2 );
+  QVERIFY( cache.cachedBytes() <= allBytes / 2 );
+  QVERIFY( cache.cachedFeatureIds().size() < 100 );
+
+  // growing a cached geometry updates its cost, other features are evicted to stay within the budget
+  const QgsFeatureId grownId = *cache.cachedFeatureIds().constBegin();
+  const int cachedCount = cache.cachedFeatureIds().size();
+  QVector< double > x, y;
+  for ( int j = 0; j < allBytes / 8 / ( 2 * sizeof( double ) ); ++j )
+  {
+    x << j * 0.001;
+    y << j * 0.001;
+  }
+  QVERIFY( layer.startEditing() );
+  QVERIFY( layer.changeGeometry( grownId, QgsGeometry( new QgsLineString( x, y ) ) ) );
+  QVERIFY( cache.isFidCached( grownId ) );
+  QVERIFY( cache.cachedBytes() <= allBytes / 2 );
+  QVERIFY( cache.cachedFeatureIds().size() < cachedCount );
+  layer.rollBack();
+
+  // features without geometry are cheap, they all fit in the same budget
+  QgsVectorLayerCache noGeometryCache( &layer, 1000 );
+  noGeometryCache.setCacheGeometry( false );
+  noGeometryCache.setCacheSizeInBytes( 200000 );
+  it = noGeometryCache.getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ) );
+  while ( it.nextFeature( f ) ) { }
+  QCOMPARE( noGeometryCache.cachedFeatureIds().size(), 100 );
+  QCOMPARE( noGeometryCache.evictionCount(), 0LL );
+}
+
+void TestVectorLayerCache::testFullCacheWithBudget()
+{
+  // a budget large enough for all the features
+  QgsVectorLayerCache cache( mPointsLayer, 2 );
+  cache.setCacheSizeInBytes( 10000000 );
+  cache.setFullCache( true );
+  QCOMPARE( cache.cacheSizeInBytes(), 10000000LL );
+  QVERIFY( cache.hasFullCache() );
+  QCOMPARE( cache.cachedFeatureIds().size(), static_cast< int >( mPointsLayer->featureCount() ) );
+
+  // adding a feature keeps the budget
+  mPointsLayer->startEditing();
+  QgsFeature f( mPointsLayer->fields() );
+  QVERIFY( mPointsLayer->addFeature( f ) );
+  QCOMPARE( cache.cacheSizeInBytes(), 10000000LL );
+  QVERIFY( cache.hasFullCache() );
+  QVERIFY( cache.isFidCached( f.id() ) );
+  mPointsLayer->rollBack();
+
+  // a budget too small for all the features is kept too, but the cache is not full
+  const qint64 smallBudget = cache.cachedBytes() / 2;
+  QgsVectorLayerCache smallCache( mPointsLayer, 2 );
+  smallCache.setCacheSizeInBytes( smallBudget );
+  smallCache.setFullCache( true );
+  QCOMPARE( smallCache.cacheSizeInBytes(), smallBudget );
+  QVERIFY( !smallCache.hasFullCache() );
+  QVERIFY( smallCache.cachedFeatureIds().size() < mPointsLayer->featureCount() );
+}
+
+void TestVectorLayerCache::testSpatialIndex()
+{
+  QgsVectorLayer layer( QStringLiteral( "Point?crs=epsg:3857&field=id:integer" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  for ( int i = 0; i < 100; ++i )
+  {
+    QgsFeature f( layer.fields() );
+    f.setAttributes( QgsAttributes() << i );
+    f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( i % 10, i / 10 ) ) );
+    features << f;
+  }
+  QVERIFY( layer.dataProvider()->addFeatures( features ) );
+
+  QgsVectorLayerCache cache( &layer, 1000 );
+  QVERIFY( !cache.spatialIndexEnabled() );
+  cache.setSpatialIndexEnabled( true );
+  QVERIFY( cache.spatialIndexEnabled() );
+
+  auto countFeatures = []( QgsFeatureIterator it ) -> int
+  {
+    int count = 0;
+    QgsFeature f;
+    while ( it.nextFeature( f ) )
+      count++;
+    return count;
+  };
+
+  QgsFeatureIterator it;
+  QVERIFY( !cache.canUseCacheForRequest( QgsFeatureRequest().setFilterRect( QgsRectangle( 1, 1, 3, 3 ) ), it ) );
+  QCOMPARE( countFeatures( cache.getFeatures( QgsRectangle( 0, 0, 4.5, 4.5 ) ) ), 25 );
+  QCOMPARE( cache.cachedFeatureIds().size(), 25 );
+
+  // rectangles within the completed extent are answered from the cache, using the spatial index
+  QVERIFY( cache.canUseCacheForRequest( QgsFeatureRequest().setFilterRect( QgsRectangle( 1, 1, 3, 3 ) ), it ) );
+  QCOMPARE( countFeatures( it ), 9 );
+  QCOMPARE( cache.cachedFeatureIdsInRectangle( QgsRectangle( 1, 1, 3, 3 ) ).size(), 9 );
+  QVERIFY( !cache.canUseCacheForRequest( QgsFeatureRequest().setFilterRect( QgsRectangle( 0, 0, 9, 9 ) ), it ) );
+
+  // only a bounded number of completed extents is remembered, and redundant ones are dropped
+  for ( int i = 0; i < 100; ++i )
+    countFeatures( cache.getFeatures( QgsRectangle( 20 + 0.01 * i, 0, 20 + 0.01 * i + 0.005, 0.005 ) ) );
+  QVERIFY( cache.mCompletedExtents.size() < 100 );
+  QCOMPARE( countFeatures( cache.getFeatures( QgsRectangle( 0, 0, 30, 30 ) ) ), 100 );
+  QCOMPARE( cache.mCompletedExtents.size(), 1 );
+
+  // evicting a feature within the extent invalidates it
+  QgsFeatureId id = -1;
+  QgsFeature f;
+  QgsFeatureIterator layerIt = layer.getFeatures( QgsRectangle( 2, 2, 2, 2 ) );
+  QVERIFY( layerIt.nextFeature( f ) );
+  id = f.id();
+  QVERIFY( cache.removeCachedFeature( id ) );
+  QVERIFY( !cache.canUseCacheForRequest( QgsFeatureRequest().setFilterRect( QgsRectangle( 1, 1, 3, 3 ) ), it ) );
+
+  // full cache requests also benefit from the index
+  cache.setFullCache( true );
+  QCOMPARE( cache.cachedFeatureIdsInRectangle( QgsRectangle( 5, 5, 9, 9 ) ).size(), 25 );
+  QCOMPARE( countFeatures( cache.getFeatures( QgsRectangle( 5, 5, 9, 9 ) ) ), 25 );
+
+  // geometry changes are reflected in the index
+  QVERIFY( layer.startEditing() );
+  QVERIFY( layer.changeGeometry( id, QgsGeometry::fromPointXY( QgsPointXY( 100, 100 ) ) ) );
+  QCOMPARE( cache.cachedFeatureIdsInRectangle( QgsRectangle( 99, 99, 101, 101 ) ), QgsFeatureIds() << id );
+  QVERIFY( cache.cachedFeatureIdsInRectangle( QgsRectangle( 1.5, 1.5, 2.5, 2.5 ) ).isEmpty() );
+  layer.rollBack();
+
+  cache.setSpatialIndexEnabled( false );
+  QVERIFY( cache.cachedFeatureIdsInRectangle( QgsRectangle( 5, 5, 9, 9 ) ).isEmpty() );
+}
+
+void TestVectorLayerCache::testStatistics()
+{
+  QgsFeature f;
+  QgsFeatureIterator it = mPointsLayer->getFeatures();
+  it.nextFeature( f );
+  const QgsFeatureId id = f.id();
+
+  QgsVectorLayerCache cache( mPointsLayer, 10 );
+  QCOMPARE( cache.hitCount(), 0LL );
+  QCOMPARE( cache.missCount(), 0LL );
+
+  QVERIFY( cache.featureAtId( id, f ) );
+  QCOMPARE( cache.missCount(), 1LL );
+  QVERIFY( cache.featureAtId( id, f ) );
+  QCOMPARE( cache.hitCount(), 1LL );
+
+  it = cache.getFeatures( QgsFeatureRequest().setFilterFid( id ) );
+  QCOMPARE( cache.hitCount(), 2LL );
+  it = cache.getFeatures( QgsFeatureRequest().setFilterExpression( QStringLiteral( "1 = 1" ) ) );
+  QCOMPARE( cache.missCount(), 2LL );
+
+  cache.resetStatistics();
+  QCOMPARE( cache.hitCount(), 0LL );
+  QCOMPARE( cache.missCount(), 0LL );
+  QCOMPARE( cache.evictionCount(), 0LL );
+}
+
 void TestVectorLayerCache::onCommittedFeaturesAdded( const QString &layerId, const QgsFeatureList &features )
 {
   Q_UNUSED( layerId )
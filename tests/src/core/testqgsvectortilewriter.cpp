@@ -24,6 +24,8 @@
 #include "qgstiles.h"
 #include "qgsvectorlayer.h"
 #include "qgsvectortilemvtdecoder.h"
+#include "qgsvectortilemvtencoder.h"
+#include "qgsvectortilefeaturebuckets_p.h"
 #include "qgsvectortilelayer.h"
 #include "qgsvectortilewriter.h"
 
@@ -54,6 +56,8 @@ class TestQgsVectorTileWriter : public QObject
     void test_mbtiles();
     void test_mbtiles_metadata();
     void test_filtering();
+    void test_deeper_zoom_levels();
+    void test_feature_buckets();
 };
 
 
@@ -315,6 +319,113 @@ void TestQgsVectorTileWriter::test_filtering()
   QCOMPARE( features0["polys"].count(), 0 );
 }
 
+void TestQgsVectorTileWriter::test_deeper_zoom_levels()
+{
+  // features are clipped progressively from parent to child tiles, check that
+  // each tile still gets exactly the points within its buffered extent
+
+  QTemporaryDir dir;
+  QString tmpDir = dir.path();
+
+  QgsDataSourceUri ds;
+  ds.setParam( "type", "xyz" );
+  ds.setParam( "url", QUrl::fromLocalFile( tmpDir ).toString() + "/{z}-{x}-{y}.pbf" );
+
+  QgsVectorLayer *vlPoints = new QgsVectorLayer( mDataDir + "/points.shp", "points", "ogr" );
+
+  QgsVectorTileWriter writer;
+  writer.setDestinationUri( ds.encodedUri() );
+  writer.setMaxZoom( 6 );
+  writer.setLayers( QList<QgsVectorTileWriter::Layer>() << QgsVectorTileWriter::Layer( vlPoints ) );
+
+  bool res = writer.writeTiles();
+  QVERIFY( res );
+  QVERIFY( writer.errorMessage().isEmpty() );
+
+  QList<QgsPointXY> points;
+  QgsCoordinateTransform ct( vlPoints->crs(), QgsCoordinateReferenceSystem( "EPSG:3857" ), QgsProject::instance()->transformContext() );
+  QgsFeatureIterator fit = vlPoints->getFeatures();
+  QgsFeature f;
+  while ( fit.nextFeature( f ) )
+    points << ct.transform( f.geometry().asPoint() );
+  delete vlPoints;
+
+  QgsVectorTileLayer *vtLayer = new QgsVectorTileLayer( ds.encodedUri(), "output" );
+  QMap<QString, QgsFields> perLayerFields;
+  perLayerFields["points"] = QgsFields();
+
+  for ( int zoomLevel = 0; zoomLevel <= 6; ++zoomLevel )
+  {
+    int pointsInZoomLevel = 0;
+    QgsTileRange tileRange = QgsTileMatrix::fromWebMercator( zoomLevel ).tileRangeFromExtent( writer.fullExtent() );
+    for ( int row = tileRange.startRow(); row <= tileRange.endRow(); ++row )
+    {
+      for ( int col = tileRange.startColumn(); col <= tileRange.endColumn(); ++col )
+      {
+        QgsTileXYZ tileID( col, row, zoomLevel );
+        QgsRectangle tileExtent = QgsVectorTileMVTEncoder( tileID ).tileExtentWithBuffer();
+        int expectedCount = 0;
+        for ( const QgsPointXY &pt : qgis::as_const( points ) )
+        {
+          if ( tileExtent.contains( pt ) )
+            ++expectedCount;
+        }
+
+        int count = 0;
+        QByteArray tile = vtLayer->getRawTile( tileID );
+        if ( !tile.isEmpty() )
+        {
+          QgsVectorTileMVTDecoder decoder;
+          QVERIFY( decoder.decode( tileID, tile ) );
+          count = decoder.layerFeatures( perLayerFields, QgsCoordinateTransform() )["points"].count();
+        }
+        QCOMPARE( count, expectedCount );
+        pointsInZoomLevel += count;
+      }
+    }
+    // points may be repeated in the buffer of neighboring tiles, but none may be lost
+    QVERIFY( pointsInZoomLevel >= points.count() );
+  }
+
+  delete vtLayer;
+}
+
+void TestQgsVectorTileWriter::test_feature_buckets()
+{
+  QgsVectorTileFeatureBuckets memoryBuckets( 3 );
+  QgsVectorTileFeatureBuckets buckets( 3, 2000 );  // small enough to get features moved to the temporary file
+  QCOMPARE( buckets.bucketCount(), 3 );
+
+  for ( int i = 0; i < 100; ++i )
+  {
+    QgsFeature f( i );
+    f.setAttributes( QgsAttributes() << i << QStringLiteral( "feature %1" ).arg( i ) );
+    if ( i % 10 != 0 )
+      f.setGeometry( QgsGeometry::fromPointXY( QgsPointXY( i, -i ) ) );
+    QVERIFY( memoryBuckets.addFeature( i % 3, f ) );
+    QVERIFY( buckets.addFeature( i % 3, f ) );
+  }
+
+  QVERIFY( !memoryBuckets.hasSpilled() );
+  QVERIFY( buckets.hasSpilled() );
+  QVERIFY( buckets.memoryUsage() <= 2000 );
+  QVERIFY( buckets.errorMessage().isEmpty() );
+
+  for ( int bucket = 0; bucket < 3; ++bucket )
+  {
+    const QgsFeatureList expected = memoryBuckets.features( bucket );
+    const QgsFeatureList features = buckets.features( bucket );
+    QCOMPARE( features.count(), expected.count() );
+    for ( int i = 0; i < features.count(); ++i )
+    {
+      QCOMPARE( features.at( i ).id(), static_cast< QgsFeatureId >( bucket + 3 * i ) );
+      QCOMPARE( features.at( i ).id(), expected.at( i ).id() );
+      QCOMPARE( features.at( i ).attributes(), expected.at( i ).attributes() );
+      QCOMPARE( features.at( i ).geometry().asWkt(), expected.at( i ).geometry().asWkt() );
+    }
+  }
+}
+
 
 QGSTEST_MAIN( TestQgsVectorTileWriter )
 #include "testqgsvectortilewriter.moc"
@@ -14,6 +14,7 @@
  ***************************************************************************/
 
 #include <limits>
+#include <cmath>
 
 #include "qgstest.h"
 #include <QObject>
@@ -31,6 +32,52 @@
 #include "qgspointcloudlayer.h"
 #include "qgspointcloudindex.h"
 #include "qgspointcloudlayerelevationproperties.h"
+#include "qgspointcloudrequest.h"
+#include "qgspointcloudstatistics.h"
+#include "qgspointcloudlayerrenderer.h"
+#include "qgspointcloudrenderer.h"
+#include "qgsmapsettings.h"
+
+/**
+ * Point cloud renderer which counts the rendered blocks and points, and can cancel
+ * the rendering after a number of blocks.
+ */
+class TestCountingPointCloudRenderer : public QgsPointCloudRenderer
+{
+  public:
+    TestCountingPointCloudRenderer( int *blockCount, qint64 *pointCount, int stopAfterBlocks = -1 )
+      : mBlockCount( blockCount )
+      , mPointCount( pointCount )
+      , mStopAfterBlocks( stopAfterBlocks )
+    {}
+
+    QString type() const override { return QStringLiteral( "counting" ); }
+
+    QgsPointCloudRenderer *clone() const override
+    {
+      TestCountingPointCloudRenderer *res = new TestCountingPointCloudRenderer( mBlockCount, mPointCount, mStopAfterBlocks );
+      copyCommonProperties( res );
+      return res;
+    }
+
+    void renderBlock( const QgsPointCloudBlock *block, QgsPointCloudRenderContext &context ) override
+    {
+      ++*mBlockCount;
+      *mPointCount += block->pointCount();
+      if ( mStopAfterBlocks > 0 && *mBlockCount >= mStopAfterBlocks )
+        context.renderContext().setRenderingStopped( true );
+    }
+
+    QDomElement save( QDomDocument &doc, const QgsReadWriteContext & ) const override
+    {
+      return doc.createElement( QStringLiteral( "renderer" ) );
+    }
+
+  private:
+    int *mBlockCount = nullptr;
+    qint64 *mPointCount = nullptr;
+    int mStopAfterBlocks = -1;
+};
 
 /**
  * \ingroup UnitTests
@@ -58,6 +105,10 @@ class TestQgsEptProvider : public QObject
     void attributes();
     void calculateZRange();
     void testIdentify();
+    void testNodeDataCache();
+    void testIdentifyPoints();
+    void testStatistics();
+    void testRenderNodeBatches();
 
   private:
     QString mTestDataDir;
@@ -389,6 +440,273 @@ void TestQgsEptProvider::testIdentify()
   }
 }
 
+void TestQgsEptProvider::testNodeDataCache()
+{
+  std::unique_ptr< QgsPointCloudLayer > layer = qgis::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/sunshine-coast/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ) );
+  QVERIFY( layer->isValid() );
+  QgsPointCloudIndex *index = layer->dataProvider()->index();
+  QVERIFY( index );
+
+  QgsPointCloudIndex::clearNodeDataCache();
+  QCOMPARE( QgsPointCloudIndex::nodeDataCacheMaximumSize(), 256LL * 1024 * 1024 );
+
+  QgsPointCloudRequest request;
+  QgsPointCloudAttributeCollection attributes;
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "X" ), QgsPointCloudAttribute::Int32 ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Classification" ), QgsPointCloudAttribute::Char ) );
+  request.setAttributes( attributes );
+
+  std::unique_ptr< QgsPointCloudBlock > decoded( index->nodeData( index->root(), request ) );
+  QVERIFY( decoded );
+  QgsPointCloudIndex::CacheStatistics statistics = QgsPointCloudIndex::nodeDataCacheStatistics();
+  QCOMPARE( statistics.hits, 0LL );
+  QCOMPARE( statistics.misses, 1LL );
+  QCOMPARE( statistics.blockCount, 1 );
+  QVERIFY( statistics.size >= static_cast< qint64 >( decoded->pointCount() ) * attributes.pointRecordSize() );
+
+  // the second request is answered from the cache, with the same data
+  std::unique_ptr< QgsPointCloudBlock > cached( index->nodeData( index->root(), request ) );
+  QVERIFY( cached );
+  QCOMPARE( cached->pointCount(), decoded->pointCount() );
+  QCOMPARE( QByteArray( cached->data(), cached->pointCount() * attributes.pointRecordSize() ),
+            QByteArray( decoded->data(), decoded->pointCount() * attributes.pointRecordSize() ) );
+  statistics = QgsPointCloudIndex::nodeDataCacheStatistics();
+  QCOMPARE( statistics.hits, 1LL );
+  QCOMPARE( statistics.misses, 1LL );
+
+  // blocks are shared by the indexes of the same data
+  std::unique_ptr< QgsPointCloudLayer > layer2 = qgis::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/sunshine-coast/ept.json" ), QStringLiteral( "layer2" ), QStringLiteral( "ept" ) );
+  cached.reset( layer2->dataProvider()->index()->nodeData( index->root(), request ) );
+  QVERIFY( cached );
+  QCOMPARE( QgsPointCloudIndex::nodeDataCacheStatistics().hits, 2LL );
+
+  // other attributes are decoded again
+  QgsPointCloudRequest otherRequest;
+  otherRequest.setAttributes( layer->dataProvider()->attributes() );
+  cached.reset( index->nodeData( index->root(), otherRequest ) );
+  QVERIFY( cached );
+  statistics = QgsPointCloudIndex::nodeDataCacheStatistics();
+  QCOMPARE( statistics.misses, 2LL );
+  QCOMPARE( statistics.blockCount, 2 );
+
+  // without cache, blocks are always decoded
+  const qint64 maximumSize = QgsPointCloudIndex::nodeDataCacheMaximumSize();
+  QgsPointCloudIndex::setNodeDataCacheMaximumSize( 0 );
+  QCOMPARE( QgsPointCloudIndex::nodeDataCacheStatistics().blockCount, 0 );
+  cached.reset( index->nodeData( index->root(), request ) );
+  QVERIFY( cached );
+  QCOMPARE( QgsPointCloudIndex::nodeDataCacheStatistics().blockCount, 0 );
+  QgsPointCloudIndex::setNodeDataCacheMaximumSize( maximumSize );
+
+  QgsPointCloudIndex::clearNodeDataCache();
+  statistics = QgsPointCloudIndex::nodeDataCacheStatistics();
+  QCOMPARE( statistics.hits, 0LL );
+  QCOMPARE( statistics.misses, 0LL );
+}
+
+void TestQgsEptProvider::testIdentifyPoints()
+{
+  std::unique_ptr< QgsPointCloudLayer > layer = qgis::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/sunshine-coast/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ) );
+  QVERIFY( layer->isValid() );
+
+  const QgsGeometry extent = QgsGeometry::fromWkt( QStringLiteral( "Polygon ((498063.02 7050996.63, 498063.25 7050996.63, 498063.25 7050996.87, 498063.02 7050996.87, 498063.02 7050996.63))" ) );
+  const float maxErrorInMapCoords = 0.0022857920266687870026;
+  const QgsPointCloudIdentifyResults results = layer->dataProvider()->identifyPoints( maxErrorInMapCoords, extent );
+  QCOMPARE( results.pointCount(), 2 );
+  QCOMPARE( results.attributes().count(), 16 );
+
+  QVariantMap expected;
+  expected[ QStringLiteral( "Blue" ) ] = 0;
+  expected[ QStringLiteral( "Classification" ) ] = 2;
+  expected[ QStringLiteral( "EdgeOfFlightLine" ) ] = 0;
+  expected[ QStringLiteral( "GpsTime" ) ] = 268793.3813974548;
+  expected[ QStringLiteral( "Green" ) ] = 0;
+  expected[ QStringLiteral( "Intensity" ) ] = 1142;
+  expected[ QStringLiteral( "NumberOfReturns" ) ] = 1;
+  expected[ QStringLiteral( "PointSourceId" ) ] = 7041;
+  expected[ QStringLiteral( "Red" ) ] = 0;
+  expected[ QStringLiteral( "ReturnNumber" ) ] = 1;
+  expected[ QStringLiteral( "ScanAngleRank" ) ] = -28;
+  expected[ QStringLiteral( "ScanDirectionFlag" ) ] = 1;
+  expected[ QStringLiteral( "UserData" ) ] = 17;
+  expected[ QStringLiteral( "X" ) ] = 498063.1400000416;
+  expected[ QStringLiteral( "Y" ) ] = 7050996.78999996;
+  expected[ QStringLiteral( "Z" ) ] = 74.89000004716218;
+  QVERIFY( results.point( 0 ) == expected );
+
+  expected[ QStringLiteral( "Classification" ) ] = 3;
+  expected[ QStringLiteral( "GpsTime" ) ] = 269160.5176644815;
+  expected[ QStringLiteral( "Intensity" ) ] = 1631;
+  expected[ QStringLiteral( "PointSourceId" ) ] = 7042;
+  expected[ QStringLiteral( "ScanAngleRank" ) ] = -12;
+  expected[ QStringLiteral( "X" ) ] = 498063.11000004224;
+  expected[ QStringLiteral( "Y" ) ] = 7050996.749999961;
+  expected[ QStringLiteral( "Z" ) ] = 74.90000004693866;
+  QVERIFY( results.point( 1 ) == expected );
+  QVERIFY( results.point( 2 ).isEmpty() );
+
+  const QVector<double> x = results.attributeValues( QStringLiteral( "X" ) );
+  QCOMPARE( x.size(), 2 );
+  QGSCOMPARENEAR( x.at( 0 ), 498063.14, 0.001 );
+  QGSCOMPARENEAR( x.at( 1 ), 498063.11, 0.001 );
+  QCOMPARE( results.attributeValues( QStringLiteral( "Classification" ) ), QVector<double>() << 2 << 3 );
+  QCOMPARE( results.attributeValues( QStringLiteral( "Intensity" ) ), QVector<double>() << 1142 << 1631 );
+  QVERIFY( results.attributeValues( QStringLiteral( "xxx" ) ).isEmpty() );
+
+  // points limit
+  const QgsGeometry allPoints = QgsGeometry::fromRect( layer->extent() );
+  QCOMPARE( layer->dataProvider()->identifyPoints( 0.001, allPoints, QgsDoubleRange(), 100 ).pointCount(), 100 );
+  QCOMPARE( layer->dataProvider()->identifyPoints( 0.001, allPoints, QgsDoubleRange(), 1000 ).pointCount(), 253 );
+}
+
+void TestQgsEptProvider::testStatistics()
+{
+  std::unique_ptr< QgsPointCloudLayer > layer = qgis::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/sunshine-coast/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ) );
+  QVERIFY( layer->isValid() );
+
+  QgsPointCloudStatisticsCalculator calculator( layer->dataProvider()->index(), QStringList() << QStringLiteral( "Z" ) << QStringLiteral( "Intensity" ) << QStringLiteral( "Classification" ) << QStringLiteral( "xxx" ) );
+  calculator.setHistogram( QStringLiteral( "Intensity" ), 0, 2500, 5 );
+  calculator.setCountClasses( QStringLiteral( "Classification" ) );
+  QVERIFY( calculator.calculate() );
+
+  // same values as the statistics of the metadata
+  const QgsPointCloudAttributeStatistics z = calculator.statistics( QStringLiteral( "Z" ) );
+  QCOMPARE( z.count(), 253LL );
+  QGSCOMPARENEAR( z.minimum(), 74.34, 0.001 );
+  QGSCOMPARENEAR( z.maximum(), 80.02, 0.001 );
+  QGSCOMPARENEAR( z.mean(), 74.833, 0.001 );
+
+  const QgsPointCloudAttributeStatistics intensity = calculator.statistics( QStringLiteral( "Intensity" ) );
+  QCOMPARE( intensity.count(), 253LL );
+  QCOMPARE( intensity.minimum(), 199.0 );
+  QCOMPARE( intensity.maximum(), 2086.0 );
+  QGSCOMPARENEAR( intensity.mean(), 728.5217, 0.0001 );
+  QVERIFY( intensity.stDev() > 0 );
+  QCOMPARE( intensity.histogram().size(), 5 );
+  qint64 histogramCount = 0;
+  for ( qint64 binCount : intensity.histogram() )
+    histogramCount += binCount;
+  QCOMPARE( histogramCount, 253LL );
+  QVERIFY( intensity.classCounts().isEmpty() );
+
+  QMap< int, qint64 > expectedClasses;
+  expectedClasses.insert( 1, 1 );
+  expectedClasses.insert( 2, 160 );
+  expectedClasses.insert( 3, 89 );
+  expectedClasses.insert( 5, 3 );
+  QCOMPARE( calculator.statistics( QStringLiteral( "Classification" ) ).classCounts(), expectedClasses );
+
+  QCOMPARE( calculator.statistics( QStringLiteral( "xxx" ) ).count(), 0LL );
+  QVERIFY( std::isnan( calculator.statistics( QStringLiteral( "xxx" ) ).mean() ) );
+
+  // filter extent
+  calculator.setFilterExtent( QgsRectangle( 498061, 7050992, 498064, 7050998 ) );
+  QVERIFY( calculator.calculate() );
+  const qint64 filteredCount = calculator.statistics( QStringLiteral( "Z" ) ).count();
+  QVERIFY( filteredCount > 0 );
+  QVERIFY( filteredCount < 253 );
+  QVERIFY( calculator.statistics( QStringLiteral( "Intensity" ) ).histogram().size() == 5 );
+
+  // merging statistics of separate values gives the statistics of all values
+  QgsPointCloudAttributeStatistics first;
+  first.addValue( 1 );
+  first.addValue( 2 );
+  QgsPointCloudAttributeStatistics second;
+  second.addValue( 3 );
+  second.addValue( 6 );
+  first.merge( second );
+  QCOMPARE( first.count(), 4LL );
+  QCOMPARE( first.minimum(), 1.0 );
+  QCOMPARE( first.maximum(), 6.0 );
+  QCOMPARE( first.mean(), 3.0 );
+  QGSCOMPARENEAR( first.stDev(), std::sqrt( 3.5 ), 1e-12 );
+}
+
+
+static void _collectNodes( QgsPointCloudIndex *index, const IndexedPointCloudNode &n, QVector< IndexedPointCloudNode > &nodes )
+{
+  nodes.append( n );
+  const QList< IndexedPointCloudNode > children = index->nodeChildren( n );
+  for ( const IndexedPointCloudNode &child : children )
+    _collectNodes( index, child, nodes );
+}
+
+void TestQgsEptProvider::testRenderNodeBatches()
+{
+  std::unique_ptr< QgsPointCloudLayer > layer = qgis::make_unique< QgsPointCloudLayer >( mTestDataDir + QStringLiteral( "point_clouds/ept/lone-star-laszip/ept.json" ), QStringLiteral( "layer" ), QStringLiteral( "ept" ) );
+  QVERIFY( layer->isValid() );
+  QgsPointCloudIndex *index = layer->dataProvider()->index();
+
+  // reference: every node of the index, loaded one after another
+  QVector< IndexedPointCloudNode > nodes;
+  _collectNodes( index, index->root(), nodes );
+  QVERIFY( nodes.size() > 4 );
+  QgsPointCloudRequest request;
+  QgsPointCloudAttributeCollection attributes;
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "X" ), QgsPointCloudAttribute::Int32 ) );
+  attributes.push_back( QgsPointCloudAttribute( QStringLiteral( "Y" ), QgsPointCloudAttribute::Int32 ) );
+  request.setAttributes( attributes );
+  int expectedBlocks = 0;
+  qint64 expectedPoints = 0;
+  for ( const IndexedPointCloudNode &n : qgis::as_const( nodes ) )
+  {
+    std::unique_ptr< QgsPointCloudBlock > block( index->nodeData( n, request ) );
+    if ( !block )
+      continue;
+    ++expectedBlocks;
+    expectedPoints += block->pointCount();
+  }
+
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( QSize( 400, 400 ) );
+  mapSettings.setDestinationCrs( layer->crs() );
+  // whole root node, so that no node is outside of the map extent
+  mapSettings.setExtent( index->nodeMapExtent( index->root() ).buffered( 1 ) );
+
+  QImage image( mapSettings.outputSize(), QImage::Format_ARGB32_Premultiplied );
+  QPainter painter( &image );
+
+  int blockCount = 0;
+  qint64 pointCount = 0;
+  auto render = [&]( int batchSize, int stopAfterBlocks ) -> bool
+  {
+    blockCount = 0;
+    pointCount = 0;
+    TestCountingPointCloudRenderer *renderer = new TestCountingPointCloudRenderer( &blockCount, &pointCount, stopAfterBlocks );
+    // small enough to traverse the whole tree
+    renderer->setMaximumScreenError( 0.000001 );
+    renderer->setMaximumScreenErrorUnit( QgsUnitTypes::RenderPixels );
+    layer->setRenderer( renderer );
+
+    QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+    context.setPainter( &painter );
+    std::unique_ptr< QgsMapLayerRenderer > layerRenderer( layer->createMapRenderer( context ) );
+    QgsPointCloudLayerRenderer *pointCloudRenderer = static_cast< QgsPointCloudLayerRenderer * >( layerRenderer.get() );
+    pointCloudRenderer->setNodeBatchSize( batchSize );
+    if ( pointCloudRenderer->nodeBatchSize() != batchSize )
+      return false;
+    return layerRenderer->render();
+  };
+
+  // whatever the batch size, every node is drawn exactly once
+  for ( int batchSize : { 1, 3, 1000 } )
+  {
+    QVERIFY( render( batchSize, -1 ) );
+    QCOMPARE( blockCount, expectedBlocks );
+    QCOMPARE( pointCount, expectedPoints );
+  }
+
+  // canceling in the middle of a batch stops drawing, pending loads are dropped
+  QVERIFY( render( 2, 3 ) );
+  QCOMPARE( blockCount, 3 );
+  QVERIFY( pointCount < expectedPoints );
+
+  // canceling exactly at the end of a batch
+  QVERIFY( render( 2, 4 ) );
+  QCOMPARE( blockCount, 4 );
+
+  painter.end();
+}
 
 QGSTEST_MAIN( TestQgsEptProvider )
 #include "testqgseptprovider.moc"
@@ -25,13 +25,19 @@ from qgis.core import (QgsVectorLayer,
                        QgsProject,
                        QgsVectorLayerJoinInfo,
                        QgsVectorFileWriter,
-                       QgsVirtualLayerDefinitionUtils
+                       QgsVirtualLayerDefinitionUtils,
+                       QgsVectorDataProvider,
+                       QgsProviderRegistry,
+                       QgsProviderMetadata,
+                       QgsFeatureIterator,
+                       QgsDataProvider
                        )
 
 from qgis.testing import start_app, unittest
 from utilities import unitTestDataPath
 
 from providertestbase import ProviderTestCase
+from provider_python import PyProvider, PyFeatureSource, PyFeatureIterator
 from qgis.PyQt.QtCore import QUrl, QVariant, QTemporaryDir
 
 from qgis.utils import spatialite_connect
@@ -47,6 +53,40 @@ def toPercent(s):
     return bytes(QUrl.toPercentEncoding(s)).decode()
 
 
+class RecordingFeatureSource(PyFeatureSource):
+    """Python feature source keeping track of the order by clauses it is requested"""
+
+    order_bys = []
+
+    def getFeatures(self, request):
+        RecordingFeatureSource.order_bys.append([(c.expression().expression(), c.ascending()) for c in request.orderBy()])
+        return QgsFeatureIterator(PyFeatureIterator(self, request))
+
+
+class NoOrderByPyProvider(PyProvider):
+
+    @classmethod
+    def providerKey(cls):
+        return 'noorderbypythonprovider'
+
+    @classmethod
+    def createProvider(cls, uri, providerOptions, flags=QgsDataProvider.ReadFlags()):
+        return cls(uri, providerOptions, flags)
+
+    def featureSource(self):
+        return RecordingFeatureSource(self)
+
+
+class OrderByPyProvider(NoOrderByPyProvider):
+
+    @classmethod
+    def providerKey(cls):
+        return 'orderbypythonprovider'
+
+    def capabilities(self):
+        return super().capabilities() | QgsVectorDataProvider.OrderByCompilation
+
+
 class TestQgsVirtualLayerProvider(unittest.TestCase, ProviderTestCase):
 
     @classmethod
@@ -1326,6 +1366,86 @@ class TestQgsVirtualLayerProvider(unittest.TestCase, ProviderTestCase):
 
         QgsProject.instance().removeMapLayer(ml.id())
 
+    def test_constraints_pushdown(self):
+        """Test that combined constraints pushed down to the source layer return the same results as SQLite"""
+
+        ml = QgsVectorLayer("Point?srid=EPSG:4326&field=a:int&field=b:string&field=c:double", "mem_pushdown", "memory")
+        self.assertEqual(ml.isValid(), True)
+        QgsProject.instance().addMapLayer(ml)
+
+        ml.startEditing()
+        for i in range(10):
+            f = QgsFeature(ml.fields())
+            f.setGeometry(QgsGeometry.fromWkt('POINT({} 0)'.format(i)))
+            f.setAttributes([i, 'v{}'.format(i % 3), None if i == 4 else i / 2])
+            ml.addFeatures([f])
+        ml.commitChanges()
+
+        def query(sql):
+            df = QgsVirtualLayerDefinition()
+            df.setQuery(sql)
+            vl = QgsVectorLayer(df.toString(), "vl", "virtual")
+            self.assertEqual(vl.isValid(), True)
+            return [f.attributes() for f in vl.getFeatures()]
+
+        # several ANDed constraints
+        self.assertEqual(query("select a from mem_pushdown where a > 2 and a <= 6 and b = 'v0'"), [[3], [6]])
+        self.assertEqual(query("select a from mem_pushdown where a >= 2 and a < 5 and c is null"), [[4]])
+        self.assertEqual(query("select a from mem_pushdown where a < 3 and c is not null"), [[0], [1], [2]])
+        self.assertEqual(query("select a from mem_pushdown where a > 7 and b <> 'v2'"), [[9]])
+        self.assertEqual(query("select a from mem_pushdown where a > 2 and c = null"), [])
+
+        # IN lists
+        self.assertEqual(query("select a from mem_pushdown where a in (1, 5, 8) and b = 'v2'"), [[5], [8]])
+        self.assertEqual(query("select a from mem_pushdown where b in ('v1', 'x')"), [[1], [4], [7]])
+
+        # rectangle filter combined with attribute constraints
+        self.assertEqual(query("select a from mem_pushdown where st_intersects(geometry, buildmbr(2.5, -1, 7.5, 1)) and c > 2"),
+                         [[5], [6], [7]])
+
+        # only some columns used
+        self.assertEqual(query("select b, a from mem_pushdown where a = 3"), [['v0', 3]])
+
+        # ORDER BY
+        self.assertEqual(query("select a from mem_pushdown where a < 4 order by c desc"), [[3], [2], [1], [0]])
+        self.assertEqual(query("select a from mem_pushdown where a > 2 and a < 6 order by c"), [[4], [3], [5]])
+
+        QgsProject.instance().removeMapLayer(ml.id())
+
+    def test_order_by_pushdown(self):
+        """Test that ORDER BY clauses are only pushed down to providers able to compile them"""
+
+        for provider in (NoOrderByPyProvider, OrderByPyProvider):
+            QgsProviderRegistry.instance().registerProvider(QgsProviderMetadata(provider.providerKey(), provider.description(), provider.createProvider))
+
+        def query(sql):
+            df = QgsVirtualLayerDefinition()
+            df.setQuery(sql)
+            vl = QgsVectorLayer(df.toString(), "vl", "virtual")
+            self.assertEqual(vl.isValid(), True)
+            RecordingFeatureSource.order_bys = []
+            return [f.attributes() for f in vl.getFeatures()]
+
+        for provider, expect_pushdown in ((NoOrderByPyProvider, False), (OrderByPyProvider, True)):
+            pl = QgsVectorLayer("Point?crs=epsg:4326&field=a:integer&field=c:double", "py_orderby", provider.providerKey())
+            self.assertEqual(pl.isValid(), True)
+            self.assertEqual(bool(pl.dataProvider().capabilities() & QgsVectorDataProvider.OrderByCompilation), expect_pushdown)
+            features = []
+            for i, c in enumerate([3.5, 1.0, 4.25, 2.0, 0.5]):
+                f = QgsFeature(pl.fields())
+                f.setGeometry(QgsGeometry.fromWkt('POINT({} 0)'.format(i)))
+                f.setAttributes([i, c])
+                features.append(f)
+            self.assertEqual(pl.dataProvider().addFeatures(features)[0], True)
+            QgsProject.instance().addMapLayer(pl)
+
+            self.assertEqual(query("select a from py_orderby order by c"), [[4], [1], [3], [0], [2]])
+            self.assertEqual(RecordingFeatureSource.order_bys[-1], [('"c"', True)] if expect_pushdown else [])
+            self.assertEqual(query("select a from py_orderby where a > 0 order by c desc"), [[2], [3], [1], [4]])
+            self.assertEqual(RecordingFeatureSource.order_bys[-1], [('"c"', False)] if expect_pushdown else [])
+
+            QgsProject.instance().removeMapLayer(pl.id())
+
 
 if __name__ == '__main__':
     unittest.main()